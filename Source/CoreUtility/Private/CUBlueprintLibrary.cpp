@@ -431,6 +431,36 @@ float UCUBlueprintLibrary::MeasureTimerStop(const FString& Category /*= TEXT("Ti
 	return (float)FCUMeasureTimer::Tock(Category, bShouldLogResult);
 }
 
+bool UCUBlueprintLibrary::GetMeasureTimerStats(const FString& Category, FCUProfilerStats& OutStats)
+{
+	return FCUProfiler::GetStats(Category, OutStats);
+}
+
+TArray<FCUProfilerStats> UCUBlueprintLibrary::GetAllMeasureTimerStats()
+{
+	return FCUProfiler::GetAllStats();
+}
+
+float UCUBlueprintLibrary::GetMeasureTimerPercentile(const FString& Category, float Percentile /*= 0.99f*/)
+{
+	return (float)FCUProfiler::GetPercentileMs(Category, Percentile);
+}
+
+bool UCUBlueprintLibrary::ExportMeasureTimerCSV(const FString& FilePath)
+{
+	return FCUProfiler::ExportCSV(FilePath);
+}
+
+bool UCUBlueprintLibrary::ExportMeasureTimerJSON(const FString& FilePath)
+{
+	return FCUProfiler::ExportJSON(FilePath);
+}
+
+void UCUBlueprintLibrary::ResetMeasureTimerStats()
+{
+	FCUProfiler::Reset();
+}
+
 void UCUBlueprintLibrary::CallFunctionOnThread(const FString& FunctionName, ESIOCallbackType ThreadType, UObject* WorldContextObject /*= nullptr*/)
 {
 	UObject* Target = WorldContextObject;
@@ -111,3 +111,26 @@ bool UCUFileComponent::ReadBytesFromFile(const FString& Directory, const FString
 	// Allow overwriting or file doesn't already exist
 	return FFileHelper::LoadFileToArray(OutBytes, *AbsoluteFilePath);
 }
+
+bool UCUFileComponent::AppendBytesToFile(const TArray<uint8>& Bytes, const FString& Directory, const FString& FileName)
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+
+	if (!PlatformFile.CreateDirectoryTree(*Directory))
+	{
+		return false;
+	}
+	return AppendBufferToFile(Bytes.GetData(), Bytes.Num(), FPaths::ConvertRelativePathToFull(Directory / FileName));
+}
+
+bool UCUFileComponent::AppendBufferToFile(const uint8* Data, int64 Num, const FString& AbsoluteFilePath)
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+
+	TUniquePtr<IFileHandle> Handle(PlatformFile.OpenWrite(*AbsoluteFilePath, true));
+	if (!Handle)
+	{
+		return false;
+	}
+	return Num == 0 || Handle->Write(Data, Num);
+}
@@ -1,48 +1,51 @@
 #include "CUMeasureTimer.h"
-#include "HAL/PlatformTime.h"
-
-#if ENABLE_CUPRECISE_TIMER
-static TMap<FString, TSharedPtr<FCUMeasureTimer>> FPreciseTimerInternalMap;
-#endif
 
 void FCUMeasureTimer::Tick(const FString& LogMsg /*= TEXT("TimeTaken")*/)
 {
 #if ENABLE_CUPRECISE_TIMER
-	TSharedPtr<FCUMeasureTimer> Timer = MakeShareable(new FCUMeasureTimer);
-	FPreciseTimerInternalMap.Add(LogMsg, Timer);
-	Timer->Then = FPlatformTime::Seconds();	//start timer last so we don't measure anything else
+	//a second Tick without Tock restarts the timer, like the old start time map did
+	FCUProfiler::RestartScope(LogMsg);
 #endif
 }
 
 double FCUMeasureTimer::Tock(const FString& LogMsg /*= TEXT("TimeTaken")*/, bool bShouldLogResult /*= true*/)
 {
 #if ENABLE_CUPRECISE_TIMER
-	double Now = FPlatformTime::Seconds();
-	if (!FPreciseTimerInternalMap.Contains(LogMsg))
+	double Elapsed = FCUProfiler::EndScope(LogMsg);
+	if (Elapsed < 0.0)
 	{
-		UE_LOG(LogTemp, Warning, TEXT("FCUMeasureTimer::Tock error: <%s> no such category ticked."), *LogMsg);
+		UE_LOG(LogTemp, Warning, TEXT("FCUMeasureTimer::Tock error: <%s> no such category ticked on this thread."), *LogMsg);
 		return 0.0;
 	}
-	TSharedPtr<FCUMeasureTimer> Timer = FPreciseTimerInternalMap[LogMsg];
-	double Elapsed = (Now - Timer->Then) * 1000.0;
 	if (bShouldLogResult)
 	{
 		UE_LOG(LogTemp, Log, TEXT("%s %1.3f ms"), *LogMsg, Elapsed);
 	}
-	FPreciseTimerInternalMap.Remove(LogMsg);
+	return Elapsed;
 #else
 	return 0.0;
 #endif
-	return Elapsed;
 }
 
-FCUScopeTimer::FCUScopeTimer(const FString& LogMsg)
+#if ENABLE_CUPRECISE_TIMER
+FCUScopeTimer::FCUScopeTimer(const TCHAR* InLogMsg, bool bInShouldLogResult /*= true*/)
+	: FCUScopeTimer(FString(InLogMsg), bInShouldLogResult)
+{
+}
+
+FCUScopeTimer::FCUScopeTimer(const FString& InLogMsg, bool bInShouldLogResult /*= true*/)
 {
-	LogMessage = LogMsg;
-	FCUMeasureTimer::Tick(LogMsg);
+	Category = FCUProfiler::FindOrAddCategory(InLogMsg);
+	bShouldLogResult = bInShouldLogResult;
+	FCUProfiler::BeginScope(Category);
 }
 
 FCUScopeTimer::~FCUScopeTimer()
 {
-	FCUMeasureTimer::Tock(LogMessage);
+	double Elapsed = FCUProfiler::EndScope(Category);
+	if (bShouldLogResult && Elapsed >= 0.0)
+	{
+		UE_LOG(LogTemp, Log, TEXT("%s %1.3f ms"), *FCUProfiler::GetCategoryName(Category), Elapsed);
+	}
 }
+#endif
@@ -0,0 +1,593 @@
+// Copyright 2019-current Getnamo. All Rights Reserved
+
+
+#include "CUProfiler.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/PlatformTLS.h"
+#include "Misc/FileHelper.h"
+#include "Misc/ScopeLock.h"
+#include <atomic>
+
+const TCHAR* FCUProfiler::OverflowCategory = TEXT("<other>");
+
+namespace CUProfilerInternal
+{
+	//HDR style buckets over nanoseconds: below 2^SubBucketBits one bucket per value, above that
+	//SubBucketCount linear buckets per power of two, so a bucket is at most 1/16th of its value wide
+	const int32 SubBucketBits = 4;
+	const int32 SubBucketCount = 1 << SubBucketBits;
+	const int32 MaxMagnitude = 42;		//~73 minutes, longer durations share the last bucket
+	const int32 BucketCount = (MaxMagnitude - SubBucketBits + 2) * SubBucketCount;
+
+	int32 BucketForNanos(uint64 Nanos)
+	{
+		if (Nanos < SubBucketCount)
+		{
+			return (int32)Nanos;
+		}
+		const uint32 Magnitude = FMath::FloorLog2_64(Nanos);
+		if (Magnitude > MaxMagnitude)
+		{
+			return BucketCount - 1;
+		}
+		const uint32 Shift = Magnitude - SubBucketBits;
+		return (int32)((Shift + 1) * SubBucketCount + ((Nanos >> Shift) - SubBucketCount));
+	}
+
+	//Middle of the values a bucket holds
+	double BucketMidNanos(int32 Index)
+	{
+		if (Index < SubBucketCount)
+		{
+			return (double)Index;
+		}
+		const int32 Shift = Index / SubBucketCount - 1;
+		const uint64 Low = uint64(Index % SubBucketCount + SubBucketCount) << Shift;
+		return (double)Low + (double)((uint64(1) << Shift) - 1) * 0.5;
+	}
+
+	/** Written by the owning thread only, relaxed atomics so readers never see torn values */
+	struct FHistogramCell
+	{
+		std::atomic<uint64> Count;
+		std::atomic<uint64> SumNanos;
+		std::atomic<uint64> MaxNanos;
+		std::atomic<uint64> Buckets[BucketCount];
+
+		FHistogramCell()
+		{
+			Clear();
+		}
+
+		void Clear()
+		{
+			Count.store(0, std::memory_order_relaxed);
+			SumNanos.store(0, std::memory_order_relaxed);
+			MaxNanos.store(0, std::memory_order_relaxed);
+			for (std::atomic<uint64>& Bucket : Buckets)
+			{
+				Bucket.store(0, std::memory_order_relaxed);
+			}
+		}
+
+		void Record(uint64 Nanos)
+		{
+			Count.fetch_add(1, std::memory_order_relaxed);
+			SumNanos.fetch_add(Nanos, std::memory_order_relaxed);
+			Buckets[BucketForNanos(Nanos)].fetch_add(1, std::memory_order_relaxed);
+			if (Nanos > MaxNanos.load(std::memory_order_relaxed))
+			{
+				MaxNanos.store(Nanos, std::memory_order_relaxed);
+			}
+		}
+	};
+
+	/** Sum of every thread's cell for one category */
+	struct FHistogram
+	{
+		uint64 Count = 0;
+		uint64 SumNanos = 0;
+		uint64 MaxNanos = 0;
+		TArray<uint64> Buckets;
+
+		FHistogram()
+		{
+			Buckets.SetNumZeroed(BucketCount);
+		}
+
+		void Add(const FHistogramCell& Cell)
+		{
+			Count += Cell.Count.load(std::memory_order_relaxed);
+			SumNanos += Cell.SumNanos.load(std::memory_order_relaxed);
+			MaxNanos = FMath::Max(MaxNanos, Cell.MaxNanos.load(std::memory_order_relaxed));
+			for (int32 i = 0; i < BucketCount; i++)
+			{
+				Buckets[i] += Cell.Buckets[i].load(std::memory_order_relaxed);
+			}
+		}
+
+		double PercentileNanos(double Fraction) const
+		{
+			if (Count == 0)
+			{
+				return 0.0;
+			}
+			const uint64 Rank = FMath::Max<uint64>(1, (uint64)FMath::CeilToDouble(FMath::Clamp(Fraction, 0.0, 1.0) * (double)Count));
+			uint64 Seen = 0;
+			for (int32 i = 0; i < BucketCount; i++)
+			{
+				Seen += Buckets[i];
+				if (Seen >= Rank)
+				{
+					return FMath::Min(BucketMidNanos(i), (double)MaxNanos);
+				}
+			}
+			return (double)MaxNanos;
+		}
+	};
+
+	/** Info packs category, depth and thread id so a slot is three atomic stores */
+	struct FScopeRecord
+	{
+		std::atomic<uint64> Info;
+		std::atomic<uint64> StartCycles;
+		std::atomic<uint64> EndCycles;
+	};
+
+	uint64 PackInfo(int32 Category, int32 Depth, uint32 ThreadId)
+	{
+		return (uint64(ThreadId) << 32) | (uint64(FMath::Min(Depth, 0xFFFF)) << 16) | uint64(Category & 0xFFFF);
+	}
+
+	struct FOpenScope
+	{
+		int32 Category;
+		uint64 StartCycles;
+	};
+
+	struct FThreadState
+	{
+		std::atomic<uint32> ThreadId;
+		std::atomic<bool> bRetired;
+
+		//Published by the owner with a release store the first time it records the category
+		std::atomic<FHistogramCell*> Cells[FCUProfiler::MaxCategories];
+
+		FScopeRecord Ring[FCUProfiler::ScopeBufferSize];
+		std::atomic<uint64> Head;		//scopes ever written, Ring[Head % size] is written next
+		std::atomic<uint64> ResetHead;	//Head at the last Reset, older scopes are hidden from readers
+
+		//owner only
+		TArray<FOpenScope> Open;
+		TMap<FString, int32> CategoryCache;
+
+		FThreadState()
+		{
+			ThreadId.store(0, std::memory_order_relaxed);
+			bRetired.store(false, std::memory_order_relaxed);
+			for (std::atomic<FHistogramCell*>& Cell : Cells)
+			{
+				Cell.store(nullptr, std::memory_order_relaxed);
+			}
+			Head.store(0, std::memory_order_relaxed);
+			ResetHead.store(0, std::memory_order_relaxed);
+		}
+
+		~FThreadState()
+		{
+			for (std::atomic<FHistogramCell*>& Cell : Cells)
+			{
+				delete Cell.load(std::memory_order_relaxed);
+			}
+		}
+
+		FHistogramCell& GetCell(int32 Category)
+		{
+			FHistogramCell* Cell = Cells[Category].load(std::memory_order_relaxed);
+			if (!Cell)
+			{
+				Cell = new FHistogramCell();
+				Cells[Category].store(Cell, std::memory_order_release);
+			}
+			return *Cell;
+		}
+
+		void Record(int32 Category, int32 Depth, uint64 StartCycles, uint64 EndCycles, double SecondsPerCycle)
+		{
+			GetCell(Category).Record((uint64)((double)(EndCycles - StartCycles) * SecondsPerCycle * 1e9));
+
+			const uint64 Index = Head.load(std::memory_order_relaxed);
+			FScopeRecord& Slot = Ring[Index % FCUProfiler::ScopeBufferSize];
+			Slot.Info.store(PackInfo(Category, Depth, ThreadId.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+			Slot.StartCycles.store(StartCycles, std::memory_order_relaxed);
+			Slot.EndCycles.store(EndCycles, std::memory_order_relaxed);
+			Head.store(Index + 1, std::memory_order_release);
+		}
+	};
+
+	/** Registration and readers only, recording stays on FThreadState */
+	struct FRegistry
+	{
+		FCriticalSection Lock;
+		TMap<FString, int32> CategoryIndices;
+		TArray<FString> CategoryNames;
+		TArray<FThreadState*> Threads;		//never freed, exited threads hand theirs to the next new thread
+		const uint64 StartCycles;
+		const double SecondsPerCycle;
+
+		FRegistry()
+			: StartCycles(FPlatformTime::Cycles64())
+			, SecondsPerCycle(FPlatformTime::GetSecondsPerCycle64())
+		{
+			AddCategory(FCUProfiler::OverflowCategory);
+		}
+
+		int32 AddCategory(const FString& Category)
+		{
+			FScopeLock ScopeLock(&Lock);
+			if (const int32* Existing = CategoryIndices.Find(Category))
+			{
+				return *Existing;
+			}
+			if (CategoryNames.Num() >= FCUProfiler::MaxCategories)
+			{
+				return 0;
+			}
+			const int32 Index = CategoryNames.Add(Category);
+			CategoryIndices.Add(Category, Index);
+			return Index;
+		}
+
+		FThreadState* AcquireThreadState()
+		{
+			FScopeLock ScopeLock(&Lock);
+			FThreadState* State = nullptr;
+			for (FThreadState* Candidate : Threads)
+			{
+				if (Candidate->bRetired.load(std::memory_order_acquire))
+				{
+					State = Candidate;
+					break;
+				}
+			}
+			if (!State)
+			{
+				State = new FThreadState();
+				Threads.Add(State);
+			}
+			State->ThreadId.store(FPlatformTLS::GetCurrentThreadId(), std::memory_order_relaxed);
+			State->bRetired.store(false, std::memory_order_relaxed);
+			return State;
+		}
+
+		bool Histogram(int32 Category, FHistogram& OutHistogram)
+		{
+			FScopeLock ScopeLock(&Lock);
+			bool bFound = false;
+			for (FThreadState* State : Threads)
+			{
+				if (FHistogramCell* Cell = State->Cells[Category].load(std::memory_order_acquire))
+				{
+					OutHistogram.Add(*Cell);
+					bFound = true;
+				}
+			}
+			return bFound;
+		}
+	};
+
+	//Leaked on purpose, threads may still record while statics are torn down
+	FRegistry& Registry()
+	{
+		static FRegistry* Instance = new FRegistry();
+		return *Instance;
+	}
+
+	/** Gives the state back when its thread exits */
+	struct FThreadHandle
+	{
+		FThreadState* State = nullptr;
+
+		~FThreadHandle()
+		{
+			if (State)
+			{
+				State->Open.Reset();
+				State->bRetired.store(true, std::memory_order_release);
+			}
+		}
+	};
+
+	FThreadState& LocalState()
+	{
+		static thread_local FThreadHandle Handle;
+		if (!Handle.State)
+		{
+			Handle.State = Registry().AcquireThreadState();
+		}
+		return *Handle.State;
+	}
+
+	FCUProfilerStats ToStats(const FString& Category, const FHistogram& Histogram)
+	{
+		FCUProfilerStats Stats;
+		Stats.Category = Category;
+		Stats.Count = (int64)Histogram.Count;
+		Stats.TotalMs = (float)(Histogram.SumNanos / 1e6);
+		Stats.MeanMs = Histogram.Count > 0 ? (float)(Histogram.SumNanos / 1e6 / (double)Histogram.Count) : 0.f;
+		Stats.P50Ms = (float)(Histogram.PercentileNanos(0.5) / 1e6);
+		Stats.P90Ms = (float)(Histogram.PercentileNanos(0.9) / 1e6);
+		Stats.P99Ms = (float)(Histogram.PercentileNanos(0.99) / 1e6);
+		Stats.MaxMs = (float)(Histogram.MaxNanos / 1e6);
+		return Stats;
+	}
+
+	FString EscapeJson(const FString& InString)
+	{
+		FString Escaped = InString.Replace(TEXT("\\"), TEXT("\\\\"));
+		Escaped.ReplaceInline(TEXT("\""), TEXT("\\\""));
+		return Escaped;
+	}
+}
+
+using namespace CUProfilerInternal;
+
+int32 FCUProfiler::FindOrAddCategory(const FString& Category)
+{
+	FThreadState& State = LocalState();
+	if (const int32* Cached = State.CategoryCache.Find(Category))
+	{
+		return *Cached;
+	}
+	const int32 Index = Registry().AddCategory(Category);
+	State.CategoryCache.Add(Category, Index);
+	return Index;
+}
+
+FString FCUProfiler::GetCategoryName(int32 CategoryIndex)
+{
+	FRegistry& Reg = Registry();
+	FScopeLock ScopeLock(&Reg.Lock);
+	return Reg.CategoryNames.IsValidIndex(CategoryIndex) ? Reg.CategoryNames[CategoryIndex] : FString();
+}
+
+void FCUProfiler::BeginScope(int32 CategoryIndex)
+{
+	if (CategoryIndex < 0 || CategoryIndex >= MaxCategories)
+	{
+		return;
+	}
+	//start the clock last so we don't measure anything else
+	FThreadState& State = LocalState();
+	FOpenScope& Scope = State.Open.AddDefaulted_GetRef();
+	Scope.Category = CategoryIndex;
+	Scope.StartCycles = FPlatformTime::Cycles64();
+}
+
+void FCUProfiler::BeginScope(const FString& Category)
+{
+	BeginScope(FindOrAddCategory(Category));
+}
+
+void FCUProfiler::RestartScope(int32 CategoryIndex)
+{
+	if (CategoryIndex < 0 || CategoryIndex >= MaxCategories)
+	{
+		return;
+	}
+	FThreadState& State = LocalState();
+	for (int32 Depth = State.Open.Num() - 1; Depth >= 0; Depth--)
+	{
+		if (State.Open[Depth].Category == CategoryIndex)
+		{
+			State.Open[Depth].StartCycles = FPlatformTime::Cycles64();
+			return;
+		}
+	}
+	BeginScope(CategoryIndex);
+}
+
+void FCUProfiler::RestartScope(const FString& Category)
+{
+	RestartScope(FindOrAddCategory(Category));
+}
+
+double FCUProfiler::EndScope(int32 CategoryIndex)
+{
+	const uint64 EndCycles = FPlatformTime::Cycles64();
+	FThreadState& State = LocalState();
+
+	for (int32 Depth = State.Open.Num() - 1; Depth >= 0; Depth--)
+	{
+		if (State.Open[Depth].Category == CategoryIndex)
+		{
+			const uint64 StartCycles = State.Open[Depth].StartCycles;
+			State.Open.RemoveAt(Depth, 1, false);
+
+			const double SecondsPerCycle = Registry().SecondsPerCycle;
+			State.Record(CategoryIndex, Depth, StartCycles, EndCycles, SecondsPerCycle);
+			return (double)(EndCycles - StartCycles) * SecondsPerCycle * 1000.0;
+		}
+	}
+	return -1.0;
+}
+
+double FCUProfiler::EndScope(const FString& Category)
+{
+	return EndScope(FindOrAddCategory(Category));
+}
+
+void FCUProfiler::Record(int32 CategoryIndex, double Milliseconds)
+{
+	if (CategoryIndex < 0 || CategoryIndex >= MaxCategories)
+	{
+		return;
+	}
+	LocalState().GetCell(CategoryIndex).Record((uint64)FMath::Max(0.0, Milliseconds * 1e6));
+}
+
+bool FCUProfiler::GetStats(const FString& Category, FCUProfilerStats& OutStats)
+{
+	FRegistry& Reg = Registry();
+	int32 Index;
+	{
+		FScopeLock ScopeLock(&Reg.Lock);
+		const int32* Found = Reg.CategoryIndices.Find(Category);
+		if (!Found)
+		{
+			return false;
+		}
+		Index = *Found;
+	}
+	FHistogram Histogram;
+	if (!Reg.Histogram(Index, Histogram))
+	{
+		return false;
+	}
+	OutStats = ToStats(Category, Histogram);
+	return true;
+}
+
+TArray<FCUProfilerStats> FCUProfiler::GetAllStats()
+{
+	FRegistry& Reg = Registry();
+	TArray<FString> Names;
+	{
+		FScopeLock ScopeLock(&Reg.Lock);
+		Names = Reg.CategoryNames;
+	}
+
+	TArray<FCUProfilerStats> AllStats;
+	for (int32 Index = 0; Index < Names.Num(); Index++)
+	{
+		FHistogram Histogram;
+		if (Reg.Histogram(Index, Histogram))
+		{
+			AllStats.Add(ToStats(Names[Index], Histogram));
+		}
+	}
+	return AllStats;
+}
+
+double FCUProfiler::GetPercentileMs(const FString& Category, double Percentile)
+{
+	FRegistry& Reg = Registry();
+	int32 Index;
+	{
+		FScopeLock ScopeLock(&Reg.Lock);
+		const int32* Found = Reg.CategoryIndices.Find(Category);
+		if (!Found)
+		{
+			return 0.0;
+		}
+		Index = *Found;
+	}
+	FHistogram Histogram;
+	Reg.Histogram(Index, Histogram);
+	return Histogram.PercentileNanos(Percentile) / 1e6;
+}
+
+TArray<FCUProfilerScope> FCUProfiler::GetRecentScopes()
+{
+	FRegistry& Reg = Registry();
+	FScopeLock ScopeLock(&Reg.Lock);
+
+	struct FRawScope
+	{
+		uint64 Info;
+		uint64 StartCycles;
+		uint64 EndCycles;
+	};
+
+	TArray<FCUProfilerScope> Scopes;
+	TArray<FRawScope> Raw;
+	for (FThreadState* State : Reg.Threads)
+	{
+		const uint64 Head = State->Head.load(std::memory_order_acquire);
+		const uint64 First = FMath::Max(Head > (uint64)ScopeBufferSize ? Head - ScopeBufferSize : 0, State->ResetHead.load(std::memory_order_relaxed));
+
+		Raw.Reset();
+		for (uint64 Index = First; Index < Head; Index++)
+		{
+			const FScopeRecord& Slot = State->Ring[Index % ScopeBufferSize];
+			Raw.Add({ Slot.Info.load(std::memory_order_relaxed), Slot.StartCycles.load(std::memory_order_relaxed), Slot.EndCycles.load(std::memory_order_relaxed) });
+		}
+
+		//the owner kept writing while we copied, drop the slots it may have overwritten
+		std::atomic_thread_fence(std::memory_order_acquire);
+		const uint64 HeadAfter = State->Head.load(std::memory_order_relaxed);
+		const uint64 FirstValid = HeadAfter >= (uint64)ScopeBufferSize ? HeadAfter - ScopeBufferSize + 1 : 0;
+
+		for (int32 i = 0; i < Raw.Num(); i++)
+		{
+			if (First + i < FirstValid)
+			{
+				continue;
+			}
+			const FRawScope& Record = Raw[i];
+			const int32 Category = (int32)(Record.Info & 0xFFFF);
+			FCUProfilerScope& Scope = Scopes.AddDefaulted_GetRef();
+			Scope.Category = Reg.CategoryNames.IsValidIndex(Category) ? Reg.CategoryNames[Category] : FString();
+			Scope.ThreadId = (uint32)(Record.Info >> 32);
+			Scope.Depth = (int32)((Record.Info >> 16) & 0xFFFF);
+			Scope.StartMs = (double)(int64)(Record.StartCycles - Reg.StartCycles) * Reg.SecondsPerCycle * 1000.0;
+			Scope.DurationMs = (double)(Record.EndCycles - Record.StartCycles) * Reg.SecondsPerCycle * 1000.0;
+		}
+	}
+
+	Scopes.Sort([](const FCUProfilerScope& A, const FCUProfilerScope& B)
+	{
+		return A.StartMs < B.StartMs;
+	});
+	return Scopes;
+}
+
+bool FCUProfiler::ExportCSV(const FString& FilePath)
+{
+	FString Csv = TEXT("Category,Count,TotalMs,MeanMs,P50Ms,P90Ms,P99Ms,MaxMs\n");
+	for (const FCUProfilerStats& Stats : GetAllStats())
+	{
+		Csv += FString::Printf(TEXT("\"%s\",%lld,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n"),
+			*Stats.Category.Replace(TEXT("\""), TEXT("\"\"")), Stats.Count, Stats.TotalMs, Stats.MeanMs, Stats.P50Ms, Stats.P90Ms, Stats.P99Ms, Stats.MaxMs);
+	}
+	return FFileHelper::SaveStringToFile(Csv, *FilePath);
+}
+
+bool FCUProfiler::ExportJSON(const FString& FilePath)
+{
+	TArray<FString> Categories;
+	for (const FCUProfilerStats& Stats : GetAllStats())
+	{
+		Categories.Add(FString::Printf(TEXT("{\"category\":\"%s\",\"count\":%lld,\"totalMs\":%.3f,\"meanMs\":%.3f,\"p50Ms\":%.3f,\"p90Ms\":%.3f,\"p99Ms\":%.3f,\"maxMs\":%.3f}"),
+			*EscapeJson(Stats.Category), Stats.Count, Stats.TotalMs, Stats.MeanMs, Stats.P50Ms, Stats.P90Ms, Stats.P99Ms, Stats.MaxMs));
+	}
+
+	//complete ('X') events in microseconds, the layout chrome://tracing and Perfetto load directly
+	TArray<FString> Events;
+	for (const FCUProfilerScope& Scope : GetRecentScopes())
+	{
+		Events.Add(FString::Printf(TEXT("{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"depth\":%d}}"),
+			*EscapeJson(Scope.Category), Scope.ThreadId, Scope.StartMs * 1000.0, Scope.DurationMs * 1000.0, Scope.Depth));
+	}
+
+	const FString Json = FString::Printf(TEXT("{\"categories\":[%s],\"traceEvents\":[%s]}"),
+		*FString::Join(Categories, TEXT(",")), *FString::Join(Events, TEXT(",")));
+	return FFileHelper::SaveStringToFile(Json, *FilePath);
+}
+
+void FCUProfiler::Reset()
+{
+	FRegistry& Reg = Registry();
+	FScopeLock ScopeLock(&Reg.Lock);
+	for (FThreadState* State : Reg.Threads)
+	{
+		for (std::atomic<FHistogramCell*>& Cell : State->Cells)
+		{
+			if (FHistogramCell* Existing = Cell.load(std::memory_order_acquire))
+			{
+				Existing->Clear();
+			}
+		}
+		State->ResetHead.store(State->Head.load(std::memory_order_acquire), std::memory_order_relaxed);
+	}
+}
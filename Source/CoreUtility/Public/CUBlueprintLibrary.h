@@ -6,6 +6,7 @@
 #include "Kismet/BlueprintFunctionLibrary.h"
 #include "Async/Future.h"
 #include "Engine/Classes/Sound/SoundWaveProcedural.h"
+#include "CUProfiler.h"
 #include "CUBlueprintLibrary.generated.h"
 
 /** Wrapper for EImageFormat::Type for BP */
@@ -160,6 +161,33 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "CoreUtility|Misc")
 	static float MeasureTimerStop(const FString& Category = TEXT("TimeTaken"), bool bShouldLogResult = true);
 
+	/**
+	* Count, mean, percentiles and max of every measurement taken for this category, on any thread.
+	* Returns false if the category was never measured.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "CoreUtility|Profiler")
+	static bool GetMeasureTimerStats(const FString& Category, FCUProfilerStats& OutStats);
+
+	/** Stats of every measured category */
+	UFUNCTION(BlueprintCallable, Category = "CoreUtility|Profiler")
+	static TArray<FCUProfilerStats> GetAllMeasureTimerStats();
+
+	/** Duration in milliseconds below which the given fraction (0-1) of this category's measurements fall */
+	UFUNCTION(BlueprintPure, Category = "CoreUtility|Profiler")
+	static float GetMeasureTimerPercentile(const FString& Category, float Percentile = 0.99f);
+
+	/** Writes one CSV row of stats per category */
+	UFUNCTION(BlueprintCallable, Category = "CoreUtility|Profiler")
+	static bool ExportMeasureTimerCSV(const FString& FilePath);
+
+	/** Writes category stats and recent scopes as JSON, loadable in chrome://tracing or Perfetto */
+	UFUNCTION(BlueprintCallable, Category = "CoreUtility|Profiler")
+	static bool ExportMeasureTimerJSON(const FString& FilePath);
+
+	/** Clears all collected measurement stats */
+	UFUNCTION(BlueprintCallable, Category = "CoreUtility|Profiler")
+	static void ResetMeasureTimerStats();
+
 	/** 
 	*	Calls function by name given calling context on thread specified. Use e.g. delay (0) to return to game thread
 	*	or use game thread callback for threadtype. This allows you to run certain functions on a background thread or
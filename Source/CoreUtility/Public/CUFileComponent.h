@@ -44,4 +44,11 @@ public:
 	/** Read array of bytes from file at specified directory */
 	UFUNCTION(BlueprintCallable, Category = FileUtility)
 	bool ReadBytesFromFile(const FString& Directory, const FString& FileName, TArray<uint8>& OutBytes);
+
+	/** Append array of bytes to file at specified directory, creating it if needed */
+	UFUNCTION(BlueprintCallable, Category = FileUtility)
+	bool AppendBytesToFile(const TArray<uint8>& Bytes, const FString& Directory, const FString& FileName);
+
+	/** Append raw bytes to an absolute file path. Thread safe, usable without a component instance. */
+	static bool AppendBufferToFile(const uint8* Data, int64 Num, const FString& AbsoluteFilePath);
 };
\ No newline at end of file
@@ -3,14 +3,14 @@
 
 #pragma once
 #include "CoreMinimal.h"
+#include "CUProfiler.h"
 
-//Toggle to enable/disable timing code logs
-#define ENABLE_CUPRECISE_TIMER 1
-
-/** 
+/**
 *	C++ Utility Timer class. Multiple categories can be used simultaneously.
+*	Thread safe, each thread times its own categories. Every duration also ends up
+*	in FCUProfiler's stats for the category.
 *
-*	Usage: 
+*	Usage:
 *	FCUMeasureTimer::Tick(TEXT("MyMeasurementCategory"));
 *	//Your code
 *	FCUMeasureTimer::Tock(TEXT("MyMeasurementCategory")); //This will log the time taken in miliseconds
@@ -22,7 +22,7 @@ class COREUTILITY_API FCUMeasureTimer
 {
 public:
 	/**
-	*	Start a timer for given category
+	*	Start a timer for given category on the calling thread, restarts it if already running
 	*/
 	static void Tick(const FString& LogMsg = TEXT("TimeTaken"));
 
@@ -30,13 +30,10 @@ public:
 	*	Returns time taken in milliseconds (to micro precision). This function will also log the time taken
 	*/
 	static double Tock(const FString& LogMsg = TEXT("TimeTaken"), bool bShouldLogResult = true);
-
-private:
-	double Then;
 };
 
-/** 
-*	Wrapper for FCUMeasureTimer calls. 
+/**
+*	Wrapper for FCUMeasureTimer calls. Compiles to nothing without ENABLE_CUPRECISE_TIMER.
 *
 *	Usage:
 *	{
@@ -51,8 +48,15 @@ private:
 class COREUTILITY_API FCUScopeTimer
 {
 public:
-	FCUScopeTimer(const FString& InLogMsg);
+#if ENABLE_CUPRECISE_TIMER
+	FCUScopeTimer(const TCHAR* InLogMsg, bool bInShouldLogResult = true);
+	FCUScopeTimer(const FString& InLogMsg, bool bInShouldLogResult = true);
 	~FCUScopeTimer();
 private:
-	FString LogMessage;
-};
\ No newline at end of file
+	int32 Category;
+	bool bShouldLogResult;
+#else
+	FCUScopeTimer(const TCHAR* InLogMsg, bool bInShouldLogResult = true) {}
+	FCUScopeTimer(const FString& InLogMsg, bool bInShouldLogResult = true) {}
+#endif
+};
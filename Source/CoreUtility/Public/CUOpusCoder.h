@@ -20,7 +20,7 @@ struct FCUOpusMinimalStream
 Symmetric coder for e.g. voip written from raw libopus due to how hidden the opus 
 coder is in the engine (this one doesn't require an online subsystem)
 */
-class FCUOpusCoder
+class COREUTILITY_API FCUOpusCoder
 {
 public:
 	FCUOpusCoder();
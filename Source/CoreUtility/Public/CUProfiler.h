@@ -0,0 +1,129 @@
+// Copyright 2019-current Getnamo. All Rights Reserved
+
+
+#pragma once
+#include "CoreMinimal.h"
+#include "CUProfiler.generated.h"
+
+//Toggle to compile FCUScopeTimer/FCUMeasureTimer down to nothing
+#ifndef ENABLE_CUPRECISE_TIMER
+#define ENABLE_CUPRECISE_TIMER 1
+#endif
+
+/** Duration summary of one profiler category, all threads combined */
+USTRUCT(BlueprintType)
+struct COREUTILITY_API FCUProfilerStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "CoreUtility|Profiler")
+	FString Category;
+
+	UPROPERTY(BlueprintReadOnly, Category = "CoreUtility|Profiler")
+	int64 Count = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "CoreUtility|Profiler")
+	float TotalMs = 0.f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "CoreUtility|Profiler")
+	float MeanMs = 0.f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "CoreUtility|Profiler")
+	float P50Ms = 0.f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "CoreUtility|Profiler")
+	float P90Ms = 0.f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "CoreUtility|Profiler")
+	float P99Ms = 0.f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "CoreUtility|Profiler")
+	float MaxMs = 0.f;
+};
+
+/** One finished scope from a thread's recent history */
+struct COREUTILITY_API FCUProfilerScope
+{
+	FString Category;
+	uint32 ThreadId = 0;
+	int32 Depth = 0;			//open scopes of the same thread around this one
+	double StartMs = 0.0;		//since the profiler started
+	double DurationMs = 0.0;
+};
+
+/**
+*	Thread safe hierarchical profiler behind FCUMeasureTimer and FCUScopeTimer.
+*
+*	Each thread keeps its own stack of open scopes, a ring of its last ScopeBufferSize
+*	finished scopes and per category histograms whose percentiles are within ~3%
+*	(HDR style log-linear buckets, each at most 1/16th of its value wide, reported
+*	at their middle). Recording never locks or shares a cache line with another
+*	thread; locks are only taken the first time a thread or category is seen, and
+*	by readers.
+*
+*	Usage:
+*	FCUProfiler::BeginScope(TEXT("Decode"));
+*	//Your code
+*	double Ms = FCUProfiler::EndScope(TEXT("Decode"));
+*
+*	FCUProfilerStats Stats;
+*	FCUProfiler::GetStats(TEXT("Decode"), Stats);
+*/
+class COREUTILITY_API FCUProfiler
+{
+public:
+	/** Categories past this count are recorded under OverflowCategory */
+	static const int32 MaxCategories = 512;
+
+	/** Finished scopes kept per thread for GetRecentScopes/ExportJSON */
+	static const int32 ScopeBufferSize = 4096;
+
+	static const TCHAR* OverflowCategory;
+
+	/** Stable index for the category, cache it to skip the per thread name lookup */
+	static int32 FindOrAddCategory(const FString& Category);
+
+	static FString GetCategoryName(int32 CategoryIndex);
+
+	/** Opens a scope on the calling thread, scopes may nest */
+	static void BeginScope(int32 CategoryIndex);
+	static void BeginScope(const FString& Category);
+
+	/**
+	*	Restarts the innermost open scope of this category on the calling thread, or opens
+	*	one if there is none. Start/stop style callers (FCUMeasureTimer::Tick) that may
+	*	start again without stopping use this, so the scope stack can't grow without bound.
+	*/
+	static void RestartScope(int32 CategoryIndex);
+	static void RestartScope(const FString& Category);
+
+	/**
+	*	Closes the innermost open scope of this category on the calling thread.
+	*	Returns its duration in milliseconds, or a negative value if none was open.
+	*/
+	static double EndScope(int32 CategoryIndex);
+	static double EndScope(const FString& Category);
+
+	/** Adds a duration measured elsewhere to the category's histogram */
+	static void Record(int32 CategoryIndex, double Milliseconds);
+
+	/** False if the category was never recorded */
+	static bool GetStats(const FString& Category, FCUProfilerStats& OutStats);
+
+	static TArray<FCUProfilerStats> GetAllStats();
+
+	/** Duration in ms below which the given fraction (0-1) of the category's samples fall */
+	static double GetPercentileMs(const FString& Category, double Percentile);
+
+	/** Recently finished scopes of all threads, ordered by start time */
+	static TArray<FCUProfilerScope> GetRecentScopes();
+
+	/** One row per category with count, total, mean, percentiles and max */
+	static bool ExportCSV(const FString& FilePath);
+
+	/** Category stats plus recent scopes as chrome://tracing / Perfetto trace events */
+	static bool ExportJSON(const FString& FilePath);
+
+	/** Clears histograms and recent scopes, samples recorded concurrently may be lost */
+	static void Reset();
+};
@@ -12,6 +12,14 @@
 #include "JsonObjectConverter.h"
 #include "UObject/PropertyPortFlags.h"
 #include "Misc/Base64.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "HAL/LowLevelMemTracker.h"
+#include "Stats/Stats.h"
+
+//FJsonValue trees parsed or converted here, SIOJson doesn't see SocketIOLib's tags so it gets its own
+DECLARE_LLM_MEMORY_STAT(TEXT("SIOJson"), STAT_SIOJsonLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("SIOJson"), STAT_SIOJsonSummaryLLM, STATGROUP_LLM);
+LLM_DEFINE_TAG(SIOJson, NAME_None, NAME_None, GET_STATFNAME(STAT_SIOJsonLLM), GET_STATFNAME(STAT_SIOJsonSummaryLLM));
 
 typedef TJsonWriterFactory< TCHAR, TCondensedJsonPrintPolicy<TCHAR> > FCondensedJsonStringWriterFactory;
 typedef TJsonWriter< TCHAR, TCondensedJsonPrintPolicy<TCHAR> > FCondensedJsonStringWriter;
@@ -633,6 +641,8 @@ USIOJsonValue* USIOJConvert::ToSIOJsonValue(const TArray<TSharedPtr<FJsonValue>>
 
 TSharedPtr<FJsonValue> USIOJConvert::JsonStringToJsonValue(const FString& JsonString)
 {
+	LLM_SCOPE_BYTAG(SIOJson);
+
 	//Null
 	if (JsonString.IsEmpty())
 	{
@@ -713,6 +723,7 @@ TSharedPtr<FJsonValue> USIOJConvert::ToJsonValue(const TArray<TSharedPtr<FJsonVa
 
 TArray<TSharedPtr<FJsonValue>> USIOJConvert::JsonStringToJsonArray(const FString& JsonString)
 {
+	LLM_SCOPE_BYTAG(SIOJson);
 	TArray < TSharedPtr<FJsonValue>> RawJsonValueArray;
 	TSharedRef< TJsonReader<> > Reader = TJsonReaderFactory<>::Create(*JsonString);
 	FJsonSerializer::Deserialize(Reader, RawJsonValueArray);
@@ -722,6 +733,7 @@ TArray<TSharedPtr<FJsonValue>> USIOJConvert::JsonStringToJsonArray(const FString
 
 TSharedPtr<FJsonObject> USIOJConvert::ToJsonObject(const FString& JsonString)
 {
+	LLM_SCOPE_BYTAG(SIOJson);
 	TSharedPtr< FJsonObject > JsonObject = MakeShareable(new FJsonObject);
 	TSharedRef< TJsonReader<> > Reader = TJsonReaderFactory<>::Create(*JsonString);
 	FJsonSerializer::Deserialize(Reader, JsonObject);
@@ -732,6 +744,9 @@ TSharedPtr<FJsonObject> USIOJConvert::ToJsonObject(const FString& JsonString)
 
 TSharedPtr<FJsonObject> USIOJConvert::ToJsonObject(UStruct* StructDefinition, void* StructPtr, bool IsBlueprintStruct, bool BinaryStructCppSupport /*= false */)
 {
+	TRACE_CPUPROFILER_EVENT_SCOPE(SIOJ_StructToJsonObject);
+	LLM_SCOPE_BYTAG(SIOJson);
+
 	TSharedRef<FJsonObject> JsonObject = MakeShareable(new FJsonObject);
 
 	if (IsBlueprintStruct || BinaryStructCppSupport)
@@ -801,6 +816,9 @@ TSharedPtr<FJsonObject> USIOJConvert::MakeJsonObject()
 
 bool USIOJConvert::JsonObjectToUStruct(TSharedPtr<FJsonObject> JsonObject, UStruct* Struct, void* StructPtr, bool IsBlueprintStruct /*= false*/, bool BinaryStructCppSupport /*= false*/)
 {
+	TRACE_CPUPROFILER_EVENT_SCOPE(SIOJ_JsonObjectToStruct);
+	LLM_SCOPE_BYTAG(SIOJson);
+
 	if (IsBlueprintStruct || BinaryStructCppSupport)
 	{
 		//Json object we pass will have their trimmed BP names, e.g. boolKey vs boolKey_8_EDBB36654CF43866C376DE921373AF23
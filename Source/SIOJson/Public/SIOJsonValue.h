@@ -36,6 +36,7 @@ class SIOJSON_API FJsonValueBinary : public FJsonValue
 {
 public:
 	FJsonValueBinary(const TArray<uint8>& InBinary) : Value(InBinary) { Type = EJson::String; }	//pretends to be none
+	FJsonValueBinary(TArray<uint8>&& InBinary) : Value(MoveTemp(InBinary)) { Type = EJson::String; }
 
 	virtual bool TryGetString(FString& OutString) const override 
 	{
@@ -55,6 +56,9 @@ public:
 	/** Return our binary data from this value */
 	TArray<uint8> AsBinary() { return Value; }
 
+	/** Access our binary data without copying it */
+	const TArray<uint8>& GetBinary() const { return Value; }
+
 	/** Convenience method to determine if passed FJsonValue is a FJsonValueBinary or not. */
 	static bool IsBinary(const TSharedPtr<FJsonValue>& InJsonValue);
 
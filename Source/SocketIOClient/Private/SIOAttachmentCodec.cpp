@@ -0,0 +1,61 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+
+
+#include "SIOAttachmentCodec.h"
+#include "SIOMessageConvert.h"
+#include "Misc/Compression.h"
+
+FSIOAttachmentCodec::FSIOAttachmentCodec(ESIOAttachmentCodec InCodec)
+{
+	FormatName = InCodec == ESIOAttachmentCodec::ZLIB ? NAME_Zlib : NAME_LZ4;
+	Name = USIOMessageConvert::StdString(CodecName(InCodec));
+}
+
+FString FSIOAttachmentCodec::CodecName(ESIOAttachmentCodec InCodec)
+{
+	switch (InCodec)
+	{
+	case ESIOAttachmentCodec::LZ4:
+		return TEXT("lz4");
+	case ESIOAttachmentCodec::ZLIB:
+		return TEXT("zlib");
+	default:
+		return TEXT("none");
+	}
+}
+
+std::string const& FSIOAttachmentCodec::get_name() const
+{
+	return Name;
+}
+
+bool FSIOAttachmentCodec::compress(char const* In, size_t InSize, std::string& Out)
+{
+	if (InSize > MAX_int32)
+	{
+		return false;
+	}
+	int32 CompressedSize = FCompression::CompressMemoryBound(FormatName, (int32)InSize);
+	Out.resize(CompressedSize);
+	if (!FCompression::CompressMemory(FormatName, &Out[0], CompressedSize, In, (int32)InSize))
+	{
+		return false;
+	}
+	Out.resize(CompressedSize);
+	return true;
+}
+
+bool FSIOAttachmentCodec::decompress(char const* In, size_t InSize, size_t RawSize, std::string& Out)
+{
+	//RawSize comes from the peer, don't let it size the buffer beyond what InSize could inflate to
+	if (InSize > MAX_int32 || RawSize > MAX_int32 || RawSize > InSize * sio::attachment_codec::max_ratio)
+	{
+		return false;
+	}
+	Out.resize(RawSize);
+	if (RawSize == 0)
+	{
+		return true;
+	}
+	return FCompression::UncompressMemory(FormatName, &Out[0], (int32)RawSize, In, (int32)InSize);
+}
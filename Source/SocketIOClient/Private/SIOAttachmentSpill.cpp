@@ -0,0 +1,83 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+
+
+#include "SIOAttachmentSpill.h"
+#include "SIOMessageConvert.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Async/MappedFileHandle.h"
+#include "Misc/Paths.h"
+#include "Misc/Guid.h"
+
+namespace
+{
+	/** Keeps the mapping alive for as long as any message references it */
+	struct FMappedSpillFile
+	{
+		TUniquePtr<IMappedFileHandle> Handle;
+		TUniquePtr<IMappedFileRegion> Region;
+		FString FilePath;
+
+		~FMappedSpillFile()
+		{
+			//region must be unmapped before the handle closes, and both before the delete
+			Region.Reset();
+			Handle.Reset();
+			FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*FilePath);
+		}
+	};
+}
+
+FSIOAttachmentSpill::FSIOAttachmentSpill(const FString& InDirectory)
+{
+	Directory = InDirectory.IsEmpty() ? DefaultDirectory() : InDirectory;
+}
+
+FString FSIOAttachmentSpill::DefaultDirectory()
+{
+	return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("SocketIO"), TEXT("Spill"));
+}
+
+sio::message::ptr FSIOAttachmentSpill::store(std::shared_ptr<const std::string> const& buffer)
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+
+	if (!buffer || buffer->empty() || !PlatformFile.CreateDirectoryTree(*Directory))
+	{
+		return nullptr;
+	}
+
+	const FString FilePath = FPaths::Combine(Directory, FGuid::NewGuid().ToString() + TEXT(".bin"));
+
+	{
+		TUniquePtr<IFileHandle> WriteHandle(PlatformFile.OpenWrite(*FilePath));
+		if (!WriteHandle.IsValid())
+		{
+			UE_LOG(SocketIO, Warning, TEXT("Attachment spill: unable to create %s, keeping attachment in memory."), *FilePath);
+			return nullptr;
+		}
+		if (!WriteHandle->Write((const uint8*)buffer->data(), (int64)buffer->size()))
+		{
+			WriteHandle.Reset();
+			PlatformFile.DeleteFile(*FilePath);
+			UE_LOG(SocketIO, Warning, TEXT("Attachment spill: write to %s failed, keeping attachment in memory."), *FilePath);
+			return nullptr;
+		}
+	}
+
+	std::shared_ptr<FMappedSpillFile> Mapped = std::make_shared<FMappedSpillFile>();
+	Mapped->FilePath = FilePath;
+	Mapped->Handle.Reset(PlatformFile.OpenMapped(*FilePath));
+	if (Mapped->Handle.IsValid())
+	{
+		Mapped->Region.Reset(Mapped->Handle->MapRegion(0, (int64)buffer->size()));
+	}
+
+	if (!Mapped->Region.IsValid() || Mapped->Region->GetMappedSize() != (int64)buffer->size())
+	{
+		//platform without mapping support, the destructor removes the file
+		return nullptr;
+	}
+
+	const char* Data = (const char*)Mapped->Region->GetMappedPtr();
+	return sio::binary_message::create(Mapped, Data, buffer->size());
+}
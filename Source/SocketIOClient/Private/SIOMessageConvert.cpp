@@ -5,6 +5,8 @@
 #include "Runtime/Json/Public/Serialization/JsonWriter.h"
 #include "Runtime/Json/Public/Policies/CondensedJsonPrintPolicy.h"
 #include "SIOJsonValue.h"
+#include "SocketIOMemory.h"
+#include "SocketIOTrace.h"
 
 DEFINE_LOG_CATEGORY(SocketIO);
 
@@ -12,6 +14,13 @@ typedef TJsonWriterFactory< TCHAR, TCondensedJsonPrintPolicy<TCHAR> > FCondensed
 typedef TJsonWriter< TCHAR, TCondensedJsonPrintPolicy<TCHAR> > FCondensedJsonStringWriter;
 
 TSharedPtr<FJsonValue> USIOMessageConvert::ToJsonValue(const sio::message::ptr& Message)
+{
+	SIO_TRACE_SCOPE(SocketIO_ToJsonValue);
+	SIO_LLM_SCOPE(SocketIO_Json);
+	return MessageToJsonValue(Message);
+}
+
+TSharedPtr<FJsonValue> USIOMessageConvert::MessageToJsonValue(const sio::message::ptr& Message)
 {
 	if (Message == nullptr)
 	{
@@ -36,12 +45,13 @@ TSharedPtr<FJsonValue> USIOMessageConvert::ToJsonValue(const sio::message::ptr&
 	{
 		//FString WarningString = FString::Printf(TEXT("<binary (size %d bytes) not supported in FJsonValue, use raw sio::message methods>"), Binary->length());
 
-		//convert sio buffer ptr into the array
-		TArray<uint8> Buffer;
-		Buffer.Append((uint8*)(Message->get_binary()->data()), Message->get_binary()->size());
-		//todo: investigate if binary optimization is possible? Do we copy?
-		
-		return MakeShareable(new FJsonValueBinary(Buffer));
+		//FJsonValue needs to own its bytes, copy once and move the array in.
+		//Use FSocketIONative::OnBinaryBufferEvent to avoid this copy entirely.
+		//Read the view rather than get_binary() so spilled attachments aren't materialized twice.
+		const sio::binary_message* Binary = static_cast<const sio::binary_message*>(Message.get());
+		TArray<uint8> Buffer((const uint8*)Binary->get_binary_data(), (int32)Binary->get_binary_size());
+
+		return MakeShareable(new FJsonValueBinary(MoveTemp(Buffer)));
 	}
 	else if (flag == sio::message::flag_array)
 	{
@@ -52,7 +62,7 @@ TSharedPtr<FJsonValue> USIOMessageConvert::ToJsonValue(const sio::message::ptr&
 
 		for (auto ItemMessage : MessageVector)
 		{
-			InArray.Add(ToJsonValue(ItemMessage));
+			InArray.Add(MessageToJsonValue(ItemMessage));
 		}
 		
 		return MakeShareable(new FJsonValueArray(InArray));
@@ -64,7 +74,7 @@ TSharedPtr<FJsonValue> USIOMessageConvert::ToJsonValue(const sio::message::ptr&
 
 		for (auto MapPair : MessageMap)
 		{
-			InObject->SetField(FStringFromStd(MapPair.first), ToJsonValue(MapPair.second));
+			InObject->SetField(FStringFromStd(MapPair.first), MessageToJsonValue(MapPair.second));
 		}
 
 		return MakeShareable(new FJsonValueObject(InObject));
@@ -86,6 +96,13 @@ TSharedPtr<FJsonValue> USIOMessageConvert::ToJsonValue(const sio::message::ptr&
 
 
 sio::message::ptr USIOMessageConvert::ToSIOMessage(const TSharedPtr<FJsonValue>& JsonValue)
+{
+	SIO_TRACE_SCOPE(SocketIO_ToSIOMessage);
+	SIO_LLM_SCOPE(SocketIO_Messages);
+	return JsonValueToMessage(JsonValue);
+}
+
+sio::message::ptr USIOMessageConvert::JsonValueToMessage(const TSharedPtr<FJsonValue>& JsonValue)
 {
 	if (!JsonValue.IsValid())
 	{
@@ -103,7 +120,8 @@ sio::message::ptr USIOMessageConvert::ToSIOMessage(const TSharedPtr<FJsonValue>&
 	{
 		if (FJsonValueBinary::IsBinary(JsonValue))
 		{
-			auto BinaryArray = FJsonValueBinary::AsBinary(JsonValue);
+			//copy straight out of the json value, AsBinary would copy the array first
+			const TArray<uint8>& BinaryArray = StaticCastSharedPtr<FJsonValueBinary>(JsonValue)->GetBinary();
 			return sio::binary_message::create(std::make_shared<std::string>((char*)BinaryArray.GetData(), BinaryArray.Num()));
 		}
 		else
@@ -127,7 +145,7 @@ sio::message::ptr USIOMessageConvert::ToSIOMessage(const TSharedPtr<FJsonValue>&
 		for (auto ItemValue : ValueArray)
 		{
 			//must use get_vector() for each
-			ArrayMessage->get_vector().push_back(ToSIOMessage(ItemValue));
+			ArrayMessage->get_vector().push_back(JsonValueToMessage(ItemValue));
 		}
 
 		return ArrayMessage;
@@ -141,7 +159,7 @@ sio::message::ptr USIOMessageConvert::ToSIOMessage(const TSharedPtr<FJsonValue>&
 		for (auto ItemPair : ValueTmap)
 		{
 			//important to use get_map() directly to insert the key in the correct map and not a pointer copy
-			ObjectMessage->get_map()[StdString(ItemPair.Key)] = ToSIOMessage(ItemPair.Value);
+			ObjectMessage->get_map()[StdString(ItemPair.Key)] = JsonValueToMessage(ItemPair.Value);
 		}
 
 		return ObjectMessage;
@@ -216,3 +234,115 @@ std::map<std::string, std::string> USIOMessageConvert::FStringMapToStdStringMap(
 
 	return ParamMap;
 }
+
+sio::client::compression_options USIOMessageConvert::ToCompressionOptions(const FSIOCompressionSettings& InSettings)
+{
+	sio::client::compression_options Options;
+	Options.enabled = InSettings.bEnabled;
+	Options.level = FMath::Clamp(InSettings.Level, 0, 9);
+	Options.client_max_window_bits = (uint8_t)FMath::Clamp(InSettings.ClientMaxWindowBits, 9, 15);
+	Options.server_max_window_bits = (uint8_t)FMath::Clamp(InSettings.ServerMaxWindowBits, 9, 15);
+	Options.client_no_context_takeover = InSettings.bClientNoContextTakeover;
+	Options.server_no_context_takeover = InSettings.bServerNoContextTakeover;
+	Options.min_compress_size = (size_t)FMath::Max(InSettings.MinCompressSize, 0);
+	return Options;
+}
+
+FSIOCompressionStats USIOMessageConvert::FromCompressionStats(const sio::client::compression_stats& InStats)
+{
+	FSIOCompressionStats Stats;
+	Stats.bNegotiated = InStats.negotiated;
+	Stats.BytesIn = (int64)InStats.bytes_in;
+	Stats.BytesOut = (int64)InStats.bytes_out;
+	Stats.BytesSaved = (int64)InStats.bytes_saved;
+	Stats.BytesReceivedCompressed = (int64)InStats.bytes_inflated_in;
+	Stats.BytesReceivedInflated = (int64)InStats.bytes_inflated_out;
+	Stats.MessagesCompressed = (int64)InStats.messages_compressed;
+	Stats.MessagesSkipped = (int64)InStats.messages_skipped;
+	Stats.CompressMs = InStats.compress_micros / 1000.f;
+	Stats.DecompressMs = InStats.decompress_micros / 1000.f;
+	return Stats;
+}
+
+sio::client::network_thread_options USIOMessageConvert::ToNetworkThreadOptions(const FSIONetworkThreadSettings& InSettings)
+{
+	sio::client::network_thread_options Options;
+	Options.busy_poll = InSettings.bBusyPoll;
+	Options.spin_polls = (unsigned)FMath::Max(InSettings.SpinPolls, 0);
+	Options.max_backoff_micros = (unsigned)FMath::Max(InSettings.MaxBackoffMicroseconds, 0);
+	Options.cpu_affinity = FMath::Max(InSettings.CpuAffinity, -1);
+	Options.priority = FMath::Clamp(InSettings.Priority, -2, 2);
+	Options.name = StdString(InSettings.ThreadName);
+	return Options;
+}
+
+FSIOMetrics USIOMessageConvert::FromMetricsSnapshot(const sio::metrics_snapshot& InSnapshot)
+{
+	FSIOMetrics Metrics;
+	Metrics.Frames = FromTrafficCounters(InSnapshot.frames);
+
+	for (const auto& NamespacePair : InSnapshot.namespaces)
+	{
+		FSIONamespaceMetrics& Namespace = Metrics.Namespaces.Add(FStringFromStd(NamespacePair.first));
+		Namespace.Traffic = FromTrafficCounters(NamespacePair.second.traffic);
+		for (const auto& EventPair : NamespacePair.second.events)
+		{
+			Namespace.Events.Add(FStringFromStd(EventPair.first), FromTrafficCounters(EventPair.second));
+		}
+		for (const auto& LatencyPair : NamespacePair.second.latency)
+		{
+			FSIOEventLatency& Latency = Namespace.Latency.Add(FStringFromStd(LatencyPair.first));
+			Latency.Decode = FromLatencyHistogram(LatencyPair.second.decode);
+			Latency.Dispatch = FromLatencyHistogram(LatencyPair.second.dispatch);
+			Latency.Queue = FromLatencyHistogram(LatencyPair.second.queue);
+			Latency.Handler = FromLatencyHistogram(LatencyPair.second.handler);
+			Latency.Total = FromLatencyHistogram(LatencyPair.second.total);
+		}
+	}
+
+	Metrics.Encode = FromLatencyHistogram(InSnapshot.encode_micros);
+	Metrics.Decode = FromLatencyHistogram(InSnapshot.decode_micros);
+	Metrics.AckRoundTrip = FromLatencyHistogram(InSnapshot.ack_rtt_micros);
+	Metrics.Reconnects = (int64)InSnapshot.reconnects;
+	Metrics.OutstandingAcks = (int64)InSnapshot.outstanding_acks;
+	Metrics.SendQueueDepth = (int64)InSnapshot.send_queue_depth;
+	Metrics.SendQueuePeak = (int64)InSnapshot.send_queue_peak;
+	Metrics.DispatchQueueDepth = (int64)InSnapshot.dispatch_queue_depth;
+	Metrics.DispatchQueuePeak = (int64)InSnapshot.dispatch_queue_peak;
+	return Metrics;
+}
+
+FSIOTrafficCounters USIOMessageConvert::FromTrafficCounters(const sio::traffic_counters& InCounters)
+{
+	FSIOTrafficCounters Counters;
+	Counters.PacketsIn = (int64)InCounters.packets_in;
+	Counters.PacketsOut = (int64)InCounters.packets_out;
+	Counters.BytesIn = (int64)InCounters.bytes_in;
+	Counters.BytesOut = (int64)InCounters.bytes_out;
+	return Counters;
+}
+
+FSIOLatencySummary USIOMessageConvert::FromLatencyHistogram(const sio::latency_histogram& InHistogram)
+{
+	FSIOLatencySummary Summary;
+	Summary.Count = (int64)InHistogram.count;
+	Summary.MeanMs = InHistogram.mean_micros() / 1000.f;
+	Summary.P50Ms = InHistogram.percentile_micros(0.5) / 1000.f;
+	Summary.P99Ms = InHistogram.percentile_micros(0.99) / 1000.f;
+	Summary.MaxMs = InHistogram.max_micros / 1000.f;
+	return Summary;
+}
+
+FSIOPacketTrace USIOMessageConvert::FromPacketTrace(const sio::packet_trace& InTrace)
+{
+	FSIOPacketTrace Trace;
+	Trace.Namespace = FStringFromStd(InTrace.nsp);
+	Trace.Event = FStringFromStd(InTrace.event);
+	Trace.ReceivedMicros = (int64)InTrace.received_micros;
+	Trace.DecodedMicros = (int64)InTrace.decoded_micros;
+	Trace.DispatchedMicros = (int64)InTrace.dispatched_micros;
+	Trace.EnqueuedMicros = (int64)InTrace.enqueued_micros;
+	Trace.HandlerStartMicros = (int64)InTrace.handler_start_micros;
+	Trace.HandlerEndMicros = (int64)InTrace.handler_end_micros;
+	return Trace;
+}
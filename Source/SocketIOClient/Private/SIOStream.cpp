@@ -0,0 +1,620 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+
+#include "SIOStream.h"
+#include "SIOMessageConvert.h"
+#include "CULambdaRunnable.h"
+#include "CUFileComponent.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Paths.h"
+#include "sio_socket.h"
+
+namespace
+{
+	sio::message::ptr FindField(const sio::message::ptr& Object, const char* Key)
+	{
+		if (!Object || Object->get_flag() != sio::message::flag_object)
+		{
+			return sio::message::ptr();
+		}
+		auto It = Object->get_map().find(Key);
+		return It != Object->get_map().end() ? It->second : sio::message::ptr();
+	}
+
+	int64 GetInt(const sio::message::ptr& Object, const char* Key, int64 Default)
+	{
+		sio::message::ptr Field = FindField(Object, Key);
+		if (Field && Field->get_flag() == sio::message::flag_integer)
+		{
+			return Field->get_int();
+		}
+		if (Field && Field->get_flag() == sio::message::flag_double)
+		{
+			return (int64)Field->get_double();
+		}
+		return Default;
+	}
+
+	FString GetString(const sio::message::ptr& Object, const char* Key)
+	{
+		sio::message::ptr Field = FindField(Object, Key);
+		if (Field && Field->get_flag() == sio::message::flag_string)
+		{
+			return USIOMessageConvert::FStringFromStd(Field->get_string());
+		}
+		return FString();
+	}
+
+	std::string SubEvent(const std::string& EventName, const char* Suffix)
+	{
+		return EventName + ":" + Suffix;
+	}
+
+	/** Ids come from the peer and name spill files, so no separators, drive letters or dot segments */
+	bool IsValidStreamId(const FString& StreamId)
+	{
+		if (StreamId.IsEmpty() || StreamId.Len() > 128 || StreamId.Contains(TEXT("..")))
+		{
+			return false;
+		}
+		for (const TCHAR Char : StreamId)
+		{
+			if (Char < 32 || FCString::Strchr(TEXT("/\\:*?\"<>|"), Char) != nullptr)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+/* FSIOUploadStream */
+
+FSIOUploadStream::FSIOUploadStream(const TSharedPtr<sio::client>& InClient, const FString& InEventName, const FString& InNamespace,
+	const FString& InStreamId, int64 InTotalSize, FReadFunction InReadFunction, const FSIOStreamSettings& InSettings)
+{
+	Client = InClient;
+	StdEventName = USIOMessageConvert::StdString(InEventName);
+	StdNamespace = USIOMessageConvert::StdString(InNamespace);
+	StreamId = InStreamId.IsEmpty() ? FGuid::NewGuid().ToString(EGuidFormats::Digits) : InStreamId;
+	TotalSize = InTotalSize;
+	ReadFunction = InReadFunction;
+	Settings = InSettings;
+	Settings.ChunkSize = FMath::Max(Settings.ChunkSize, 1);
+	Settings.Window = FMath::Max(Settings.Window, 1);
+	Window = Settings.Window;
+
+	NextOffset = 0;
+	AckedOffset = 0;
+	InFlight = 0;
+	NextSeq = 0;
+	Generation = 0;
+	bOpen = false;
+	bEndSent = false;
+	bFinished = false;
+	bReading = false;
+}
+
+FSIOUploadStream::FReadFunction FSIOUploadStream::FileReader(const FString& FilePath, int64& OutSize)
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	TSharedPtr<IFileHandle, ESPMode::ThreadSafe> Handle(PlatformFile.OpenRead(*FilePath));
+	if (!Handle.IsValid())
+	{
+		OutSize = -1;
+		return nullptr;
+	}
+	OutSize = Handle->Size();
+
+	//Chunks are read one at a time on the pool thread that pumps the stream
+	TSharedRef<FCriticalSection, ESPMode::ThreadSafe> HandleLock = MakeShared<FCriticalSection, ESPMode::ThreadSafe>();
+	return [Handle, HandleLock](int64 Offset, int32 Length, TArray<uint8>& OutChunk)
+	{
+		FScopeLock ScopeLock(&HandleLock.Get());
+		OutChunk.SetNumUninitialized(Length);
+		return Handle->Seek(Offset) && Handle->Read(OutChunk.GetData(), Length);
+	};
+}
+
+void FSIOUploadStream::Start()
+{
+	int32 OpenGeneration;
+	int64 ResumeOffset;
+	{
+		FScopeLock ScopeLock(&Lock);
+		if (bFinished || !Client.IsValid())
+		{
+			return;
+		}
+		//Anything in flight from a previous connection is void, the receiver tells us where to continue
+		Generation++;
+		OpenGeneration = Generation;
+		bOpen = false;
+		bEndSent = false;
+		InFlight = 0;
+		ResumeOffset = AckedOffset;
+	}
+
+	sio::message::ptr Open = sio::object_message::create();
+	Open->get_map()["id"] = sio::string_message::create(USIOMessageConvert::StdString(StreamId));
+	Open->get_map()["size"] = sio::int_message::create(TotalSize);
+	Open->get_map()["offset"] = sio::int_message::create(ResumeOffset);
+
+	TWeakPtr<FSIOUploadStream, ESPMode::ThreadSafe> WeakThis = AsShared();
+	Client->socket(StdNamespace)->emit(SubEvent(StdEventName, "open"), sio::message::list(Open), [WeakThis, OpenGeneration](sio::message::list const& Response)
+	{
+		if (TSharedPtr<FSIOUploadStream, ESPMode::ThreadSafe> Pinned = WeakThis.Pin())
+		{
+			Pinned->HandleOpenAck(OpenGeneration, Response);
+		}
+	});
+}
+
+void FSIOUploadStream::Cancel()
+{
+	FScopeLock ScopeLock(&Lock);
+	Generation++;
+	bFinished = true;
+}
+
+int64 FSIOUploadStream::GetAckedOffset() const
+{
+	FScopeLock ScopeLock(&Lock);
+	return AckedOffset;
+}
+
+bool FSIOUploadStream::IsFinished() const
+{
+	FScopeLock ScopeLock(&Lock);
+	return bFinished;
+}
+
+sio::message::ptr FSIOUploadStream::MakeHeader(int64 Offset) const
+{
+	sio::message::ptr Header = sio::object_message::create();
+	Header->get_map()["id"] = sio::string_message::create(USIOMessageConvert::StdString(StreamId));
+	Header->get_map()["seq"] = sio::int_message::create(NextSeq);
+	Header->get_map()["offset"] = sio::int_message::create(Offset);
+	return Header;
+}
+
+void FSIOUploadStream::HandleOpenAck(int32 InGeneration, const sio::message::list& Response)
+{
+	int64 Offset = 0;
+	FString Error;
+	const bool bOk = ParseAck(Response, Offset, Error);
+	{
+		FScopeLock ScopeLock(&Lock);
+		//a late ack of an earlier connection must not touch the resumed stream
+		if (InGeneration != Generation || bFinished)
+		{
+			return;
+		}
+		if (!bOk)
+		{
+			ScopeLock.Unlock();
+			Finish(false, Error);
+			return;
+		}
+		//the receiver may have less than we think (lost chunks) or more (resume from another session)
+		AckedOffset = FMath::Clamp<int64>(Offset, 0, TotalSize);
+		NextOffset = AckedOffset;
+		//credits are the smaller of what we allow and what the receiver advertises
+		const int64 ReceiverWindow = GetInt(Response[0], "window", 0);
+		Window = ReceiverWindow > 0 ? (int32)FMath::Min<int64>(Settings.Window, ReceiverWindow) : Settings.Window;
+		bOpen = true;
+	}
+	Pump();
+}
+
+void FSIOUploadStream::Pump()
+{
+	{
+		FScopeLock ScopeLock(&Lock);
+		if (bReading || !bOpen || bFinished || bEndSent || InFlight >= Window)
+		{
+			return;
+		}
+		bReading = true;
+	}
+
+	//acks arrive on the network thread, disk reads there would stall pings and every other socket
+	TWeakPtr<FSIOUploadStream, ESPMode::ThreadSafe> WeakThis = AsShared();
+	FCULambdaRunnable::RunLambdaOnBackGroundThreadPool([WeakThis]
+	{
+		if (TSharedPtr<FSIOUploadStream, ESPMode::ThreadSafe> Pinned = WeakThis.Pin())
+		{
+			Pinned->SendChunks();
+		}
+	});
+}
+
+void FSIOUploadStream::SendChunks()
+{
+	//one reader at a time keeps chunks in order, it only stops under Lock so no ack is missed
+	while (true)
+	{
+		int64 Offset;
+		int32 Length;
+		int32 PumpGeneration;
+		sio::message::ptr Header;
+		{
+			FScopeLock ScopeLock(&Lock);
+			if (!bOpen || bFinished || bEndSent || InFlight >= Window)
+			{
+				bReading = false;
+				return;
+			}
+			if (NextOffset >= TotalSize)
+			{
+				bReading = false;
+				//all data sent, end once everything is acked
+				if (InFlight > 0)
+				{
+					return;
+				}
+				bEndSent = true;
+				PumpGeneration = Generation;
+				ScopeLock.Unlock();
+
+				sio::message::ptr End = sio::object_message::create();
+				End->get_map()["id"] = sio::string_message::create(USIOMessageConvert::StdString(StreamId));
+				End->get_map()["size"] = sio::int_message::create(TotalSize);
+
+				TWeakPtr<FSIOUploadStream, ESPMode::ThreadSafe> WeakThis = AsShared();
+				Client->socket(StdNamespace)->emit(SubEvent(StdEventName, "end"), sio::message::list(End), [WeakThis, PumpGeneration](sio::message::list const& Response)
+				{
+					if (TSharedPtr<FSIOUploadStream, ESPMode::ThreadSafe> Pinned = WeakThis.Pin())
+					{
+						Pinned->HandleEndAck(PumpGeneration, Response);
+					}
+				});
+				return;
+			}
+			Offset = NextOffset;
+			Length = (int32)FMath::Min<int64>(Settings.ChunkSize, TotalSize - Offset);
+			Header = MakeHeader(Offset);
+			NextOffset += Length;
+			NextSeq++;
+			InFlight++;
+			PumpGeneration = Generation;
+		}
+
+		TSharedRef<TArray<uint8>, ESPMode::ThreadSafe> Chunk = MakeShared<TArray<uint8>, ESPMode::ThreadSafe>();
+		if (!ReadFunction || !ReadFunction(Offset, Length, *Chunk) || Chunk->Num() != Length)
+		{
+			{
+				FScopeLock ScopeLock(&Lock);
+				bReading = false;
+			}
+			Finish(false, FString::Printf(TEXT("Failed to read %d bytes at offset %lld"), Length, Offset));
+			return;
+		}
+
+		//the chunk array is referenced by the outgoing message until it has been framed
+		std::shared_ptr<const void> ChunkOwner(Chunk->GetData(), [Chunk](const void*) {});
+		sio::message::list Message(Header);
+		Message.push(sio::binary_message::create(ChunkOwner, (const char*)Chunk->GetData(), (size_t)Chunk->Num()));
+
+		TWeakPtr<FSIOUploadStream, ESPMode::ThreadSafe> WeakThis = AsShared();
+		Client->socket(StdNamespace)->emit(SubEvent(StdEventName, "chunk"), Message, [WeakThis, PumpGeneration](sio::message::list const& Response)
+		{
+			if (TSharedPtr<FSIOUploadStream, ESPMode::ThreadSafe> Pinned = WeakThis.Pin())
+			{
+				Pinned->HandleChunkAck(PumpGeneration, Response);
+			}
+		});
+	}
+}
+
+void FSIOUploadStream::HandleChunkAck(int32 InGeneration, const sio::message::list& Response)
+{
+	int64 Offset = 0;
+	FString Error;
+	const bool bOk = ParseAck(Response, Offset, Error);
+	int64 Acked;
+	{
+		FScopeLock ScopeLock(&Lock);
+		if (InGeneration != Generation || bFinished)
+		{
+			return;
+		}
+		if (!bOk)
+		{
+			ScopeLock.Unlock();
+			Finish(false, Error);
+			return;
+		}
+		InFlight = FMath::Max(InFlight - 1, 0);
+		AckedOffset = FMath::Max(AckedOffset, FMath::Min(Offset, TotalSize));
+		Acked = AckedOffset;
+	}
+
+	if (OnProgress)
+	{
+		const int64 Total = TotalSize;
+		TFunction<void(int64, int64)> ProgressFunction = OnProgress;
+		RunCallback([ProgressFunction, Acked, Total]
+		{
+			ProgressFunction(Acked, Total);
+		});
+	}
+	Pump();
+}
+
+void FSIOUploadStream::HandleEndAck(int32 InGeneration, const sio::message::list& Response)
+{
+	int64 Offset = 0;
+	FString Error;
+	bool bOk = ParseAck(Response, Offset, Error);
+	{
+		FScopeLock ScopeLock(&Lock);
+		if (InGeneration != Generation)
+		{
+			return;
+		}
+	}
+	if (bOk && Offset < TotalSize)
+	{
+		Error = FString::Printf(TEXT("Receiver ended with %lld of %lld bytes"), Offset, TotalSize);
+		bOk = false;
+	}
+	Finish(bOk, Error);
+}
+
+void FSIOUploadStream::Finish(bool bSuccess, const FString& Error)
+{
+	{
+		FScopeLock ScopeLock(&Lock);
+		if (bFinished)
+		{
+			return;
+		}
+		bFinished = true;
+	}
+	if (!bSuccess)
+	{
+		UE_LOG(SocketIO, Warning, TEXT("Upload stream %s failed: %s"), *StreamId, *Error);
+	}
+	if (OnComplete)
+	{
+		TFunction<void(bool, const FString&)> CompleteFunction = OnComplete;
+		RunCallback([CompleteFunction, bSuccess, Error]
+		{
+			CompleteFunction(bSuccess, Error);
+		});
+	}
+}
+
+void FSIOUploadStream::RunCallback(TFunction<void()> Callback)
+{
+	if (Settings.bCallbackOnGameThread)
+	{
+		FCULambdaRunnable::RunShortLambdaOnGameThread(Callback);
+	}
+	else
+	{
+		Callback();
+	}
+}
+
+bool FSIOUploadStream::ParseAck(const sio::message::list& Response, int64& OutOffset, FString& OutError)
+{
+	if (Response.size() == 0)
+	{
+		OutError = TEXT("Empty ack");
+		return false;
+	}
+	OutError = GetString(Response[0], "error");
+	if (!OutError.IsEmpty())
+	{
+		return false;
+	}
+	OutOffset = GetInt(Response[0], "offset", 0);
+	return true;
+}
+
+/* FSIODownloadReader */
+
+FSIODownloadReader::FSIODownloadReader(const FSIODownloadHandlers& InHandlers)
+{
+	Handlers = InHandlers;
+	Handlers.Settings.Window = FMath::Max(Handlers.Settings.Window, 1);
+}
+
+void FSIODownloadReader::Bind(sio::socket::ptr const& Socket, const FString& EventName)
+{
+	const std::string StdEventName = USIOMessageConvert::StdString(EventName);
+	TSharedRef<FSIODownloadReader, ESPMode::ThreadSafe> Self = AsShared();
+
+	//Handlers run on the network thread and fill the ack before socket.io sends it
+	Socket->on(SubEvent(StdEventName, "open"), sio::socket::event_listener([Self](sio::event& Event)
+	{
+		Event.put_ack_message(Self->HandleOpen(Event.get_messages()));
+	}));
+	Socket->on(SubEvent(StdEventName, "chunk"), sio::socket::event_listener([Self](sio::event& Event)
+	{
+		Event.put_ack_message(Self->HandleChunk(Event.get_messages()));
+	}));
+	Socket->on(SubEvent(StdEventName, "end"), sio::socket::event_listener([Self](sio::event& Event)
+	{
+		Event.put_ack_message(Self->HandleEnd(Event.get_messages()));
+	}));
+}
+
+int64 FSIODownloadReader::GetReceivedOffset(const FString& StreamId) const
+{
+	FScopeLock ScopeLock(&Lock);
+	const FStreamState* State = Streams.Find(StreamId);
+	return State ? State->ReceivedOffset : 0;
+}
+
+sio::message::list FSIODownloadReader::HandleOpen(const sio::message::list& Args)
+{
+	if (Args.size() == 0)
+	{
+		return MakeAck(0, TEXT("Missing stream header"));
+	}
+	const FString StreamId = GetString(Args[0], "id");
+	const int64 TotalSize = GetInt(Args[0], "size", -1);
+	if (!IsValidStreamId(StreamId))
+	{
+		return MakeAck(0, TEXT("Invalid stream id"));
+	}
+	if (TotalSize < 0)
+	{
+		return MakeAck(0, TEXT("Missing stream size"));
+	}
+
+	int64 ResumeOffset;
+	{
+		FScopeLock ScopeLock(&Lock);
+		FStreamState* State = Streams.Find(StreamId);
+		if (!State)
+		{
+			FStreamState NewState;
+			if (!Handlers.SpillDirectory.IsEmpty())
+			{
+				const FString SpillDirectory = FPaths::ConvertRelativePathToFull(Handlers.SpillDirectory);
+				NewState.FilePath = FPaths::ConvertRelativePathToFull(SpillDirectory / StreamId);
+				if (!FPaths::IsUnderDirectory(NewState.FilePath, SpillDirectory) || NewState.FilePath == SpillDirectory)
+				{
+					return MakeAck(0, TEXT("Invalid stream id"));
+				}
+				//a spill file from an earlier session is where we resume
+				IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+				PlatformFile.CreateDirectoryTree(*SpillDirectory);
+				NewState.ReceivedOffset = FMath::Max<int64>(PlatformFile.FileSize(*NewState.FilePath), 0);
+			}
+			State = &Streams.Add(StreamId, NewState);
+		}
+		if (State->ReceivedOffset > TotalSize)
+		{
+			//the spill file belongs to a different blob, don't resume into it
+			Streams.Remove(StreamId);
+			return MakeAck(0, TEXT("Stream size is smaller than the data already received"));
+		}
+		State->TotalSize = TotalSize;
+		State->bFailed = false;
+		ResumeOffset = State->ReceivedOffset;
+	}
+
+	if (Handlers.OnOpen)
+	{
+		TFunction<void(const FString&, int64, int64)> OpenFunction = Handlers.OnOpen;
+		RunCallback([OpenFunction, StreamId, TotalSize, ResumeOffset]
+		{
+			OpenFunction(StreamId, TotalSize, ResumeOffset);
+		});
+	}
+
+	sio::message::list Ack = MakeAck(ResumeOffset);
+	Ack[0]->get_map()["window"] = sio::int_message::create(Handlers.Settings.Window);
+	return Ack;
+}
+
+sio::message::list FSIODownloadReader::HandleChunk(const sio::message::list& Args)
+{
+	if (Args.size() < 2 || Args[1]->get_flag() != sio::message::flag_binary)
+	{
+		return MakeAck(0, TEXT("Chunk without binary payload"));
+	}
+	const FString StreamId = GetString(Args[0], "id");
+	const int64 Offset = GetInt(Args[0], "offset", -1);
+	const FSIOBuffer Chunk(Args[1]);
+
+	FString FilePath;
+	int64 Received;
+	{
+		FScopeLock ScopeLock(&Lock);
+		FStreamState* State = Streams.Find(StreamId);
+		if (!State || State->bFailed)
+		{
+			return MakeAck(0, TEXT("Unknown stream"));
+		}
+		if (Offset + Chunk.Num() <= State->ReceivedOffset)
+		{
+			//resent after a resume, already have it
+			return MakeAck(State->ReceivedOffset);
+		}
+		if (Offset != State->ReceivedOffset)
+		{
+			//chunks arrive in order on one connection, a gap means the sender lost track
+			return MakeAck(State->ReceivedOffset, TEXT("Out of order chunk"));
+		}
+		if (Offset + Chunk.Num() > State->TotalSize)
+		{
+			//the sender announced the size on open, nothing may grow the blob past it
+			State->bFailed = true;
+			return MakeAck(State->ReceivedOffset, TEXT("Chunk past the end of the stream"));
+		}
+		if (!State->FilePath.IsEmpty() &&
+			!UCUFileComponent::AppendBufferToFile(Chunk.GetData(), Chunk.Num(), State->FilePath))
+		{
+			State->bFailed = true;
+			return MakeAck(State->ReceivedOffset, TEXT("Failed to write spill file"));
+		}
+		State->ReceivedOffset += Chunk.Num();
+		Received = State->ReceivedOffset;
+		FilePath = State->FilePath;
+	}
+
+	if (Handlers.OnChunk)
+	{
+		TFunction<void(const FString&, int64, const FSIOBuffer&)> ChunkFunction = Handlers.OnChunk;
+		RunCallback([ChunkFunction, StreamId, Offset, Chunk]
+		{
+			ChunkFunction(StreamId, Offset, Chunk);
+		});
+	}
+	return MakeAck(Received);
+}
+
+sio::message::list FSIODownloadReader::HandleEnd(const sio::message::list& Args)
+{
+	const FString StreamId = Args.size() > 0 ? GetString(Args[0], "id") : FString();
+
+	FStreamState State;
+	{
+		FScopeLock ScopeLock(&Lock);
+		if (!Streams.RemoveAndCopyValue(StreamId, State))
+		{
+			return MakeAck(0, TEXT("Unknown stream"));
+		}
+	}
+	const int64 TotalSize = GetInt(Args[0], "size", State.TotalSize);
+	const bool bSuccess = !State.bFailed && State.ReceivedOffset == TotalSize;
+
+	if (Handlers.OnComplete)
+	{
+		TFunction<void(const FString&, bool, int64, const FString&)> CompleteFunction = Handlers.OnComplete;
+		const FString FilePath = State.FilePath;
+		RunCallback([CompleteFunction, StreamId, bSuccess, TotalSize, FilePath]
+		{
+			CompleteFunction(StreamId, bSuccess, TotalSize, FilePath);
+		});
+	}
+	return MakeAck(State.ReceivedOffset, bSuccess ? FString() : TEXT("Incomplete stream"));
+}
+
+sio::message::list FSIODownloadReader::MakeAck(int64 Offset, const FString& Error)
+{
+	sio::message::ptr Ack = sio::object_message::create();
+	Ack->get_map()["offset"] = sio::int_message::create(Offset);
+	if (!Error.IsEmpty())
+	{
+		Ack->get_map()["error"] = sio::string_message::create(USIOMessageConvert::StdString(Error));
+	}
+	return sio::message::list(Ack);
+}
+
+void FSIODownloadReader::RunCallback(TFunction<void()> Callback)
+{
+	if (Handlers.Settings.bCallbackOnGameThread)
+	{
+		FCULambdaRunnable::RunShortLambdaOnGameThread(Callback);
+	}
+	else
+	{
+		Callback();
+	}
+}
@@ -6,9 +6,26 @@
 #include "SIOMessageConvert.h"
 #include "CULambdaRunnable.h"
 #include "Runtime/Core/Public/HAL/ThreadSafeBool.h"
+#include "Containers/Ticker.h"
+#include "Stats/Stats.h"
 
 #define LOCTEXT_NAMESPACE "FSocketIOClientModule"
 
+//'stat SocketIO', summed over every plugin managed client and refreshed once a second
+DECLARE_STATS_GROUP(TEXT("SocketIO"), STATGROUP_SocketIO, STATCAT_Advanced);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Clients"), STAT_SocketIOClients, STATGROUP_SocketIO);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Received KB/s"), STAT_SocketIOKBInPerSecond, STATGROUP_SocketIO);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Sent KB/s"), STAT_SocketIOKBOutPerSecond, STATGROUP_SocketIO);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Frames received"), STAT_SocketIOFramesIn, STATGROUP_SocketIO);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Frames sent"), STAT_SocketIOFramesOut, STATGROUP_SocketIO);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Outstanding acks"), STAT_SocketIOOutstandingAcks, STATGROUP_SocketIO);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Send queue depth"), STAT_SocketIOSendDepth, STATGROUP_SocketIO);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Dispatch queue depth"), STAT_SocketIODispatchDepth, STATGROUP_SocketIO);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Reconnects"), STAT_SocketIOReconnects, STATGROUP_SocketIO);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Encode mean (ms)"), STAT_SocketIOEncodeMs, STATGROUP_SocketIO);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Decode mean (ms)"), STAT_SocketIODecodeMs, STATGROUP_SocketIO);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Ack RTT p99 (ms)"), STAT_SocketIOAckRttMs, STATGROUP_SocketIO);
+
 //struct 
 
 class FSocketIOClientModule : public ISocketIOClientModule
@@ -24,6 +41,14 @@ public:
 	virtual void ShutdownModule() override;
 
 private:
+	/** Publishes the SocketIO stat group */
+	bool TickStats(float DeltaTime);
+
+	FTSTicker::FDelegateHandle StatsTickerHandle;
+	uint64 LastStatsBytesIn = 0;
+	uint64 LastStatsBytesOut = 0;
+	double LastStatsSeconds = 0.0;
+
 	FCriticalSection DeleteSection;
 
 	//All native pointers manages by the plugin
@@ -42,6 +67,19 @@ void FSocketIOClientModule::StartupModule()
 	// This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
 
 	PluginNativePointers.Empty();
+
+	if (!sio::client::io_backend_available())
+	{
+		UE_LOG(SocketIO, Error, TEXT("SocketIO: built for the %s backend but this host refuses it, every connect will fail. Rebuild without SIO_IO_URING."), ANSI_TO_TCHAR(sio::client::io_backend()));
+	}
+	else
+	{
+		UE_LOG(SocketIO, Log, TEXT("SocketIO: using the %s backend"), ANSI_TO_TCHAR(sio::client::io_backend()));
+	}
+
+#if STATS
+	StatsTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FSocketIOClientModule::TickStats), 1.f);
+#endif
 }
 
 void FSocketIOClientModule::ShutdownModule()
@@ -49,6 +87,12 @@ void FSocketIOClientModule::ShutdownModule()
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
 
+	if (StatsTickerHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(StatsTickerHandle);
+		StatsTickerHandle.Reset();
+	}
+
 	/*
 	Ensure we call release pointers, this will catch all the plugin scoped 
 	connections pointers which don't get auto-released between game worlds.
@@ -146,6 +190,73 @@ void FSocketIOClientModule::ReleaseNativePointer(TSharedPtr<FSocketIONative> Poi
 	});
 }
 
+bool FSocketIOClientModule::TickStats(float DeltaTime)
+{
+#if STATS
+	if (!FThreadStats::IsCollectingData())
+	{
+		return true;
+	}
+
+	TArray<TSharedPtr<FSocketIONative>> Pointers;
+	{
+		FScopeLock Lock(&DeleteSection);
+		Pointers = PluginNativePointers;
+	}
+
+	sio::traffic_counters Frames;
+	sio::latency_histogram Encode;
+	sio::latency_histogram Decode;
+	sio::latency_histogram AckRtt;
+	uint64 OutstandingAcks = 0;
+	uint64 SendDepth = 0;
+	uint64 DispatchDepth = 0;
+	uint64 Reconnects = 0;
+
+	for (const TSharedPtr<FSocketIONative>& Pointer : Pointers)
+	{
+		if (!Pointer.IsValid())
+		{
+			continue;
+		}
+		const sio::metrics_snapshot Snapshot = Pointer->GetMetricsSnapshot();
+		Frames.merge(Snapshot.frames);
+		Encode.merge(Snapshot.encode_micros);
+		Decode.merge(Snapshot.decode_micros);
+		AckRtt.merge(Snapshot.ack_rtt_micros);
+		OutstandingAcks += Snapshot.outstanding_acks;
+		SendDepth += Snapshot.send_queue_depth;
+		DispatchDepth += Snapshot.dispatch_queue_depth;
+		Reconnects += Snapshot.reconnects;
+	}
+
+	//the ticker hands us the frame delta, not the interval
+	const double Now = FPlatformTime::Seconds();
+	const float Elapsed = (float)FMath::Max(Now - LastStatsSeconds, 0.001);
+	LastStatsSeconds = Now;
+
+	//totals drop when a client is released, count that interval as zero
+	const float KBIn = Frames.bytes_in >= LastStatsBytesIn ? (Frames.bytes_in - LastStatsBytesIn) / 1024.f / Elapsed : 0.f;
+	const float KBOut = Frames.bytes_out >= LastStatsBytesOut ? (Frames.bytes_out - LastStatsBytesOut) / 1024.f / Elapsed : 0.f;
+	LastStatsBytesIn = Frames.bytes_in;
+	LastStatsBytesOut = Frames.bytes_out;
+
+	SET_DWORD_STAT(STAT_SocketIOClients, Pointers.Num());
+	SET_FLOAT_STAT(STAT_SocketIOKBInPerSecond, KBIn);
+	SET_FLOAT_STAT(STAT_SocketIOKBOutPerSecond, KBOut);
+	SET_DWORD_STAT(STAT_SocketIOFramesIn, Frames.packets_in);
+	SET_DWORD_STAT(STAT_SocketIOFramesOut, Frames.packets_out);
+	SET_DWORD_STAT(STAT_SocketIOOutstandingAcks, OutstandingAcks);
+	SET_DWORD_STAT(STAT_SocketIOSendDepth, SendDepth);
+	SET_DWORD_STAT(STAT_SocketIODispatchDepth, DispatchDepth);
+	SET_DWORD_STAT(STAT_SocketIOReconnects, Reconnects);
+	SET_FLOAT_STAT(STAT_SocketIOEncodeMs, Encode.mean_micros() / 1000.f);
+	SET_FLOAT_STAT(STAT_SocketIODecodeMs, Decode.mean_micros() / 1000.f);
+	SET_FLOAT_STAT(STAT_SocketIOAckRttMs, AckRtt.percentile_micros(0.99) / 1000.f);
+#endif
+	return true;
+}
+
 #undef LOCTEXT_NAMESPACE
 	
 IMPLEMENT_MODULE(FSocketIOClientModule, SocketIOClient)
@@ -29,6 +29,15 @@ USocketIOClientComponent::USocketIOClientComponent(const FObjectInitializer &ini
 	ReconnectionTimeout = 0.f;
 	MaxReconnectionAttempts = -1.f;
 	ReconnectionDelayInMs = 5000;
+	ReconnectionDelayMaxInMs = 25000;
+	ReconnectionBackoff = ESIOReconnectBackoff::EXPONENTIAL;
+	AttachmentCodec = ESIOAttachmentCodec::NONE;
+	MinAttachmentCompressSize = 1024;
+	WireCodec = ESIOWireCodec::JSON;
+	AttachmentSpillThreshold = 0;
+	MaxPartialPacketBytes = 0;
+	bEnableLatencyTracing = false;
+	TraceSampleOneIn = 0;
 
 	bStaticallyInitialized = false;
 
@@ -416,9 +425,20 @@ void USocketIOClientComponent::Connect(const FString& InAddressAndPort, const FS
 	//Sync all params to native client before connecting
 	NativeClient->MaxReconnectionAttempts = MaxReconnectionAttempts;
 	NativeClient->ReconnectionDelay = ReconnectionDelayInMs;
+	NativeClient->ReconnectionDelayMax = ReconnectionDelayMaxInMs;
+	NativeClient->ReconnectionBackoff = ReconnectionBackoff;
 	NativeClient->VerboseLog = bVerboseConnectionLog;
 	NativeClient->bUnbindEventsOnDisconnect = bUnbindEventsOnDisconnect;
 	NativeClient->bForceTLSUse = bForceTLS;
+	NativeClient->CompressionSettings = CompressionSettings;
+	NativeClient->NetworkThreadSettings = NetworkThreadSettings;
+	NativeClient->AttachmentCodec = AttachmentCodec;
+	NativeClient->MinAttachmentCompressSize = MinAttachmentCompressSize;
+	NativeClient->WireCodec = WireCodec;
+	NativeClient->AttachmentSpillThreshold = AttachmentSpillThreshold;
+	NativeClient->MaxPartialPacketBytes = MaxPartialPacketBytes;
+	NativeClient->bEnableLatencyTracing = bEnableLatencyTracing;
+	NativeClient->TraceSampleOneIn = TraceSampleOneIn;
 
 	ConnectWithParams(URLParams);
 }
@@ -465,6 +485,53 @@ void USocketIOClientComponent::LeaveNamespace(const FString& Namespace)
 	NativeClient->LeaveNamespace(Namespace);
 }
 
+FSIOCompressionStats USocketIOClientComponent::GetCompressionStats()
+{
+	return NativeClient->GetCompressionStats();
+}
+
+FSIOMetrics USocketIOClientComponent::GetMetrics()
+{
+	return NativeClient->GetMetrics();
+}
+
+TArray<FSIOPacketTrace> USocketIOClientComponent::GetTraceSamples()
+{
+	return NativeClient->GetTraceSamples();
+}
+
+bool USocketIOClientComponent::SaveTraceSamples(const FString& FilePath)
+{
+	return NativeClient->SaveTraceSamples(FilePath);
+}
+
+bool USocketIOClientComponent::StartTrafficCapture(const FString& FilePath)
+{
+	return NativeClient->StartCapture(FilePath);
+}
+
+void USocketIOClientComponent::StopTrafficCapture()
+{
+	NativeClient->StopCapture();
+}
+
+bool USocketIOClientComponent::ReplayTrafficCapture(const FString& FilePath, bool bRealtime /*= true*/)
+{
+	TWeakObjectPtr<USocketIOClientComponent> WeakThis = this;
+	return NativeClient->ReplayCapture(FilePath, bRealtime, [WeakThis](int32 Frames)
+	{
+		if (WeakThis.IsValid())
+		{
+			WeakThis->OnReplayFinished.Broadcast(Frames);
+		}
+	});
+}
+
+void USocketIOClientComponent::StopTrafficReplay()
+{
+	NativeClient->StopReplay();
+}
+
 #if PLATFORM_WINDOWS
 #pragma endregion Connect
 #pragma region Emit
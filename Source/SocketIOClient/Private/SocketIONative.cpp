@@ -3,11 +3,15 @@
 
 #include "SocketIONative.h"
 #include "SIOMessageConvert.h"
+#include "SIOAttachmentCodec.h"
+#include "SIOAttachmentSpill.h"
 #include "CULambdaRunnable.h"
 #include "SIOJConvert.h"
 #include "sio_client.h"
 #include "sio_message.h"
 #include "sio_socket.h"
+#include "Misc/FileHelper.h"
+#include "SocketIOTrace.h"
 
 FSocketIONative::FSocketIONative(const bool bForceTLS, const bool bShouldVerifyTLSCertificate)
 {
@@ -17,20 +21,44 @@ FSocketIONative::FSocketIONative(const bool bForceTLS, const bool bShouldVerifyT
 	bIsConnected = false;
 	MaxReconnectionAttempts = -1;
 	ReconnectionDelay = 5000;
+	ReconnectionDelayMax = 25000;
+	ReconnectionBackoff = ESIOReconnectBackoff::EXPONENTIAL;
 	bCallbackOnGameThread = true;
 	bUnbindEventsOnDisconnect = false;
+	AttachmentCodec = ESIOAttachmentCodec::NONE;
+	MinAttachmentCompressSize = 1024;
+	WireCodec = ESIOWireCodec::JSON;
+	AttachmentSpillThreshold = 0;
+	MaxPartialPacketBytes = 0;
+	LastMetricsMicros = 0;
+	bEnableLatencyTracing = false;
+	TraceSampleOneIn = 0;
+	TraceSampleCapacity = 1024;
 	bForceTLSUse = bForceTLS;
+	bIsSetupForUnixSocket = false;
 	InitPrivateClient(bForceTLS, bShouldVerifyTLSCertificate);
 
 	ClearAllCallbacks();
 }
 
 
-void FSocketIONative::InitPrivateClient(const bool bShouldUseTlsLibraries /*= false*/, const bool bShouldVerifyTLSCertificate /*= false*/)
+void FSocketIONative::InitPrivateClient(const bool bShouldUseTlsLibraries /*= false*/, const bool bShouldVerifyTLSCertificate /*= false*/, const bool bShouldUseUnixSocket /*= false*/)
 {
-	bIsSetupForTLS = bShouldUseTlsLibraries;
+	bIsSetupForTLS = bShouldUseTlsLibraries && !bShouldUseUnixSocket;
+	bIsSetupForUnixSocket = bShouldUseUnixSocket;
 	bUsingTLSCertVerification = bShouldVerifyTLSCertificate;
-	PrivateClient = MakeShareable(new sio::client(bShouldUseTlsLibraries, bUsingTLSCertVerification));
+	if (bShouldUseUnixSocket)
+	{
+		if (!sio::client::has_unix_sockets())
+		{
+			UE_LOG(SocketIO, Error, TEXT("Unix domain sockets are not supported on this platform, unix:// connections will fail."));
+		}
+		PrivateClient = MakeShareable(new sio::client(sio::client::unix_socket_t()));
+	}
+	else
+	{
+		PrivateClient = MakeShareable(new sio::client(bShouldUseTlsLibraries, bUsingTLSCertVerification));
+	}
 }
 
 void FSocketIONative::Connect(const FSIOConnectParams& InConnectParams)
@@ -55,15 +83,47 @@ void FSocketIONative::Connect(const FSIOConnectParams& InConnectParams)
 		AuthMessage->get_map()["token"] = sio::string_message::create(USIOMessageConvert::StdString(URLParams.AuthToken));
 	}
 
+	//Offer attachment compression, the server confirms by echoing attachmentCodec in its connect packet
+	std::shared_ptr<sio::attachment_codec> StdCodec;
+	if (AttachmentCodec != ESIOAttachmentCodec::NONE)
+	{
+		StdCodec = std::make_shared<FSIOAttachmentCodec>(AttachmentCodec);
+		StdCodec->set_min_size((size_t)FMath::Max(MinAttachmentCompressSize, 0));
+		sio::message::ptr Offer = sio::array_message::create();
+		Offer->get_vector().push_back(sio::string_message::create(StdCodec->get_name()));
+		AuthMessage->get_map()["attachmentCodecs"] = Offer;
+	}
+
 	QueryMap = USIOMessageConvert::FStringMapToStdStringMap(URLParams.Query);
 	HeadersMap = USIOMessageConvert::FStringMapToStdStringMap(URLParams.Headers);
+	sio::client::compression_options CompressionOptions = USIOMessageConvert::ToCompressionOptions(CompressionSettings);
+	sio::client::network_thread_options ThreadOptions = USIOMessageConvert::ToNetworkThreadOptions(NetworkThreadSettings);
+	sio::client::wire_codec StdWireCodec = (WireCodec == ESIOWireCodec::MSGPACK) ? sio::client::wire_codec_msgpack : sio::client::wire_codec_json;
+	sio::client::reconnect_backoff StdBackoff = static_cast<sio::client::reconnect_backoff>(ReconnectionBackoff);
+
+	sio::client::attachment_limits AttachmentLimits;
+	AttachmentLimits.spill_threshold = (size_t)FMath::Max<int64>(AttachmentSpillThreshold, 0);
+	AttachmentLimits.max_partial_size = (size_t)FMath::Max<int64>(MaxPartialPacketBytes, 0);
+	sio::attachment_store::ptr SpillStore;
+	if (AttachmentLimits.spill_threshold > 0)
+	{
+		SpillStore = std::make_shared<FSIOAttachmentSpill>();
+	}
+
+	ApplyLatencyTracing();
 
 	//Connect to the server on a background thread so it never blocks
-	FCULambdaRunnable::RunLambdaOnBackGroundThread([&, StdAddressString, StdPathString, QueryMap, HeadersMap, AuthMessage]
+	FCULambdaRunnable::RunLambdaOnBackGroundThread([&, StdAddressString, StdPathString, QueryMap, HeadersMap, AuthMessage, CompressionOptions, ThreadOptions, StdCodec, StdWireCodec, StdBackoff, AttachmentLimits, SpillStore]
 	{
 		PrivateClient->set_reconnect_attempts(MaxReconnectionAttempts);
 		PrivateClient->set_reconnect_delay(ReconnectionDelay);
+		PrivateClient->set_reconnect_delay_max(FMath::Max(ReconnectionDelayMax, ReconnectionDelay));
+		PrivateClient->set_reconnect_backoff(StdBackoff);
 		PrivateClient->set_path(StdPathString);
+		PrivateClient->set_compression_options(CompressionOptions);
+		PrivateClient->set_network_thread_options(ThreadOptions);
+		PrivateClient->set_attachment_codec(StdCodec);
+		PrivateClient->set_attachment_limits(AttachmentLimits, SpillStore);
 
 		//close and reconnect if different url
 		if(PrivateClient->opened())
@@ -80,6 +140,7 @@ void FSocketIONative::Connect(const FSIOConnectParams& InConnectParams)
 				return;
 			}
 		}
+		PrivateClient->set_wire_codec(StdWireCodec);
 		PrivateClient->connect(StdAddressString, QueryMap, HeadersMap, AuthMessage);
 	});
 }
@@ -94,6 +155,145 @@ void FSocketIONative::Connect(const FString& InAddressAndPort)
 	Connect(URLParams);
 }
 
+FSIOCompressionStats FSocketIONative::GetCompressionStats() const
+{
+	return USIOMessageConvert::FromCompressionStats(PrivateClient->get_compression_stats());
+}
+
+FSIOMetrics FSocketIONative::GetMetrics()
+{
+	const sio::metrics_snapshot Snapshot = GetMetricsSnapshot();
+	FSIOMetrics Metrics = USIOMessageConvert::FromMetricsSnapshot(Snapshot);
+
+	FScopeLock ScopeLock(&MetricsLock);
+
+	//counters restart when the client is re-created, skip that interval
+	if (Snapshot.captured_micros > LastMetricsMicros && LastMetricsMicros > 0 &&
+		Snapshot.frames.bytes_in >= LastMetricsFrames.bytes_in && Snapshot.frames.bytes_out >= LastMetricsFrames.bytes_out)
+	{
+		const double Seconds = (Snapshot.captured_micros - LastMetricsMicros) / 1000000.0;
+		Metrics.BytesInPerSecond = (float)((Snapshot.frames.bytes_in - LastMetricsFrames.bytes_in) / Seconds);
+		Metrics.BytesOutPerSecond = (float)((Snapshot.frames.bytes_out - LastMetricsFrames.bytes_out) / Seconds);
+	}
+	LastMetricsFrames = Snapshot.frames;
+	LastMetricsMicros = Snapshot.captured_micros;
+
+	return Metrics;
+}
+
+sio::metrics_snapshot FSocketIONative::GetMetricsSnapshot() const
+{
+	return PrivateClient.IsValid() ? PrivateClient->get_metrics() : sio::metrics_snapshot();
+}
+
+void FSocketIONative::ApplyLatencyTracing()
+{
+	sio::trace_options Options;
+	Options.enabled = bEnableLatencyTracing;
+	Options.sample_one_in = (unsigned)FMath::Max(TraceSampleOneIn, 0);
+	Options.sample_capacity = (size_t)FMath::Max(TraceSampleCapacity, 0);
+	PrivateClient->set_trace_options(Options);
+}
+
+TArray<FSIOPacketTrace> FSocketIONative::GetTraceSamples() const
+{
+	TArray<FSIOPacketTrace> Samples;
+	for (const sio::packet_trace& Trace : PrivateClient->get_trace_samples())
+	{
+		Samples.Add(USIOMessageConvert::FromPacketTrace(Trace));
+	}
+	return Samples;
+}
+
+bool FSocketIONative::SaveTraceSamples(const FString& FilePath) const
+{
+	auto Span = [](int64 From, int64 To)
+	{
+		return (From > 0 && To >= From) ? To - From : 0;
+	};
+
+	FString Csv = TEXT("namespace,event,received_us,decode_us,dispatch_us,queue_us,handler_us,total_us\n");
+	for (const FSIOPacketTrace& Trace : GetTraceSamples())
+	{
+		Csv += FString::Printf(TEXT("%s,%s,%lld,%lld,%lld,%lld,%lld,%lld\n"),
+			*Trace.Namespace,
+			*Trace.Event,
+			Trace.ReceivedMicros,
+			Span(Trace.ReceivedMicros, Trace.DecodedMicros),
+			Span(Trace.DecodedMicros, Trace.DispatchedMicros),
+			Span(Trace.EnqueuedMicros, Trace.HandlerStartMicros),
+			Span(Trace.HandlerStartMicros, Trace.HandlerEndMicros),
+			Span(Trace.ReceivedMicros, Trace.HandlerEndMicros));
+	}
+	return FFileHelper::SaveStringToFile(Csv, *FilePath);
+}
+
+bool FSocketIONative::StartCapture(const FString& FilePath)
+{
+	return PrivateClient->start_capture(USIOMessageConvert::StdString(FilePath));
+}
+
+void FSocketIONative::StopCapture()
+{
+	PrivateClient->stop_capture();
+}
+
+bool FSocketIONative::ReplayCapture(const FString& FilePath, bool bRealtime, TFunction<void(int32)> OnFinished /*= nullptr*/)
+{
+	return PrivateClient->replay_capture(USIOMessageConvert::StdString(FilePath), bRealtime, [OnFinished](size_t Frames)
+	{
+		if (OnFinished)
+		{
+			FCULambdaRunnable::RunShortLambdaOnGameThread([OnFinished, Frames]
+			{
+				OnFinished((int32)Frames);
+			});
+		}
+	});
+}
+
+void FSocketIONative::StopReplay()
+{
+	PrivateClient->stop_replay();
+}
+
+void FSocketIONative::RunEventOnGameThread(TFunction<void()> Callback)
+{
+	//events waiting for the game thread are the dispatch queue
+	std::shared_ptr<sio::dispatch_gauge> Gauge = PrivateClient->get_dispatch_gauge();
+	Gauge->push();
+
+	sio::packet_trace Trace;
+	if (!sio::client::claim_trace(Trace))
+	{
+		FCULambdaRunnable::RunShortLambdaOnGameThread([Callback, Gauge]
+		{
+			Gauge->pop();
+			SIO_TRACE_SCOPE(SocketIO_GameThreadDispatch);
+			Callback();
+		});
+		return;
+	}
+	Trace.enqueued_micros = sio::trace_clock_micros();
+
+	//holds the metrics only, the last client reference must never be released on the game thread
+	sio::client::trace_recorder RecordTrace = PrivateClient->get_trace_recorder();
+	FCULambdaRunnable::RunShortLambdaOnGameThread([Callback, Trace, RecordTrace, Gauge]() mutable
+	{
+		Gauge->pop();
+		SIO_TRACE_SCOPE(SocketIO_GameThreadDispatch);
+		Trace.handler_start_micros = sio::trace_clock_micros();
+		Callback();
+		Trace.handler_end_micros = sio::trace_clock_micros();
+		RecordTrace(Trace);
+	});
+}
+
+bool FSocketIONative::IsAttachmentCodecActive() const
+{
+	return PrivateClient->is_attachment_codec_active();
+}
+
 void FSocketIONative::JoinNamespace(const FString& Namespace)
 {
 	//just referencing the namespace will join it
@@ -259,6 +459,7 @@ void FSocketIONative::EmitRaw(const FString& EventName, const sio::message::list
 				{
 					FCULambdaRunnable::RunShortLambdaOnGameThread([&, CallbackFunction, response]
 					{
+						SIO_TRACE_SCOPE(SocketIO_GameThreadAck);
 						if (CallbackFunction)
 						{
 							CallbackFunction(response);
@@ -281,9 +482,20 @@ void FSocketIONative::EmitRaw(const FString& EventName, const sio::message::list
 
 void FSocketIONative::EmitRawBinary(const FString& EventName, uint8* Data, int32 DataLength, const FString& Namespace /*= FString(TEXT("/"))*/)
 {
+	//We don't know how long Data lives, take a copy. Use EmitBinary with a shared buffer to avoid it.
 	PrivateClient->socket(USIOMessageConvert::StdString(Namespace))->emit(USIOMessageConvert::StdString(EventName), std::make_shared<std::string>((char*)Data, DataLength));
 }
 
+void FSocketIONative::EmitBinary(const FString& EventName, const TSharedRef<TArray<uint8>, ESPMode::ThreadSafe>& Data, const FString& Namespace /*= FString(TEXT("/"))*/)
+{
+	//The std owner holds a reference to the array until the network thread has framed it
+	TSharedRef<TArray<uint8>, ESPMode::ThreadSafe> Owner = Data;
+	std::shared_ptr<const void> StdOwner(Owner->GetData(), [Owner](const void*) {});
+
+	sio::message::list MessageList(sio::binary_message::create(StdOwner, (const char*)Owner->GetData(), (size_t)Owner->Num()));
+	PrivateClient->socket(USIOMessageConvert::StdString(Namespace))->emit(USIOMessageConvert::StdString(EventName), MessageList);
+}
+
 void FSocketIONative::OnEvent(const FString& EventName, 
 	TFunction< void(const FString&, const TSharedPtr<FJsonValue>&)> CallbackFunction, 
 	const FString& Namespace /*= FString(TEXT("/"))*/,
@@ -341,7 +553,7 @@ void FSocketIONative::OnRawEvent(const FString& EventName,
 
 					if (bCallbackThisEventOnGameThread)
 					{
-						FCULambdaRunnable::RunShortLambdaOnGameThread([&, SafeFunction, SafeName, data]
+						RunEventOnGameThread([SafeFunction, SafeName, data]
 							{
 								SafeFunction(SafeName, data);
 							});
@@ -359,6 +571,17 @@ void FSocketIONative::OnRawBinaryEvent(const FString& EventName, TFunction< void
 {
 	const TFunction< void(const FString&, const TArray<uint8>&)> SafeFunction = CallbackFunction;	//copy the function so it remains in context
 
+	//Share the frame until the callback thread, then copy exactly once into the array the callback expects
+	OnBinaryBufferEvent(EventName, [SafeFunction](const FString& Name, const FSIOBuffer& Buffer)
+	{
+		SafeFunction(Name, Buffer.ToArray());
+	}, Namespace);
+}
+
+void FSocketIONative::OnBinaryBufferEvent(const FString& EventName, TFunction< void(const FString&, const FSIOBuffer&)> CallbackFunction, const FString& Namespace /*= FString(TEXT("/"))*/)
+{
+	const TFunction< void(const FString&, const FSIOBuffer&)> SafeFunction = CallbackFunction;	//copy the function so it remains in context
+
 	PrivateClient->socket(USIOMessageConvert::StdString(Namespace))->on(
 		USIOMessageConvert::StdString(EventName),
 		sio::socket::event_listener_aux(
@@ -366,17 +589,14 @@ void FSocketIONative::OnRawBinaryEvent(const FString& EventName, TFunction< void
 	{
 		const FString SafeName = USIOMessageConvert::FStringFromStd(name);
 
-		//Construct raw buffer
+		//Reference the received buffer, copying the view only bumps a refcount
 		if (data->get_flag() == sio::message::flag_binary)
 		{
-			TArray<uint8> Buffer;
-			int32 BufferSize = data->get_binary()->size();
-			auto MessageBuffer = data->get_binary();
-			Buffer.Append((uint8*)(MessageBuffer->data()), BufferSize);
+			const FSIOBuffer Buffer(data);
 
 			if (bCallbackOnGameThread)
 			{
-				FCULambdaRunnable::RunShortLambdaOnGameThread([&, SafeFunction, SafeName, Buffer]
+				RunEventOnGameThread([SafeFunction, SafeName, Buffer]
 				{
 					SafeFunction(SafeName, Buffer);
 				});
@@ -393,6 +613,18 @@ void FSocketIONative::OnRawBinaryEvent(const FString& EventName, TFunction< void
 	}));
 }
 
+TSharedPtr<FSIOUploadStream, ESPMode::ThreadSafe> FSocketIONative::OpenUploadStream(const FString& EventName, int64 TotalSize, FSIOUploadStream::FReadFunction ReadFunction, const FSIOStreamSettings& Settings /*= FSIOStreamSettings()*/, const FString& StreamId /*= TEXT("")*/, const FString& Namespace /*= TEXT("/")*/)
+{
+	return MakeShared<FSIOUploadStream, ESPMode::ThreadSafe>(PrivateClient, EventName, Namespace, StreamId, TotalSize, ReadFunction, Settings);
+}
+
+TSharedPtr<FSIODownloadReader, ESPMode::ThreadSafe> FSocketIONative::OnDownloadStream(const FString& EventName, const FSIODownloadHandlers& Handlers, const FString& Namespace /*= TEXT("/")*/)
+{
+	TSharedPtr<FSIODownloadReader, ESPMode::ThreadSafe> Reader = MakeShared<FSIODownloadReader, ESPMode::ThreadSafe>(Handlers);
+	Reader->Bind(PrivateClient->socket(USIOMessageConvert::StdString(Namespace)), EventName);
+	return Reader;
+}
+
 void FSocketIONative::UnbindEvent(const FString& EventName, const FString& Namespace /*= TEXT("/")*/)
 {
 	OnRawEvent(EventName, nullptr, Namespace);
@@ -610,37 +842,26 @@ bool FSocketIONative::IsTLSURL(const FString& URL)
 	return URL.StartsWith(TEXT("https://")) || URL.StartsWith(TEXT("wss://"));
 }
 
+bool FSocketIONative::IsUnixSocketURL(const FString& URL)
+{
+	return URL.StartsWith(TEXT("unix://")) || URL.StartsWith(TEXT("ws+unix://"));
+}
+
 void FSocketIONative::SyncPrivateClientToTLSMode(const FString& URL)
 {
-	//Should be in TLS mode?
-	if (IsTLSURL(URL) || bForceTLSUse)
-	{
-		//needs to swap to TLS
-		if (!bIsSetupForTLS)
-		{
-			if (PrivateClient->opened())
-			{
-				PrivateClient->sync_close();
-			}
-			ClearInternalCallbacks();
-			InitPrivateClient(true, bUsingTLSCertVerification);
-			RebindCurrentEventMap();
-		}
-	}
-	//Should not be in TLS mode
-	else
+	//unix sockets never use TLS, otherwise TLS if the URL or bForceTLSUse asks for it
+	const bool bShouldUseUnixSocket = IsUnixSocketURL(URL);
+	const bool bShouldUseTLS = !bShouldUseUnixSocket && (IsTLSURL(URL) || bForceTLSUse);
+
+	if (bShouldUseUnixSocket != bIsSetupForUnixSocket || bShouldUseTLS != bIsSetupForTLS)
 	{
-		//URL is not TLS, but we are setup for it
-		if (bIsSetupForTLS)
+		if (PrivateClient->opened())
 		{
-			if (PrivateClient->opened())
-			{
-				PrivateClient->sync_close();
-			}
-			ClearInternalCallbacks();
-			InitPrivateClient(false, bUsingTLSCertVerification);
-			RebindCurrentEventMap();
+			PrivateClient->sync_close();
 		}
+		ClearInternalCallbacks();
+		InitPrivateClient(bShouldUseTLS, bUsingTLSCertVerification, bShouldUseUnixSocket);
+		RebindCurrentEventMap();
 	}
 }
 
@@ -0,0 +1,29 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "sio_attachment_codec.h"
+#include "SIOMessageConvert.h"
+
+/**
+* sio::attachment_codec backed by FCompression. Created by FSocketIONative on connect
+* when an attachment codec is selected.
+*/
+class SOCKETIOCLIENT_API FSIOAttachmentCodec : public sio::attachment_codec
+{
+public:
+	FSIOAttachmentCodec(ESIOAttachmentCodec InCodec);
+
+	/** Name as advertised in the handshake auth payload */
+	static FString CodecName(ESIOAttachmentCodec InCodec);
+
+	virtual std::string const& get_name() const override;
+	virtual bool compress(char const* In, size_t InSize, std::string& Out) override;
+	virtual bool decompress(char const* In, size_t InSize, size_t RawSize, std::string& Out) override;
+
+private:
+	FName FormatName;
+	std::string Name;
+};
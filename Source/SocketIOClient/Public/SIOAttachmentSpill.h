@@ -0,0 +1,26 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "sio_attachment_store.h"
+
+/**
+* sio::attachment_store that writes large inbound attachments to a temp file and hands
+* back a memory mapped view of it. The file is deleted once the last message referencing
+* it is released. Created by FSocketIONative on connect when a spill threshold is set.
+*/
+class SOCKETIOCLIENT_API FSIOAttachmentSpill : public sio::attachment_store
+{
+public:
+	FSIOAttachmentSpill(const FString& InDirectory = FString());
+
+	/** Saved/SocketIO/Spill */
+	static FString DefaultDirectory();
+
+	virtual sio::message::ptr store(std::shared_ptr<const std::string> const& buffer) override;
+
+private:
+	FString Directory;
+};
@@ -0,0 +1,52 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "sio_message.h"
+#include <memory>
+#include <string>
+
+/**
+* Read-only, refcounted view of a received binary attachment. Shares the buffer the
+* websocket frame was read into (or the mapped spill file), so copying an FSIOBuffer
+* (e.g. into a game thread lambda) never copies the bytes. Safe to pass between threads, the data is immutable.
+*/
+struct SOCKETIOCLIENT_API FSIOBuffer
+{
+	FSIOBuffer() : Data(nullptr), Size(0) {}
+
+	explicit FSIOBuffer(const std::shared_ptr<const std::string>& InData)
+		: Owner(InData), Data(InData ? InData->data() : nullptr), Size(InData ? InData->size() : 0) {}
+
+	/** View a binary message without materializing external storage */
+	explicit FSIOBuffer(const sio::message::ptr& InMessage) : Data(nullptr), Size(0)
+	{
+		if (InMessage && InMessage->get_flag() == sio::message::flag_binary)
+		{
+			const sio::binary_message* Binary = static_cast<const sio::binary_message*>(InMessage.get());
+			Owner = Binary->get_binary_owner();
+			Data = Binary->get_binary_data();
+			Size = Binary->get_binary_size();
+		}
+	}
+
+	bool IsValid() const { return Owner != nullptr; }
+
+	const uint8* GetData() const { return (const uint8*)Data; }
+
+	int32 Num() const { return (int32)Size; }
+
+	TArrayView<const uint8> GetView() const { return TArrayView<const uint8>(GetData(), Num()); }
+
+	/** Explicit copy for consumers that need to own or modify the bytes */
+	TArray<uint8> ToArray() const { return TArray<uint8>(GetData(), Num()); }
+
+	/** Binary message sharing these bytes, e.g. to re-emit them without copying */
+	sio::message::ptr ToMessage() const { return sio::binary_message::create(Owner, Data, Size); }
+
+private:
+	std::shared_ptr<const void> Owner;
+	const char* Data;
+	size_t Size;
+};
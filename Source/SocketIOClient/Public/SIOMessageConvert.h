@@ -47,6 +47,413 @@ struct SOCKETIOCLIENT_API FSIOConnectParams
 	}
 };
 
+/** Optional compression of binary attachments, negotiated via the handshake auth payload */
+UENUM(BlueprintType)
+enum class ESIOAttachmentCodec : uint8
+{
+	/** Attachments are sent as is */
+	NONE,
+
+	/** Fast, moderate ratio. Good default for voice and transform blobs */
+	LZ4,
+
+	/** Slower, better ratio */
+	ZLIB
+};
+
+/** Encoding of socket.io packets on the wire. The server must be configured with the matching parser. */
+UENUM(BlueprintType)
+enum class ESIOWireCodec : uint8
+{
+	/** Default socket.io parser, binaries travel as separate attachment frames */
+	JSON,
+
+	/** socket.io-msgpack-parser, one binary frame per packet with binaries inlined */
+	MSGPACK
+};
+
+/** How the wait between reconnection attempts grows. Mirrors sio::client::reconnect_backoff, in the same order. */
+UENUM(BlueprintType)
+enum class ESIOReconnectBackoff : uint8
+{
+	/** Delay * 1.5^attempt up to the max delay, no randomness */
+	EXPONENTIAL,
+
+	/** Random between 0 and the exponential delay. Spreads out clients best after a server restart */
+	FULL_JITTER,
+
+	/** Half the exponential delay plus a random half, never retries immediately */
+	EQUAL_JITTER,
+
+	/** Random between the delay and three times the previous wait */
+	DECORRELATED_JITTER
+};
+
+/**
+* permessage-deflate settings. Only used if the server also supports the extension.
+*/
+USTRUCT(BlueprintType)
+struct SOCKETIOCLIENT_API FSIOCompressionSettings
+{
+	GENERATED_USTRUCT_BODY();
+
+	/** Offer permessage-deflate to the server on connect */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = SocketIOCompression)
+	bool bEnabled;
+
+	/** zlib compression level 0 (none) - 9 (best). Default 6 */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = SocketIOCompression)
+	int32 Level;
+
+	/** Window size as a power of two (9-15) used for frames we send */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = SocketIOCompression)
+	int32 ClientMaxWindowBits;
+
+	/** Window size as a power of two (9-15) requested for frames the server sends */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = SocketIOCompression)
+	int32 ServerMaxWindowBits;
+
+	/** Reset our compressor after each message. Less memory, worse ratio. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = SocketIOCompression)
+	bool bClientNoContextTakeover;
+
+	/** Ask the server to reset its compressor after each message */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = SocketIOCompression)
+	bool bServerNoContextTakeover;
+
+	/** Frames smaller than this many bytes are sent uncompressed */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = SocketIOCompression)
+	int32 MinCompressSize;
+
+	FSIOCompressionSettings()
+	{
+		bEnabled = false;
+		Level = 6;
+		ClientMaxWindowBits = 15;
+		ServerMaxWindowBits = 15;
+		bClientNoContextTakeover = false;
+		bServerNoContextTakeover = false;
+		MinCompressSize = 256;
+	}
+};
+
+/**
+* How the client's network thread waits for the socket and where it runs. Applied on connect.
+*/
+USTRUCT(BlueprintType)
+struct SOCKETIOCLIENT_API FSIONetworkThreadSettings
+{
+	GENERATED_USTRUCT_BODY();
+
+	/** Spin on non-blocking polls instead of sleeping in the OS. Saves the wakeup on every message, costs a core. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = SocketIONetworkThread)
+	bool bBusyPoll;
+
+	/** Empty polls in a row before the busy poll backs off */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = SocketIONetworkThread, meta = (ClampMin = 0))
+	int32 SpinPolls;
+
+	/** Longest pause between polls once backed off, in microseconds. 0 only yields the core. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = SocketIONetworkThread, meta = (ClampMin = 0))
+	int32 MaxBackoffMicroseconds;
+
+	/** Pin the thread to this core, -1 lets the OS schedule it. Not supported on Mac and iOS. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = SocketIONetworkThread, meta = (ClampMin = -1))
+	int32 CpuAffinity;
+
+	/** -2 lowest to 2 highest, 0 keeps the OS default. Raising it may need privileges on Linux. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = SocketIONetworkThread, meta = (ClampMin = -2, ClampMax = 2))
+	int32 Priority;
+
+	/** Thread name shown in debuggers and profilers, empty keeps the default */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = SocketIONetworkThread)
+	FString ThreadName;
+
+	FSIONetworkThreadSettings()
+	{
+		bBusyPoll = false;
+		SpinPolls = 10000;
+		MaxBackoffMicroseconds = 0;
+		CpuAffinity = -1;
+		Priority = 0;
+	}
+};
+
+/**
+* Compression counters since the connection was created
+*/
+USTRUCT(BlueprintType)
+struct SOCKETIOCLIENT_API FSIOCompressionStats
+{
+	GENERATED_USTRUCT_BODY();
+
+	/** True if the server accepted permessage-deflate on the current connection */
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOCompression)
+	bool bNegotiated;
+
+	/** Uncompressed bytes passed to deflate */
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOCompression)
+	int64 BytesIn;
+
+	/** Compressed bytes sent */
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOCompression)
+	int64 BytesOut;
+
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOCompression)
+	int64 BytesSaved;
+
+	/** Compressed bytes received and their inflated size */
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOCompression)
+	int64 BytesReceivedCompressed;
+
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOCompression)
+	int64 BytesReceivedInflated;
+
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOCompression)
+	int64 MessagesCompressed;
+
+	/** Messages sent raw on a compressed connection because they were under MinCompressSize */
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOCompression)
+	int64 MessagesSkipped;
+
+	/** CPU time spent in deflate/inflate */
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOCompression)
+	float CompressMs;
+
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOCompression)
+	float DecompressMs;
+
+	FSIOCompressionStats()
+	{
+		bNegotiated = false;
+		BytesIn = 0;
+		BytesOut = 0;
+		BytesSaved = 0;
+		BytesReceivedCompressed = 0;
+		BytesReceivedInflated = 0;
+		MessagesCompressed = 0;
+		MessagesSkipped = 0;
+		CompressMs = 0.f;
+		DecompressMs = 0.f;
+	}
+};
+
+/**
+* Packet and byte counters for one direction pair
+*/
+USTRUCT(BlueprintType)
+struct SOCKETIOCLIENT_API FSIOTrafficCounters
+{
+	GENERATED_USTRUCT_BODY();
+
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	int64 PacketsIn;
+
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	int64 PacketsOut;
+
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	int64 BytesIn;
+
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	int64 BytesOut;
+
+	FSIOTrafficCounters()
+	{
+		PacketsIn = 0;
+		PacketsOut = 0;
+		BytesIn = 0;
+		BytesOut = 0;
+	}
+};
+
+/**
+* Summary of a timing histogram. Percentiles are bucket upper bounds (powers of two in microseconds).
+*/
+USTRUCT(BlueprintType)
+struct SOCKETIOCLIENT_API FSIOLatencySummary
+{
+	GENERATED_USTRUCT_BODY();
+
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	int64 Count;
+
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	float MeanMs;
+
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	float P50Ms;
+
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	float P99Ms;
+
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	float MaxMs;
+
+	FSIOLatencySummary()
+	{
+		Count = 0;
+		MeanMs = 0.f;
+		P50Ms = 0.f;
+		P99Ms = 0.f;
+		MaxMs = 0.f;
+	}
+};
+
+/**
+* Where received events spent their time, only filled while latency tracing is enabled
+*/
+USTRUCT(BlueprintType)
+struct SOCKETIOCLIENT_API FSIOEventLatency
+{
+	GENERATED_USTRUCT_BODY();
+
+	/** First frame received until decoded */
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	FSIOLatencySummary Decode;
+
+	/** Decoded until the listener ran on the network thread */
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	FSIOLatencySummary Dispatch;
+
+	/** Game thread hop, zero for events handled on the network thread */
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	FSIOLatencySummary Queue;
+
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	FSIOLatencySummary Handler;
+
+	/** First frame received until the handler returned */
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	FSIOLatencySummary Total;
+};
+
+/**
+* One sampled event trace. Timestamps share a monotonic microsecond clock, 0 if the stage didn't apply.
+*/
+USTRUCT(BlueprintType)
+struct SOCKETIOCLIENT_API FSIOPacketTrace
+{
+	GENERATED_USTRUCT_BODY();
+
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	FString Namespace;
+
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	FString Event;
+
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	int64 ReceivedMicros;
+
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	int64 DecodedMicros;
+
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	int64 DispatchedMicros;
+
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	int64 EnqueuedMicros;
+
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	int64 HandlerStartMicros;
+
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	int64 HandlerEndMicros;
+
+	FSIOPacketTrace()
+	{
+		ReceivedMicros = 0;
+		DecodedMicros = 0;
+		DispatchedMicros = 0;
+		EnqueuedMicros = 0;
+		HandlerStartMicros = 0;
+		HandlerEndMicros = 0;
+	}
+};
+
+USTRUCT(BlueprintType)
+struct SOCKETIOCLIENT_API FSIONamespaceMetrics
+{
+	GENERATED_USTRUCT_BODY();
+
+	/** All socket.io packets of this namespace, including acks */
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	FSIOTrafficCounters Traffic;
+
+	/** Event packets by event name */
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	TMap<FString, FSIOTrafficCounters> Events;
+
+	/** Received event latency by event name, see FSocketIONative::bEnableLatencyTracing */
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	TMap<FString, FSIOEventLatency> Latency;
+};
+
+/**
+* Traffic and timing counters since the client was created
+*/
+USTRUCT(BlueprintType)
+struct SOCKETIOCLIENT_API FSIOMetrics
+{
+	GENERATED_USTRUCT_BODY();
+
+	/** Every websocket frame, including engine.io ping/pong */
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	FSIOTrafficCounters Frames;
+
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	TMap<FString, FSIONamespaceMetrics> Namespaces;
+
+	/** Frame byte rates since the previous GetMetrics call on the same client */
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	float BytesInPerSecond;
+
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	float BytesOutPerSecond;
+
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	FSIOLatencySummary Encode;
+
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	FSIOLatencySummary Decode;
+
+	/** Emit with callback until the server's ack arrived */
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	FSIOLatencySummary AckRoundTrip;
+
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	int64 Reconnects;
+
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	int64 OutstandingAcks;
+
+	/** Frames waiting for the network thread, now and at worst */
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	int64 SendQueueDepth;
+
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	int64 SendQueuePeak;
+
+	/** Received events waiting for their game thread handler, now and at worst */
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	int64 DispatchQueueDepth;
+
+	UPROPERTY(BlueprintReadOnly, Category = SocketIOMetrics)
+	int64 DispatchQueuePeak;
+
+	FSIOMetrics()
+	{
+		BytesInPerSecond = 0.f;
+		BytesOutPerSecond = 0.f;
+		Reconnects = 0;
+		OutstandingAcks = 0;
+		SendQueueDepth = 0;
+		SendQueuePeak = 0;
+		DispatchQueueDepth = 0;
+		DispatchQueuePeak = 0;
+	}
+};
+
 /**
  * Static Conversion Utilities
  */
@@ -69,4 +476,22 @@ public:
 	static std::map<std::string, std::string> JsonObjectToStdStringMap(TSharedPtr<FJsonObject> InObject);
 	static TMap<FString, FString> JsonObjectToFStringMap(TSharedPtr<FJsonObject> InObject);
 	static std::map<std::string, std::string> FStringMapToStdStringMap(const TMap<FString, FString>& InMap);
+
+	//FSIOCompressionSettings <-> sio::client::compression_options
+	static sio::client::compression_options ToCompressionOptions(const FSIOCompressionSettings& InSettings);
+	static FSIOCompressionStats FromCompressionStats(const sio::client::compression_stats& InStats);
+
+	//FSIONetworkThreadSettings -> sio::client::network_thread_options
+	static sio::client::network_thread_options ToNetworkThreadOptions(const FSIONetworkThreadSettings& InSettings);
+
+	//sio::metrics_snapshot -> FSIOMetrics, rates are left for the caller
+	static FSIOMetrics FromMetricsSnapshot(const sio::metrics_snapshot& InSnapshot);
+	static FSIOTrafficCounters FromTrafficCounters(const sio::traffic_counters& InCounters);
+	static FSIOLatencySummary FromLatencyHistogram(const sio::latency_histogram& InHistogram);
+	static FSIOPacketTrace FromPacketTrace(const sio::packet_trace& InTrace);
+
+private:
+	//Recursive bodies of ToJsonValue/ToSIOMessage, so the trace scope only wraps the outer call
+	static TSharedPtr<FJsonValue> MessageToJsonValue(const sio::message::ptr& Message);
+	static sio::message::ptr JsonValueToMessage(const TSharedPtr<FJsonValue>& JsonValue);
 }; 
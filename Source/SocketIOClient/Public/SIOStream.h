@@ -0,0 +1,155 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SIOBuffer.h"
+#include "sio_client.h"
+
+/**
+* Chunked blob transfer over plain socket.io events, so large files never have to sit
+* in memory as one attachment. For a stream bound to EventName the events are:
+*
+*	EventName:open	{id, size, offset}			ack {offset, window} - where the receiver wants to (re)start
+*	EventName:chunk	{id, seq, offset}, <binary>	ack {offset} - contiguous bytes received, returns one credit
+*	EventName:end	{id, size}					ack {offset}
+*
+* Any ack may carry {error} instead, which fails the stream. The sender never has more
+* chunks without an ack than the smaller of its own Window and the window the receiver
+* advertised. Reopening a stream with a known id resumes it. Ids name the receiver's spill
+* files, so they may not contain path separators or "..".
+*/
+struct SOCKETIOCLIENT_API FSIOStreamSettings
+{
+	/** Bytes per binary chunk */
+	int32 ChunkSize = 64 * 1024;
+
+	/** Max chunks in flight without an ack */
+	int32 Window = 8;
+
+	/** Deliver progress/chunk/complete callbacks on the game thread, otherwise on the network thread */
+	bool bCallbackOnGameThread = true;
+};
+
+class SOCKETIOCLIENT_API FSIOUploadStream : public TSharedFromThis<FSIOUploadStream, ESPMode::ThreadSafe>
+{
+public:
+	/** Fill OutChunk with up to Length bytes starting at Offset. Return false on read failure. Called on a pool thread. */
+	typedef TFunction<bool(int64 Offset, int32 Length, TArray<uint8>& OutChunk)> FReadFunction;
+
+	FSIOUploadStream(const TSharedPtr<sio::client>& InClient, const FString& InEventName, const FString& InNamespace,
+		const FString& InStreamId, int64 InTotalSize, FReadFunction InReadFunction, const FSIOStreamSettings& InSettings);
+
+	/** Reads chunks from a file on demand. OutSize is -1 if the file can't be opened. */
+	static FReadFunction FileReader(const FString& FilePath, int64& OutSize);
+
+	/**
+	* Open the stream and start sending. Calling it again (e.g. after a reconnect) reopens
+	* the stream and resumes from the offset the receiver reports.
+	*/
+	void Start();
+
+	/** Stop sending, in-flight acks are ignored */
+	void Cancel();
+
+	const FString& GetStreamId() const { return StreamId; }
+
+	int64 GetTotalSize() const { return TotalSize; }
+
+	/** Bytes the receiver has confirmed */
+	int64 GetAckedOffset() const;
+
+	bool IsFinished() const;
+
+	/** Called whenever the receiver confirms more bytes */
+	TFunction<void(int64 AckedBytes, int64 TotalSize)> OnProgress;
+
+	/** Called once, after the end ack or on the first error */
+	TFunction<void(bool bSuccess, const FString& Error)> OnComplete;
+
+private:
+	/** Starts a pool task that reads and emits chunks while there are credits */
+	void Pump();
+	void SendChunks();
+	void HandleOpenAck(int32 InGeneration, const sio::message::list& Response);
+	void HandleChunkAck(int32 InGeneration, const sio::message::list& Response);
+	void HandleEndAck(int32 InGeneration, const sio::message::list& Response);
+	void Finish(bool bSuccess, const FString& Error);
+	void RunCallback(TFunction<void()> Callback);
+
+	/** Reads offset/error from an ack, returns false on error */
+	static bool ParseAck(const sio::message::list& Response, int64& OutOffset, FString& OutError);
+
+	sio::message::ptr MakeHeader(int64 Offset) const;
+
+	TSharedPtr<sio::client> Client;
+	std::string StdEventName;
+	std::string StdNamespace;
+	FString StreamId;
+	int64 TotalSize;
+	FReadFunction ReadFunction;
+	FSIOStreamSettings Settings;
+
+	mutable FCriticalSection Lock;
+	int64 NextOffset;
+	int64 AckedOffset;
+	int32 InFlight;
+	int32 Window;
+	int32 NextSeq;
+	int32 Generation;
+	bool bOpen;
+	bool bEndSent;
+	bool bFinished;
+	bool bReading;
+};
+
+/** Receiving side of a stream, see FSIOUploadStream for the wire format */
+struct SOCKETIOCLIENT_API FSIODownloadHandlers
+{
+	/** A stream was opened, ResumeOffset > 0 if it continues an earlier transfer */
+	TFunction<void(const FString& StreamId, int64 TotalSize, int64 ResumeOffset)> OnOpen;
+
+	/** Each chunk in order. The buffer shares the received frame, no copy. */
+	TFunction<void(const FString& StreamId, int64 Offset, const FSIOBuffer& Chunk)> OnChunk;
+
+	/** Stream ended. With spilling, FilePath is where the blob was written. */
+	TFunction<void(const FString& StreamId, bool bSuccess, int64 TotalSize, const FString& FilePath)> OnComplete;
+
+	/** If set, chunks are appended to SpillDirectory/StreamId as they arrive */
+	FString SpillDirectory;
+
+	FSIOStreamSettings Settings;
+};
+
+class SOCKETIOCLIENT_API FSIODownloadReader : public TSharedFromThis<FSIODownloadReader, ESPMode::ThreadSafe>
+{
+public:
+	FSIODownloadReader(const FSIODownloadHandlers& InHandlers);
+
+	/** Bind the open/chunk/end events on the given socket */
+	void Bind(sio::socket::ptr const& Socket, const FString& EventName);
+
+	/** Bytes received so far for a stream, 0 if unknown */
+	int64 GetReceivedOffset(const FString& StreamId) const;
+
+private:
+	struct FStreamState
+	{
+		int64 TotalSize = 0;
+		int64 ReceivedOffset = 0;
+		FString FilePath;
+		bool bFailed = false;
+	};
+
+	sio::message::list HandleOpen(const sio::message::list& Args);
+	sio::message::list HandleChunk(const sio::message::list& Args);
+	sio::message::list HandleEnd(const sio::message::list& Args);
+
+	static sio::message::list MakeAck(int64 Offset, const FString& Error = FString());
+	void RunCallback(TFunction<void()> Callback);
+
+	FSIODownloadHandlers Handlers;
+
+	mutable FCriticalSection Lock;
+	TMap<FString, FStreamState> Streams;
+};
@@ -14,6 +14,7 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FSIOCOpenEventSignature, FString,
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FSIOCCloseEventSignature, TEnumAsByte<ESIOConnectionCloseReason>, Reason);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FSIOCEventJsonSignature, FString, EventName, class USIOJsonValue*, EventData);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FSIOConnectionProblemSignature, int32, Attempts, int32,  NextAttemptInMs, float, TimeSinceConnected);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FSIOCReplayFinishedSignature, int32, Frames);
 
 //For Direct Delegate Event Bind
 DECLARE_DYNAMIC_DELEGATE_OneParam(FSIOJsonValueSignature, USIOJsonValue*, EventData);
@@ -62,6 +63,10 @@ public:
 	UPROPERTY(BlueprintAssignable, Category = "SocketIO Events")
 	FSIOCEventSignature OnFail;
 
+	/** Received when ReplayTrafficCapture has fed all frames, or was stopped. */
+	UPROPERTY(BlueprintAssignable, Category = "SocketIO Events")
+	FSIOCReplayFinishedSignature OnReplayFinished;
+
 
 	/**
 	* Default connection params used on e.g. on begin play. Can be updated and re-used on custom connection.
@@ -101,6 +106,17 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SocketIO Connection Properties")
 	int32 ReconnectionDelayInMs;
 
+	/** Longest wait between reconnection attempts */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SocketIO Connection Properties")
+	int32 ReconnectionDelayMaxInMs;
+
+	/**
+	* How the wait grows between reconnection attempts. Jitter keeps many clients from
+	* reconnecting in lockstep after a server restart. A server's retry-after hint is added on top.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SocketIO Connection Properties")
+	ESIOReconnectBackoff ReconnectionBackoff;
+
 	/**
 	* Number of times the connection should try before giving up.
 	* Default: infinity, this means you never truly disconnect, just suffer connection problems 
@@ -117,6 +133,42 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SocketIO Connection Properties")
 	bool bVerboseConnectionLog;
 
+	/** permessage-deflate negotiation settings, applied on connect */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SocketIO Connection Properties")
+	FSIOCompressionSettings CompressionSettings;
+
+	/** Busy polling and placement of the network thread, for latency sensitive connections. Applied on connect. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SocketIO Connection Properties")
+	FSIONetworkThreadSettings NetworkThreadSettings;
+
+	/** Compression offered for binary attachments. Only used if the server echoes it back on namespace connect. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SocketIO Connection Properties")
+	ESIOAttachmentCodec AttachmentCodec;
+
+	/** Binary attachments smaller than this are sent uncompressed */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SocketIO Connection Properties")
+	int32 MinAttachmentCompressSize;
+
+	/** Packet encoding, must match the parser the server uses */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SocketIO Connection Properties")
+	ESIOWireCodec WireCodec;
+
+	/** Received attachments of at least this many bytes are kept in a memory mapped temp file instead of the heap. 0 disables spilling. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SocketIO Connection Properties")
+	int64 AttachmentSpillThreshold;
+
+	/** Disconnect if a binary packet buffers more than this many heap bytes while waiting for its attachments. 0 = unlimited. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SocketIO Connection Properties")
+	int64 MaxPartialPacketBytes;
+
+	/** Trace received events from socket read to handler end, see GetMetrics latency and GetTraceSamples */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SocketIO Connection Properties")
+	bool bEnableLatencyTracing;
+
+	/** Keep every Nth finished trace as a sample, 0 keeps none */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SocketIO Connection Properties")
+	int32 TraceSampleOneIn;
+
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SocketIO Scope Properties")
 	bool bLimitConnectionToGameWorld;
@@ -203,6 +255,57 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "SocketIO Functions")
 	void LeaveNamespace(const FString& Namespace);
 
+	/**
+	* Bytes saved and CPU time spent by permessage-deflate since this client was created
+	*/
+	UFUNCTION(BlueprintPure, Category = "SocketIO Functions")
+	FSIOCompressionStats GetCompressionStats();
+
+	/**
+	* Per namespace and per event traffic, encode/decode timings, ack round trips and queue depth.
+	* Byte rates are measured since the previous call.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "SocketIO Functions")
+	FSIOMetrics GetMetrics();
+
+	/**
+	* Sampled per event traces, oldest first. Requires bEnableLatencyTracing and TraceSampleOneIn > 0.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "SocketIO Functions")
+	TArray<FSIOPacketTrace> GetTraceSamples();
+
+	/**
+	* Write sampled traces as CSV, one row per event with per stage durations
+	*
+	* @param FilePath	absolute output path
+	*/
+	UFUNCTION(BlueprintCallable, Category = "SocketIO Functions")
+	bool SaveTraceSamples(const FString& FilePath);
+
+	/**
+	* Record every websocket frame sent or received to a binary capture file, for ReplayTrafficCapture
+	*
+	* @param FilePath	absolute output path, overwritten
+	*/
+	UFUNCTION(BlueprintCallable, Category = "SocketIO Functions")
+	bool StartTrafficCapture(const FString& FilePath);
+
+	UFUNCTION(BlueprintCallable, Category = "SocketIO Functions")
+	void StopTrafficCapture();
+
+	/**
+	* Replay the received frames of a capture through decode and your bound events while disconnected.
+	* Nothing is sent, connection events don't fire. OnReplayFinished fires at the end.
+	*
+	* @param FilePath	capture written by StartTrafficCapture
+	* @param bRealtime	keep the captured pacing, otherwise replay as fast as possible
+	*/
+	UFUNCTION(BlueprintCallable, Category = "SocketIO Functions")
+	bool ReplayTrafficCapture(const FString& FilePath, bool bRealtime = true);
+
+	UFUNCTION(BlueprintCallable, Category = "SocketIO Functions")
+	void StopTrafficReplay();
+
 	//
 	//Blueprint Functions
 	//
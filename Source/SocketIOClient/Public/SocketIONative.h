@@ -8,6 +8,8 @@
 #include "SIOJsonValue.h"
 #include "SIOJConvert.h"
 #include "SIOMessageConvert.h"
+#include "SIOBuffer.h"
+#include "SIOStream.h"
 #include "CoreMinimal.h"
 
 UENUM(BlueprintType)
@@ -65,6 +67,12 @@ public:
 	/** in milliseconds, default is 5000 */
 	uint32 ReconnectionDelay;
 
+	/** in milliseconds, the longest wait between attempts. Default is 25000 */
+	uint32 ReconnectionDelayMax;
+
+	/** How the wait grows between attempts. A server's retry-after hint is added on top. Set before connecting */
+	ESIOReconnectBackoff ReconnectionBackoff;
+
 	/** Whether this instance has a currently live connection to the server. */
 	bool bIsConnected;
 
@@ -89,17 +97,88 @@ public:
 	/** If at initialization forcing is set true, it will use TLS despite URL used */
 	bool bForceTLSUse;
 
+	/** Set true if connection currently runs over a unix domain socket (unix:// URL) */
+	bool bIsSetupForUnixSocket;
+
 	/** If true will attempt to verify certificate (NB: this currently doesn't work) */
 	bool bUsingTLSCertVerification;
 
 	/** If true all events are unbound on disconnect */
 	bool bUnbindEventsOnDisconnect;
 
+	/** permessage-deflate settings, set before connecting */
+	FSIOCompressionSettings CompressionSettings;
+
+	/** Busy polling, core affinity, priority and name of the network thread, set before connecting */
+	FSIONetworkThreadSettings NetworkThreadSettings;
+
+	/** Bytes saved and CPU time spent by permessage-deflate on this client */
+	FSIOCompressionStats GetCompressionStats() const;
+
+	/** Traffic and timing counters, byte rates are measured since the previous GetMetrics call */
+	FSIOMetrics GetMetrics();
+
+	/** Raw counters, cheap enough to poll. Restart from zero if the client is re-created for a TLS mode change. */
+	sio::metrics_snapshot GetMetricsSnapshot() const;
+
+	/** Stamp received events from socket read to handler end, aggregated per event into GetMetrics().Namespaces[..].Latency */
+	bool bEnableLatencyTracing;
+
+	/** Keep every Nth finished trace for GetTraceSamples, 0 keeps none */
+	int32 TraceSampleOneIn;
+
+	/** Newest samples kept */
+	int32 TraceSampleCapacity;
+
+	/** Apply the tracing fields above now, they are also applied on connect */
+	void ApplyLatencyTracing();
+
+	/** Sampled traces, oldest first */
+	TArray<FSIOPacketTrace> GetTraceSamples() const;
+
+	/** Write sampled traces as CSV with per stage durations in microseconds. Returns false if the file can't be written. */
+	bool SaveTraceSamples(const FString& FilePath) const;
+
+	/** Log every websocket frame with timestamp, direction and opcode to a binary file until StopCapture. Returns false if the file can't be opened. */
+	bool StartCapture(const FString& FilePath);
+
+	void StopCapture();
+
+	/**
+	* Feed the received frames of a capture back through decode and event dispatch, including game thread handlers.
+	* Only while disconnected; nothing is sent and connection events are skipped.
+	*
+	* @param bRealtime	keep the captured pacing, otherwise replay as fast as frames decode
+	* @param OnFinished	called on the game thread with the number of frames replayed
+	*/
+	bool ReplayCapture(const FString& FilePath, bool bRealtime, TFunction<void(int32)> OnFinished = nullptr);
+
+	void StopReplay();
+
+	/** Codec offered to the server for binary attachments, set before connecting */
+	ESIOAttachmentCodec AttachmentCodec;
+
+	/** Attachments smaller than this many bytes are never compressed */
+	int32 MinAttachmentCompressSize;
+
+	/** True once the server accepted AttachmentCodec for this connection */
+	bool IsAttachmentCodecActive() const;
+
+	/** Packet encoding, set before connecting */
+	ESIOWireCodec WireCodec;
+
+	/** Inbound attachments this size or larger are spilled to a mapped temp file, 0 keeps all in memory */
+	int64 AttachmentSpillThreshold;
+
+	/** Close the connection if a binary packet buffers more than this many bytes, 0 = unlimited */
+	int64 MaxPartialPacketBytes;
+
 	/**
 	* Connect to a socket.io server, optional method if auto-connect is set to true.
 	* Overloaded function where you don't care about query and headers
 	*
-	* @param AddressAndPort	the address in URL format with port
+	* @param AddressAndPort	the address in URL format with port, or unix:///path/to/server.sock
+	*						for a server on the same host listening on a unix domain socket
 	*
 	*/
 	void Connect(const FString& InAddressAndPort = TEXT(""));
@@ -316,6 +395,19 @@ public:
 		int32 DataLength,
 		const FString& Namespace = TEXT("/"));
 
+	/**
+	* Emit a binary message without copying it into the socket.io message. The buffer is
+	* referenced until it has been masked into the outgoing websocket frame, don't modify it after calling.
+	*
+	* @param EventName				Event name
+	* @param Data					Shared buffer, kept alive until sent
+	* @param Namespace				Optional Namespace within socket.io
+	*/
+	void EmitBinary(
+		const FString& EventName,
+		const TSharedRef<TArray<uint8>, ESPMode::ThreadSafe>& Data,
+		const FString& Namespace = TEXT("/"));
+
 
 	/**
 	* Call function callback on receiving socket event. C++ only.
@@ -359,6 +451,52 @@ public:
 		TFunction< void(const FString&, const TArray<uint8>&)> CallbackFunction,
 		const FString& Namespace = TEXT("/"));
 
+	/**
+	* Call function callback on receiving binary event without copying the payload. C++ only.
+	* The buffer shares the received websocket frame, keep it as long as you need the bytes.
+	* NB: Does not get added to FSocketIONative event map (use OnEvent)!
+	*
+	* @param EventName	Event name
+	* @param TFunction	Lambda callback, receives a read-only view of the attachment
+	* @param Namespace	Optional namespace, defaults to default namespace
+	*/
+	void OnBinaryBufferEvent(
+		const FString& EventName,
+		TFunction< void(const FString&, const FSIOBuffer&)> CallbackFunction,
+		const FString& Namespace = TEXT("/"));
+
+	/**
+	* Open a chunked upload of TotalSize bytes, read on demand through ReadFunction.
+	* Call Start() on the returned stream to begin, and again after a reconnect to resume. C++ only.
+	*
+	* @param EventName		Base event name, see SIOStream.h for the sub events
+	* @param TotalSize		Blob size in bytes
+	* @param ReadFunction	Chunk reader, e.g. FSIOUploadStream::FileReader
+	* @param Settings		Chunk size, in-flight window and callback thread
+	* @param StreamId		Id of an earlier stream to resume, generated if empty
+	* @param Namespace		Optional namespace, defaults to default namespace
+	*/
+	TSharedPtr<FSIOUploadStream, ESPMode::ThreadSafe> OpenUploadStream(
+		const FString& EventName,
+		int64 TotalSize,
+		FSIOUploadStream::FReadFunction ReadFunction,
+		const FSIOStreamSettings& Settings = FSIOStreamSettings(),
+		const FString& StreamId = TEXT(""),
+		const FString& Namespace = TEXT("/"));
+
+	/**
+	* Receive chunked streams the server sends on EventName. Chunks are acked as they arrive,
+	* delivered through Handlers.OnChunk and optionally appended to a spill file. C++ only.
+	*
+	* @param EventName	Base event name, see SIOStream.h for the sub events
+	* @param Handlers	Callbacks and spill settings
+	* @param Namespace	Optional namespace, defaults to default namespace
+	*/
+	TSharedPtr<FSIODownloadReader, ESPMode::ThreadSafe> OnDownloadStream(
+		const FString& EventName,
+		const FSIODownloadHandlers& Handlers,
+		const FString& Namespace = TEXT("/"));
+
 	/**
 	* Unbinds currently bound callback from given event.
 	*
@@ -368,6 +506,9 @@ public:
 
 protected:
 
+	/** Runs a received event's callback on the game thread and carries its latency trace across the hop */
+	void RunEventOnGameThread(TFunction<void()> Callback);
+
 	/** On disconnect or mode change bound events become invalid */
 	void ClearInternalCallbacks();
 
@@ -379,14 +520,22 @@ protected:
 	/** Checks for https prepend */
 	bool IsTLSURL(const FString& URL);
 
-	/** If non-matching mode, this will:
+	/** Checks for unix:// or ws+unix:// prepend */
+	bool IsUnixSocketURL(const FString& URL);
+
+	/** If non-matching mode (TLS, plain or unix socket), this will:
 	- close the connection
 	- clear and re-link internal callbacks
 	- re-construct PrivateClient in the correct mode
-	NB: URL preference overwritten if bForceTLSUse is true*/
+	NB: URL preference overwritten if bForceTLSUse is true, except for unix sockets*/
 	void SyncPrivateClientToTLSMode(const FString& URL);
 
-	void InitPrivateClient(const bool bShouldUseTlsLibraries = false, const bool bShouldVerifyTLSCertificate = false);
+	void InitPrivateClient(const bool bShouldUseTlsLibraries = false, const bool bShouldVerifyTLSCertificate = false, const bool bShouldUseUnixSocket = false);
 
 	TSharedPtr<sio::client> PrivateClient;
+
+	/** Frame totals at the previous GetMetrics call, for rates */
+	FCriticalSection MetricsLock;
+	sio::traffic_counters LastMetricsFrames;
+	uint64 LastMetricsMicros;
 };
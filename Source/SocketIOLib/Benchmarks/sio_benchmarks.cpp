@@ -0,0 +1,953 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+//
+//  sio_benchmarks.cpp
+//
+//  Google Benchmark suite for the protocol core hot paths, built by CMakeLists.txt
+//  with -DSIO_BUILD_BENCHMARKS=ON. Every case reports allocs_per_op next to time.
+//
+//  Machine readable results for regression tracking:
+//      sio_benchmarks --benchmark_out=sio_core.json --benchmark_out_format=json
+//
+
+#define ASIO_STANDALONE
+#define _WEBSOCKETPP_CPP11_STL_
+
+#include "sio_client.h"
+#include "sio_packet.h"
+#include "sio_msgpack_codec.h"
+#include "sio_capture.h"
+#include "sio_simd.h"
+
+#include <benchmark/benchmark.h>
+#include <websocketpp/server.hpp>
+#include <websocketpp/config/core.hpp>
+#include <websocketpp/frame.hpp>
+#include <websocketpp/utf8_validator.hpp>
+#include <asio.hpp>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <map>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <zlib.h>
+
+// Counts heap allocations of the calling thread, the codecs run on the benchmark thread.
+static thread_local uint64_t t_allocations = 0;
+
+void* operator new(size_t size)
+{
+    ++t_allocations;
+    if (void* p = malloc(size ? size : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+    free(p);
+}
+
+namespace
+{
+    using namespace sio;
+
+    enum corpus_kind
+    {
+        corpus_small_event,     // chat sized event, a few scalars
+        corpus_large_object,    // nested object with arrays, ~20 KB of JSON
+        corpus_binary_heavy     // small header and four 64 KB attachments
+    };
+
+    const char* corpus_name(int kind)
+    {
+        switch (kind)
+        {
+        case corpus_small_event: return "small_event";
+        case corpus_large_object: return "large_object";
+        default: return "binary_heavy";
+        }
+    }
+
+    message::ptr make_corpus(int kind)
+    {
+        message::list args;
+        if (kind == corpus_small_event)
+        {
+            message::ptr obj = object_message::create();
+            obj->get_map()["user"] = string_message::create("player_42");
+            obj->get_map()["text"] = string_message::create("gg well played");
+            obj->get_map()["ts"] = int_message::create(1700000000123);
+            args.push(obj);
+        }
+        else if (kind == corpus_large_object)
+        {
+            message::ptr root = object_message::create();
+            message::ptr entities = array_message::create();
+            for (int i = 0; i < 100; ++i)
+            {
+                message::ptr entity = object_message::create();
+                entity->get_map()["id"] = int_message::create(i);
+                entity->get_map()["name"] = string_message::create("entity_" + std::to_string(i));
+                entity->get_map()["alive"] = bool_message::create(i % 3 != 0);
+                message::ptr pos = array_message::create();
+                pos->get_vector().push_back(double_message::create(i * 1.5));
+                pos->get_vector().push_back(double_message::create(i * -2.25));
+                pos->get_vector().push_back(double_message::create(100.0 + i));
+                entity->get_map()["pos"] = pos;
+                message::ptr tags = object_message::create();
+                tags->get_map()["team"] = string_message::create(i % 2 ? "red" : "blue");
+                tags->get_map()["score"] = int_message::create(i * 10);
+                entity->get_map()["tags"] = tags;
+                entities->get_vector().push_back(entity);
+            }
+            root->get_map()["entities"] = entities;
+            root->get_map()["tick"] = int_message::create(123456);
+            args.push(root);
+        }
+        else
+        {
+            message::ptr obj = object_message::create();
+            obj->get_map()["codec"] = string_message::create("opus");
+            obj->get_map()["frames"] = int_message::create(4);
+            args.push(obj);
+            for (int i = 0; i < 4; ++i)
+            {
+                args.push(std::make_shared<const std::string>(64 * 1024, static_cast<char>('a' + i)));
+            }
+        }
+        return args.to_array_message("bench");
+    }
+
+    struct encoded_frame
+    {
+        std::shared_ptr<const std::string> payload;
+        bool binary;
+    };
+
+    std::vector<encoded_frame> encode_corpus(packet_codec const& codec, int kind)
+    {
+        std::vector<encoded_frame> frames;
+        packet pack("/", make_corpus(kind));
+        codec.encode(pack, [&frames](bool binary, frame_buffer const& buffer)
+        {
+            frames.push_back({ std::make_shared<const std::string>(buffer.data, buffer.size), binary });
+        });
+        return frames;
+    }
+
+    size_t frame_bytes(std::vector<encoded_frame> const& frames)
+    {
+        size_t bytes = 0;
+        for (encoded_frame const& frame : frames)
+        {
+            bytes += frame.payload->size();
+        }
+        return bytes;
+    }
+
+    template<typename codec_type>
+    void encode_benchmark(benchmark::State& state)
+    {
+        codec_type codec;
+        const int kind = static_cast<int>(state.range(0));
+        message::ptr msg = make_corpus(kind);
+        size_t bytes = 0;
+        uint64_t allocations = 0;
+        for (auto _ : state)
+        {
+            uint64_t before = t_allocations;
+            packet pack("/", msg);
+            codec.encode(pack, [&bytes](bool, frame_buffer const& buffer)
+            {
+                bytes += buffer.size;
+                benchmark::DoNotOptimize(buffer.data);
+            });
+            allocations += t_allocations - before;
+        }
+        state.SetLabel(corpus_name(kind));
+        state.SetBytesProcessed(static_cast<int64_t>(bytes));
+        state.SetItemsProcessed(state.iterations());
+        state.counters["allocs_per_op"] = benchmark::Counter(static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+    }
+
+    template<typename codec_type>
+    void decode_benchmark(benchmark::State& state)
+    {
+        codec_type codec;
+        const int kind = static_cast<int>(state.range(0));
+        std::vector<encoded_frame> frames = encode_corpus(codec, kind);
+        uint64_t allocations = 0;
+        for (auto _ : state)
+        {
+            uint64_t before = t_allocations;
+            std::unique_ptr<packet> decoded;
+            for (encoded_frame const& frame : frames)
+            {
+                decoded = codec.decode(frame.payload, frame.binary);
+            }
+            if (!decoded)
+            {
+                state.SkipWithError("corpus did not decode to a packet");
+                break;
+            }
+            benchmark::DoNotOptimize(decoded->get_message());
+            decoded.reset();
+            allocations += t_allocations - before;
+        }
+        state.SetLabel(corpus_name(kind));
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * frame_bytes(frames)));
+        state.SetItemsProcessed(state.iterations());
+        state.counters["allocs_per_op"] = benchmark::Counter(static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+    }
+
+    // FCompression's LZ4 and Zlib are engine only, SocketIOTools' SIOBenchmarks covers both. This is
+    // zlib at the same level, through the json codec's header and escape handling.
+    class zlib_attachment_codec : public attachment_codec
+    {
+    public:
+        std::string const& get_name() const override
+        {
+            static const std::string name("zlib");
+            return name;
+        }
+
+        bool compress(char const* in, size_t in_size, std::string& out) override
+        {
+            uLongf size = compressBound(static_cast<uLong>(in_size));
+            out.resize(size);
+            if (compress2(reinterpret_cast<Bytef*>(&out[0]), &size, reinterpret_cast<Bytef const*>(in), static_cast<uLong>(in_size), Z_DEFAULT_COMPRESSION) != Z_OK)
+            {
+                return false;
+            }
+            out.resize(size);
+            return true;
+        }
+
+        bool decompress(char const* in, size_t in_size, size_t raw_size, std::string& out) override
+        {
+            out.resize(raw_size);
+            uLongf size = static_cast<uLongf>(raw_size);
+            return raw_size == 0 || (uncompress(reinterpret_cast<Bytef*>(&out[0]), &size, reinterpret_cast<Bytef const*>(in), static_cast<uLong>(in_size)) == Z_OK && size == raw_size);
+        }
+    };
+
+    // range(0) 0 compresses the binary_heavy attachments on encode, 1 inflates them on decode.
+    void BM_AttachmentCodec(benchmark::State& state)
+    {
+        const bool decode = state.range(0) == 1;
+        json_codec codec;
+        codec.set_attachment_codec(std::make_shared<zlib_attachment_codec>());
+        codec.set_attachment_codec_active(true);
+        message::ptr msg = make_corpus(corpus_binary_heavy);
+        size_t raw_bytes = 0;
+        for (message::ptr const& arg : msg->get_vector())
+        {
+            if (arg->get_flag() == message::flag_binary)
+            {
+                raw_bytes += arg->get_binary()->size();
+            }
+        }
+        std::vector<encoded_frame> frames = encode_corpus(codec, corpus_binary_heavy);
+        size_t wire_bytes = 0;
+        for (encoded_frame const& frame : frames)
+        {
+            wire_bytes += frame.binary ? frame.payload->size() : 0;
+        }
+
+        uint64_t allocations = 0;
+        for (auto _ : state)
+        {
+            uint64_t before = t_allocations;
+            if (decode)
+            {
+                std::unique_ptr<packet> decoded;
+                for (encoded_frame const& frame : frames)
+                {
+                    decoded = codec.decode(frame.payload, frame.binary);
+                }
+                if (!decoded)
+                {
+                    state.SkipWithError(codec.get_error().empty() ? "corpus did not decode to a packet" : codec.get_error().c_str());
+                    break;
+                }
+                benchmark::DoNotOptimize(decoded->get_message());
+            }
+            else
+            {
+                packet pack("/", msg);
+                codec.encode(pack, [](bool, frame_buffer const& buffer) { benchmark::DoNotOptimize(buffer.data); });
+            }
+            allocations += t_allocations - before;
+        }
+        state.SetLabel(decode ? "zlib/decode" : "zlib/encode");
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * raw_bytes));
+        state.counters["compression_ratio"] = wire_bytes > 0 ? static_cast<double>(raw_bytes) / wire_bytes : 0.0;
+        // inverted rate of raw gigabytes: wall nanoseconds per raw byte
+        state.counters["ns_per_byte"] = benchmark::Counter(static_cast<double>(state.iterations() * raw_bytes) * 1e-9, benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+        state.counters["allocs_per_op"] = benchmark::Counter(static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+    }
+
+    void BM_JsonEncode(benchmark::State& state) { encode_benchmark<json_codec>(state); }
+    void BM_JsonDecode(benchmark::State& state) { decode_benchmark<json_codec>(state); }
+    void BM_MsgpackEncode(benchmark::State& state) { encode_benchmark<msgpack_codec>(state); }
+    void BM_MsgpackDecode(benchmark::State& state) { decode_benchmark<msgpack_codec>(state); }
+
+    const int kReplayEvents = 2000;
+
+    // Small events as a capture, replay feeds them through on_frame -> decode -> socket dispatch.
+    std::string replay_corpus_path()
+    {
+        static std::string path;
+        if (path.empty())
+        {
+            const char* dir = getenv("TMPDIR");
+            path = std::string(dir ? dir : "/tmp") + "/sio_bench_replay.siocap";
+            json_codec codec;
+            std::vector<encoded_frame> frames = encode_corpus(codec, corpus_small_event);
+            capture_writer writer;
+            writer.open(path);
+            for (int i = 0; i < kReplayEvents; ++i)
+            {
+                for (encoded_frame const& frame : frames)
+                {
+                    writer.write(capture_inbound, frame.binary ? 2 : 1, frame.payload->data(), frame.payload->size());
+                }
+            }
+            writer.close();
+        }
+        return path;
+    }
+
+    // Dispatch while range(0) threads keep binding and unbinding listeners on the same socket,
+    // the way game code rebinds events during play.
+    void BM_DispatchUnderContention(benchmark::State& state)
+    {
+        const std::string path = replay_corpus_path();
+        sio::client sio_client;
+        sio_client.set_logs_quiet();
+        sio::socket::ptr sock = sio_client.socket("/");
+        std::atomic<int64_t> handled(0);
+        sock->on("bench", sio::socket::event_listener([&handled](sio::event&)
+        {
+            handled.fetch_add(1, std::memory_order_relaxed);
+        }));
+
+        std::atomic<bool> stop(false);
+        std::vector<std::thread> churners;
+        for (int64_t i = 0; i < state.range(0); ++i)
+        {
+            churners.emplace_back([&sock, &stop, i]()
+            {
+                const std::string name = "churn_" + std::to_string(i);
+                while (!stop.load(std::memory_order_relaxed))
+                {
+                    sock->on(name, sio::socket::event_listener([](sio::event&) {}));
+                    sock->off(name);
+                }
+            });
+        }
+
+        for (auto _ : state)
+        {
+            std::promise<size_t> done;
+            std::future<size_t> finished = done.get_future();
+            if (!sio_client.replay_capture(path, false, [&done](size_t frames) { done.set_value(frames); }))
+            {
+                state.SkipWithError("replay_capture failed");
+                break;
+            }
+            finished.wait();
+        }
+
+        stop = true;
+        for (std::thread& churner : churners)
+        {
+            churner.join();
+        }
+        state.SetItemsProcessed(handled.load());
+    }
+
+    // Live connection over a memory_pipe: frames -> packet_manager -> socket dispatch, and with
+    // range(0) = 1 every handler emits a reply back through encode and send. No sockets involved.
+    void BM_MemoryPipeEvents(benchmark::State& state)
+    {
+        const bool reply = state.range(0) != 0;
+        json_codec codec;
+        std::vector<encoded_frame> frames = encode_corpus(codec, corpus_small_event);
+
+        sio::memory_pipe::ptr pipe = sio::memory_pipe::create();
+        std::atomic<int64_t> replies(0);
+        pipe->set_connect_listener([&pipe](std::string const&, std::map<std::string, std::string> const&)
+        {
+            pipe->send("0{\"sid\":\"bench\",\"pingInterval\":25000,\"pingTimeout\":60000}", false);
+            return true;
+        });
+        pipe->set_frame_listener([&pipe, &replies](char const* data, size_t size, bool)
+        {
+            if (size >= 2 && data[0] == '4' && data[1] == '0')
+            {
+                pipe->send("40{\"sid\":\"bench_ns\"}", false);
+            }
+            else if (size >= 2 && data[0] == '4' && data[1] == '2')
+            {
+                replies.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+
+        sio::client sio_client(pipe);
+        sio_client.set_logs_quiet();
+        std::promise<void> joined;
+        sio_client.set_socket_open_listener([&joined](std::string const&) { joined.set_value(); });
+        sio::socket::ptr sock = sio_client.socket("/");
+        std::atomic<int64_t> handled(0);
+        sock->on("bench", sio::socket::event_listener([&handled, &sock, reply](sio::event& ev)
+        {
+            handled.fetch_add(1, std::memory_order_relaxed);
+            if (reply)
+            {
+                sock->emit("bench_reply", ev.get_message());
+            }
+        }));
+        sio_client.connect("http://127.0.0.1");
+        joined.get_future().wait();
+
+        int64_t expected = 0;
+        for (auto _ : state)
+        {
+            for (int i = 0; i < kReplayEvents; ++i)
+            {
+                for (encoded_frame const& frame : frames)
+                {
+                    pipe->send(frame.payload, frame.binary);
+                }
+            }
+            expected += kReplayEvents;
+            while (handled.load(std::memory_order_relaxed) < expected || (reply && replies.load(std::memory_order_relaxed) < expected))
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        sio_client.sync_close();
+        state.SetItemsProcessed(handled.load());
+    }
+
+    // Emits from the benchmark thread into a memory_pipe that only counts frames. network_allocs_per_emit
+    // is what the client's network thread allocates per emit (the posted send and everything it runs),
+    // allocs_per_emit what the emitting thread does, encoding included. Both after a warm up batch.
+    void BM_EmitAllocations(benchmark::State& state)
+    {
+        sio::memory_pipe::ptr pipe = sio::memory_pipe::create();
+        std::atomic<int64_t> frames(0);
+        std::atomic<uint64_t> network_allocations(0);
+        pipe->set_connect_listener([&pipe](std::string const&, std::map<std::string, std::string> const&)
+        {
+            pipe->send("0{\"sid\":\"bench\",\"pingInterval\":25000,\"pingTimeout\":60000}", false);
+            return true;
+        });
+        pipe->set_frame_listener([&pipe, &frames, &network_allocations](char const* data, size_t size, bool)
+        {
+            if (size >= 2 && data[0] == '4' && data[1] == '0')
+            {
+                pipe->send("40{\"sid\":\"bench_ns\"}", false);
+                return;
+            }
+            // runs on the network thread, so this is its own counter
+            network_allocations.store(t_allocations, std::memory_order_relaxed);
+            frames.fetch_add(1, std::memory_order_release);
+        });
+
+        sio::client sio_client(pipe);
+        sio_client.set_logs_quiet();
+        std::promise<void> joined;
+        sio_client.set_socket_open_listener([&joined](std::string const&) { joined.set_value(); });
+        sio::socket::ptr sock = sio_client.socket("/");
+        sio_client.connect("http://127.0.0.1");
+        joined.get_future().wait();
+
+        sio::message::list payload(std::string(64, 'x'));
+        int64_t expected = 0;
+        auto emit_batch = [&]()
+        {
+            for (int i = 0; i < kReplayEvents; ++i)
+            {
+                sock->emit("bench", payload);
+            }
+            expected += kReplayEvents;
+            while (frames.load(std::memory_order_acquire) < expected)
+            {
+                std::this_thread::yield();
+            }
+        };
+
+        emit_batch();
+        const uint64_t network_start = network_allocations.load(std::memory_order_relaxed);
+        uint64_t allocations = 0;
+        for (auto _ : state)
+        {
+            const uint64_t before = t_allocations;
+            emit_batch();
+            allocations += t_allocations - before;
+        }
+        const uint64_t network = network_allocations.load(std::memory_order_relaxed) - network_start;
+
+        sio_client.sync_close();
+        state.SetItemsProcessed(state.iterations() * kReplayEvents);
+        state.counters["allocs_per_emit"] = benchmark::Counter(static_cast<double>(allocations) / kReplayEvents, benchmark::Counter::kAvgIterations);
+        state.counters["network_allocs_per_emit"] = benchmark::Counter(static_cast<double>(network) / kReplayEvents, benchmark::Counter::kAvgIterations);
+        // the warm-up batch filled the pools, after that the send path must not allocate
+        if (network > 0)
+        {
+            state.SkipWithError("network thread allocated after warm-up");
+        }
+    }
+
+    enum frame_kernel
+    {
+        kernel_websocketpp,     // the loops websocketpp's processor runs
+        kernel_scalar,          // sio_simd.h portable kernel
+        kernel_dispatched       // sio_simd.h kernel picked for this CPU
+    };
+
+    // Multi-megabyte JSON text, range(1) = 0 all ASCII, 1 with non-ASCII chat text in every object
+    std::string make_large_text_frame(bool multi_byte)
+    {
+        std::string out = "42[\"state\",[";
+        for (int i = 0; out.size() < 4 * 1024 * 1024; ++i)
+        {
+            out += "{\"id\":" + std::to_string(i) + ",\"name\":\"entity_" + std::to_string(i) + "\",\"pos\":[1.5,-2.25,100.0],\"text\":\"";
+            out += multi_byte ? "gg \xc3\xa9t\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80" : "gg well played";
+            out += "\"},";
+        }
+        out.back() = ']';
+        out += "]";
+        return out;
+    }
+
+    // Client frame masking over range(1) MB, the one pass over every outgoing payload byte
+    void BM_FrameMask(benchmark::State& state)
+    {
+        const size_t size = static_cast<size_t>(state.range(1)) * 1024 * 1024;
+        std::vector<uint8_t> in(size, 0x5a);
+        std::vector<uint8_t> out(size);
+        websocketpp::frame::masking_key_type key;
+        key.i = 0x12345678;
+        for (auto _ : state)
+        {
+            switch (state.range(0))
+            {
+            case kernel_websocketpp: websocketpp::frame::word_mask_exact(in.data(), out.data(), size, key); break;
+            case kernel_scalar: sio::mask_copy_scalar(in.data(), out.data(), size, key.i); break;
+            default: sio::mask_copy(in.data(), out.data(), size, key.i); break;
+            }
+            benchmark::DoNotOptimize(out.data());
+            benchmark::ClobberMemory();
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * size);
+        state.SetLabel(state.range(0) == kernel_dispatched ? sio::simd_kernel_name() : state.range(0) == kernel_scalar ? "scalar" : "websocketpp");
+    }
+
+    // UTF-8 validation of a ~4 MB text frame, websocketpp does this on every text frame it sends or receives
+    void BM_Utf8Validate(benchmark::State& state)
+    {
+        const std::string text = make_large_text_frame(state.range(1) != 0);
+        for (auto _ : state)
+        {
+            bool valid;
+            switch (state.range(0))
+            {
+            case kernel_websocketpp: valid = websocketpp::utf8_validator::validate(text); break;
+            case kernel_scalar: valid = sio::is_valid_utf8_scalar(text.data(), text.size()); break;
+            default: valid = sio::is_valid_utf8(text.data(), text.size()); break;
+            }
+            if (!valid)
+            {
+                state.SkipWithError("corpus is not valid UTF-8");
+                break;
+            }
+            benchmark::DoNotOptimize(valid);
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * text.size());
+        state.SetLabel(state.range(0) == kernel_dispatched ? sio::simd_kernel_name() : state.range(0) == kernel_scalar ? "scalar" : "websocketpp");
+    }
+
+    inline void tune_socket(asio::ip::tcp::socket& socket)
+    {
+        // the server writes frame header and payload separately, Nagle would hold the payload for an ACK
+        socket.set_option(asio::ip::tcp::no_delay(true));
+    }
+
+    template<typename socket_type>
+    inline void tune_socket(socket_type&) {}
+
+    // Just enough engine.io/socket.io to open a namespace and ack events. websocketpp runs on its
+    // iostream transport so the TCP and unix socket variants differ only in the socket underneath.
+    template<typename protocol>
+    class ack_server
+    {
+    public:
+        typedef websocketpp::server<websocketpp::config::core> server_type;
+
+        explicit ack_server(typename protocol::endpoint const& endpoint) :
+            m_acceptor(m_io_service, endpoint)
+        {
+            m_server.clear_access_channels(websocketpp::log::alevel::all);
+            m_server.clear_error_channels(websocketpp::log::elevel::all);
+            m_server.set_write_handler([this](websocketpp::connection_hdl hdl, char const* data, size_t size)
+            {
+                auto it = m_sessions.find(hdl.lock().get());
+                if (it != m_sessions.end())
+                {
+                    asio::error_code ec;
+                    asio::write(it->second->socket, asio::buffer(data, size), ec);
+                }
+                return websocketpp::lib::error_code();
+            });
+            m_server.set_open_handler([this](websocketpp::connection_hdl hdl)
+            {
+                m_server.send(hdl, "0{\"sid\":\"bench\",\"pingInterval\":25000,\"pingTimeout\":60000}", websocketpp::frame::opcode::text);
+            });
+            m_server.set_message_handler([this](websocketpp::connection_hdl hdl, server_type::message_ptr msg)
+            {
+                on_message(hdl, msg->get_payload());
+            });
+            accept();
+            m_thread = std::thread([this]() { m_io_service.run(); });
+        }
+
+        ~ack_server()
+        {
+            m_io_service.stop();
+            m_thread.join();
+        }
+
+        typename protocol::endpoint local_endpoint() const { return m_acceptor.local_endpoint(); }
+
+    private:
+        struct session
+        {
+            explicit session(asio::io_service& io_service) : socket(io_service), buffer(64 * 1024) {}
+
+            typename protocol::socket socket;
+            server_type::connection_ptr con;
+            std::vector<char> buffer;
+        };
+
+        void accept()
+        {
+            std::shared_ptr<session> s = std::make_shared<session>(m_io_service);
+            m_acceptor.async_accept(s->socket, [this, s](asio::error_code const& ec)
+            {
+                if (ec)
+                {
+                    return;
+                }
+                tune_socket(s->socket);
+                s->con = m_server.get_connection();
+                m_sessions[s->con.get()] = s;
+                s->con->start();
+                read(s);
+                accept();
+            });
+        }
+
+        void read(std::shared_ptr<session> const& s)
+        {
+            s->socket.async_read_some(asio::buffer(s->buffer), [this, s](asio::error_code const& ec, size_t bytes)
+            {
+                if (ec)
+                {
+                    s->con->eof();
+                    m_sessions.erase(s->con.get());
+                    return;
+                }
+                s->con->read_all(s->buffer.data(), bytes);
+                read(s);
+            });
+        }
+
+        void on_message(websocketpp::connection_hdl hdl, std::string const& payload)
+        {
+            if (payload.compare(0, 2, "40") == 0)
+            {
+                m_server.send(hdl, "40{\"sid\":\"bench_ns\"}", websocketpp::frame::opcode::text);
+            }
+            else if (payload.compare(0, 2, "42") == 0 && payload.size() > 2 && payload[2] >= '0' && payload[2] <= '9')
+            {
+                // 42<ack id>["bench",...] is answered with 43<ack id>[], events without ack id get nothing
+                m_server.send(hdl, "43" + payload.substr(2, payload.find('[') - 2) + "[]", websocketpp::frame::opcode::text);
+            }
+        }
+
+        asio::io_service m_io_service;
+        typename protocol::acceptor m_acceptor;
+        server_type m_server;
+        // keyed by connection, only touched on the server thread
+        std::map<void*, std::shared_ptr<session>> m_sessions;
+        std::thread m_thread;
+    };
+
+    inline std::string endpoint_url(asio::ip::tcp::endpoint const& endpoint)
+    {
+        return "http://127.0.0.1:" + std::to_string(endpoint.port());
+    }
+
+#if defined(ASIO_HAS_LOCAL_SOCKETS)
+    inline std::string endpoint_url(asio::local::stream_protocol::endpoint const& endpoint)
+    {
+        return "unix://" + endpoint.path();
+    }
+#endif
+
+    template<typename protocol>
+    void round_trip_benchmark(benchmark::State& state, typename protocol::endpoint const& endpoint, sio::client& sio_client)
+    {
+        ack_server<protocol> server(endpoint);
+        const std::string url = endpoint_url(server.local_endpoint());
+        sio_client.set_logs_quiet();
+        std::promise<void> joined;
+        sio_client.set_socket_open_listener([&joined](std::string const&) { joined.set_value(); });
+        sio::socket::ptr sock = sio_client.socket("/");
+        sio_client.connect(url);
+        if (joined.get_future().wait_for(std::chrono::seconds(5)) != std::future_status::ready)
+        {
+            state.SkipWithError("connect failed");
+            return;
+        }
+
+        sio::message::list payload(std::string(64, 'x'));
+        std::atomic<bool> acked(false);
+        for (auto _ : state)
+        {
+            acked.store(false, std::memory_order_relaxed);
+            sock->emit("bench", payload, [&acked](sio::message::list const&) { acked.store(true, std::memory_order_release); });
+            while (!acked.load(std::memory_order_acquire))
+            {
+                std::this_thread::yield();
+            }
+        }
+        sio_client.sync_close();
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // Emit -> ack latency against the same server over loopback TCP (0), a unix domain socket (1)
+    // and loopback TCP with a busy polling network thread (2).
+    void BM_TransportRoundTrip(benchmark::State& state)
+    {
+        if (state.range(0) != 1)
+        {
+            sio::client sio_client;
+            if (state.range(0) == 2)
+            {
+                sio::client::network_thread_options options;
+                options.busy_poll = true;
+                sio_client.set_network_thread_options(options);
+            }
+            round_trip_benchmark<asio::ip::tcp>(state, asio::ip::tcp::endpoint(asio::ip::address_v4::loopback(), 0), sio_client);
+            return;
+        }
+#if defined(ASIO_HAS_LOCAL_SOCKETS)
+        if (!sio::client::has_unix_sockets())
+        {
+            state.SkipWithError("no unix domain sockets");
+            return;
+        }
+        const char* dir = getenv("TMPDIR");
+        const std::string path = std::string(dir ? dir : "/tmp") + "/sio_bench.sock";
+        unlink(path.c_str());
+        sio::client sio_client(sio::client::unix_socket_t{});
+        round_trip_benchmark<asio::local::stream_protocol>(state, asio::local::stream_protocol::endpoint(path), sio_client);
+        unlink(path.c_str());
+#else
+        state.SkipWithError("no unix domain sockets");
+#endif
+    }
+    // Pipelined emit -> ack throughput over loopback TCP with range(0) clients, each on its own
+    // network thread, keeping kWindow acks outstanding. Compare builds with and without SIO_IO_URING,
+    // the io_backend context line says which one ran.
+    void BM_LoopbackThroughput(benchmark::State& state)
+    {
+        static const int kWindow = 256;
+        const int client_count = static_cast<int>(state.range(0));
+
+        ack_server<asio::ip::tcp> server(asio::ip::tcp::endpoint(asio::ip::address_v4::loopback(), 0));
+        const std::string url = endpoint_url(server.local_endpoint());
+
+        std::vector<std::unique_ptr<sio::client>> clients;
+        std::vector<sio::socket::ptr> sockets;
+        std::vector<std::future<void>> joins;
+        for (int i = 0; i < client_count; ++i)
+        {
+            clients.emplace_back(new sio::client());
+            sio::client& sio_client = *clients.back();
+            sio_client.set_logs_quiet();
+            std::shared_ptr<std::promise<void>> joined = std::make_shared<std::promise<void>>();
+            joins.push_back(joined->get_future());
+            sio_client.set_socket_open_listener([joined](std::string const&) { joined->set_value(); });
+            sockets.push_back(sio_client.socket("/"));
+            sio_client.connect(url);
+        }
+        for (std::future<void>& joined : joins)
+        {
+            if (joined.wait_for(std::chrono::seconds(5)) != std::future_status::ready)
+            {
+                state.SkipWithError("connect failed");
+                return;
+            }
+        }
+
+        sio::message::list payload(std::string(64, 'x'));
+        std::atomic<int64_t> acked(0);
+        int64_t expected = 0;
+        for (auto _ : state)
+        {
+            for (int window = 0; window < kWindow; ++window)
+            {
+                for (sio::socket::ptr const& sock : sockets)
+                {
+                    sock->emit("bench", payload, [&acked](sio::message::list const&) { acked.fetch_add(1, std::memory_order_release); });
+                }
+            }
+            expected += static_cast<int64_t>(kWindow) * client_count;
+            while (acked.load(std::memory_order_acquire) < expected)
+            {
+                std::this_thread::yield();
+            }
+        }
+        for (std::unique_ptr<sio::client>& sio_client : clients)
+        {
+            sio_client->sync_close();
+        }
+        state.SetItemsProcessed(expected);
+    }
+
+    // BM_EmitAllocations over a real websocket on loopback TCP. Each batch emits events without ack
+    // (send path only) and then one with ack, whose callback samples the network thread's counter on
+    // that thread. An empty batch is just that round trip, subtracting it leaves the send cost per emit.
+    // Batches stay below the connection's message pool, bursts beyond it go to the heap by design.
+    void BM_WebsocketAllocations(benchmark::State& state)
+    {
+        static const int kBatch = 32;
+
+        ack_server<asio::ip::tcp> server(asio::ip::tcp::endpoint(asio::ip::address_v4::loopback(), 0));
+        sio::client sio_client;
+        sio_client.set_logs_quiet();
+        std::promise<void> joined;
+        sio_client.set_socket_open_listener([&joined](std::string const&) { joined.set_value(); });
+        sio::socket::ptr sock = sio_client.socket("/");
+        sio_client.connect(endpoint_url(server.local_endpoint()));
+        if (joined.get_future().wait_for(std::chrono::seconds(5)) != std::future_status::ready)
+        {
+            state.SkipWithError("connect failed");
+            return;
+        }
+
+        sio::message::list payload(std::string(64, 'x'));
+        std::atomic<int64_t> acked(0);
+        std::atomic<uint64_t> network_allocations(0);
+        int64_t expected = 0;
+        // network thread allocations since the previous batch's ack
+        auto batch = [&](int events)
+        {
+            const uint64_t start = network_allocations.load(std::memory_order_acquire);
+            for (int i = 0; i < events; ++i)
+            {
+                sock->emit("bench", payload);
+            }
+            sock->emit("flush", payload, [&network_allocations, &acked](sio::message::list const&)
+            {
+                network_allocations.store(t_allocations, std::memory_order_relaxed);
+                acked.fetch_add(1, std::memory_order_release);
+            });
+            ++expected;
+            while (acked.load(std::memory_order_acquire) < expected)
+            {
+                std::this_thread::yield();
+            }
+            return network_allocations.load(std::memory_order_relaxed) - start;
+        };
+
+        // fills the message pool, the handler pools and websocketpp's write buffers
+        for (int i = 0; i < 8; ++i)
+        {
+            batch(kBatch);
+            batch(0);
+        }
+        uint64_t send_allocations = 0;
+        uint64_t round_trip_allocations = 0;
+        for (auto _ : state)
+        {
+            const uint64_t full = batch(kBatch);
+            const uint64_t empty = batch(0);
+            send_allocations += full > empty ? full - empty : 0;
+            round_trip_allocations += empty;
+        }
+
+        sio_client.sync_close();
+        state.SetItemsProcessed(state.iterations() * kBatch);
+        state.counters["network_allocs_per_emit"] = benchmark::Counter(static_cast<double>(send_allocations) / kBatch, benchmark::Counter::kAvgIterations);
+        // one emit plus its ack, decoding the ack into a message tree is the bulk of it
+        state.counters["network_allocs_per_round_trip"] = benchmark::Counter(static_cast<double>(round_trip_allocations), benchmark::Counter::kAvgIterations);
+        // pooled messages leave websocketpp's send queue, a deque that takes a node every few dozen frames
+        if (send_allocations * 2 >= static_cast<uint64_t>(state.iterations()) * kBatch)
+        {
+            state.SkipWithError("websocket send path allocates per emit");
+        }
+    }
+}
+
+BENCHMARK(BM_JsonEncode)->DenseRange(corpus_small_event, corpus_binary_heavy);
+BENCHMARK(BM_JsonDecode)->DenseRange(corpus_small_event, corpus_binary_heavy);
+BENCHMARK(BM_MsgpackEncode)->DenseRange(corpus_small_event, corpus_binary_heavy);
+BENCHMARK(BM_MsgpackDecode)->DenseRange(corpus_small_event, corpus_binary_heavy);
+BENCHMARK(BM_AttachmentCodec)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_DispatchUnderContention)->Arg(0)->Arg(1)->Arg(4)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_MemoryPipeEvents)->Arg(0)->Arg(1)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_EmitAllocations)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_WebsocketAllocations)->UseRealTime()->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_FrameMask)->ArgsProduct({ { kernel_websocketpp, kernel_scalar, kernel_dispatched }, { 1, 8 } })->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_Utf8Validate)->ArgsProduct({ { kernel_websocketpp, kernel_scalar, kernel_dispatched }, { 0, 1 } })->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_TransportRoundTrip)->Arg(0)->Arg(1)->Arg(2)->UseRealTime()->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_LoopbackThroughput)->Arg(1)->Arg(8)->Arg(32)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+int main(int argc, char** argv)
+{
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    {
+        return 1;
+    }
+    benchmark::AddCustomContext("io_backend", sio::client::io_backend());
+    benchmark::AddCustomContext("simd_kernel", sio::simd_kernel_name());
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
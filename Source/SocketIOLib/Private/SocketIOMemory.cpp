@@ -0,0 +1,19 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+
+
+#include "SocketIOMemory.h"
+#include "Stats/Stats.h"
+
+//Only the parent rolls up into the 'stat LLM' summary, subsystems are listed in 'stat LLMFULL'
+DECLARE_LLM_MEMORY_STAT(TEXT("SocketIO"), STAT_SocketIOLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("SocketIO"), STAT_SocketIOSummaryLLM, STATGROUP_LLM);
+DECLARE_LLM_MEMORY_STAT(TEXT("SocketIO/Network"), STAT_SocketIONetworkLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("SocketIO/Messages"), STAT_SocketIOMessagesLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("SocketIO/PacketQueue"), STAT_SocketIOPacketQueueLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("SocketIO/Json"), STAT_SocketIOJsonLLM, STATGROUP_LLMFULL);
+
+LLM_DEFINE_TAG(SocketIO, NAME_None, NAME_None, GET_STATFNAME(STAT_SocketIOLLM), GET_STATFNAME(STAT_SocketIOSummaryLLM));
+LLM_DEFINE_TAG(SocketIO_Network, TEXT("SocketIO/Network"), TEXT("SocketIO"), GET_STATFNAME(STAT_SocketIONetworkLLM));
+LLM_DEFINE_TAG(SocketIO_Messages, TEXT("SocketIO/Messages"), TEXT("SocketIO"), GET_STATFNAME(STAT_SocketIOMessagesLLM));
+LLM_DEFINE_TAG(SocketIO_PacketQueue, TEXT("SocketIO/PacketQueue"), TEXT("SocketIO"), GET_STATFNAME(STAT_SocketIOPacketQueueLLM));
+LLM_DEFINE_TAG(SocketIO_Json, TEXT("SocketIO/Json"), TEXT("SocketIO"), GET_STATFNAME(STAT_SocketIOJsonLLM));
@@ -0,0 +1,34 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+
+
+#include "SocketIOTrace.h"
+#include "HAL/PlatformTLS.h"
+#include "HAL/PlatformTime.h"
+
+UE_TRACE_CHANNEL_DEFINE(SocketIOChannel);
+
+UE_TRACE_EVENT_BEGIN(SocketIO, Packet)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint64, Size)
+	UE_TRACE_EVENT_FIELD(uint8, Inbound)
+	UE_TRACE_EVENT_FIELD(UE::Trace::AnsiString, Namespace)
+	UE_TRACE_EVENT_FIELD(UE::Trace::AnsiString, EventName)
+UE_TRACE_EVENT_END()
+
+void SocketIOTrace::OutputPacket(bool bInbound, const std::string& Namespace, const std::string* EventName, uint64 Size)
+{
+	UE_TRACE_LOG(SocketIO, Packet, SocketIOChannel)
+		<< Packet.Cycle(FPlatformTime::Cycles64())
+		<< Packet.Size(Size)
+		<< Packet.Inbound(bInbound ? 1 : 0)
+		<< Packet.Namespace(Namespace.c_str(), (int32)Namespace.size())
+		<< Packet.EventName(EventName ? EventName->c_str() : "", EventName ? (int32)EventName->size() : 0);
+}
+
+void SocketIOTrace::RegisterNetworkThread()
+{
+#if UE_TRACE_ENABLED
+	//sort after engine threads, every client gets its own row under the same name
+	UE::Trace::ThreadRegister(TEXT("SocketIO Network"), FPlatformTLS::GetCurrentThreadId(), 1000);
+#endif
+}
@@ -0,0 +1,121 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+//
+//  sio_capture.cpp
+//
+
+#include "sio_capture.h"
+#include <cstring>
+
+namespace sio
+{
+    using namespace std;
+
+    namespace
+    {
+        const char kMAGIC[6] = { 'S', 'I', 'O', 'C', 'A', 'P' };
+
+        const size_t kRECORD_HEADER_SIZE = 8 + 1 + 1 + 4;
+
+        void put_le(char* out, uint64_t value, size_t bytes)
+        {
+            for (size_t i = 0; i < bytes; ++i)
+            {
+                out[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+            }
+        }
+
+        uint64_t get_le(char const* in, size_t bytes)
+        {
+            uint64_t value = 0;
+            for (size_t i = 0; i < bytes; ++i)
+            {
+                value |= static_cast<uint64_t>(static_cast<unsigned char>(in[i])) << (8 * i);
+            }
+            return value;
+        }
+    }
+
+    capture_writer::capture_writer() :
+        m_open(false)
+    {
+    }
+
+    capture_writer::~capture_writer()
+    {
+        close();
+    }
+
+    bool capture_writer::open(string const& path)
+    {
+        lock_guard<mutex> guard(m_mutex);
+        if (m_file.is_open())
+        {
+            m_file.close();
+        }
+        m_file.open(path, ios::binary | ios::trunc);
+        if (!m_file.is_open())
+        {
+            m_open = false;
+            return false;
+        }
+        char header[sizeof(kMAGIC) + 2];
+        memcpy(header, kMAGIC, sizeof(kMAGIC));
+        put_le(header + sizeof(kMAGIC), version, 2);
+        m_file.write(header, sizeof(header));
+        m_start = chrono::steady_clock::now();
+        m_open = true;
+        return true;
+    }
+
+    void capture_writer::close()
+    {
+        lock_guard<mutex> guard(m_mutex);
+        m_open = false;
+        if (m_file.is_open())
+        {
+            m_file.close();
+        }
+    }
+
+    void capture_writer::write(capture_direction direction, uint8_t opcode, char const* data, size_t size)
+    {
+        lock_guard<mutex> guard(m_mutex);
+        if (!m_file.is_open())
+        {
+            return;
+        }
+        uint64_t micros = static_cast<uint64_t>(chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - m_start).count());
+        char header[kRECORD_HEADER_SIZE];
+        put_le(header, micros, 8);
+        header[8] = static_cast<char>(direction);
+        header[9] = static_cast<char>(opcode);
+        put_le(header + 10, size, 4);
+        m_file.write(header, sizeof(header));
+        m_file.write(data, static_cast<streamsize>(size));
+    }
+
+    bool capture_reader::open(string const& path)
+    {
+        m_file.open(path, ios::binary);
+        char header[sizeof(kMAGIC) + 2];
+        if (!m_file.read(header, sizeof(header)) || memcmp(header, kMAGIC, sizeof(kMAGIC)) != 0)
+        {
+            return false;
+        }
+        return get_le(header + sizeof(kMAGIC), 2) == capture_writer::version;
+    }
+
+    bool capture_reader::next(capture_record& out)
+    {
+        char header[kRECORD_HEADER_SIZE];
+        if (!m_file.read(header, sizeof(header)))
+        {
+            return false;
+        }
+        out.micros = get_le(header, 8);
+        out.direction = static_cast<capture_direction>(header[8]);
+        out.opcode = static_cast<uint8_t>(header[9]);
+        out.payload.resize(static_cast<size_t>(get_le(header + 10, 4)));
+        return out.payload.empty() || static_cast<bool>(m_file.read(&out.payload[0], static_cast<streamsize>(out.payload.size())));
+    }
+}
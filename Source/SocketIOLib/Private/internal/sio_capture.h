@@ -0,0 +1,81 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+//
+//  sio_capture.h
+//
+//  Websocket frame log behind client::start_capture() and replay_capture().
+//
+//  File layout, all integers little endian:
+//      header  "SIOCAP" u16 version
+//      record  u64 micros since capture start | u8 direction | u8 opcode | u32 size | payload
+//
+
+#ifndef SIO_CAPTURE_H
+#define SIO_CAPTURE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+
+namespace sio
+{
+    enum capture_direction : uint8_t
+    {
+        capture_inbound = 0,
+        capture_outbound = 1
+    };
+
+    struct capture_record
+    {
+        uint64_t micros = 0;
+        capture_direction direction = capture_inbound;
+        uint8_t opcode = 0;         // websocketpp frame::opcode
+        std::string payload;
+    };
+
+    // Appends frames from any thread. Frames are buffered by the stream and flushed on close.
+    class capture_writer
+    {
+    public:
+        static const uint16_t version = 1;
+
+        capture_writer();
+
+        ~capture_writer();
+
+        // Truncates the file. False if it can't be opened.
+        bool open(std::string const& path);
+
+        void close();
+
+        bool is_open() const { return m_open.load(std::memory_order_relaxed); }
+
+        void write(capture_direction direction, uint8_t opcode, char const* data, size_t size);
+
+    private:
+        std::mutex m_mutex;
+
+        std::ofstream m_file;
+
+        std::atomic<bool> m_open;
+
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    class capture_reader
+    {
+    public:
+        // False if the file can't be opened or isn't a capture.
+        bool open(std::string const& path);
+
+        // False at the end of the file or on a truncated record.
+        bool next(capture_record& out);
+
+    private:
+        std::ifstream m_file;
+    };
+}
+
+#endif // SIO_CAPTURE_H
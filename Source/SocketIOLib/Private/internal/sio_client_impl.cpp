@@ -26,21 +26,16 @@
 #define _WEBSOCKETPP_CPP11_STL_
 
 #include "sio_client_impl.h"
+#include "sio_thread.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
 #include <sstream>
 #include <mutex>
 #include <cmath>
 
-// Comment this out to disable handshake logging to stdout
-#define SIO_LIB_DEBUG 0
-
 using namespace std;
 
-#if defined(SIO_LIB_DEBUG) && SIO_LIB_DEBUG
-#define DEBUG_LOG(CategoryName, Verbosity, Format, ...) UE_LOG(CategoryName, Verbosity, Format, ##__VA_ARGS__)
-#else
-#define DEBUG_LOG(CategoryName, Verbosity, Format, ...)
-#endif
-
 #define LOG(x)
 
 using std::chrono::milliseconds;
@@ -48,49 +43,60 @@ using std::chrono::milliseconds;
 namespace sio
 {
     /*************************public:*************************/
-    template<typename client_type>
-    client_impl<client_type>::client_impl() :
+    template<typename transport_type>
+    client_impl<transport_type>::client_impl() :
         m_ping_interval(0),
         m_ping_timeout(0),
         m_network_thread(),
+        m_metrics(std::make_shared<metrics_recorder>()),
+        m_inbound_packet_bytes(0),
+        m_inbound_packet_received(0),
+        m_inbound_packet_decoded(0),
         m_con_state(con_closed),
         m_reconn_delay(5000),
         m_reconn_delay_max(25000),
         m_reconn_attempts(0xFFFFFFFF),
         m_reconn_made(0),
-        m_path("socket.io")
+        m_reconn_backoff(client::backoff_exponential),
+        m_reconn_prev_delay(0),
+        m_retry_after(0),
+        m_reconn_rng(std::random_device()()),
+        m_path("socket.io"),
+        m_wire_codec(client::wire_codec_json),
+        m_network_running(false),
+        m_replaying(false),
+        m_replay_cancel(false)
     {
-        using websocketpp::log::alevel;
-#ifndef DEBUG
-        m_client.clear_access_channels(alevel::all);
-        m_client.set_access_channels(alevel::connect | alevel::disconnect | alevel::app);
-#endif
-        // Initialize the Asio transport policy
-        m_client.init_asio();
-
-        // Bind the clients we are using
+        // Bind the transport we are using
         using std::placeholders::_1;
         using std::placeholders::_2;
 
-        m_client.set_open_handler(std::bind(&client_impl<client_type>::on_open, this, _1));
-        m_client.set_close_handler(std::bind(&client_impl<client_type>::on_close, this, _1));
-        m_client.set_fail_handler(std::bind(&client_impl<client_type>::on_fail, this, _1));
-        m_client.set_message_handler(std::bind(&client_impl<client_type>::on_message, this, _1, _2));
-        m_packet_mgr.set_decode_callback(std::bind(&client_impl<client_type>::on_decode, this, _1));
-        m_packet_mgr.set_encode_callback(std::bind(&client_impl<client_type>::on_encode, this, _1, _2));
+        transport_handlers handlers;
+        handlers.on_open = std::bind(&client_impl<transport_type>::on_open, this);
+        handlers.on_close = std::bind(&client_impl<transport_type>::on_close, this, _1, _2);
+        handlers.on_fail = std::bind(&client_impl<transport_type>::on_fail, this, _1);
+        handlers.on_frame = std::bind(&client_impl<transport_type>::on_message, this, _1, _2);
+        m_transport.set_handlers(handlers);
+        m_packet_mgr.set_decode_callback(std::bind(&client_impl<transport_type>::on_decode, this, _1));
+        m_packet_mgr.set_encode_callback(std::bind(&client_impl<transport_type>::on_encode, this, _1, _2));
+        m_packet_mgr.set_error_callback(std::bind(&client_impl<transport_type>::on_packet_error, this, _1));
+        m_packet_mgr.set_metrics(m_metrics.get());
         template_init();
     }
 
-    template<typename client_type>
-    client_impl<client_type>::~client_impl()
+    template<typename transport_type>
+    client_impl<transport_type>::~client_impl()
     {
+        stop_replay();
         this->sockets_invoke_void(socket_on_close());
         sync_close();
     }
 
-    template<typename client_type>
-    void client_impl<client_type>::connect(const string& uri, const map<string, string>& query, const map<string, string>& headers, const message::ptr& auth, const std::string& path /*= "socket.io"*/)
+    template<typename transport_type>
+    void client_impl<transport_type>::connect(const string& uri, const map<string, string>& query, const map<string, string>& headers, const message::ptr& auth, const std::string& path /*= "socket.io"*/)
     {
+        // replay drives the packet manager from its own thread, it can't overlap a live connection
+        stop_replay();
 
         if (m_reconn_timer)
         {
@@ -139,13 +145,14 @@ namespace sio
         }
 
         this->reset_states();
-        m_client.get_io_service().dispatch(std::bind(&client_impl<client_type>::connect_impl, this, m_base_url, m_query_string));
-        m_network_thread.reset(new thread(std::bind(&client_impl<client_type>::run_loop, this)));//uri lifecycle?
+        m_transport.get_io_service().dispatch(make_alloc_handler(m_handler_memory, std::bind(&client_impl<transport_type>::connect_impl, this, m_base_url, m_query_string)));
+        m_network_running = true;
+        m_network_thread.reset(new thread(std::bind(&client_impl<transport_type>::run_loop, this)));//uri lifecycle?
 
     }
 
-    template<typename client_type>
-    socket::ptr const& client_impl<client_type>::socket(string const& nsp)
+    template<typename transport_type>
+    socket::ptr const& client_impl<transport_type>::socket(string const& nsp)
     {
         lock_guard<mutex> guard(m_socket_mutex);
         string aux;
@@ -176,20 +183,20 @@ namespace sio
         }
     }
 
-    template<typename client_type>
-    void client_impl<client_type>::close()
+    template<typename transport_type>
+    void client_impl<transport_type>::close()
     {
         m_con_state = con_closing;
         this->sockets_invoke_void(&sio::socket::close);
-        m_client.get_io_service().dispatch(std::bind(&client_impl<client_type>::close_impl, this, close::status::normal, "End by user"));
+        m_transport.get_io_service().dispatch(make_alloc_handler(m_handler_memory, std::bind(&client_impl<transport_type>::close_impl, this, close::status::normal, "End by user")));
     }
 
-    template<typename client_type>
-    void client_impl<client_type>::sync_close()
+    template<typename transport_type>
+    void client_impl<transport_type>::sync_close()
     {
         m_con_state = con_closing;
         this->sockets_invoke_void(&sio::socket::close);
-        m_client.get_io_service().dispatch(std::bind(&client_impl<client_type>::close_impl, this, close::status::normal, "End by user"));
+        m_transport.get_io_service().dispatch(make_alloc_handler(m_handler_memory, std::bind(&client_impl<transport_type>::close_impl, this, close::status::normal, "End by user")));
         if (m_network_thread)
         {
             m_network_thread->join();
@@ -197,34 +204,42 @@ namespace sio
         }
     }
 
-    template<typename client_type>
-    void client_impl<client_type>::set_logs_default()
+    template<typename transport_type>
+    void client_impl<transport_type>::set_logs_default()
     {
-        m_client.clear_access_channels(websocketpp::log::alevel::all);
-        m_client.set_access_channels(websocketpp::log::alevel::connect | websocketpp::log::alevel::disconnect | websocketpp::log::alevel::app);
+        m_transport.set_logs_default();
     }
 
-    template<typename client_type>
-    void client_impl<client_type>::set_logs_quiet()
+    template<typename transport_type>
+    void client_impl<transport_type>::set_logs_quiet()
     {
-        m_client.clear_access_channels(websocketpp::log::alevel::all);
+        m_transport.set_logs_quiet();
     }
 
-    template<typename client_type>
-    void client_impl<client_type>::set_logs_verbose()
+    template<typename transport_type>
+    void client_impl<transport_type>::set_logs_verbose()
     {
-        m_client.set_access_channels(websocketpp::log::alevel::all);
+        m_transport.set_logs_verbose();
     }
 
     /*************************protected:*************************/
-    template<typename client_type>
-    void client_impl<client_type>::send(packet& p)
+    template<typename transport_type>
+    void client_impl<transport_type>::send(packet& p)
     {
-        m_packet_mgr.encode(p);
+        // may run on any emitting thread, count into a local and attribute the packet once
+        SIO_LLM_SCOPE(SocketIO_Network);
+        size_t bytes = 0;
+        m_packet_mgr.encode(p, [&](bool isBin, frame_buffer const& payload)
+            {
+                bytes += payload.size;
+                this->on_encode(isBin, payload);
+            });
+        m_metrics->record_packet_out(p, bytes);
+        SocketIOTrace::OutputPacket(false, p.get_nsp(), metrics_recorder::event_name(p), bytes);
     }
 
-    template<typename client_type>
-    void client_impl<client_type>::remove_socket(string const& nsp)
+    template<typename transport_type>
+    void client_impl<transport_type>::remove_socket(string const& nsp)
     {
         lock_guard<mutex> guard(m_socket_mutex);
         auto it = m_sockets.find(nsp);
@@ -234,65 +249,110 @@ namespace sio
         }
     }
 
-    template<typename client_type>
-    asio::io_service& client_impl<client_type>::get_io_service()
+    template<typename transport_type>
+    asio::io_service& client_impl<transport_type>::get_io_service()
     {
-        return m_client.get_io_service();
+        return m_transport.get_io_service();
     }
 
-    template<typename client_type>
-    void client_impl<client_type>::on_socket_closed(string const& nsp)
+    template<typename transport_type>
+    void client_impl<transport_type>::on_socket_closed(string const& nsp)
     {
         if (m_socket_close_listener)m_socket_close_listener(nsp);
     }
 
-    template<typename client_type>
-    void client_impl<client_type>::on_socket_opened(string const& nsp)
+    template<typename transport_type>
+    void client_impl<transport_type>::on_socket_opened(string const& nsp)
     {
         if (m_socket_open_listener)m_socket_open_listener(nsp);
     }
 
     /*************************private:*************************/
-    template<typename client_type>
-    void client_impl<client_type>::run_loop()
+    template<typename transport_type>
+    void client_impl<transport_type>::run_loop()
     {
+        // every websocketpp processor (and so every deflate extension) is created on this thread
+        deflate_context::current() = &m_deflate;
+        SocketIOTrace::RegisterNetworkThread();
+        SIO_LLM_SCOPE(SocketIO_Network);
+
+        if (m_thread_options.cpu_affinity >= 0 && !set_current_thread_affinity(m_thread_options.cpu_affinity))
+        {
+            LOG("Could not pin the network thread to cpu " << m_thread_options.cpu_affinity << endl);
+        }
+        if (m_thread_options.priority != 0 && !set_current_thread_priority(m_thread_options.priority))
+        {
+            LOG("Could not set the network thread priority to " << m_thread_options.priority << endl);
+        }
+        if (!m_thread_options.name.empty())
+        {
+            set_current_thread_name(m_thread_options.name);
+        }
 
-        m_client.run();
-        m_client.reset();
-        m_client.get_alog().write(websocketpp::log::alevel::devel,
-            "run loop end");
+        if (m_thread_options.busy_poll)
+        {
+            busy_poll(m_transport.get_io_service(), m_thread_options.spin_polls, m_thread_options.max_backoff_micros);
+        }
+        else
+        {
+            m_transport.run();
+        }
+        m_transport.reset();
+        m_network_running = false;
     }
 
-    template<typename client_type>
-    void client_impl<client_type>::connect_impl(const string& uri, const string& queryString)
+    template<typename transport_type>
+    void client_impl<transport_type>::connect_impl(const string& uri, const string& queryString)
     {
+        // the deflate extension reads the options while the connection below is set up
+        m_deflate.sync_options();
         do {
-            websocketpp::uri uo(uri);
             ostringstream ss;
+            std::string path("/socket.io/");
 
-            if (is_tls(uri))
+            if (is_unix_socket(uri))
             {
-                // This requires SIO_TLS to have been compiled in.
-                ss << "wss://";
+                // ws+unix://<socket path>:<resource>, see unix_transport
+                std::string target = uri.substr(uri.find("://") + 3);
+                size_t resource = target.find(':');
+                if (resource != std::string::npos)
+                {
+                    path = target.substr(resource + 1);
+                    target.resize(resource);
+                }
+                ss << "ws+unix://" << target << ":";
             }
             else
             {
-                ss << "ws://";
+                websocketpp::uri uo(uri);
+
+                if (is_tls(uri))
+                {
+                    // This requires SIO_TLS to have been compiled in.
+                    ss << "wss://";
+                }
+                else
+                {
+                    ss << "ws://";
+                }
+
+                const std::string host(uo.get_host());
+                // As per RFC2732, literal IPv6 address should be enclosed in "[" and "]".
+                if (host.find(':') != std::string::npos) {
+                    ss << "[" << uo.get_host() << "]";
+                }
+                else {
+                    ss << uo.get_host();
+                }
+                ss << ":" << uo.get_port();
+
+                // If a resource path was included in the URI, use that, otherwise
+                // use the default /socket.io/.
+                if (uo.get_resource() != "/")
+                {
+                    path = uo.get_resource();
+                }
             }
-
-            const std::string host(uo.get_host());
-            // As per RFC2732, literal IPv6 address should be enclosed in "[" and "]".
-            if (host.find(':') != std::string::npos) {
-                ss << "[" << uo.get_host() << "]";
-            }
-            else {
-                ss << uo.get_host();
-            }
-
-            // If a resource path was included in the URI, use that, otherwise
-            // use the default /socket.io/.
-            
-            std::string path(uo.get_resource() == "/" ? "/socket.io/" : uo.get_resource());
 			
             //override if m_path is set
 			if (m_path != "socket.io")
@@ -300,24 +360,14 @@ namespace sio
                 path = "/" + m_path + "/";
 			}
 
-            ss << ":" << uo.get_port() << path << "?EIO=4&transport=websocket";
+            ss << path << "?EIO=4&transport=websocket";
             if (m_sid.size() > 0) {
                 ss << "&sid=" << m_sid;
             }
             ss << "&t=" << time(NULL) << queryString;
-            lib::error_code ec;
-            typename client_type::connection_ptr con = m_client.get_connection(ss.str(), ec);
-            if (ec) {
-                m_client.get_alog().write(websocketpp::log::alevel::app,
-                    "Get Connection Error: " + ec.message());
+            if (!m_transport.connect(ss.str(), m_http_headers)) {
                 break;
             }
-
-            for (auto&& header : m_http_headers) {
-                con->replace_header(header.first, header.second);
-            }
-
-            m_client.connect(con);
             return;
         }         while (0);
         if (m_fail_listener)
@@ -326,8 +376,8 @@ namespace sio
         }
     }
 
-    template<typename client_type>
-    void client_impl<client_type>::close_impl(close::status::value const& code, string const& reason)
+    template<typename transport_type>
+    void client_impl<transport_type>::close_impl(close::status::value const& code, string const& reason)
     {
         DEBUG_LOG(LogTemp, Log, TEXT("Close by reason: %s"), *FString(reason.c_str()));
         if (m_reconn_timer)
@@ -335,68 +385,74 @@ namespace sio
             m_reconn_timer->cancel();
             m_reconn_timer.reset();
         }
-        if (m_con.expired())
+        if (!m_transport.is_open())
         {
             DEBUG_LOG(LogTemp, Warning, TEXT("close_impl::Error: No active session: %s"), *FString(reason.c_str()));
         }
         else
         {
-            lib::error_code ec;
-            m_client.close(m_con, code, reason, ec);
+            m_transport.close(code, reason);
         }
     }
 
-    template<typename client_type>
-    void client_impl<client_type>::send_impl(shared_ptr<const string> const& payload_ptr, frame::opcode::value opcode)
+    template<typename transport_type>
+    void client_impl<transport_type>::send_impl(frame_buffer const& payload, frame::opcode::value opcode)
     {
+        SIO_TRACE_SCOPE(SocketIO_SendFrame);
+        m_metrics->send_pop();
         if (m_con_state == con_opened)
         {
-            lib::error_code ec;
-            m_client.send(m_con, *payload_ptr, opcode, ec);
-            if (ec)
+            m_metrics->record_frame_out(payload.size);
+            if (m_capture.is_open())
             {
-                //DEBUG_LOG(LogTemp, Warning, TEXT("close_impl::Error: Send failed,reason: %s"), *FString(ec.message().c_str()));
+                m_capture.write(capture_outbound, static_cast<uint8_t>(opcode), payload.data, payload.size);
             }
+            // small frames cost more CPU to deflate than they save on the wire
+            m_transport.send(payload, opcode, m_deflate.should_compress(payload.size));
         }
     }
 
-    template<typename client_type>
-    void client_impl<client_type>::ping(const asio::error_code& ec)
+    template<typename transport_type>
+    void client_impl<transport_type>::ping(const asio::error_code& ec)
     {
-        if (ec || m_con.expired())
+        if (ec || !m_transport.is_open())
         {
             if (ec != asio::error::operation_aborted)
-                //LOG("ping exit,con is expired?" << m_con.expired() << ",ec:" << ec.message() << endl);
+                //LOG("ping exit,con is open?" << m_transport.is_open() << ",ec:" << ec.message() << endl);
             return;
         }
         packet p(packet::frame_ping);
-        m_packet_mgr.encode(p, [&](bool /*isBin*/, shared_ptr<const string> payload)
+        m_packet_mgr.encode(p, [&](bool /*isBin*/, frame_buffer const& payload)
             {
-                lib::error_code ec;
-                this->m_client.send(this->m_con, *payload, frame::opcode::text, ec);
+                this->m_metrics->record_frame_out(payload.size);
+                if (this->m_capture.is_open())
+                {
+                    this->m_capture.write(capture_outbound, frame::opcode::text, payload.data, payload.size);
+                }
+                this->m_transport.send(payload, frame::opcode::text, false);
             });
         if (!m_ping_timeout_timer)
         {
-            m_ping_timeout_timer.reset(new asio::steady_timer(m_client.get_io_service()));
+            m_ping_timeout_timer.reset(new asio::steady_timer(m_transport.get_io_service()));
             std::error_code timeout_ec;
             m_ping_timeout_timer->expires_from_now(milliseconds(m_ping_timeout), timeout_ec);
-            m_ping_timeout_timer->async_wait(std::bind(&client_impl<client_type>::timeout_pong, this, std::placeholders::_1));
+            m_ping_timeout_timer->async_wait(make_alloc_handler(m_handler_memory, std::bind(&client_impl<transport_type>::timeout_pong, this, std::placeholders::_1)));
         }
     }
 
-    template<typename client_type>
-    void client_impl<client_type>::timeout_pong(const asio::error_code& ec)
+    template<typename transport_type>
+    void client_impl<transport_type>::timeout_pong(const asio::error_code& ec)
     {
         if (ec)
         {
             return;
         }
         LOG("Pong timeout" << endl);
-        m_client.get_io_service().dispatch(std::bind(&client_impl<client_type>::close_impl, this, close::status::policy_violation, "Pong timeout"));
+        m_transport.get_io_service().dispatch(make_alloc_handler(m_handler_memory, std::bind(&client_impl<transport_type>::close_impl, this, close::status::policy_violation, "Pong timeout")));
     }
 
-    template<typename client_type>
-    void client_impl<client_type>::timeout_reconnect(asio::error_code const& ec)
+    template<typename transport_type>
+    void client_impl<transport_type>::timeout_reconnect(asio::error_code const& ec)
     {
         if (ec)
         {
@@ -406,23 +462,57 @@ namespace sio
         {
             m_con_state = con_opening;
             m_reconn_made++;
+            m_metrics->record_reconnect();
             this->reset_states();
             LOG("Reconnecting..." << endl);
             if (m_reconnecting_listener) m_reconnecting_listener();
-            m_client.get_io_service().dispatch(std::bind(&client_impl<client_type>::connect_impl, this, m_base_url, m_query_string));
+            m_transport.get_io_service().dispatch(make_alloc_handler(m_handler_memory, std::bind(&client_impl<transport_type>::connect_impl, this, m_base_url, m_query_string)));
         }
     }
 
-    template<typename client_type>
-    unsigned client_impl<client_type>::next_delay() const
+    template<typename transport_type>
+    unsigned client_impl<transport_type>::next_delay()
     {
-        //no jitter, fixed power root.
         unsigned reconn_made = min<unsigned>(m_reconn_made, 32);//protect the pow result to be too big.
-        return static_cast<unsigned>(min<double>(m_reconn_delay * pow(1.5, reconn_made), m_reconn_delay_max));
+        double ceiling = min<double>(m_reconn_delay * pow(1.5, reconn_made), m_reconn_delay_max);
+        double delay = ceiling;
+        switch (m_reconn_backoff)
+        {
+        case client::backoff_full_jitter:
+            delay = uniform_real_distribution<double>(0, ceiling)(m_reconn_rng);
+            break;
+        case client::backoff_equal_jitter:
+            delay = ceiling / 2 + uniform_real_distribution<double>(0, ceiling / 2)(m_reconn_rng);
+            break;
+        case client::backoff_decorrelated_jitter:
+        {
+            // the first attempt after a drop starts over from the base delay
+            double previous = m_reconn_made == 0 ? m_reconn_delay : m_reconn_prev_delay;
+            double high = max<double>(m_reconn_delay, previous * 3);
+            delay = min<double>(uniform_real_distribution<double>(m_reconn_delay, high)(m_reconn_rng), m_reconn_delay_max);
+            break;
+        }
+        default:
+            break;
+        }
+        // the server's hint is a floor, even past m_reconn_delay_max. Jittered modes spread the
+        // clients it was sent to over the hint's first tenth instead of all returning at once.
+        const double retry_after = m_retry_after;
+        m_retry_after = 0;
+        if (retry_after > delay)
+        {
+            delay = retry_after;
+            if (m_reconn_backoff != client::backoff_exponential)
+            {
+                delay += uniform_real_distribution<double>(0, retry_after / 10)(m_reconn_rng);
+            }
+        }
+        m_reconn_prev_delay = static_cast<unsigned>(delay);
+        return m_reconn_prev_delay;
     }
 
-    template<typename client_type>
-    socket::ptr client_impl<client_type>::get_socket_locked(string const& nsp)
+    template<typename transport_type>
+    socket::ptr client_impl<transport_type>::get_socket_locked(string const& nsp)
     {
         lock_guard<mutex> guard(m_socket_mutex);
         auto it = m_sockets.find(nsp);
@@ -436,8 +526,8 @@ namespace sio
         }
     }
 
-    template<typename client_type>
-    void client_impl<client_type>::sockets_invoke_void(void (sio::socket::* fn)(void))
+    template<typename transport_type>
+    void client_impl<transport_type>::sockets_invoke_void(void (sio::socket::* fn)(void))
     {
         map<const string, socket::ptr> socks;
         {
@@ -449,16 +539,16 @@ namespace sio
         }
     }
 
-    template<typename client_type>
-    void client_impl<client_type>::on_fail(connection_hdl)
+    template<typename transport_type>
+    void client_impl<transport_type>::on_fail(string const& retry_after)
     {
+        m_retry_after = parse_retry_after(retry_after);
         if (m_con_state == con_closing) {
             LOG("Connection failed while closing." << endl);
             this->close();
             return;
         }
 
-        m_con.reset();
         m_con_state = con_closed;
         this->sockets_invoke_void(socket_on_disconnect());
         LOG("Connection failed." << endl);
@@ -467,10 +557,10 @@ namespace sio
             LOG("Reconnect for attempt:" << m_reconn_made << endl);
             unsigned delay = this->next_delay();
             if (m_reconnect_listener) m_reconnect_listener(m_reconn_made, delay);
-            m_reconn_timer.reset(new asio::steady_timer(m_client.get_io_service()));
+            m_reconn_timer.reset(new asio::steady_timer(m_transport.get_io_service()));
             asio::error_code ec;
             m_reconn_timer->expires_from_now(milliseconds(delay), ec);
-            m_reconn_timer->async_wait(std::bind(&client_impl<client_type>::timeout_reconnect, this, std::placeholders::_1));
+            m_reconn_timer->async_wait(make_alloc_handler(m_handler_memory, std::bind(&client_impl<transport_type>::timeout_reconnect, this, std::placeholders::_1)));
         }
         else
         {
@@ -478,8 +568,8 @@ namespace sio
         }
     }
 
-    template<typename client_type>
-    void client_impl<client_type>::on_open(connection_hdl con)
+    template<typename transport_type>
+    void client_impl<transport_type>::on_open()
     {
         if (m_con_state == con_closing) {
             LOG("Connection opened while closing." << endl);
@@ -489,31 +579,19 @@ namespace sio
 
         LOG("Connected." << endl);
         m_con_state = con_opened;
-        m_con = con;
         m_reconn_made = 0;
         this->sockets_invoke_void(socket_on_open());
         this->socket("");
         if (m_open_listener)m_open_listener();
     }
 
-    template<typename client_type>
-    void client_impl<client_type>::on_close(connection_hdl con)
+    template<typename transport_type>
+    void client_impl<transport_type>::on_close(close::status::value code, string const& remote_reason)
     {
         LOG("Client Disconnected." << endl);
+        m_retry_after = parse_retry_after(remote_reason);
         con_state m_con_state_was = m_con_state;
         m_con_state = con_closed;
-        lib::error_code ec;
-        close::status::value code = close::status::normal;
-        typename client_type::connection_ptr conn_ptr = m_client.get_con_from_hdl(con, ec);
-        if (ec) {
-            LOG("OnClose get conn failed" << ec << endl);
-        }
-        else
-        {
-            code = conn_ptr->get_local_close_code();
-        }
-
-        m_con.reset();
         this->clear_timers();
         client::close_reason reason;
 
@@ -533,10 +611,10 @@ namespace sio
                 LOG("Reconnect for attempt:" << m_reconn_made << endl);
                 unsigned delay = this->next_delay();
                 if (m_reconnect_listener) m_reconnect_listener(m_reconn_made, delay);
-                m_reconn_timer.reset(new asio::steady_timer(m_client.get_io_service()));
+                m_reconn_timer.reset(new asio::steady_timer(m_transport.get_io_service()));
                 asio::error_code ec2;
                 m_reconn_timer->expires_from_now(milliseconds(delay), ec2);
-                m_reconn_timer->async_wait(std::bind(&client_impl<client_type>::timeout_reconnect, this, std::placeholders::_1));
+                m_reconn_timer->async_wait(make_alloc_handler(m_handler_memory, std::bind(&client_impl<transport_type>::timeout_reconnect, this, std::placeholders::_1)));
                 return;
             }
             reason = client::close_reason_drop;
@@ -548,20 +626,116 @@ namespace sio
         }
     }
 
-    template<typename client_type>
-    void client_impl<client_type>::on_message(connection_hdl, message_ptr msg)
+    template<typename transport_type>
+    void client_impl<transport_type>::on_message(shared_ptr<const string> const& payload, bool binary_frame)
     {
+        SIO_TRACE_SCOPE(SocketIO_OnMessage);
         if (m_ping_timeout_timer) {
             asio::error_code ec;
             m_ping_timeout_timer->expires_from_now(milliseconds(m_ping_timeout), ec);
-            m_ping_timeout_timer->async_wait(std::bind(&client_impl<client_type>::timeout_pong, this, std::placeholders::_1));
+            m_ping_timeout_timer->async_wait(make_alloc_handler(m_handler_memory, std::bind(&client_impl<transport_type>::timeout_pong, this, std::placeholders::_1)));
+        }
+        // Parse the incoming message according to socket.IO rules.
+        if (m_capture.is_open())
+        {
+            m_capture.write(capture_inbound, static_cast<uint8_t>(binary_frame ? frame::opcode::binary : frame::opcode::text), payload->data(), payload->size());
+        }
+        on_frame(payload, binary_frame);
+    }
+
+    template<typename transport_type>
+    void client_impl<transport_type>::on_frame(shared_ptr<const string> const& payload, bool binary_frame)
+    {
+        m_metrics->record_frame_in(payload->size());
+        if (m_inbound_packet_bytes == 0 && m_metrics->is_tracing())
+        {
+            m_inbound_packet_received = trace_clock_micros();
         }
-        // Parse the incoming message according to socket.IO rules
-        m_packet_mgr.put_payload(msg->get_payload());
+        m_inbound_packet_bytes += payload->size();
+        m_packet_mgr.put_payload(payload, binary_frame);
     }
 
-    template<typename client_type>
-    void client_impl<client_type>::on_handshake(message::ptr const& message)
+    template<typename transport_type>
+    bool client_impl<transport_type>::replay_capture(string const& path, bool realtime, client::replay_listener const& on_finished)
+    {
+        // a pending reconnect keeps the network thread alive, and its reset_states() would race the replay thread
+        if (m_con_state != con_closed || m_replaying || m_network_running)
+        {
+            LOG("Capture replay needs a closed connection and a stopped network thread." << endl);
+            return false;
+        }
+        shared_ptr<capture_reader> reader = make_shared<capture_reader>();
+        if (!reader->open(path))
+        {
+            return false;
+        }
+        if (m_replay_thread)
+        {
+            m_replay_thread->join();
+        }
+        m_replay_cancel = false;
+        m_replaying = true;
+        m_packet_mgr.reset();
+        m_inbound_packet_bytes = 0;
+        m_replay_thread.reset(new thread(std::bind(&client_impl<transport_type>::replay_loop, this, reader, realtime, on_finished)));
+        return true;
+    }
+
+    template<typename transport_type>
+    void client_impl<transport_type>::stop_replay()
+    {
+        {
+            lock_guard<mutex> guard(m_replay_mutex);
+            m_replay_cancel = true;
+        }
+        m_replay_cv.notify_all();
+        if (m_replay_thread)
+        {
+            m_replay_thread->join();
+            m_replay_thread.reset();
+        }
+    }
+
+    template<typename transport_type>
+    void client_impl<transport_type>::replay_loop(shared_ptr<capture_reader> reader, bool realtime, client::replay_listener on_finished)
+    {
+        SIO_LLM_SCOPE(SocketIO_Network);
+        size_t frames = 0;
+        capture_record record;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        while (reader->next(record))
+        {
+            if (record.direction != capture_inbound)
+            {
+                continue;
+            }
+            if (realtime)
+            {
+                unique_lock<mutex> lock(m_replay_mutex);
+                m_replay_cv.wait_until(lock, start + chrono::microseconds(record.micros), [this] { return m_replay_cancel; });
+            }
+            {
+                lock_guard<mutex> guard(m_replay_mutex);
+                if (m_replay_cancel)
+                {
+                    break;
+                }
+            }
+            on_frame(make_shared<const string>(std::move(record.payload)), record.opcode == frame::opcode::binary);
+            frames++;
+        }
+        // a capture cut mid packet must not leak into the next connection
+        m_packet_mgr.reset();
+        m_inbound_packet_bytes = 0;
+        m_replaying = false;
+        if (on_finished)
+        {
+            on_finished(frames);
+        }
+    }
+
+    template<typename transport_type>
+    void client_impl<transport_type>::on_handshake(message::ptr const& message)
     {
         if (message && message->get_flag() == message::flag_object)
         {
@@ -597,16 +771,21 @@ namespace sio
         }
     failed:
         //just close it.
-        m_client.get_io_service().dispatch(std::bind(&client_impl<client_type>::close_impl, this, close::status::policy_violation, "Handshake error"));
+        m_transport.get_io_service().dispatch(make_alloc_handler(m_handler_memory, std::bind(&client_impl<transport_type>::close_impl, this, close::status::policy_violation, "Handshake error")));
     }
 
-    template<typename client_type>
-    void client_impl<client_type>::on_ping()
+    template<typename transport_type>
+    void client_impl<transport_type>::on_ping()
     {
         packet p(packet::frame_pong);
-        m_packet_mgr.encode(p, [&](bool /*isBin*/, shared_ptr<const string> payload)
+        m_packet_mgr.encode(p, [&](bool /*isBin*/, frame_buffer const& payload)
             {
-                this->m_client.send(this->m_con, *payload, frame::opcode::text);
+                this->m_metrics->record_frame_out(payload.size);
+                if (this->m_capture.is_open())
+                {
+                    this->m_capture.write(capture_outbound, frame::opcode::text, payload.data, payload.size);
+                }
+                this->m_transport.send(payload, frame::opcode::text, false);
             });
 
         if (m_ping_timeout_timer)
@@ -616,15 +795,64 @@ namespace sio
         }
     }
 
-    template<typename client_type>
-    void client_impl<client_type>::on_decode(packet const& p)
+    template<typename transport_type>
+    void client_impl<transport_type>::dispatch_traced(socket::ptr& so_ptr, packet const& p, string const& event)
+    {
+        traced_dispatch dispatch;
+        dispatch.trace.nsp = p.get_nsp();
+        dispatch.trace.event = event;
+        dispatch.trace.received_micros = m_inbound_packet_received;
+        dispatch.trace.decoded_micros = m_inbound_packet_decoded;
+        dispatch.trace.dispatched_micros = trace_clock_micros();
+
+        // listeners that move the event to another thread claim the trace and record it themselves
+        metrics_recorder::current_dispatch() = &dispatch;
+        socket_on_message_packet(so_ptr, p);
+        metrics_recorder::current_dispatch() = nullptr;
+
+        if (!dispatch.claimed)
+        {
+            dispatch.trace.handler_start_micros = dispatch.trace.dispatched_micros;
+            dispatch.trace.handler_end_micros = trace_clock_micros();
+            m_metrics->record_trace(dispatch.trace);
+        }
+    }
+
+    template<typename transport_type>
+    void client_impl<transport_type>::on_decode(packet const& p)
     {
+        size_t packet_bytes = m_inbound_packet_bytes;
+        m_inbound_packet_bytes = 0;
+        // replay only reaches event listeners, connection state and ack callbacks of real emits stay with the real connection
+        if (m_replaying && (p.get_frame() != packet::frame_message || p.get_type() == packet::type_connect || p.get_type() == packet::type_disconnect ||
+            p.get_type() == packet::type_ack || p.get_type() == packet::type_binary_ack))
+        {
+            return;
+        }
+        m_inbound_packet_decoded = m_metrics->is_tracing() ? trace_clock_micros() : 0;
         switch (p.get_frame())
         {
         case packet::frame_message:
         {
+            m_metrics->record_packet_in(p, packet_bytes);
+            SocketIOTrace::OutputPacket(true, p.get_nsp(), metrics_recorder::event_name(p), packet_bytes);
+            if (p.get_type() == packet::type_connect)
+            {
+                this->on_namespace_connect(p);
+            }
             socket::ptr so_ptr = get_socket_locked(p.get_nsp());
-            if (so_ptr)socket_on_message_packet(so_ptr, p);
+            if (so_ptr)
+            {
+                string const* event = m_metrics->is_tracing() ? metrics_recorder::event_name(p) : nullptr;
+                if (event)
+                {
+                    dispatch_traced(so_ptr, p, *event);
+                }
+                else
+                {
+                    socket_on_message_packet(so_ptr, p);
+                }
+            }
             break;
         }
         case packet::frame_open:
@@ -643,15 +871,71 @@ namespace sio
         }
     }
 
-    template<typename client_type>
-    void client_impl<client_type>::on_encode(bool isBinary, shared_ptr<const string> const& payload)
+    template<typename transport_type>
+    void client_impl<transport_type>::on_namespace_connect(packet const& p)
     {
-        LOG("encoded payload length:" << payload->length() << endl);
-        m_client.get_io_service().dispatch(std::bind(&client_impl<client_type>::send_impl, this, payload, isBinary ? frame::opcode::binary : frame::opcode::text));
+        attachment_codec::ptr const& codec = m_packet_mgr.get_attachment_codec();
+        const message::ptr& msg = p.get_message();
+        if (!codec || m_packet_mgr.is_attachment_codec_active() || !msg || msg->get_flag() != message::flag_object)
+        {
+            return;
+        }
+        // server accepted our offer if it echoes the codec name back
+        auto it = msg->get_map().find("attachmentCodec");
+        if (it != msg->get_map().end() && it->second && it->second->get_flag() == message::flag_string &&
+            it->second->get_string() == codec->get_name())
+        {
+            m_packet_mgr.set_attachment_codec_active(true);
+        }
     }
 
-    template<typename client_type>
-    void client_impl<client_type>::clear_timers()
+    template<typename transport_type>
+    void client_impl<transport_type>::set_attachment_limits(client::attachment_limits const& limits, attachment_store::ptr const& store)
+    {
+        m_packet_mgr.get_json_codec()->set_attachment_store(store, limits.spill_threshold);
+        m_packet_mgr.set_max_partial_size(limits.max_partial_size);
+        // a single frame can't be larger than the partial limit either, let websocketpp refuse it before buffering
+        m_transport.set_max_message_size(limits.max_partial_size);
+    }
+
+    template<typename transport_type>
+    void client_impl<transport_type>::on_packet_error(std::string const& reason)
+    {
+        LOG("Packet error: " << reason << endl);
+        if (m_replaying)
+        {
+            return;
+        }
+        m_transport.get_io_service().dispatch(make_alloc_handler(m_handler_memory, std::bind(&client_impl<transport_type>::close_impl, this, close::status::protocol_error, reason)));
+    }
+
+    template<typename transport_type>
+    void client_impl<transport_type>::set_wire_codec(client::wire_codec codec)
+    {
+        if (m_con_state != con_closed)
+        {
+            LOG("Wire codec can only be changed while disconnected." << endl);
+            return;
+        }
+        m_wire_codec = codec;
+        m_packet_mgr.set_codec(codec == client::wire_codec_msgpack ? std::make_shared<msgpack_codec>() : shared_ptr<packet_codec>());
+    }
+
+    template<typename transport_type>
+    void client_impl<transport_type>::on_encode(bool isBinary, frame_buffer const& payload)
+    {
+        LOG("encoded payload length:" << payload.size << endl);
+        if (m_replaying)
+        {
+            // acks and emits from replayed handlers have nowhere to go
+            return;
+        }
+        m_metrics->send_push();
+        m_transport.get_io_service().dispatch(make_alloc_handler(m_handler_memory, std::bind(&client_impl<transport_type>::send_impl, this, payload, isBinary ? frame::opcode::binary : frame::opcode::text)));
+    }
+
+    template<typename transport_type>
+    void client_impl<transport_type>::clear_timers()
     {
         LOG("clear timers" << endl);
         asio::error_code ec;
@@ -662,19 +946,33 @@ namespace sio
         }
     }
 
-    template<typename client_type>
-    void client_impl<client_type>::reset_states()
+    template<typename transport_type>
+    void client_impl<transport_type>::reset_states()
     {
-        m_client.reset();
+        m_transport.reset();
         m_sid.clear();
         m_packet_mgr.reset();
+        m_inbound_packet_bytes = 0;
+        m_deflate.negotiated = false;
     }
 
     template<>
-    void client_impl<client_type_no_tls>::template_init()
+    void client_impl<transport_no_tls>::template_init()
     {
     }
 
+    template<>
+    void client_impl<memory_transport>::template_init()
+    {
+    }
+
+#if SIO_UNIX_SOCKETS
+    template<>
+    void client_impl<unix_transport>::template_init()
+    {
+    }
+#endif
+
 #if SIO_TLS
     typedef websocketpp::lib::shared_ptr<asio::ssl::context> context_ptr;
     static context_ptr on_tls_init(int verify_mode, connection_hdl conn)
@@ -697,21 +995,36 @@ namespace sio
         return ctx;
     }
 
-    template<typename client_type>
-    void client_impl<client_type>::set_verify_mode(int mode)
+    template<typename transport_type>
+    void client_impl<transport_type>::set_verify_mode(int mode)
     {
         verify_mode = mode;
     }
 
     template<>
-    void client_impl<client_type_tls>::template_init()
+    void websocket_transport<client_type_tls>::set_tls_init_handler(int verify_mode)
     {
         m_client.set_tls_init_handler(std::bind(&on_tls_init, verify_mode, std::placeholders::_1));
     }
+
+    template<>
+    void client_impl<transport_tls>::template_init()
+    {
+        m_transport.set_tls_init_handler(verify_mode);
+    }
 #endif
 
+    bool client_impl_base::is_unix_socket(const string& uri)
+    {
+        return uri.compare(0, 7, "unix://") == 0 || uri.compare(0, 10, "ws+unix://") == 0;
+    }
+
     bool client_impl_base::is_tls(const string& uri)
     {
+        if (is_unix_socket(uri))
+        {
+            return false;
+        }
         websocketpp::uri uo(uri);
         if (uo.get_scheme() == "http" || uo.get_scheme() == "ws")
         {
@@ -731,6 +1044,36 @@ namespace sio
         }
     }
 
+    unsigned client_impl_base::parse_retry_after(const string& text)
+    {
+        // a close reason can hold other words around the key, a header is the bare number
+        static const char key[] = "retry-after=";
+        auto it = std::search(text.begin(), text.end(), key, key + sizeof(key) - 1,
+            [](char a, char b) { return tolower(static_cast<unsigned char>(a)) == b; });
+        const bool keyed = it != text.end();
+        const char* begin = text.c_str() + (keyed ? (it - text.begin()) + sizeof(key) - 1 : 0);
+        while (isspace(static_cast<unsigned char>(*begin)))
+        {
+            ++begin;
+        }
+        if (!isdigit(static_cast<unsigned char>(*begin)))
+        {
+            return 0;
+        }
+        char* end = nullptr;
+        double seconds = strtod(begin, &end);
+        while (!keyed && isspace(static_cast<unsigned char>(*end)))
+        {
+            ++end;
+        }
+        if (!keyed && *end != '\0')
+        {
+            return 0;
+        }
+        // a misbehaving server shouldn't park clients for days
+        return static_cast<unsigned>(min(seconds, 3600.0) * 1000);
+    }
+
     socket* client_impl_base::new_socket(const string& nsp,const message::ptr& auth)
     {
         return new sio::socket(this, nsp, auth);
@@ -741,13 +1084,17 @@ namespace sio
         s->on_message_packet(p);
     }
 
-    template class client_impl<client_type_no_tls>;
+    template class client_impl<transport_no_tls>;
+    template class client_impl<memory_transport>;
+#if SIO_UNIX_SOCKETS
+    template class client_impl<unix_transport>;
+#endif
 #if SIO_TLS
-    template class client_impl<client_type_tls>;
+    template class client_impl<transport_tls>;
 #endif
 
-    template<typename client_type>
-    std::string client_impl<client_type>::encode_query_string(const std::string& query) {
+    template<typename transport_type>
+    std::string client_impl<transport_type>::encode_query_string(const std::string& query) {
         ostringstream ss;
         ss << std::hex;
         // Percent-encode (RFC3986) non-alphanumeric characters.
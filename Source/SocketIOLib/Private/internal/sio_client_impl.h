@@ -3,88 +3,25 @@
 #ifndef SIO_CLIENT_IMPL_H
 #define SIO_CLIENT_IMPL_H
 
-#ifndef SIO_TLS
-#define SIO_TLS 0
-#endif
-
-/* This disables two things:
-   1) error 4503 where MSVC complains about
-	  decorated names being too long. There's no way around
-	  this.
-   2) We also disable a security error triggered by
-	  websocketpp not using checked iterators.
-*/
-#ifdef _MSC_VER
-#pragma warning(disable : 4503)
-#define _SCL_SECURE_NO_WARNINGS
-#endif
-
-/* For this code, we will use standalone ASIO
-   and websocketpp in C++11 mode only */
-#define ASIO_STANDALONE
-#define _WEBSOCKETPP_CPP11_STL_
-
-#include <cstdint>
-#define INTIALIZER(__TYPE__)
-
-#include "CoreMinimal.h" 
-
-#if PLATFORM_WINDOWS
-//#define WIN32_LEAN_AND_MEAN
-#include "Windows/WindowsHWrapper.h"
-#include "Windows/AllowWindowsPlatformAtomics.h"
-#endif
-
-#include <websocketpp/client.hpp>
-#include <asio/system_timer.hpp>
-
-#if defined(DEBUG)
-  #if SIO_TLS
-    #define UI UI_ST
-    THIRD_PARTY_INCLUDES_START
-    #include "openssl/hmac.h"
-    #include <websocketpp/config/debug_asio.hpp>
-    typedef websocketpp::config::debug_asio_tls client_config_tls;
-    THIRD_PARTY_INCLUDES_END
-    #undef UI
-  #endif //SIO_TLS
-	#include <websocketpp/config/debug_asio_no_tls.hpp>
-	typedef websocketpp::config::debug_asio client_config;
-#else
-  #if SIO_TLS
-    #define UI UI_ST
-    THIRD_PARTY_INCLUDES_START
-    #include "openssl/hmac.h"
-    #include <websocketpp/config/asio_client.hpp>
-    typedef websocketpp::config::asio_tls_client client_config_tls;
-    THIRD_PARTY_INCLUDES_END
-    #undef UI
-  #endif //SIO_TLS
-	#include <websocketpp/config/asio_no_tls_client.hpp>
-	typedef websocketpp::config::asio_client client_config;
-#endif //DEBUG
-#include <asio/deadline_timer.hpp>
+#include "sio_transport.h"
+#include "sio_handler_alloc.h"
 
 #include <memory>
 #include <map>
 #include <thread>
+#include <condition_variable>
+#include <random>
 
 #include "sio_client.h"
 #include "sio_packet.h"
-
-#if PLATFORM_WINDOWS
-#include "Windows/HideWindowsPlatformAtomics.h"
-#endif
+#include "sio_msgpack_codec.h"
+#include "sio_metrics_recorder.h"
+#include "sio_capture.h"
 
     namespace sio
     {
         using namespace websocketpp;
 
-        typedef websocketpp::client<client_config> client_type_no_tls;
-#if SIO_TLS
-        typedef websocketpp::client<client_config_tls> client_type_tls;
-#endif
-
         class client_impl_base {
 
         public:
@@ -123,6 +60,29 @@
             virtual void set_reconnect_attempts(unsigned attempts) {};
             virtual void set_reconnect_delay(unsigned millis) {};
             virtual void set_reconnect_delay_max(unsigned millis) {};
+            virtual void set_reconnect_backoff(client::reconnect_backoff backoff) {};
+            virtual client::reconnect_backoff get_reconnect_backoff() const { return client::backoff_exponential; };
+            virtual void set_compression_options(client::compression_options const& options) {};
+            virtual client::compression_stats get_compression_stats() const { return client::compression_stats(); };
+            virtual void set_network_thread_options(client::network_thread_options const& options) {};
+            virtual client::network_thread_options get_network_thread_options() const { return client::network_thread_options(); };
+            virtual metrics_snapshot get_metrics() const { return metrics_snapshot(); };
+            virtual void set_trace_options(trace_options const& options) {};
+            virtual trace_options get_trace_options() const { return trace_options(); };
+            virtual std::vector<packet_trace> get_trace_samples() const { return std::vector<packet_trace>(); };
+            virtual void record_trace(packet_trace const& trace) {};
+            virtual client::trace_recorder get_trace_recorder() const { return [](packet_trace const&) {}; };
+            virtual std::shared_ptr<dispatch_gauge> get_dispatch_gauge() const { return std::make_shared<dispatch_gauge>(); };
+            virtual void set_attachment_codec(attachment_codec::ptr const& codec) {};
+            virtual bool is_attachment_codec_active() const { return false; };
+            virtual void set_attachment_limits(client::attachment_limits const& limits, attachment_store::ptr const& store) {};
+            virtual void set_wire_codec(client::wire_codec codec) {};
+            virtual client::wire_codec get_wire_codec() const { return client::wire_codec_json; };
+            virtual bool start_capture(std::string const& path) { return false; };
+            virtual void stop_capture() {};
+            virtual bool replay_capture(std::string const& path, bool realtime, client::replay_listener const& on_finished) { return false; };
+            virtual void stop_replay() {};
+            virtual bool is_replaying() const { return false; };
 
             // used by sio::socket
             virtual void send(packet& p) {};
@@ -130,6 +90,10 @@
             virtual asio::io_service& get_io_service() = 0;
             virtual void on_socket_closed(std::string const& nsp) {};
             virtual void on_socket_opened(std::string const& nsp) {};
+            virtual metrics_recorder* get_metrics_recorder() { return nullptr; };
+
+            // recycled memory for the handlers posted to get_io_service()
+            handler_memory& get_handler_memory() { return m_handler_memory; }
 
             virtual void set_logs_default() {};
             virtual void set_logs_quiet() {};
@@ -140,11 +104,21 @@
             // used for selecting whether or not to use TLS
             static bool is_tls(const std::string& uri);
 
+            // unix:///path/to/server.sock or ws+unix:///path/to/server.sock:/resource
+            static bool is_unix_socket(const std::string& uri);
+
+            // Milliseconds from a Retry-After header value or a close reason holding "retry-after=<seconds>",
+            // 0 when there is none. HTTP dates are not supported.
+            static unsigned parse_retry_after(const std::string& text);
+
 #if SIO_TLS
             virtual void set_verify_mode(int mode) {};
 #endif
 
         protected:
+            // outlives the transport and its io_service, which free their queued handlers into it
+            handler_memory m_handler_memory;
+
             // Wrap protected member functions of sio::socket because only client_impl_base is friended.
             sio::socket* new_socket(std::string const&, message::ptr const&);
             void socket_on_message_packet(sio::socket::ptr&, packet const&);
@@ -154,11 +128,9 @@
             inline socket_void_fn socket_on_open() { return &sio::socket::on_open; }
         };
 
-    template<typename client_type>
+    template<typename transport_type>
     class client_impl : public client_impl_base {
     public:
-        typedef typename client_type::message_ptr message_ptr;
-
         client_impl();
         void template_init() override; // template-specific initialization
 
@@ -187,6 +159,56 @@
 
         void set_reconnect_delay_max(unsigned millis) { m_reconn_delay_max = millis; if (m_reconn_delay > millis) m_reconn_delay = millis; }
 
+        void set_reconnect_backoff(client::reconnect_backoff backoff) { m_reconn_backoff = backoff; }
+
+        client::reconnect_backoff get_reconnect_backoff() const { return m_reconn_backoff; }
+
+        void set_compression_options(client::compression_options const& options) { m_deflate.set_options(options); }
+
+        client::compression_stats get_compression_stats() const { return m_deflate.get_stats(); }
+
+        void set_network_thread_options(client::network_thread_options const& options) { m_thread_options = options; }
+
+        client::network_thread_options get_network_thread_options() const { return m_thread_options; }
+
+        metrics_snapshot get_metrics() const { return m_metrics->snapshot(); }
+
+        void set_trace_options(trace_options const& options) { m_metrics->set_trace_options(options); }
+
+        trace_options get_trace_options() const { return m_metrics->get_trace_options(); }
+
+        std::vector<packet_trace> get_trace_samples() const { return m_metrics->get_trace_samples(); }
+
+        void record_trace(packet_trace const& trace) { m_metrics->record_trace(trace); }
+
+        std::shared_ptr<dispatch_gauge> get_dispatch_gauge() const { return m_metrics->get_dispatch_gauge(); }
+
+        client::trace_recorder get_trace_recorder() const
+        {
+            std::shared_ptr<metrics_recorder> metrics = m_metrics;
+            return [metrics](packet_trace const& trace) { metrics->record_trace(trace); };
+        }
+
+        void set_attachment_codec(attachment_codec::ptr const& codec) { m_packet_mgr.set_attachment_codec(codec); }
+
+        bool is_attachment_codec_active() const { return m_packet_mgr.is_attachment_codec_active(); }
+
+        void set_attachment_limits(client::attachment_limits const& limits, attachment_store::ptr const& store);
+
+        void set_wire_codec(client::wire_codec codec);
+
+        client::wire_codec get_wire_codec() const { return m_wire_codec; }
+
+        bool start_capture(std::string const& path) { return m_capture.open(path); }
+
+        void stop_capture() { m_capture.close(); }
+
+        bool replay_capture(std::string const& path, bool realtime, client::replay_listener const& on_finished);
+
+        void stop_replay();
+
+        bool is_replaying() const { return m_replaying; }
+
         void set_logs_default();
 
         void set_logs_quiet();
@@ -227,6 +249,8 @@
 
         void on_socket_opened(std::string const& nsp);
 
+        metrics_recorder* get_metrics_recorder() { return m_metrics.get(); }
+
     private:
         void run_loop();
 
@@ -234,7 +258,7 @@
 
         void close_impl(close::status::value const& code, std::string const& reason);
 
-        void send_impl(std::shared_ptr<const std::string> const& payload_ptr, frame::opcode::value opcode);
+        void send_impl(frame_buffer const& payload, frame::opcode::value opcode);
 
         void ping(const asio::error_code& ec);
 
@@ -242,29 +266,36 @@
 
         void timeout_reconnect(asio::error_code const& ec);
 
-        unsigned next_delay() const;
+        unsigned next_delay();
 
         socket::ptr get_socket_locked(std::string const& nsp);
 
         void sockets_invoke_void(void (sio::socket::* fn)(void));
 
         void on_decode(packet const& pack);
-        void on_encode(bool isBinary, shared_ptr<const string> const& payload);
+        void on_frame(shared_ptr<const string> const& payload, bool binary_frame);
+        void replay_loop(shared_ptr<capture_reader> reader, bool realtime, client::replay_listener on_finished);
+        void dispatch_traced(socket::ptr& so_ptr, packet const& p, string const& event);
+        void on_encode(bool isBinary, frame_buffer const& payload);
 
-        //websocket callbacks
-        void on_fail(connection_hdl con);
+        //transport callbacks
+        void on_fail(std::string const& retry_after);
 
-        void on_open(connection_hdl con);
+        void on_open();
 
-        void on_close(connection_hdl con);
+        void on_close(close::status::value code, std::string const& remote_reason);
 
-        void on_message(connection_hdl con, message_ptr msg);
+        void on_message(shared_ptr<const string> const& payload, bool binary_frame);
 
         //socketio callbacks
         void on_handshake(message::ptr const& message);
 
         void on_ping();
 
+        void on_namespace_connect(packet const& pack);
+
+        void on_packet_error(std::string const& reason);
+
         void reset_states();
 
         void clear_timers();
@@ -272,9 +303,7 @@
         // Percent encode query string
         std::string encode_query_string(const std::string& query);
 
-        // Connection pointer for client functions.
-        connection_hdl m_con;
-        client_type m_client;
+        transport_type m_transport;
 
         // Socket.IO server settings
         std::string m_sid;
@@ -288,6 +317,18 @@
 
         std::unique_ptr<std::thread> m_network_thread;
 
+        // read by the network thread when it starts
+        client::network_thread_options m_thread_options;
+
+        // declared before m_packet_mgr, which keeps a pointer to it. Shared so claimed traces
+        // can be recorded after the client is gone, see client::get_trace_recorder().
+        std::shared_ptr<metrics_recorder> m_metrics;
+
+        // frame bytes and trace stamps of the packet being received, network thread only
+        size_t m_inbound_packet_bytes;
+        uint64_t m_inbound_packet_received;
+        uint64_t m_inbound_packet_decoded;
+
         packet_manager m_packet_mgr;
 
         std::unique_ptr<asio::steady_timer> m_ping_timeout_timer;
@@ -317,9 +358,36 @@
 
         unsigned m_reconn_made;
 
+        client::reconnect_backoff m_reconn_backoff;
+
+        // last wait, decorrelated jitter grows from it
+        unsigned m_reconn_prev_delay;
+
+        // server hint for the next wait, consumed by next_delay
+        unsigned m_retry_after;
+
+        std::mt19937 m_reconn_rng;
+
         //passthrough path of plugin
         std::string m_path;
 
+        // permessage-deflate settings and counters, reached by the extension through deflate_context::current()
+        deflate_context m_deflate;
+
+        client::wire_codec m_wire_codec;
+
+        capture_writer m_capture;
+
+        // true from connect() until run_loop returned, the network thread may touch the packet manager meanwhile
+        std::atomic<bool> m_network_running;
+
+        // replay feeds frames from its own thread, only while the connection is closed and the network thread stopped
+        std::unique_ptr<std::thread> m_replay_thread;
+        std::atomic<bool> m_replaying;
+        bool m_replay_cancel;
+        std::mutex m_replay_mutex;
+        std::condition_variable m_replay_cv;
+
 #if SIO_TLS
         int verify_mode = -1;
 #endif
@@ -0,0 +1,364 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+//
+//  sio_deflate.h
+//
+//  permessage-deflate (RFC 7692) extension for the websocketpp client configs
+//  used by client_impl. Unlike the stock websocketpp extension this one reads
+//  its settings at runtime (level, window bits, context takeover) and keeps
+//  compression statistics.
+//
+
+#ifndef SIO_DEFLATE_H
+#define SIO_DEFLATE_H
+
+#include <websocketpp/extensions/extension.hpp>
+#include <websocketpp/extensions/permessage_deflate/enabled.hpp>
+#include <websocketpp/http/constants.hpp>
+#include <websocketpp/common/system_error.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+#include "sio_client.h"
+
+namespace sio
+{
+    /**
+     * Per client settings and counters shared by every deflate extension instance
+     * created on that client's network thread.
+     */
+    class deflate_context
+    {
+    public:
+        deflate_context() : m_options_changed(false)
+        {
+            reset_stats();
+        }
+
+        // Network thread copy, only read and written there. Other threads go through set_options.
+        client::compression_options options;
+
+        std::atomic<uint64_t> bytes_in;
+        std::atomic<uint64_t> bytes_out;
+        std::atomic<uint64_t> bytes_inflated_in;
+        std::atomic<uint64_t> bytes_inflated_out;
+        std::atomic<uint64_t> messages_compressed;
+        std::atomic<uint64_t> messages_skipped;
+        std::atomic<uint64_t> compress_micros;
+        std::atomic<uint64_t> decompress_micros;
+        std::atomic<bool> negotiated;
+
+        // Any thread. Taken over by the network thread on its next connect or send.
+        void set_options(client::compression_options const& new_options)
+        {
+            std::lock_guard<std::mutex> guard(m_options_mutex);
+            m_pending_options = new_options;
+            m_options_changed = true;
+        }
+
+        // Network thread only
+        void sync_options()
+        {
+            if (m_options_changed)
+            {
+                std::lock_guard<std::mutex> guard(m_options_mutex);
+                options = m_pending_options;
+                m_options_changed = false;
+            }
+        }
+
+        bool should_compress(size_t payload_size)
+        {
+            sync_options();
+            if (!options.enabled || !negotiated)
+            {
+                return false;
+            }
+            if (payload_size < options.min_compress_size)
+            {
+                messages_skipped++;
+                return false;
+            }
+            return true;
+        }
+
+        void reset_stats()
+        {
+            bytes_in = 0;
+            bytes_out = 0;
+            bytes_inflated_in = 0;
+            bytes_inflated_out = 0;
+            messages_compressed = 0;
+            messages_skipped = 0;
+            compress_micros = 0;
+            decompress_micros = 0;
+            negotiated = false;
+        }
+
+        client::compression_stats get_stats() const
+        {
+            client::compression_stats stats;
+            stats.negotiated = negotiated;
+            stats.bytes_in = bytes_in;
+            stats.bytes_out = bytes_out;
+            stats.bytes_saved = bytes_in > bytes_out ? bytes_in - bytes_out : 0;
+            stats.bytes_inflated_in = bytes_inflated_in;
+            stats.bytes_inflated_out = bytes_inflated_out;
+            stats.messages_compressed = messages_compressed;
+            stats.messages_skipped = messages_skipped;
+            stats.compress_micros = compress_micros;
+            stats.decompress_micros = decompress_micros;
+            return stats;
+        }
+
+        // The context of the client whose network thread we're currently on.
+        // websocketpp constructs extensions inside its processor, so this is
+        // the only way to reach per client settings from the extension.
+        static deflate_context*& current()
+        {
+            static thread_local deflate_context* s_current = nullptr;
+            return s_current;
+        }
+
+    private:
+        std::mutex m_options_mutex;
+        client::compression_options m_pending_options;
+        std::atomic<bool> m_options_changed;
+    };
+
+    template <typename config>
+    class permessage_deflate
+    {
+    public:
+        permessage_deflate() :
+            m_context(deflate_context::current()),
+            m_enabled(false),
+            m_initialized(false),
+            m_client_no_context_takeover(false),
+            m_client_max_window_bits(15),
+            m_compress_buffer_size(16384)
+        {
+        }
+
+        ~permessage_deflate()
+        {
+            if (m_initialized)
+            {
+                deflateEnd(&m_dstate);
+                inflateEnd(&m_istate);
+            }
+        }
+
+        bool is_implemented() const
+        {
+            return m_context != nullptr && m_context->options.enabled;
+        }
+
+        bool is_enabled() const
+        {
+            return m_enabled;
+        }
+
+        std::string generate_offer() const
+        {
+            if (!is_implemented())
+            {
+                return std::string();
+            }
+            client::compression_options const& opt = m_context->options;
+            std::ostringstream ss;
+            ss << "permessage-deflate";
+            if (opt.client_no_context_takeover)
+            {
+                ss << "; client_no_context_takeover";
+            }
+            if (opt.server_no_context_takeover)
+            {
+                ss << "; server_no_context_takeover";
+            }
+            if (opt.client_max_window_bits < 15)
+            {
+                ss << "; client_max_window_bits=" << unsigned(clamp_bits(opt.client_max_window_bits));
+            }
+            else
+            {
+                ss << "; client_max_window_bits";
+            }
+            if (opt.server_max_window_bits < 15)
+            {
+                ss << "; server_max_window_bits=" << unsigned(clamp_bits(opt.server_max_window_bits));
+            }
+            return ss.str();
+        }
+
+        websocketpp::lib::error_code validate_offer(websocketpp::http::attribute_list const&)
+        {
+            return websocketpp::lib::error_code();
+        }
+
+        // Client side: called with the attributes of the server's response.
+        websocketpp::err_str_pair negotiate(websocketpp::http::attribute_list const& response)
+        {
+            namespace pmd = websocketpp::extensions::permessage_deflate;
+            websocketpp::err_str_pair ret;
+            if (!is_implemented())
+            {
+                ret.first = pmd::error::make_error_code(pmd::error::invalid_parameters);
+                return ret;
+            }
+
+            m_client_no_context_takeover = m_context->options.client_no_context_takeover;
+            m_client_max_window_bits = clamp_bits(m_context->options.client_max_window_bits);
+
+            for (websocketpp::http::attribute_list::const_iterator it = response.begin(); it != response.end(); ++it)
+            {
+                if (it->first == "client_no_context_takeover")
+                {
+                    m_client_no_context_takeover = true;
+                }
+                else if (it->first == "client_max_window_bits")
+                {
+                    int bits = atoi(it->second.c_str());
+                    if (!it->second.empty() && (bits < 8 || bits > 15))
+                    {
+                        ret.first = pmd::error::make_error_code(pmd::error::invalid_attribute_value);
+                        return ret;
+                    }
+                    if (bits > 0 && bits < m_client_max_window_bits)
+                    {
+                        m_client_max_window_bits = clamp_bits(static_cast<uint8_t>(bits));
+                    }
+                }
+                else if (it->first != "server_no_context_takeover" && it->first != "server_max_window_bits")
+                {
+                    ret.first = pmd::error::make_error_code(pmd::error::invalid_attributes);
+                    return ret;
+                }
+            }
+
+            m_enabled = true;
+            ret.second = generate_offer();
+            return ret;
+        }
+
+        websocketpp::lib::error_code init(bool /*is_server*/)
+        {
+            namespace pmd = websocketpp::extensions::permessage_deflate;
+
+            m_dstate.zalloc = Z_NULL;
+            m_dstate.zfree = Z_NULL;
+            m_dstate.opaque = Z_NULL;
+            int ret = deflateInit2(&m_dstate, m_context->options.level, Z_DEFLATED,
+                -1 * m_client_max_window_bits, 8, Z_DEFAULT_STRATEGY);
+            if (ret != Z_OK)
+            {
+                return pmd::error::make_error_code(pmd::error::zlib_error);
+            }
+
+            m_istate.zalloc = Z_NULL;
+            m_istate.zfree = Z_NULL;
+            m_istate.opaque = Z_NULL;
+            m_istate.avail_in = 0;
+            m_istate.next_in = Z_NULL;
+            // Always inflate with the largest window, it decodes any smaller window too.
+            ret = inflateInit2(&m_istate, -15);
+            if (ret != Z_OK)
+            {
+                deflateEnd(&m_dstate);
+                return pmd::error::make_error_code(pmd::error::zlib_error);
+            }
+
+            m_compress_buffer.reset(new unsigned char[m_compress_buffer_size]);
+            m_initialized = true;
+            m_context->negotiated = true;
+            return websocketpp::lib::error_code();
+        }
+
+        // Output keeps the trailing 0x00 0x00 0xff 0xff, the processor strips it.
+        websocketpp::lib::error_code compress(std::string const& in, std::string& out)
+        {
+            namespace pmd = websocketpp::extensions::permessage_deflate;
+            if (!m_initialized)
+            {
+                return pmd::error::make_error_code(pmd::error::uninitialized);
+            }
+            auto start = std::chrono::steady_clock::now();
+            size_t out_start = out.size();
+
+            m_dstate.avail_in = static_cast<uInt>(in.size());
+            m_dstate.next_in = (unsigned char*)(const_cast<char*>(in.data()));
+            do
+            {
+                m_dstate.avail_out = static_cast<uInt>(m_compress_buffer_size);
+                m_dstate.next_out = m_compress_buffer.get();
+                deflate(&m_dstate, m_client_no_context_takeover ? Z_FULL_FLUSH : Z_SYNC_FLUSH);
+                size_t output = m_compress_buffer_size - m_dstate.avail_out;
+                out.append((char*)(m_compress_buffer.get()), output);
+            } while (m_dstate.avail_out == 0);
+
+            m_context->bytes_in += in.size();
+            m_context->bytes_out += out.size() - out_start;
+            m_context->messages_compressed++;
+            m_context->compress_micros += elapsed_micros(start);
+            return websocketpp::lib::error_code();
+        }
+
+        websocketpp::lib::error_code decompress(uint8_t const* buf, size_t len, std::string& out)
+        {
+            namespace pmd = websocketpp::extensions::permessage_deflate;
+            if (!m_initialized)
+            {
+                return pmd::error::make_error_code(pmd::error::uninitialized);
+            }
+            auto start = std::chrono::steady_clock::now();
+            size_t out_start = out.size();
+
+            m_istate.avail_in = static_cast<uInt>(len);
+            m_istate.next_in = const_cast<unsigned char*>(buf);
+            do
+            {
+                m_istate.avail_out = static_cast<uInt>(m_compress_buffer_size);
+                m_istate.next_out = m_compress_buffer.get();
+                int ret = inflate(&m_istate, Z_SYNC_FLUSH);
+                if (ret == Z_NEED_DICT || ret == Z_DATA_ERROR || ret == Z_MEM_ERROR)
+                {
+                    return pmd::error::make_error_code(pmd::error::zlib_error);
+                }
+                out.append((char*)(m_compress_buffer.get()), m_compress_buffer_size - m_istate.avail_out);
+            } while (m_istate.avail_out == 0);
+
+            m_context->bytes_inflated_in += len;
+            m_context->bytes_inflated_out += out.size() - out_start;
+            m_context->decompress_micros += elapsed_micros(start);
+            return websocketpp::lib::error_code();
+        }
+
+    private:
+        // zlib does not support raw deflate with an 8 bit window, 9 is the smallest usable value.
+        static uint8_t clamp_bits(uint8_t bits)
+        {
+            return bits < 9 ? 9 : (bits > 15 ? 15 : bits);
+        }
+
+        static uint64_t elapsed_micros(std::chrono::steady_clock::time_point const& start)
+        {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count());
+        }
+
+        deflate_context* m_context;
+        bool m_enabled;
+        bool m_initialized;
+        bool m_client_no_context_takeover;
+        uint8_t m_client_max_window_bits;
+        size_t m_compress_buffer_size;
+        std::unique_ptr<unsigned char[]> m_compress_buffer;
+        z_stream m_dstate;
+        z_stream m_istate;
+    };
+}
+
+#endif // SIO_DEFLATE_H
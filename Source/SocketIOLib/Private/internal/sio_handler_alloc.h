@@ -0,0 +1,152 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+//
+//  sio_handler_alloc.h
+//
+//  Recycled memory for asio completion handlers. Every emit posts a send to the
+//  network thread from whichever thread emitted, and every received frame re-arms
+//  the pong timer; asio allocates an operation for each. Wrapped with
+//  make_alloc_handler those operations come from a handler_memory free list
+//  through asio's associated allocator, so once warmed up they never reach the heap.
+//
+//      timer.async_wait(make_alloc_handler(m_handler_memory, std::bind(&x::on_timer, this, _1)));
+//
+//  A handler_memory has to outlive the io_service its handlers are queued on.
+//
+
+#ifndef SIO_HANDLER_ALLOC_H
+#define SIO_HANDLER_ALLOC_H
+
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace sio
+{
+    // Free list of fixed size blocks. Handlers are allocated on the emitting thread and
+    // freed on the network thread, so it is locked; larger requests go to the heap.
+    class handler_memory
+    {
+    public:
+        handler_memory() : m_free(nullptr), m_free_count(0) {}
+
+        ~handler_memory()
+        {
+            while (m_free)
+            {
+                block* next = m_free->next;
+                ::operator delete(m_free);
+                m_free = next;
+            }
+        }
+
+        handler_memory(handler_memory const&) = delete;
+        handler_memory& operator=(handler_memory const&) = delete;
+
+        void* allocate(size_t size)
+        {
+            if (size > block_size)
+            {
+                return ::operator new(size);
+            }
+            {
+                std::lock_guard<std::mutex> guard(m_mutex);
+                if (m_free)
+                {
+                    block* b = m_free;
+                    m_free = b->next;
+                    --m_free_count;
+                    return b;
+                }
+            }
+            return ::operator new(block_size);
+        }
+
+        void deallocate(void* p, size_t size)
+        {
+            if (size <= block_size)
+            {
+                std::lock_guard<std::mutex> guard(m_mutex);
+                // bursts of queued emits are handed back to the heap beyond this
+                if (m_free_count < max_free_blocks)
+                {
+                    block* b = static_cast<block*>(p);
+                    b->next = m_free;
+                    m_free = b;
+                    ++m_free_count;
+                    return;
+                }
+            }
+            ::operator delete(p);
+        }
+
+    private:
+        // fits a bound member call with a frame_buffer plus asio's operation header
+        static const size_t block_size = 256;
+        static const size_t max_free_blocks = 64;
+
+        struct block
+        {
+            block* next;
+        };
+
+        block* m_free;
+        size_t m_free_count;
+        std::mutex m_mutex;
+    };
+
+    template<typename T>
+    class handler_allocator
+    {
+    public:
+        typedef T value_type;
+
+        explicit handler_allocator(handler_memory& memory) : m_memory(&memory) {}
+
+        template<typename U>
+        handler_allocator(handler_allocator<U> const& other) : m_memory(other.m_memory) {}
+
+        T* allocate(size_t n) { return static_cast<T*>(m_memory->allocate(sizeof(T) * n)); }
+
+        void deallocate(T* p, size_t n) { m_memory->deallocate(p, sizeof(T) * n); }
+
+        template<typename U>
+        bool operator==(handler_allocator<U> const& other) const { return m_memory == other.m_memory; }
+
+        template<typename U>
+        bool operator!=(handler_allocator<U> const& other) const { return m_memory != other.m_memory; }
+
+    private:
+        template<typename> friend class handler_allocator;
+
+        handler_memory* m_memory;
+    };
+
+    // Forwards the call, asio picks the allocator up through get_allocator()
+    template<typename handler_type>
+    class alloc_handler
+    {
+    public:
+        typedef handler_allocator<handler_type> allocator_type;
+
+        alloc_handler(handler_memory& memory, handler_type handler) : m_memory(&memory), m_handler(std::move(handler)) {}
+
+        allocator_type get_allocator() const { return allocator_type(*m_memory); }
+
+        template<typename... args_type>
+        void operator()(args_type&&... args) { m_handler(std::forward<args_type>(args)...); }
+
+    private:
+        handler_memory* m_memory;
+        handler_type m_handler;
+    };
+
+    template<typename handler_type>
+    inline alloc_handler<typename std::decay<handler_type>::type> make_alloc_handler(handler_memory& memory, handler_type&& handler)
+    {
+        return alloc_handler<typename std::decay<handler_type>::type>(memory, std::forward<handler_type>(handler));
+    }
+}
+
+#endif // SIO_HANDLER_ALLOC_H
@@ -0,0 +1,117 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+//
+//  sio_message_pool.h
+//
+//  Recycled websocketpp messages. The stock con_msg_manager makes a new message
+//  (and a new payload string) for every frame sent or received. message_pool keeps
+//  the messages it made and hands out one nobody else references any more, so its
+//  payload capacity, header string and shared_ptr control block are reused and a
+//  warmed up connection no longer reaches the heap for outgoing frames.
+//
+//  Plugged in through the client configs in sio_transport.h:
+//
+//      typedef websocketpp::message_buffer::message<sio::message_pool> message_type;
+//      typedef sio::message_pool<message_type> con_msg_manager_type;
+//      typedef sio::message_pool_factory<con_msg_manager_type> endpoint_msg_manager_type;
+//
+//  Received frames still cost an allocation: websocket_protocol::on_message steals
+//  their payload so attachments reference it, which leaves the pooled message
+//  without capacity for the next frame.
+//
+
+#ifndef SIO_MESSAGE_POOL_H
+#define SIO_MESSAGE_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <websocketpp/frame.hpp>
+
+namespace sio
+{
+    // One per connection. Messages are taken on the network thread and usually released
+    // there too, the lock only guards the rare release from elsewhere.
+    template<typename message>
+    class message_pool : public std::enable_shared_from_this<message_pool<message> >
+    {
+    public:
+        typedef message_pool<message> type;
+        typedef std::shared_ptr<message_pool> ptr;
+        typedef std::weak_ptr<message_pool> weak_ptr;
+        typedef typename message::ptr message_ptr;
+
+        message_pool() : m_next(0) {}
+
+        message_ptr get_message()
+        {
+            return std::make_shared<message>(type::shared_from_this());
+        }
+
+        message_ptr get_message(websocketpp::frame::opcode::value op, size_t size)
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            // round robin, the oldest message is the most likely to be written out already
+            for (size_t i = 0; i < m_messages.size(); ++i)
+            {
+                message_ptr& candidate = m_messages[(m_next + i) % m_messages.size()];
+                if (candidate.use_count() == 1)
+                {
+                    // pairs with the release of whoever dropped the last other reference
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    m_next = (m_next + i + 1) % m_messages.size();
+                    reset(*candidate, op, size);
+                    return candidate;
+                }
+            }
+            message_ptr fresh = std::make_shared<message>(type::shared_from_this(), op, size);
+            if (m_messages.size() < max_messages)
+            {
+                m_messages.push_back(fresh);
+            }
+            return fresh;
+        }
+
+        // websocketpp's own recycling hook, nothing calls it
+        bool recycle(message*) { return false; }
+
+    private:
+        // more than a send window of frames in flight at once is a burst, those go to the heap
+        static const size_t max_messages = 64;
+
+        static void reset(message& msg, websocketpp::frame::opcode::value op, size_t size)
+        {
+            msg.set_opcode(op);
+            msg.set_header(std::string());
+            msg.set_prepared(false);
+            msg.set_fin(true);
+            msg.set_terminal(false);
+            msg.set_compressed(false);
+            std::string& payload = msg.get_raw_payload();
+            payload.clear();
+            payload.reserve(size);
+        }
+
+        std::vector<message_ptr> m_messages;
+        size_t m_next;
+        std::mutex m_mutex;
+    };
+
+    // The endpoint side, hands each new connection its own pool.
+    template<typename con_msg_manager>
+    class message_pool_factory
+    {
+    public:
+        typedef typename con_msg_manager::ptr con_msg_man_ptr;
+
+        con_msg_man_ptr get_manager() const
+        {
+            return std::make_shared<con_msg_manager>();
+        }
+    };
+}
+
+#endif // SIO_MESSAGE_POOL_H
@@ -0,0 +1,402 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+//
+//  sio_metrics_recorder.cpp
+//
+
+#include "sio_metrics_recorder.h"
+#include "sio_packet.h"
+
+namespace sio
+{
+    using namespace std;
+
+    namespace
+    {
+        // Recorders a thread owns a shard in, past this it records into the overflow shard.
+        const size_t kMAX_SLOTS = 16;
+
+        atomic<uint64_t> s_next_recorder_id(1);
+    }
+
+    const char* const metrics_recorder::overflow_event = "<other>";
+
+    string const* metrics_recorder::event_name(packet const& p)
+    {
+        if (p.get_type() != packet::type_event && p.get_type() != packet::type_binary_event)
+        {
+            return nullptr;
+        }
+        message::ptr const& msg = p.get_message();
+        if (!msg || msg->get_flag() != message::flag_array)
+        {
+            return nullptr;
+        }
+        vector<message::ptr> const& items = msg->get_vector();
+        if (items.empty() || !items[0] || items[0]->get_flag() != message::flag_string)
+        {
+            return nullptr;
+        }
+        return &items[0]->get_string();
+    }
+
+    void metrics_recorder::traffic_cell::add(bool inbound, size_t bytes)
+    {
+        if (inbound)
+        {
+            packets_in.fetch_add(1, memory_order_relaxed);
+            bytes_in.fetch_add(bytes, memory_order_relaxed);
+        }
+        else
+        {
+            packets_out.fetch_add(1, memory_order_relaxed);
+            bytes_out.fetch_add(bytes, memory_order_relaxed);
+        }
+    }
+
+    void metrics_recorder::traffic_cell::load_into(traffic_counters& out) const
+    {
+        out.packets_in += packets_in.load(memory_order_relaxed);
+        out.packets_out += packets_out.load(memory_order_relaxed);
+        out.bytes_in += bytes_in.load(memory_order_relaxed);
+        out.bytes_out += bytes_out.load(memory_order_relaxed);
+    }
+
+    metrics_recorder::histogram_cell::histogram_cell()
+    {
+        for (size_t i = 0; i < latency_histogram::bucket_count; ++i)
+        {
+            buckets[i] = 0;
+        }
+    }
+
+    void metrics_recorder::histogram_cell::record(uint64_t micros)
+    {
+        count.fetch_add(1, memory_order_relaxed);
+        sum_micros.fetch_add(micros, memory_order_relaxed);
+        buckets[latency_histogram::bucket_for(micros)].fetch_add(1, memory_order_relaxed);
+        // one writer at a time (the owner, or the overflow lock holder), no CAS needed
+        if (micros > max_micros.load(memory_order_relaxed))
+        {
+            max_micros.store(micros, memory_order_relaxed);
+        }
+    }
+
+    void metrics_recorder::histogram_cell::load_into(latency_histogram& out) const
+    {
+        latency_histogram h;
+        h.count = count.load(memory_order_relaxed);
+        h.sum_micros = sum_micros.load(memory_order_relaxed);
+        h.max_micros = max_micros.load(memory_order_relaxed);
+        for (size_t i = 0; i < latency_histogram::bucket_count; ++i)
+        {
+            h.buckets[i] = buckets[i].load(memory_order_relaxed);
+        }
+        out.merge(h);
+    }
+
+    void metrics_recorder::latency_cell::load_into(event_latency& out) const
+    {
+        decode.load_into(out.decode);
+        dispatch.load_into(out.dispatch);
+        queue.load_into(out.queue);
+        handler.load_into(out.handler);
+        total.load_into(out.total);
+    }
+
+    metrics_recorder::shard_ref::shard_ref(shard& s, mutex* overflow_mutex) :
+        m_shard(s)
+    {
+        if (overflow_mutex)
+        {
+            m_lock = unique_lock<mutex>(*overflow_mutex);
+        }
+    }
+
+    metrics_recorder::thread_slots::~thread_slots()
+    {
+        for (shard_slot const& slot : slots)
+        {
+            slot.owned->retired.store(true, memory_order_release);
+        }
+    }
+
+    metrics_recorder::thread_slots& metrics_recorder::local_slots()
+    {
+        static thread_local thread_slots s_slots;
+        return s_slots;
+    }
+
+    metrics_recorder::metrics_recorder() :
+        m_id(s_next_recorder_id.fetch_add(1)),
+        m_start(chrono::steady_clock::now()),
+        m_outstanding_acks(0),
+        m_send_depth(0),
+        m_send_peak(0),
+        m_dispatch(make_shared<dispatch_gauge>()),
+        m_tracing(false),
+        m_sample_one_in(0),
+        m_traces_seen(0),
+        m_next_sample(0)
+    {
+        m_shards.emplace_back(make_shared<shard>());
+        m_overflow = m_shards.front().get();
+    }
+
+    metrics_recorder::~metrics_recorder()
+    {
+    }
+
+    metrics_recorder::shard_ref metrics_recorder::local_shard()
+    {
+        vector<shard_slot>& slots = local_slots().slots;
+        for (shard_slot const& slot : slots)
+        {
+            if (slot.recorder_id == m_id)
+            {
+                return shard_ref(*slot.owned, nullptr);
+            }
+        }
+
+        if (slots.size() >= kMAX_SLOTS)
+        {
+            // a slot nobody else references belongs to a destroyed recorder
+            for (auto it = slots.begin(); it != slots.end();)
+            {
+                it = it->owned.use_count() == 1 ? slots.erase(it) : it + 1;
+            }
+        }
+        if (slots.size() >= kMAX_SLOTS)
+        {
+            // evicting a live slot would cost a new shard on every miss of a round-robin caller
+            return shard_ref(*m_overflow, &m_overflow_mutex);
+        }
+        slots.push_back(shard_slot{ m_id, acquire_shard() });
+        return shard_ref(*slots.back().owned, nullptr);
+    }
+
+    shared_ptr<metrics_recorder::shard> metrics_recorder::acquire_shard()
+    {
+        lock_guard<mutex> guard(m_shards_mutex);
+        for (shared_ptr<shard> const& candidate : m_shards)
+        {
+            bool retired = true;
+            if (candidate.get() != m_overflow &&
+                candidate->retired.compare_exchange_strong(retired, false, memory_order_acquire))
+            {
+                return candidate;
+            }
+        }
+        m_shards.emplace_back(make_shared<shard>());
+        return m_shards.back();
+    }
+
+    void metrics_recorder::record_frame_in(size_t bytes)
+    {
+        local_shard()->frames.add(true, bytes);
+    }
+
+    void metrics_recorder::record_frame_out(size_t bytes)
+    {
+        local_shard()->frames.add(false, bytes);
+    }
+
+    void metrics_recorder::record_packet_in(packet const& p, size_t bytes)
+    {
+        record_packet(p, bytes, true);
+    }
+
+    void metrics_recorder::record_packet_out(packet const& p, size_t bytes)
+    {
+        record_packet(p, bytes, false);
+    }
+
+    // Lookups need no lock, only the owning thread (or the overflow lock holder) ever inserts into its shard.
+    metrics_recorder::namespace_cell& metrics_recorder::find_namespace(shard& s, string const& nsp)
+    {
+        auto it = s.namespaces.find(nsp);
+        if (it == s.namespaces.end())
+        {
+            lock_guard<mutex> guard(s.map_mutex);
+            it = s.namespaces.emplace(nsp, unique_ptr<namespace_cell>(new namespace_cell())).first;
+        }
+        return *it->second;
+    }
+
+    template<typename cell>
+    cell& metrics_recorder::find_event(shard& s, unordered_map<string, unique_ptr<cell> >& events, string const& name)
+    {
+        auto it = events.find(name);
+        if (it == events.end())
+        {
+            string key = events.size() < max_events ? name : string(overflow_event);
+            it = events.find(key);
+            if (it == events.end())
+            {
+                lock_guard<mutex> guard(s.map_mutex);
+                it = events.emplace(key, unique_ptr<cell>(new cell())).first;
+            }
+        }
+        return *it->second;
+    }
+
+    void metrics_recorder::record_packet(packet const& p, size_t bytes, bool inbound)
+    {
+        shard_ref s = local_shard();
+        namespace_cell& nsp = find_namespace(*s, p.get_nsp());
+        nsp.traffic.add(inbound, bytes);
+
+        string const* name = event_name(p);
+        if (name)
+        {
+            find_event(*s, nsp.events, *name).add(inbound, bytes);
+        }
+    }
+
+    void metrics_recorder::record_trace(packet_trace const& trace)
+    {
+        {
+            shard_ref s = local_shard();
+            latency_cell& cell = find_event(*s, find_namespace(*s, trace.nsp).latency, trace.event);
+
+            // stages missing a timestamp are skipped, clocks can't run backwards
+            auto span = [](uint64_t from, uint64_t to) { return from > 0 && to >= from ? to - from : uint64_t(0); };
+            cell.decode.record(span(trace.received_micros, trace.decoded_micros));
+            cell.dispatch.record(span(trace.decoded_micros, trace.dispatched_micros));
+            cell.queue.record(span(trace.enqueued_micros, trace.handler_start_micros));
+            cell.handler.record(span(trace.handler_start_micros, trace.handler_end_micros));
+            cell.total.record(span(trace.received_micros, trace.handler_end_micros));
+        }
+
+        unsigned one_in = m_sample_one_in.load(memory_order_relaxed);
+        if (one_in == 0 || (m_traces_seen.fetch_add(1, memory_order_relaxed) % one_in) != 0)
+        {
+            return;
+        }
+        lock_guard<mutex> guard(m_sample_mutex);
+        size_t capacity = m_trace_options.sample_capacity;
+        if (capacity == 0)
+        {
+            return;
+        }
+        if (m_samples.size() < capacity)
+        {
+            m_samples.push_back(trace);
+        }
+        else
+        {
+            m_samples[m_next_sample] = trace;
+            m_next_sample = (m_next_sample + 1) % capacity;
+        }
+    }
+
+    void metrics_recorder::set_trace_options(trace_options const& options)
+    {
+        lock_guard<mutex> guard(m_sample_mutex);
+        // keep collected samples unless the ring changes size
+        if (options.sample_capacity != m_trace_options.sample_capacity)
+        {
+            m_samples.clear();
+            m_next_sample = 0;
+        }
+        m_trace_options = options;
+        m_sample_one_in = options.sample_one_in;
+        m_tracing = options.enabled;
+    }
+
+    trace_options metrics_recorder::get_trace_options() const
+    {
+        lock_guard<mutex> guard(m_sample_mutex);
+        return m_trace_options;
+    }
+
+    vector<packet_trace> metrics_recorder::get_trace_samples() const
+    {
+        lock_guard<mutex> guard(m_sample_mutex);
+        // oldest first
+        vector<packet_trace> out;
+        out.reserve(m_samples.size());
+        out.insert(out.end(), m_samples.begin() + m_next_sample, m_samples.end());
+        out.insert(out.end(), m_samples.begin(), m_samples.begin() + m_next_sample);
+        return out;
+    }
+
+    traced_dispatch*& metrics_recorder::current_dispatch()
+    {
+        static thread_local traced_dispatch* s_current = nullptr;
+        return s_current;
+    }
+
+    void metrics_recorder::record_encode(uint64_t micros)
+    {
+        local_shard()->encode.record(micros);
+    }
+
+    void metrics_recorder::record_decode(uint64_t micros)
+    {
+        local_shard()->decode.record(micros);
+    }
+
+    void metrics_recorder::record_ack_rtt(uint64_t micros)
+    {
+        local_shard()->ack_rtt.record(micros);
+    }
+
+    void metrics_recorder::record_reconnect()
+    {
+        local_shard()->reconnects.fetch_add(1, memory_order_relaxed);
+    }
+
+    void metrics_recorder::send_push()
+    {
+        int64_t depth = m_send_depth.fetch_add(1, memory_order_relaxed) + 1;
+        int64_t peak = m_send_peak.load(memory_order_relaxed);
+        while (depth > peak && !m_send_peak.compare_exchange_weak(peak, depth, memory_order_relaxed))
+        {
+        }
+    }
+
+    uint64_t metrics_recorder::now_micros() const
+    {
+        return static_cast<uint64_t>(chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - m_start).count());
+    }
+
+    metrics_snapshot metrics_recorder::snapshot() const
+    {
+        metrics_snapshot out;
+        out.captured_micros = now_micros();
+        {
+            lock_guard<mutex> guard(m_shards_mutex);
+            for (shared_ptr<shard> const& s : m_shards)
+            {
+                s->frames.load_into(out.frames);
+                s->encode.load_into(out.encode_micros);
+                s->decode.load_into(out.decode_micros);
+                s->ack_rtt.load_into(out.ack_rtt_micros);
+                out.reconnects += s->reconnects.load(memory_order_relaxed);
+
+                lock_guard<mutex> map_guard(s->map_mutex);
+                for (auto const& nsp : s->namespaces)
+                {
+                    namespace_metrics& nsp_out = out.namespaces[nsp.first];
+                    nsp.second->traffic.load_into(nsp_out.traffic);
+                    for (auto const& ev : nsp.second->events)
+                    {
+                        ev.second->load_into(nsp_out.events[ev.first]);
+                    }
+                    for (auto const& ev : nsp.second->latency)
+                    {
+                        ev.second->load_into(nsp_out.latency[ev.first]);
+                    }
+                }
+            }
+        }
+        int64_t acks = m_outstanding_acks.load(memory_order_relaxed);
+        int64_t depth = m_send_depth.load(memory_order_relaxed);
+        out.outstanding_acks = acks > 0 ? static_cast<uint64_t>(acks) : 0;
+        out.send_queue_depth = depth > 0 ? static_cast<uint64_t>(depth) : 0;
+        out.send_queue_peak = static_cast<uint64_t>(m_send_peak.load(memory_order_relaxed));
+        out.dispatch_queue_depth = m_dispatch->depth();
+        out.dispatch_queue_peak = m_dispatch->peak();
+        return out;
+    }
+}
@@ -0,0 +1,247 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+//
+//  sio_metrics_recorder.h
+//
+//  Collects the counters behind client::get_metrics(). Every thread that
+//  records gets its own shard of relaxed atomics, so the hot path never takes
+//  a lock or shares a cache line with another thread. snapshot() sums the
+//  shards. The only lock on the recording side is taken the first time a
+//  thread sees a namespace or event name. Shards of exited threads are handed
+//  to the next new thread, and a thread recording into more recorders than it
+//  has slots for shares one locked overflow shard per recorder.
+//
+
+#ifndef SIO_METRICS_RECORDER_H
+#define SIO_METRICS_RECORDER_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "sio_metrics.h"
+#include "sio_trace.h"
+
+namespace sio
+{
+    class packet;
+
+    // The trace of the packet whose listeners run on this thread right now.
+    struct traced_dispatch
+    {
+        packet_trace trace;
+        bool claimed = false;       // a listener took it over and will record it itself
+    };
+
+    class metrics_recorder
+    {
+    public:
+        // Distinct event names tracked per namespace and thread, the rest count as overflow_event.
+        static const size_t max_events = 256;
+
+        static const char* const overflow_event;
+
+        metrics_recorder();
+
+        ~metrics_recorder();
+
+        void record_frame_in(size_t bytes);
+
+        void record_frame_out(size_t bytes);
+
+        void record_packet_in(packet const& p, size_t bytes);
+
+        void record_packet_out(packet const& p, size_t bytes);
+
+        void record_encode(uint64_t micros);
+
+        void record_decode(uint64_t micros);
+
+        void record_ack_rtt(uint64_t micros);
+
+        void record_reconnect();
+
+        // Adds a finished trace to the event's latency histograms and maybe to the samples.
+        void record_trace(packet_trace const& trace);
+
+        void set_trace_options(trace_options const& options);
+
+        trace_options get_trace_options() const;
+
+        bool is_tracing() const { return m_tracing.load(std::memory_order_relaxed); }
+
+        std::vector<packet_trace> get_trace_samples() const;
+
+        // Set by client_impl while listeners run, read through client::claim_trace().
+        static traced_dispatch*& current_dispatch();
+
+        void ack_pending(int64_t delta) { m_outstanding_acks.fetch_add(delta, std::memory_order_relaxed); }
+
+        // A frame was handed to the network thread / the network thread took it.
+        void send_push();
+
+        void send_pop() { m_send_depth.fetch_sub(1, std::memory_order_relaxed); }
+
+        std::shared_ptr<dispatch_gauge> const& get_dispatch_gauge() const { return m_dispatch; }
+
+        uint64_t now_micros() const;
+
+        // Name of an event packet, null for every other packet type.
+        static std::string const* event_name(packet const& p);
+
+        metrics_snapshot snapshot() const;
+
+    private:
+        struct traffic_cell
+        {
+            std::atomic<uint64_t> packets_in{ 0 };
+            std::atomic<uint64_t> packets_out{ 0 };
+            std::atomic<uint64_t> bytes_in{ 0 };
+            std::atomic<uint64_t> bytes_out{ 0 };
+
+            void add(bool inbound, size_t bytes);
+
+            void load_into(traffic_counters& out) const;
+        };
+
+        struct histogram_cell
+        {
+            std::atomic<uint64_t> count{ 0 };
+            std::atomic<uint64_t> sum_micros{ 0 };
+            std::atomic<uint64_t> max_micros{ 0 };
+            std::atomic<uint64_t> buckets[latency_histogram::bucket_count];
+
+            histogram_cell();
+
+            void record(uint64_t micros);
+
+            void load_into(latency_histogram& out) const;
+        };
+
+        struct latency_cell
+        {
+            histogram_cell decode;
+            histogram_cell dispatch;
+            histogram_cell queue;
+            histogram_cell handler;
+            histogram_cell total;
+
+            void load_into(event_latency& out) const;
+        };
+
+        struct namespace_cell
+        {
+            traffic_cell traffic;
+            std::unordered_map<std::string, std::unique_ptr<traffic_cell> > events;
+            std::unordered_map<std::string, std::unique_ptr<latency_cell> > latency;
+        };
+
+        // Written by its owning thread only. The owner takes map_mutex just to insert,
+        // readers take it to walk the maps.
+        struct shard
+        {
+            traffic_cell frames;
+            histogram_cell encode;
+            histogram_cell decode;
+            histogram_cell ack_rtt;
+            std::atomic<uint64_t> reconnects{ 0 };
+
+            std::mutex map_mutex;
+            std::unordered_map<std::string, std::unique_ptr<namespace_cell> > namespaces;
+
+            // Set when the owning thread exits, the next thread without a shard takes it over.
+            std::atomic<bool> retired{ false };
+        };
+
+        // The shard a thread writes to, locked only when it is the shared overflow shard.
+        class shard_ref
+        {
+        public:
+            shard_ref(shard& s, std::mutex* overflow_mutex);
+
+            shard& operator*() const { return m_shard; }
+
+            shard* operator->() const { return &m_shard; }
+
+        private:
+            shard& m_shard;
+
+            std::unique_lock<std::mutex> m_lock;
+        };
+
+        // Each thread remembers the shard it owns per recorder. Ids are never reused, so a
+        // stale entry of a destroyed recorder can't be mistaken for a live one.
+        struct shard_slot
+        {
+            uint64_t recorder_id;
+            std::shared_ptr<shard> owned;
+        };
+
+        // Retires the thread's shards when it exits.
+        struct thread_slots
+        {
+            std::vector<shard_slot> slots;
+
+            ~thread_slots();
+        };
+
+        static thread_slots& local_slots();
+
+        shard_ref local_shard();
+
+        // An exited thread's shard if there is one, otherwise a new one.
+        std::shared_ptr<shard> acquire_shard();
+
+        void record_packet(packet const& p, size_t bytes, bool inbound);
+
+        static namespace_cell& find_namespace(shard& s, std::string const& nsp);
+
+        // Inserts on first sight, past max_events everything shares overflow_event.
+        template<typename cell>
+        static cell& find_event(shard& s, std::unordered_map<std::string, std::unique_ptr<cell> >& events, std::string const& name);
+
+        const uint64_t m_id;
+
+        const std::chrono::steady_clock::time_point m_start;
+
+        mutable std::mutex m_shards_mutex;
+
+        std::vector<std::shared_ptr<shard> > m_shards;
+
+        // Shared by threads that ran out of slots. Always m_shards[0], written under m_overflow_mutex.
+        shard* m_overflow;
+
+        std::mutex m_overflow_mutex;
+
+        // Gauges move in both directions from different threads, a shard per thread doesn't help.
+        std::atomic<int64_t> m_outstanding_acks;
+
+        std::atomic<int64_t> m_send_depth;
+
+        std::atomic<int64_t> m_send_peak;
+
+        // Fed by whoever defers handlers, outside the library. Shared so their queue can outlive us.
+        const std::shared_ptr<dispatch_gauge> m_dispatch;
+
+        std::atomic<bool> m_tracing;
+
+        // copy of m_trace_options.sample_one_in, checked before taking the lock
+        std::atomic<unsigned> m_sample_one_in;
+
+        std::atomic<uint64_t> m_traces_seen;
+
+        // Only sampled traces get here, a plain lock is fine.
+        mutable std::mutex m_sample_mutex;
+
+        trace_options m_trace_options;
+
+        std::vector<packet_trace> m_samples;    // ring, m_next_sample is the oldest once full
+
+        size_t m_next_sample;
+    };
+}
+
+#endif // SIO_METRICS_RECORDER_H
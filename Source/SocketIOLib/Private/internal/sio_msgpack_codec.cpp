@@ -0,0 +1,437 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+//
+//  sio_msgpack_codec.cpp
+//
+
+#include "sio_msgpack_codec.h"
+#include "sio_platform.h"
+#include <cstdint>
+#include <cstring>
+
+namespace sio
+{
+    using namespace std;
+
+    namespace
+    {
+        // Nested containers deeper than this are rejected instead of recursing further.
+        const int kMAX_DEPTH = 64;
+
+        void write_be(string& out, uint64_t v, int bytes)
+        {
+            for (int i = bytes - 1; i >= 0; --i)
+            {
+                out.push_back((char)((v >> (i * 8)) & 0xFF));
+            }
+        }
+
+        bool read_be(string const& in, size_t& pos, int bytes, uint64_t& v)
+        {
+            if (in.size() - pos < (size_t)bytes)
+            {
+                return false;
+            }
+            v = 0;
+            for (int i = 0; i < bytes; ++i)
+            {
+                v = (v << 8) | (unsigned char)in[pos + i];
+            }
+            pos += bytes;
+            return true;
+        }
+
+        void write_int(string& out, int64_t v)
+        {
+            if (v >= 0)
+            {
+                if (v < 0x80) { out.push_back((char)v); }
+                else if (v <= 0xFF) { out.push_back((char)0xcc); write_be(out, v, 1); }
+                else if (v <= 0xFFFF) { out.push_back((char)0xcd); write_be(out, v, 2); }
+                else if (v <= 0xFFFFFFFFLL) { out.push_back((char)0xce); write_be(out, v, 4); }
+                else { out.push_back((char)0xcf); write_be(out, v, 8); }
+            }
+            else
+            {
+                if (v >= -32) { out.push_back((char)(0xe0 | (v + 32))); }
+                else if (v >= INT8_MIN) { out.push_back((char)0xd0); write_be(out, (uint64_t)v, 1); }
+                else if (v >= INT16_MIN) { out.push_back((char)0xd1); write_be(out, (uint64_t)v, 2); }
+                else if (v >= INT32_MIN) { out.push_back((char)0xd2); write_be(out, (uint64_t)v, 4); }
+                else { out.push_back((char)0xd3); write_be(out, (uint64_t)v, 8); }
+            }
+        }
+
+        void write_str_header(string& out, size_t len)
+        {
+            if (len < 32) { out.push_back((char)(0xa0 | len)); }
+            else if (len <= 0xFF) { out.push_back((char)0xd9); write_be(out, len, 1); }
+            else if (len <= 0xFFFF) { out.push_back((char)0xda); write_be(out, len, 2); }
+            else { out.push_back((char)0xdb); write_be(out, len, 4); }
+        }
+
+        void write_str(string& out, string const& s)
+        {
+            write_str_header(out, s.size());
+            out.append(s);
+        }
+
+        void write_container_header(string& out, size_t len, unsigned char fix, unsigned char c16)
+        {
+            if (len < 16) { out.push_back((char)(fix | len)); }
+            else if (len <= 0xFFFF) { out.push_back((char)c16); write_be(out, len, 2); }
+            else { out.push_back((char)(c16 + 1)); write_be(out, len, 4); }
+        }
+
+        void pack(message const& msg, string& out)
+        {
+            switch (msg.get_flag())
+            {
+            case message::flag_integer:
+                write_int(out, msg.get_int());
+                break;
+            case message::flag_double:
+            {
+                double d = msg.get_double();
+                uint64_t bits;
+                memcpy(&bits, &d, sizeof(bits));
+                out.push_back((char)0xcb);
+                write_be(out, bits, 8);
+                break;
+            }
+            case message::flag_string:
+                write_str(out, msg.get_string());
+                break;
+            case message::flag_binary:
+            {
+                binary_message const& bin = static_cast<binary_message const&>(msg);
+                size_t len = bin.get_binary_size();
+                if (len <= 0xFF) { out.push_back((char)0xc4); write_be(out, len, 1); }
+                else if (len <= 0xFFFF) { out.push_back((char)0xc5); write_be(out, len, 2); }
+                else { out.push_back((char)0xc6); write_be(out, len, 4); }
+                if (len > 0)
+                {
+                    out.append(bin.get_binary_data(), len);
+                }
+                break;
+            }
+            case message::flag_array:
+            {
+                vector<message::ptr> const& arr = msg.get_vector();
+                write_container_header(out, arr.size(), 0x90, 0xdc);
+                for (auto it = arr.begin(); it != arr.end(); ++it)
+                {
+                    if (*it) { pack(**it, out); }
+                    else { out.push_back((char)0xc0); }
+                }
+                break;
+            }
+            case message::flag_object:
+            {
+                map<string, message::ptr> const& obj = msg.get_map();
+                write_container_header(out, obj.size(), 0x80, 0xde);
+                for (auto it = obj.begin(); it != obj.end(); ++it)
+                {
+                    write_str(out, it->first);
+                    if (it->second) { pack(*it->second, out); }
+                    else { out.push_back((char)0xc0); }
+                }
+                break;
+            }
+            case message::flag_boolean:
+                out.push_back(msg.get_bool() ? (char)0xc3 : (char)0xc2);
+                break;
+            case message::flag_null:
+            default:
+                out.push_back((char)0xc0);
+                break;
+            }
+        }
+
+        bool read_bytes(string const& in, size_t& pos, size_t len, string& out)
+        {
+            if (in.size() - pos < len)
+            {
+                return false;
+            }
+            out.assign(in.data() + pos, len);
+            pos += len;
+            return true;
+        }
+
+        bool read_len(string const& in, size_t& pos, int bytes, size_t& len)
+        {
+            uint64_t v;
+            if (!read_be(in, pos, bytes, v))
+            {
+                return false;
+            }
+            len = (size_t)v;
+            return true;
+        }
+
+        bool read_str(string const& in, size_t& pos, string& out)
+        {
+            if (pos >= in.size())
+            {
+                return false;
+            }
+            unsigned char c = (unsigned char)in[pos++];
+            size_t len;
+            if ((c & 0xe0) == 0xa0) { len = c & 0x1f; }
+            else if (c == 0xd9) { if (!read_len(in, pos, 1, len)) return false; }
+            else if (c == 0xda) { if (!read_len(in, pos, 2, len)) return false; }
+            else if (c == 0xdb) { if (!read_len(in, pos, 4, len)) return false; }
+            else { return false; }
+            return read_bytes(in, pos, len, out);
+        }
+
+        message::ptr unpack(string const& in, size_t& pos, int depth);
+
+        message::ptr unpack_array(string const& in, size_t& pos, size_t count, int depth)
+        {
+            message::ptr arr = array_message::create();
+            vector<message::ptr>& vec = arr->get_vector();
+            // every element takes at least one byte, don't let a bogus count reserve gigabytes
+            vec.reserve(count < in.size() - pos ? count : in.size() - pos);
+            for (size_t i = 0; i < count; ++i)
+            {
+                message::ptr item = unpack(in, pos, depth + 1);
+                if (!item)
+                {
+                    return message::ptr();
+                }
+                vec.push_back(item);
+            }
+            return arr;
+        }
+
+        message::ptr unpack_map(string const& in, size_t& pos, size_t count, int depth)
+        {
+            message::ptr obj = object_message::create();
+            map<string, message::ptr>& m = obj->get_map();
+            for (size_t i = 0; i < count; ++i)
+            {
+                string key;
+                if (!read_str(in, pos, key))
+                {
+                    return message::ptr();
+                }
+                message::ptr value = unpack(in, pos, depth + 1);
+                if (!value)
+                {
+                    return message::ptr();
+                }
+                m[key] = value;
+            }
+            return obj;
+        }
+
+        message::ptr unpack(string const& in, size_t& pos, int depth)
+        {
+            if (pos >= in.size() || depth > kMAX_DEPTH)
+            {
+                return message::ptr();
+            }
+            unsigned char c = (unsigned char)in[pos];
+            uint64_t v;
+            size_t len;
+
+            if (c <= 0x7f) { pos++; return int_message::create(c); }
+            if (c >= 0xe0) { pos++; return int_message::create((int8_t)c); }
+            if ((c & 0xf0) == 0x80) { pos++; return unpack_map(in, pos, c & 0x0f, depth); }
+            if ((c & 0xf0) == 0x90) { pos++; return unpack_array(in, pos, c & 0x0f, depth); }
+            if ((c & 0xe0) == 0xa0 || c == 0xd9 || c == 0xda || c == 0xdb)
+            {
+                string s;
+                if (!read_str(in, pos, s))
+                {
+                    return message::ptr();
+                }
+                return string_message::create(std::move(s));
+            }
+
+            pos++;
+            switch (c)
+            {
+            case 0xc0: return null_message::create();
+            case 0xc2: return bool_message::create(false);
+            case 0xc3: return bool_message::create(true);
+            case 0xc4:
+            case 0xc5:
+            case 0xc6:
+            {
+                if (!read_len(in, pos, c == 0xc4 ? 1 : (c == 0xc5 ? 2 : 4), len))
+                {
+                    return message::ptr();
+                }
+                shared_ptr<string> bin = make_shared<string>();
+                if (!read_bytes(in, pos, len, *bin))
+                {
+                    return message::ptr();
+                }
+                return binary_message::create(bin);
+            }
+            case 0xca:
+            {
+                if (!read_be(in, pos, 4, v)) return message::ptr();
+                uint32_t bits = (uint32_t)v;
+                float f;
+                memcpy(&f, &bits, sizeof(f));
+                return double_message::create(f);
+            }
+            case 0xcb:
+            {
+                if (!read_be(in, pos, 8, v)) return message::ptr();
+                double d;
+                memcpy(&d, &v, sizeof(d));
+                return double_message::create(d);
+            }
+            case 0xcc: if (!read_be(in, pos, 1, v)) return message::ptr(); return int_message::create((int64_t)v);
+            case 0xcd: if (!read_be(in, pos, 2, v)) return message::ptr(); return int_message::create((int64_t)v);
+            case 0xce: if (!read_be(in, pos, 4, v)) return message::ptr(); return int_message::create((int64_t)v);
+            case 0xcf: if (!read_be(in, pos, 8, v)) return message::ptr(); return int_message::create((int64_t)v);
+            case 0xd0: if (!read_be(in, pos, 1, v)) return message::ptr(); return int_message::create((int8_t)v);
+            case 0xd1: if (!read_be(in, pos, 2, v)) return message::ptr(); return int_message::create((int16_t)v);
+            case 0xd2: if (!read_be(in, pos, 4, v)) return message::ptr(); return int_message::create((int32_t)v);
+            case 0xd3: if (!read_be(in, pos, 8, v)) return message::ptr(); return int_message::create((int64_t)v);
+            case 0xdc:
+            case 0xdd:
+                if (!read_len(in, pos, c == 0xdc ? 2 : 4, len)) return message::ptr();
+                return unpack_array(in, pos, len, depth);
+            case 0xde:
+            case 0xdf:
+                if (!read_len(in, pos, c == 0xde ? 2 : 4, len)) return message::ptr();
+                return unpack_map(in, pos, len, depth);
+            default:
+                //ext types are not used by socket.io
+                return message::ptr();
+            }
+        }
+    }
+
+    msgpack_codec::msgpack_codec()
+    {
+    }
+
+    void msgpack_codec::pack_message(message const& msg, string& out)
+    {
+        pack(msg, out);
+    }
+
+    message::ptr msgpack_codec::unpack_message(string const& in, size_t& pos)
+    {
+        size_t cursor = pos;
+        message::ptr msg = unpack(in, cursor, 0);
+        if (msg)
+        {
+            pos = cursor;
+        }
+        return msg;
+    }
+
+    void msgpack_codec::encode(packet& pack, frame_callback_function const& frame_callback) const
+    {
+        SIO_TRACE_SCOPE(SocketIO_MsgpackEncode);
+        if (pack.get_frame() != packet::frame_message)
+        {
+            m_text_codec.encode(pack, frame_callback);
+            return;
+        }
+        //binaries are inlined, so event/ack never become their binary variants
+        pack.determine_type(false);
+
+        int pack_id = (int)pack.get_pack_id();
+        message::ptr const& msg = pack.get_message();
+        size_t fields = 2 + (msg ? 1 : 0) + (pack_id >= 0 ? 1 : 0);
+
+        shared_ptr<string> payload = make_shared<string>();
+        payload->reserve(64);
+        write_container_header(*payload, fields, 0x80, 0xde);
+        write_str(*payload, "type");
+        write_int(*payload, pack.get_type());
+        write_str(*payload, "nsp");
+        write_str(*payload, pack.get_nsp().empty() ? string("/") : pack.get_nsp());
+        if (msg)
+        {
+            write_str(*payload, "data");
+            pack_message(*msg, *payload);
+        }
+        if (pack_id >= 0)
+        {
+            write_str(*payload, "id");
+            write_int(*payload, pack_id);
+        }
+        frame_callback(true, frame_buffer(shared_ptr<const string>(payload)));
+    }
+
+    unique_ptr<packet> msgpack_codec::decode(shared_ptr<const string> const& payload, bool binary_frame)
+    {
+        SIO_TRACE_SCOPE(SocketIO_MsgpackDecode);
+        if (!binary_frame)
+        {
+            unique_ptr<packet> p = m_text_codec.decode(payload, false);
+            m_error = m_text_codec.get_error();
+            return p;
+        }
+
+        // the whole packet is one frame, reject it before unpacking copies its binaries
+        if (exceeds_partial_size(payload->size()))
+        {
+            m_error = "Partial packet exceeds size limit";
+            return unique_ptr<packet>();
+        }
+
+        size_t pos = 0;
+        message::ptr root = unpack_message(*payload, pos);
+        if (!root || root->get_flag() != message::flag_object)
+        {
+            return unique_ptr<packet>();
+        }
+        map<string, message::ptr> const& fields = root->get_map();
+
+        auto type_it = fields.find("type");
+        if (type_it == fields.end() || !type_it->second || type_it->second->get_flag() != message::flag_integer)
+        {
+            return unique_ptr<packet>();
+        }
+        int64_t type = type_it->second->get_int();
+        if (type < packet::type_min || type > packet::type_max)
+        {
+            return unique_ptr<packet>();
+        }
+
+        string nsp = "/";
+        auto nsp_it = fields.find("nsp");
+        if (nsp_it != fields.end() && nsp_it->second && nsp_it->second->get_flag() == message::flag_string)
+        {
+            nsp = nsp_it->second->get_string();
+        }
+
+        message::ptr data;
+        auto data_it = fields.find("data");
+        if (data_it != fields.end())
+        {
+            data = data_it->second;
+        }
+
+        int pack_id = -1;
+        auto id_it = fields.find("id");
+        if (id_it != fields.end() && id_it->second && id_it->second->get_flag() == message::flag_integer)
+        {
+            pack_id = (int)id_it->second->get_int();
+        }
+
+        return unique_ptr<packet>(new packet((packet::type)type, nsp, data, pack_id));
+    }
+
+    void msgpack_codec::reset()
+    {
+        m_text_codec.reset();
+        m_error.clear();
+    }
+
+    void msgpack_codec::set_max_partial_size(size_t max_partial_size)
+    {
+        packet_codec::set_max_partial_size(max_partial_size);
+        m_text_codec.set_max_partial_size(max_partial_size);
+    }
+}
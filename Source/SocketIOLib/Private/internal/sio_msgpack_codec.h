@@ -0,0 +1,43 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+//
+//  sio_msgpack_codec.h
+//
+//  Wire codec compatible with socket.io-msgpack-parser. Every socket.io packet
+//  is a single binary frame holding a msgpack map { type, nsp, data, id } with
+//  binaries inlined as msgpack bin, so there are no attachment frames and no
+//  placeholder bookkeeping. Engine.io control frames stay text.
+//
+
+#ifndef SIO_MSGPACK_CODEC_H
+#define SIO_MSGPACK_CODEC_H
+
+#include "sio_packet.h"
+
+namespace sio
+{
+    class msgpack_codec : public packet_codec
+    {
+    public:
+        msgpack_codec();
+
+        void encode(packet& pack, frame_callback_function const& frame_callback) const override;
+
+        unique_ptr<packet> decode(shared_ptr<const string> const& payload, bool binary_frame) override;
+
+        void reset() override;
+
+        void set_max_partial_size(size_t max_partial_size) override;
+
+        // Exposed for tooling, pack_message appends to out.
+        static void pack_message(message const& msg, string& out);
+
+        // Returns null and leaves pos untouched on malformed input.
+        static message::ptr unpack_message(string const& in, size_t& pos);
+
+    private:
+        // open/ping/pong/close and any text frames still use the socket.io text format
+        json_codec m_text_codec;
+    };
+}
+
+#endif // SIO_MSGPACK_CODEC_H
@@ -24,21 +24,21 @@
 #define _WEBSOCKETPP_CPP11_STL_
 
 #include "sio_packet.h"
+#include "sio_metrics_recorder.h"
+#include "sio_platform.h"
 #include <rapidjson/document.h>
 #include <rapidjson/encodedstream.h>
 #include <rapidjson/writer.h>
 #include <cassert>
+#include <cstdlib>
 
 #define kBIN_PLACE_HOLDER "_placeholder"
 
-#include "Runtime/Core/Public/Misc/CString.h"
-#include "Runtime/Core/Public/Containers/UnrealString.h"
-
 namespace sio
 {
     using namespace rapidjson;
     using namespace std;
-    void accept_message(message const& msg, Value& val, Document& doc, vector<shared_ptr<const string> >& buffers);
+    void accept_message(message const& msg, Value& val, Document& doc, vector<frame_buffer>& buffers);
 
     void accept_bool_message(bool_message const& msg, Value& val)
     {
@@ -66,7 +66,7 @@ namespace sio
     }
 
 
-    void accept_binary_message(binary_message const& msg, Value& val, Document& doc, vector<shared_ptr<const string> >& buffers)
+    void accept_binary_message(binary_message const& msg, Value& val, Document& doc, vector<frame_buffer>& buffers)
     {
         val.SetObject();
         Value boolVal;
@@ -75,10 +75,11 @@ namespace sio
         Value numVal;
         numVal.SetInt((int)buffers.size());
         val.AddMember("num", numVal, doc.GetAllocator());
-        buffers.push_back(msg.get_binary());
+        //reference the bytes, external buffers stay caller owned until written
+        buffers.push_back(frame_buffer(msg.get_binary_owner(), msg.get_binary_data(), msg.get_binary_size()));
     }
 
-    void accept_array_message(array_message const& msg, Value& val, Document& doc, vector<shared_ptr<const string> >& buffers)
+    void accept_array_message(array_message const& msg, Value& val, Document& doc, vector<frame_buffer>& buffers)
     {
         val.SetArray();
         for (vector<message::ptr>::const_iterator it = msg.get_vector().begin(); it != msg.get_vector().end(); ++it) {
@@ -88,7 +89,7 @@ namespace sio
         }
     }
 
-    void accept_object_message(object_message const& msg, Value& val, Document& doc, vector<shared_ptr<const string> >& buffers)
+    void accept_object_message(object_message const& msg, Value& val, Document& doc, vector<frame_buffer>& buffers)
     {
         val.SetObject();
         for (map<string, message::ptr>::const_iterator it = msg.get_map().begin(); it != msg.get_map().end(); ++it) {
@@ -100,7 +101,7 @@ namespace sio
         }
     }
 
-    void accept_message(message const& msg, Value& val, Document& doc, vector<shared_ptr<const string> >& buffers)
+    void accept_message(message const& msg, Value& val, Document& doc, vector<frame_buffer>& buffers)
     {
         const message* msg_ptr = &msg;
         switch (msg.get_flag())
@@ -150,7 +151,7 @@ namespace sio
         }
     }
 
-    message::ptr from_json(Value const& value, vector<shared_ptr<const string> > const& buffers)
+    message::ptr from_json(Value const& value, vector<message::ptr> const& buffers)
     {
         if (value.IsInt64())
         {
@@ -182,7 +183,7 @@ namespace sio
                 int num = value["num"].GetInt();
                 if (num >= 0 && num < static_cast<int>(buffers.size()))
                 {
-                    return binary_message::create(buffers[num]);
+                    return buffers[num];
                 }
                 return message::ptr();
             }
@@ -221,11 +222,11 @@ namespace sio
             || (isAck && pack_id >= 0)));
     }
 
-    packet::packet(type type, string const& nsp, message::ptr const& msg) :
+    packet::packet(type type, string const& nsp, message::ptr const& msg, int pack_id) :
         _frame(frame_message),
         _type(type),
         _nsp(nsp),
-        _pack_id(-1),
+        _pack_id(pack_id),
         _message(msg),
         _pending_buffers(0)
     {
@@ -265,19 +266,20 @@ namespace sio
         return is_binary_message(payload_ptr) || is_text_message(payload_ptr);
     }
 
-    bool packet::parse_buffer(const string& buf_payload)
+    bool packet::parse_buffer(message::ptr const& attachment)
     {
+        SIO_LLM_SCOPE(SocketIO_Messages);
         if (_pending_buffers > 0) {
-            assert(is_binary_message(buf_payload));//this is ensured by outside.
-            _buffers.push_back(std::make_shared<string>(buf_payload.data(), buf_payload.size()));
+            //binary framing is ensured by outside, decoded attachments carry no frame prefix
+            _buffers.push_back(attachment);
             _pending_buffers--;
             if (_pending_buffers == 0) {
 
                 Document doc;
-                doc.Parse<0>(_buffers.front()->data());
-                _buffers.erase(_buffers.begin());
+                doc.Parse<0>(_buffered_json.data());
                 _message = from_json(doc, _buffers);
                 _buffers.clear();
+                _buffered_json.clear();
                 return false;
             }
             return true;
@@ -287,11 +289,14 @@ namespace sio
 
     bool packet::parse(const string& payload_ptr)
     {
+        SIO_TRACE_SCOPE(SocketIO_PacketParse);
+        SIO_LLM_SCOPE(SocketIO_Messages);
         assert(!is_binary_message(payload_ptr)); //this is ensured by outside
         _frame = (packet::frame_type)(payload_ptr[0] - '0');
         _message.reset();
         _pack_id = -1;
         _buffers.clear();
+        _buffered_json.clear();
         _pending_buffers = 0;
         size_t pos = 1;
         if (_frame == frame_message) {
@@ -303,7 +308,7 @@ namespace sio
             pos++;
             if (_type == type_binary_event || _type == type_binary_ack) {
                 size_t score_pos = payload_ptr.find('-');
-                _pending_buffers = FCString::Atoi64(*FString(payload_ptr.substr(pos, score_pos - pos).c_str()));
+                _pending_buffers = strtoll(payload_ptr.c_str() + pos, nullptr, 10);
                 pos = score_pos + 1;
             }
         }
@@ -343,25 +348,26 @@ namespace sio
 
         if (pos < json_pos)//we've got pack id.
         {
-            _pack_id = FCString::Atoi(*FString(payload_ptr.substr(pos, json_pos - pos).c_str()));
+            _pack_id = atoi(payload_ptr.c_str() + pos);
         }
         if (_frame == frame_message && (_type == type_binary_event || _type == type_binary_ack)) {
             //parse later when all buffers are arrived.
-            _buffers.push_back(make_shared<string>(payload_ptr.data() + json_pos, payload_ptr.length() - json_pos));
+            _buffered_json.assign(payload_ptr.data() + json_pos, payload_ptr.length() - json_pos);
             return true;
         }
         else
         {
             Document doc;
             doc.Parse<0>(payload_ptr.data() + json_pos);
-            _message = from_json(doc, vector<shared_ptr<const string> >());
+            _message = from_json(doc, vector<message::ptr>());
             return false;
         }
 
     }
 
-    bool packet::accept(string& payload_ptr, vector<shared_ptr<const string> >& buffers)
+    bool packet::accept(string& payload_ptr, vector<frame_buffer>& buffers)
     {
+        SIO_TRACE_SCOPE(SocketIO_PacketAccept);
         char frame_char = _frame + '0';
         payload_ptr.append(&frame_char, 1);
         if (_frame != frame_message) {
@@ -374,15 +380,7 @@ namespace sio
             hasMessage = true;
         }
         bool hasBinary = buffers.size() > 0;
-        _type = _type & (~type_undetermined);
-        if (_type == type_event)
-        {
-            _type = hasBinary ? type_binary_event : type_event;
-        }
-        else if (_type == type_ack)
-        {
-            _type = hasBinary ? type_binary_ack : type_ack;
-        }
+        determine_type(hasBinary);
         ostringstream ss;
         ss.precision(8);
         ss << _type;
@@ -413,6 +411,23 @@ namespace sio
         return hasBinary;
     }
 
+    void packet::determine_type(bool hasBinary)
+    {
+        if ((_type & type_undetermined) == 0)
+        {
+            return;
+        }
+        _type = _type & (~type_undetermined);
+        if (_type == type_event)
+        {
+            _type = hasBinary ? type_binary_event : type_event;
+        }
+        else if (_type == type_ack)
+        {
+            _type = hasBinary ? type_binary_ack : type_ack;
+        }
+    }
+
     packet::frame_type packet::get_frame() const
     {
         return _frame;
@@ -440,91 +455,338 @@ namespace sio
     }
 
 
-    void packet_manager::set_decode_callback(function<void(packet const&)> const& decode_callback)
-    {
-        m_decode_callback = decode_callback;
-    }
-
-    void packet_manager::set_encode_callback(function<void(bool, shared_ptr<const string> const&)> const& encode_callback)
+    frame_buffer json_codec::encode_attachment(frame_buffer const& buffer) const
     {
-        m_encode_callback = encode_callback;
+        if (!m_attachment_codec_active)
+        {
+            return buffer;
+        }
+        if (buffer.size >= m_attachment_codec->get_min_size() && buffer.size <= 0xFFFFFFFFu)
+        {
+            shared_ptr<string> encoded = make_shared<string>();
+            encoded->reserve(attachment_codec::header_size + buffer.size);
+            attachment_codec::write_header(*encoded, (uint32_t)buffer.size);
+            string body;
+            if (m_attachment_codec->compress(buffer.data, buffer.size, body) &&
+                body.size() + attachment_codec::header_size < buffer.size)
+            {
+                encoded->append(body);
+                return frame_buffer(shared_ptr<const string>(encoded));
+            }
+        }
+        //didn't pay off, send as is unless the receiver would take it for a header
+        if (!attachment_codec::needs_escape(buffer.data, buffer.size))
+        {
+            return buffer;
+        }
+        shared_ptr<string> escaped = make_shared<string>();
+        escaped->reserve(attachment_codec::header_size + buffer.size);
+        attachment_codec::write_raw_header(*escaped, (uint32_t)buffer.size);
+        escaped->append(buffer.data, buffer.size);
+        return frame_buffer(shared_ptr<const string>(escaped));
     }
 
-    void packet_manager::reset()
+    bool json_codec::decode_attachment(string const& payload, string& out)
     {
-        m_partial_packet.reset();
+        const size_t body_size = payload.size() - attachment_codec::header_size;
+        const uint32_t raw_size = attachment_codec::read_raw_size(payload);
+        if (attachment_codec::has_raw_header(payload))
+        {
+            if (raw_size != body_size)
+            {
+                m_error = "Escaped attachment size mismatch";
+                return false;
+            }
+            if (exceeds_partial_size(m_partial_size + body_size))
+            {
+                m_error = "Partial packet exceeds size limit";
+                return false;
+            }
+            out.assign(payload, attachment_codec::header_size, body_size);
+            return true;
+        }
+        // checked before the codec sizes its output to raw_size
+        if (raw_size > body_size * attachment_codec::max_ratio)
+        {
+            m_error = "Compressed attachment claims an impossible size";
+            return false;
+        }
+        // inflation always lands on the heap, even if the result is spilled afterwards
+        if (exceeds_partial_size(m_partial_size + raw_size))
+        {
+            m_error = "Partial packet exceeds size limit";
+            return false;
+        }
+        out.clear();
+        if (!m_attachment_codec->decompress(payload.data() + attachment_codec::header_size, body_size, raw_size, out) ||
+            out.size() != raw_size)
+        {
+            m_error = "Compressed attachment is corrupt";
+            return false;
+        }
+        return true;
     }
 
-    void packet_manager::encode(packet& pack, encode_callback_function const& override_encode_callback) const
+    void json_codec::encode(packet& pack, frame_callback_function const& frame_callback) const
     {
         shared_ptr<string> ptr = make_shared<string>();
-        vector<shared_ptr<const string> > buffers;
-        const encode_callback_function* cb_ptr = &m_encode_callback;
-        if (override_encode_callback)
-        {
-            cb_ptr = &override_encode_callback;
-        }
+        vector<frame_buffer> buffers;
         if (pack.accept(*ptr, buffers))
         {
-            if ((*cb_ptr))
-            {
-                (*cb_ptr)(false, ptr);
-            }
+            frame_callback(false, frame_buffer(shared_ptr<const string>(ptr)));
             for (auto it = buffers.begin(); it != buffers.end(); ++it)
             {
-                if ((*cb_ptr))
-                {
-                    (*cb_ptr)(true, *it);
-                }
+                frame_callback(true, encode_attachment(*it));
             }
         }
         else
         {
-            if ((*cb_ptr))
-            {
-                (*cb_ptr)(false, ptr);
-            }
+            frame_callback(false, frame_buffer(shared_ptr<const string>(ptr)));
         }
     }
 
-    void packet_manager::put_payload(string const& payload)
+    unique_ptr<packet> json_codec::decode(shared_ptr<const string> const& payload_ptr, bool binary_frame)
     {
+        string const& payload = *payload_ptr;
         unique_ptr<packet> p;
-        do
+        if (m_partial_packet && m_attachment_codec_active &&
+            (attachment_codec::has_header(payload) || attachment_codec::has_raw_header(payload)))
+        {
+            string decoded;
+            message::ptr attachment;
+            if (decode_attachment(payload, decoded))
+            {
+                attachment = make_attachment(make_shared<const string>(std::move(decoded)));
+            }
+            if (!attachment)
+            {
+                // never deliver the packet, m_error tells the manager to drop the connection
+                m_partial_packet.reset();
+            }
+            else if (!m_partial_packet->parse_buffer(attachment))
+            {
+                p = std::move(m_partial_packet);
+            }
+        }
+        else if (packet::is_text_message(payload) && !binary_frame)
         {
-            if (packet::is_text_message(payload))
+            p.reset(new packet());
+            if (p->parse(payload))
             {
-                p.reset(new packet());
-                if (p->parse(payload))
+                if (exceeds_partial_size(payload.size()))
                 {
-                    m_partial_packet = std::move(p);
+                    m_error = "Partial packet exceeds size limit";
+                    p.reset();
                 }
                 else
                 {
-                    break;
+                    m_partial_packet = std::move(p);
+                    m_partial_size = payload.size();
                 }
             }
-            else if (packet::is_binary_message(payload))
+        }
+        else if (binary_frame || packet::is_binary_message(payload))
+        {
+            if (m_partial_packet)
             {
-                if (m_partial_packet)
+                message::ptr attachment = make_attachment(payload_ptr);
+                if (!attachment)
+                {
+                    m_partial_packet.reset();
+                }
+                else if (!m_partial_packet->parse_buffer(attachment))
                 {
-                    if (!m_partial_packet->parse_buffer(payload))
-                    {
-                        p = std::move(m_partial_packet);
-                        break;
-                    }
+                    p = std::move(m_partial_packet);
                 }
             }
-            else
+        }
+        else
+        {
+            p.reset(new packet());
+            p->parse(payload);
+        }
+        if (!m_partial_packet)
+        {
+            m_partial_size = 0;
+        }
+        return p;
+    }
+
+    message::ptr json_codec::make_attachment(shared_ptr<const string> const& buffer)
+    {
+        if (m_attachment_store && m_spill_threshold > 0 && buffer->size() >= m_spill_threshold)
+        {
+            message::ptr stored = m_attachment_store->store(buffer);
+            if (stored)
             {
-                p.reset(new packet());
-                p->parse(payload);
-                break;
+                return stored;
             }
+        }
+        // the last attachment counts too, the packet holds all of them until it is delivered
+        if (exceeds_partial_size(m_partial_size + buffer->size()))
+        {
+            m_error = "Partial packet exceeds size limit";
+            return message::ptr();
+        }
+        m_partial_size += buffer->size();
+        return binary_message::create(buffer);
+    }
+
+    void json_codec::reset()
+    {
+        m_partial_packet.reset();
+        m_partial_size = 0;
+        m_error.clear();
+        m_attachment_codec_active = false;
+    }
+
+    void json_codec::set_attachment_store(attachment_store::ptr const& store, size_t spill_threshold)
+    {
+        m_attachment_store = store;
+        m_spill_threshold = spill_threshold;
+    }
+
+    void json_codec::set_attachment_codec(attachment_codec::ptr const& codec)
+    {
+        m_attachment_codec = codec;
+        m_attachment_codec_active = false;
+    }
+
+    attachment_codec::ptr const& json_codec::get_attachment_codec() const
+    {
+        return m_attachment_codec;
+    }
+
+    void json_codec::set_attachment_codec_active(bool active)
+    {
+        m_attachment_codec_active = active && m_attachment_codec;
+    }
+
+    bool json_codec::is_attachment_codec_active() const
+    {
+        return m_attachment_codec_active;
+    }
+
+    packet_manager::packet_manager() :
+        m_max_partial_size(0),
+        m_failed(false),
+        m_metrics(nullptr),
+        m_json_codec(make_shared<json_codec>()),
+        m_codec(m_json_codec)
+    {
+    }
+
+    void packet_manager::set_error_callback(error_callback_function const& error_callback)
+    {
+        m_error_callback = error_callback;
+    }
+
+    void packet_manager::set_max_partial_size(size_t max_partial_size)
+    {
+        m_max_partial_size = max_partial_size;
+        m_json_codec->set_max_partial_size(max_partial_size);
+        m_codec->set_max_partial_size(max_partial_size);
+    }
+
+    void packet_manager::set_metrics(metrics_recorder* metrics)
+    {
+        m_metrics = metrics;
+    }
+
+    void packet_manager::set_decode_callback(function<void(packet const&)> const& decode_callback)
+    {
+        m_decode_callback = decode_callback;
+    }
+
+    void packet_manager::set_encode_callback(encode_callback_function const& encode_callback)
+    {
+        m_encode_callback = encode_callback;
+    }
+
+    void packet_manager::set_codec(shared_ptr<packet_codec> const& codec)
+    {
+        m_codec = codec ? codec : m_json_codec;
+        m_codec->set_max_partial_size(m_max_partial_size);
+        m_codec->reset();
+    }
+
+    shared_ptr<json_codec> const& packet_manager::get_json_codec() const
+    {
+        return m_json_codec;
+    }
+
+    void packet_manager::reset()
+    {
+        m_json_codec->reset();
+        m_codec->reset();
+        m_failed = false;
+    }
+
+    void packet_manager::set_attachment_codec(attachment_codec::ptr const& codec)
+    {
+        m_json_codec->set_attachment_codec(codec);
+    }
+
+    attachment_codec::ptr const& packet_manager::get_attachment_codec() const
+    {
+        return m_json_codec->get_attachment_codec();
+    }
+
+    void packet_manager::set_attachment_codec_active(bool active)
+    {
+        m_json_codec->set_attachment_codec_active(active);
+    }
+
+    bool packet_manager::is_attachment_codec_active() const
+    {
+        return m_json_codec->is_attachment_codec_active();
+    }
+
+    void packet_manager::encode(packet& pack, encode_callback_function const& override_encode_callback) const
+    {
+        const encode_callback_function* cb_ptr = &m_encode_callback;
+        if (override_encode_callback)
+        {
+            cb_ptr = &override_encode_callback;
+        }
+        if (!(*cb_ptr))
+        {
+            return;
+        }
+        if (!m_metrics)
+        {
+            m_codec->encode(pack, *cb_ptr);
             return;
-        } while (0);
+        }
+        uint64_t start = m_metrics->now_micros();
+        m_codec->encode(pack, *cb_ptr);
+        m_metrics->record_encode(m_metrics->now_micros() - start);
+    }
 
-        if (m_decode_callback)
+    void packet_manager::put_payload(shared_ptr<const string> const& payload, bool binary_frame)
+    {
+        if (m_failed)
+        {
+            return;
+        }
+        uint64_t start = m_metrics ? m_metrics->now_micros() : 0;
+        unique_ptr<packet> p = m_codec->decode(payload, binary_frame);
+        if (m_metrics)
+        {
+            m_metrics->record_decode(m_metrics->now_micros() - start);
+        }
+        if (!m_codec->get_error().empty())
+        {
+            m_failed = true;
+            string error = m_codec->get_error();
+            m_codec->reset();
+            if (m_error_callback)
+            {
+                m_error_callback(error);
+            }
+            return;
+        }
+        if (p && m_decode_callback)
         {
             m_decode_callback(*p);
         }
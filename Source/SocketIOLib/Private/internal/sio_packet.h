@@ -9,12 +9,32 @@
 #define SIO_PACKET_H
 #include <sstream>
 #include "sio_message.h"
+#include "sio_attachment_codec.h"
+#include "sio_attachment_store.h"
 #include <functional>
+#include <atomic>
 
 namespace sio
 {
     using namespace std;
 
+    class metrics_recorder;
+
+    // Payload of one outgoing websocket frame. Either an encoded string or caller
+    // owned attachment bytes, owner keeps data alive until the frame is written.
+    struct frame_buffer
+    {
+        frame_buffer() : data(nullptr), size(0) {}
+
+        frame_buffer(shared_ptr<const string> const& str) : owner(str), data(str->data()), size(str->size()) {}
+
+        frame_buffer(shared_ptr<const void> const& owner, char const* data, size_t size) : owner(owner), data(data), size(size) {}
+
+        shared_ptr<const void> owner;
+        char const* data;
+        size_t size;
+    };
+
     class packet
     {
     public:
@@ -49,13 +69,14 @@ namespace sio
         int _pack_id;
         message::ptr _message;
         unsigned _pending_buffers;
-        vector<shared_ptr<const string> > _buffers;
+        string _buffered_json;//json of a binary packet, parsed once all attachments arrived
+        vector<message::ptr> _buffers;
     public:
         packet(string const& nsp, message::ptr const& msg, int pack_id = -1, bool isAck = false);//message type constructor.
 
         packet(frame_type frame);
 
-        packet(type type, string const& nsp = string(), message::ptr const& msg = message::ptr());//other message types constructor.
+        packet(type type, string const& nsp = string(), message::ptr const& msg = message::ptr(), int pack_id = -1);//other message types constructor.
         //empty constructor for parse.
         packet();
 
@@ -65,9 +86,11 @@ namespace sio
 
         bool parse(string const& payload_ptr);//return true if need to parse buffer.
 
-        bool parse_buffer(string const& buf_payload);
+        bool parse_buffer(message::ptr const& attachment);//binary_message for the next placeholder, no copy
+
+        bool accept(string& payload_ptr, vector<frame_buffer>& buffers); //return true if has binary buffers.
 
-        bool accept(string& payload_ptr, vector<shared_ptr<const string> >& buffers); //return true if has binary buffers.
+        void determine_type(bool hasBinary);//resolve event/ack into their (binary) wire type
 
         string const& get_nsp() const;
 
@@ -80,28 +103,148 @@ namespace sio
         static bool is_binary_message(string const& payload_ptr);
     };
 
+    /**
+     * Wire format of socket.io packets. Engine.io frames (open, ping, pong, close) always
+     * use the text encoding, codecs only decide how socket.io messages are carried.
+     */
+    class packet_codec
+    {
+    public:
+        typedef function<void(bool, frame_buffer const&)> frame_callback_function;
+
+        virtual ~packet_codec() {}
+
+        // Serialize pack, calling frame_callback(isBinary, payload) once per websocket frame.
+        virtual void encode(packet& pack, frame_callback_function const& frame_callback) const = 0;
+
+        // Feed a websocket frame. Returns the packet once it is complete, otherwise null.
+        // Binary frames may be kept as attachment buffers, so payload must not be modified afterwards.
+        virtual unique_ptr<packet> decode(shared_ptr<const string> const& payload, bool binary_frame) = 0;
+
+        virtual void reset() {}
+
+        // Heap bytes held for a packet that is still waiting for frames.
+        virtual size_t get_partial_size() const { return 0; }
+
+        // Why decode rejected the peer's input, empty while all is well. Cleared by reset().
+        string const& get_error() const { return m_error; }
+
+        // Max heap bytes one packet may hold while it is decoded, 0 is unlimited.
+        // Checked before anything is buffered or inflated, exceeding it sets the error.
+        virtual void set_max_partial_size(size_t max_partial_size) { m_max_partial_size = max_partial_size; }
+
+    protected:
+        bool exceeds_partial_size(size_t bytes) const { return m_max_partial_size > 0 && bytes > m_max_partial_size; }
+
+        string m_error;
+
+        size_t m_max_partial_size = 0;
+    };
+
+    // Default socket.io text encoding with placeholder based binary attachments
+    class json_codec : public packet_codec
+    {
+    public:
+        void encode(packet& pack, frame_callback_function const& frame_callback) const override;
+
+        unique_ptr<packet> decode(shared_ptr<const string> const& payload, bool binary_frame) override;
+
+        void reset() override;
+
+        size_t get_partial_size() const override { return m_partial_size; }
+
+        // Attachments of at least spill_threshold bytes are handed to store, 0 disables spilling.
+        void set_attachment_store(attachment_store::ptr const& store, size_t spill_threshold);
+
+        void set_attachment_codec(attachment_codec::ptr const& codec);
+
+        attachment_codec::ptr const& get_attachment_codec() const;
+
+        void set_attachment_codec_active(bool active);
+
+        bool is_attachment_codec_active() const;
+
+    private:
+        frame_buffer encode_attachment(frame_buffer const& buffer) const;
+
+        // Strips the header of a compressed or escaped attachment, sets m_error on bad input.
+        bool decode_attachment(string const& payload, string& out);
+
+        // Null with m_error set when keeping buffer would exceed the partial size limit.
+        message::ptr make_attachment(shared_ptr<const string> const& buffer);
+
+        std::unique_ptr<packet> m_partial_packet;
+
+        size_t m_partial_size = 0;
+
+        attachment_store::ptr m_attachment_store;
+
+        size_t m_spill_threshold = 0;
+
+        attachment_codec::ptr m_attachment_codec;
+
+        std::atomic<bool> m_attachment_codec_active{ false };
+    };
+
     class packet_manager
     {
     public:
-        typedef function<void(bool, shared_ptr<const string> const&)> encode_callback_function;
+        typedef function<void(bool, frame_buffer const&)> encode_callback_function;
         typedef  function<void(packet const&)> decode_callback_function;
+        typedef function<void(string const&)> error_callback_function;
+
+        packet_manager();
 
         void set_decode_callback(decode_callback_function const& decode_callback);
 
         void set_encode_callback(encode_callback_function const& encode_callback);
 
+        // Called once when the peer violates a limit, further payloads are dropped until reset().
+        void set_error_callback(error_callback_function const& error_callback);
+
+        // Max heap bytes a partial packet may hold, 0 is unlimited.
+        void set_max_partial_size(size_t max_partial_size);
+
+        // Receives encode/decode timings, not owned. Set once before use.
+        void set_metrics(metrics_recorder* metrics);
+
+        // Swap the wire codec, null restores the json codec. Only call while disconnected.
+        void set_codec(shared_ptr<packet_codec> const& codec);
+
+        shared_ptr<json_codec> const& get_json_codec() const;
+
         void encode(packet& pack, encode_callback_function const& override_encode_callback = encode_callback_function()) const;
 
-        void put_payload(string const& payload);
+        void put_payload(shared_ptr<const string> const& payload, bool binary_frame = false);
 
         void reset();
 
+        // Attachment compression only applies to the json codec, other codecs inline binaries.
+        void set_attachment_codec(attachment_codec::ptr const& codec);
+
+        attachment_codec::ptr const& get_attachment_codec() const;
+
+        // Called once the server confirmed it understands the codec. Until then attachments go out raw.
+        void set_attachment_codec_active(bool active);
+
+        bool is_attachment_codec_active() const;
+
     private:
         decode_callback_function m_decode_callback;
 
         encode_callback_function m_encode_callback;
 
-        std::unique_ptr<packet> m_partial_packet;
+        error_callback_function m_error_callback;
+
+        size_t m_max_partial_size;
+
+        bool m_failed;
+
+        metrics_recorder* m_metrics;
+
+        shared_ptr<json_codec> m_json_codec;
+
+        shared_ptr<packet_codec> m_codec;
     };
 }
 #endif
@@ -0,0 +1,59 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+//
+//  sio_platform.h
+//
+//  The protocol core's only contact points with Unreal: logging, Insights scopes,
+//  LLM tags and the third party include guards. Inside the engine these forward to
+//  SocketIOTrace.h / SocketIOMemory.h. With SIO_STANDALONE=1 (CMakeLists.txt) they
+//  compile to nothing, so sio_packet, sio_socket and client_impl build as a plain
+//  static library for benchmarks, sanitizers and perf.
+//
+
+#ifndef SIO_PLATFORM_H
+#define SIO_PLATFORM_H
+
+#ifndef SIO_STANDALONE
+#define SIO_STANDALONE 0
+#endif
+
+// Comment this out to disable handshake logging to stdout
+#ifndef SIO_LIB_DEBUG
+#define SIO_LIB_DEBUG 0
+#endif
+
+#if SIO_STANDALONE
+
+#include <cstdint>
+#include <string>
+
+#ifndef THIRD_PARTY_INCLUDES_START
+#define THIRD_PARTY_INCLUDES_START
+#define THIRD_PARTY_INCLUDES_END
+#endif
+
+#define SIO_TRACE_SCOPE(Name)
+#define SIO_LLM_SCOPE(Tag)
+#define DEBUG_LOG(CategoryName, Verbosity, Format, ...)
+
+namespace SocketIOTrace
+{
+    inline void OutputPacket(bool, const std::string&, const std::string*, uint64_t) {}
+
+    inline void RegisterNetworkThread() {}
+}
+
+#else
+
+#include "CoreMinimal.h"
+#include "SocketIOMemory.h"
+#include "SocketIOTrace.h"
+
+#if SIO_LIB_DEBUG
+#define DEBUG_LOG(CategoryName, Verbosity, Format, ...) UE_LOG(CategoryName, Verbosity, Format, ##__VA_ARGS__)
+#else
+#define DEBUG_LOG(CategoryName, Verbosity, Format, ...)
+#endif
+
+#endif // SIO_STANDALONE
+
+#endif // SIO_PLATFORM_H
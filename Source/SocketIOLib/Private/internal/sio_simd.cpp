@@ -0,0 +1,341 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+//
+//  sio_simd.cpp
+//
+//  Masking xors the key broadcast across a whole register, the kernels only
+//  differ in register width. UTF-8 validation skips pure ASCII blocks (most JSON)
+//  with one compare per register; blocks holding multi byte sequences go through
+//  the scalar path, 8 ASCII bytes or one sequence at a time.
+//
+
+#include "sio_simd.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SIO_SIMD_X64 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define SIO_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+// MSVC compiles any intrinsic, GCC and Clang only those of the function's target
+#if defined(SIO_SIMD_X64) && (defined(__GNUC__) || defined(__clang__))
+#define SIO_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SIO_TARGET_AVX2
+#endif
+
+namespace sio
+{
+    namespace
+    {
+        inline void mask_tail(uint8_t const* in, uint8_t* out, size_t i, size_t size, uint32_t key)
+        {
+            // i is a multiple of 4 here, so the key lines up again
+            uint8_t key_bytes[4];
+            memcpy(key_bytes, &key, 4);
+            for (; i < size; ++i)
+            {
+                out[i] = in[i] ^ key_bytes[i & 3];
+            }
+        }
+
+        // Validates the sequence starting at s[i] and moves i past it.
+        // Ranges from the Unicode standard, table 3-7 (well-formed UTF-8 byte sequences).
+        inline bool utf8_sequence(uint8_t const* s, size_t size, size_t& i)
+        {
+            const uint8_t lead = s[i];
+            if (lead < 0x80)
+            {
+                ++i;
+                return true;
+            }
+            size_t length;
+            uint8_t low = 0x80;
+            uint8_t high = 0xBF;
+            if (lead >= 0xC2 && lead <= 0xDF)
+            {
+                length = 2;
+            }
+            else if (lead >= 0xE0 && lead <= 0xEF)
+            {
+                length = 3;
+                if (lead == 0xE0) low = 0xA0;           // overlong
+                else if (lead == 0xED) high = 0x9F;     // surrogates
+            }
+            else if (lead >= 0xF0 && lead <= 0xF4)
+            {
+                length = 4;
+                if (lead == 0xF0) low = 0x90;           // overlong
+                else if (lead == 0xF4) high = 0x8F;     // above U+10FFFF
+            }
+            else
+            {
+                return false;
+            }
+            if (size - i < length || s[i + 1] < low || s[i + 1] > high)
+            {
+                return false;
+            }
+            for (size_t k = 2; k < length; ++k)
+            {
+                if ((s[i + k] & 0xC0) != 0x80)
+                {
+                    return false;
+                }
+            }
+            i += length;
+            return true;
+        }
+
+        // Validates from s[i] until at least end, skipping ASCII 8 bytes at a time. The last
+        // sequence may run past end, i is left after it.
+        inline bool utf8_span(uint8_t const* s, size_t size, size_t& i, size_t end)
+        {
+            while (i < end)
+            {
+                if (i + 8 <= size)
+                {
+                    uint64_t word;
+                    memcpy(&word, s + i, 8);
+                    if ((word & 0x8080808080808080ull) == 0)
+                    {
+                        i += 8;
+                        continue;
+                    }
+                }
+                if (!utf8_sequence(s, size, i))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+#if defined(SIO_SIMD_X64)
+        void mask_copy_sse2(uint8_t const* in, uint8_t* out, size_t size, uint32_t key)
+        {
+            const __m128i k = _mm_set1_epi32(static_cast<int>(key));
+            size_t i = 0;
+            for (; i + 64 <= size; i += 64)
+            {
+                __m128i a = _mm_loadu_si128(reinterpret_cast<__m128i const*>(in + i));
+                __m128i b = _mm_loadu_si128(reinterpret_cast<__m128i const*>(in + i + 16));
+                __m128i c = _mm_loadu_si128(reinterpret_cast<__m128i const*>(in + i + 32));
+                __m128i d = _mm_loadu_si128(reinterpret_cast<__m128i const*>(in + i + 48));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_xor_si128(a, k));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 16), _mm_xor_si128(b, k));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 32), _mm_xor_si128(c, k));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 48), _mm_xor_si128(d, k));
+            }
+            for (; i + 16 <= size; i += 16)
+            {
+                __m128i a = _mm_loadu_si128(reinterpret_cast<__m128i const*>(in + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_xor_si128(a, k));
+            }
+            mask_tail(in, out, i, size, key);
+        }
+
+        bool is_valid_utf8_sse2(char const* data, size_t size)
+        {
+            uint8_t const* s = reinterpret_cast<uint8_t const*>(data);
+            size_t i = 0;
+            while (i + 16 <= size)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(s + i));
+                if (_mm_movemask_epi8(v) == 0)
+                {
+                    i += 16;
+                    continue;
+                }
+                // the next block starts after the sequence that ends this one
+                if (!utf8_span(s, size, i, i + 16))
+                {
+                    return false;
+                }
+            }
+            return utf8_span(s, size, i, size);
+        }
+
+        SIO_TARGET_AVX2 void mask_copy_avx2(uint8_t const* in, uint8_t* out, size_t size, uint32_t key)
+        {
+            const __m256i k = _mm256_set1_epi32(static_cast<int>(key));
+            size_t i = 0;
+            for (; i + 128 <= size; i += 128)
+            {
+                __m256i a = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(in + i));
+                __m256i b = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(in + i + 32));
+                __m256i c = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(in + i + 64));
+                __m256i d = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(in + i + 96));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_xor_si256(a, k));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i + 32), _mm256_xor_si256(b, k));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i + 64), _mm256_xor_si256(c, k));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i + 96), _mm256_xor_si256(d, k));
+            }
+            for (; i + 32 <= size; i += 32)
+            {
+                __m256i a = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(in + i));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_xor_si256(a, k));
+            }
+            mask_tail(in, out, i, size, key);
+        }
+
+        SIO_TARGET_AVX2 bool is_valid_utf8_avx2(char const* data, size_t size)
+        {
+            uint8_t const* s = reinterpret_cast<uint8_t const*>(data);
+            size_t i = 0;
+            while (i + 64 <= size)
+            {
+                __m256i a = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(s + i));
+                __m256i b = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(s + i + 32));
+                if (_mm256_movemask_epi8(_mm256_or_si256(a, b)) == 0)
+                {
+                    i += 64;
+                    continue;
+                }
+                if (!utf8_span(s, size, i, i + 64))
+                {
+                    return false;
+                }
+            }
+            return utf8_span(s, size, i, size);
+        }
+
+        bool cpu_has_avx2()
+        {
+#if defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7)
+            {
+                return false;
+            }
+            __cpuid(info, 1);
+            // the OS has to save the ymm registers too
+            const bool os_avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0;
+            if (!os_avx || (_xgetbv(0) & 6) != 6)
+            {
+                return false;
+            }
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+#else
+            return __builtin_cpu_supports("avx2") != 0;
+#endif
+        }
+#endif // SIO_SIMD_X64
+
+#if defined(SIO_SIMD_NEON)
+        void mask_copy_neon(uint8_t const* in, uint8_t* out, size_t size, uint32_t key)
+        {
+            const uint8x16_t k = vreinterpretq_u8_u32(vdupq_n_u32(key));
+            size_t i = 0;
+            for (; i + 64 <= size; i += 64)
+            {
+                uint8x16_t a = vld1q_u8(in + i);
+                uint8x16_t b = vld1q_u8(in + i + 16);
+                uint8x16_t c = vld1q_u8(in + i + 32);
+                uint8x16_t d = vld1q_u8(in + i + 48);
+                vst1q_u8(out + i, veorq_u8(a, k));
+                vst1q_u8(out + i + 16, veorq_u8(b, k));
+                vst1q_u8(out + i + 32, veorq_u8(c, k));
+                vst1q_u8(out + i + 48, veorq_u8(d, k));
+            }
+            for (; i + 16 <= size; i += 16)
+            {
+                vst1q_u8(out + i, veorq_u8(vld1q_u8(in + i), k));
+            }
+            mask_tail(in, out, i, size, key);
+        }
+
+        bool is_valid_utf8_neon(char const* data, size_t size)
+        {
+            uint8_t const* s = reinterpret_cast<uint8_t const*>(data);
+            size_t i = 0;
+            while (i + 32 <= size)
+            {
+                uint8x16_t v = vorrq_u8(vld1q_u8(s + i), vld1q_u8(s + i + 16));
+                if (vmaxvq_u8(v) < 0x80)
+                {
+                    i += 32;
+                    continue;
+                }
+                if (!utf8_span(s, size, i, i + 32))
+                {
+                    return false;
+                }
+            }
+            return utf8_span(s, size, i, size);
+        }
+#endif // SIO_SIMD_NEON
+
+        struct simd_kernel
+        {
+            const char* name;
+            void (*mask_copy)(uint8_t const*, uint8_t*, size_t, uint32_t);
+            bool (*is_valid_utf8)(char const*, size_t);
+        };
+
+        simd_kernel select_kernel()
+        {
+#if defined(SIO_SIMD_X64)
+            if (cpu_has_avx2())
+            {
+                return simd_kernel{ "avx2", &mask_copy_avx2, &is_valid_utf8_avx2 };
+            }
+            return simd_kernel{ "sse2", &mask_copy_sse2, &is_valid_utf8_sse2 };
+#elif defined(SIO_SIMD_NEON)
+            return simd_kernel{ "neon", &mask_copy_neon, &is_valid_utf8_neon };
+#else
+            return simd_kernel{ "scalar", &mask_copy_scalar, &is_valid_utf8_scalar };
+#endif
+        }
+
+        simd_kernel const& active_kernel()
+        {
+            static const simd_kernel kernel = select_kernel();
+            return kernel;
+        }
+    }
+
+    const char* simd_kernel_name()
+    {
+        return active_kernel().name;
+    }
+
+    void mask_copy(uint8_t const* in, uint8_t* out, size_t size, uint32_t key)
+    {
+        active_kernel().mask_copy(in, out, size, key);
+    }
+
+    bool is_valid_utf8(char const* data, size_t size)
+    {
+        return active_kernel().is_valid_utf8(data, size);
+    }
+
+    void mask_copy_scalar(uint8_t const* in, uint8_t* out, size_t size, uint32_t key)
+    {
+        uint64_t key64 = key;
+        key64 |= key64 << 32;
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8)
+        {
+            uint64_t word;
+            memcpy(&word, in + i, 8);
+            word ^= key64;
+            memcpy(out + i, &word, 8);
+        }
+        mask_tail(in, out, i, size, key);
+    }
+
+    bool is_valid_utf8_scalar(char const* data, size_t size)
+    {
+        size_t i = 0;
+        return utf8_span(reinterpret_cast<uint8_t const*>(data), size, i, size);
+    }
+}
@@ -0,0 +1,34 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+//
+//  sio_simd.h
+//
+//  Frame masking and UTF-8 validation for outgoing websocket frames, the two
+//  passes over every payload byte before it is written. The kernel is picked
+//  once per process by CPU feature: AVX2 or SSE2 on x64, NEON on arm64, 64 bit
+//  words elsewhere.
+//
+
+#ifndef SIO_SIMD_H
+#define SIO_SIMD_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace sio
+{
+    // "avx2", "sse2", "neon" or "scalar"
+    const char* simd_kernel_name();
+
+    // out[i] = in[i] ^ key byte i % 4, in memory order of key. in and out may be the same buffer.
+    void mask_copy(uint8_t const* in, uint8_t* out, size_t size, uint32_t key);
+
+    // RFC 3629 well-formed: no overlongs, surrogates or code points above U+10FFFF
+    bool is_valid_utf8(char const* data, size_t size);
+
+    // The portable kernels, for comparison
+    void mask_copy_scalar(uint8_t const* in, uint8_t* out, size_t size, uint32_t key);
+
+    bool is_valid_utf8_scalar(char const* data, size_t size);
+}
+
+#endif // SIO_SIMD_H
@@ -0,0 +1,100 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+//
+//  sio_thread.cpp
+//
+
+#include "sio_thread.h"
+#include "sio_platform.h"
+
+#if defined(_WIN32)
+#if !SIO_STANDALONE
+#include "Windows/WindowsHWrapper.h"
+#else
+#include <windows.h>
+#endif
+#else
+#include <pthread.h>
+#include <sched.h>
+#if defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#endif
+
+using namespace std;
+
+namespace sio
+{
+    bool set_current_thread_affinity(int cpu)
+    {
+        if (cpu < 0)
+        {
+            return false;
+        }
+#if defined(_WIN32)
+        if (cpu >= 64)
+        {
+            return false;
+        }
+        return ::SetThreadAffinityMask(::GetCurrentThread(), DWORD_PTR(1) << cpu) != 0;
+#elif defined(__linux__)
+        // sched_setaffinity with pid 0 is the calling thread, pthread_setaffinity_np is missing on Android
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return ::sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+        // macOS and iOS only take affinity hints, not a core
+        return false;
+#endif
+    }
+
+    bool set_current_thread_priority(int priority)
+    {
+        priority = std::max(-2, std::min(2, priority));
+#if defined(_WIN32)
+        static const int levels[] = { THREAD_PRIORITY_LOWEST, THREAD_PRIORITY_BELOW_NORMAL, THREAD_PRIORITY_NORMAL,
+            THREAD_PRIORITY_ABOVE_NORMAL, THREAD_PRIORITY_HIGHEST };
+        return ::SetThreadPriority(::GetCurrentThread(), levels[priority + 2]) != 0;
+#elif defined(__linux__)
+        // threads have their own nice value on Linux, going below 0 needs CAP_SYS_NICE or RLIMIT_NICE
+        return ::setpriority(PRIO_PROCESS, static_cast<id_t>(::syscall(SYS_gettid)), -5 * priority) == 0;
+#else
+        int policy = 0;
+        sched_param param;
+        if (::pthread_getschedparam(::pthread_self(), &policy, &param) != 0)
+        {
+            return false;
+        }
+        const int low = ::sched_get_priority_min(policy);
+        const int high = ::sched_get_priority_max(policy);
+        param.sched_priority = low + (high - low) * (priority + 2) / 4;
+        return ::pthread_setschedparam(::pthread_self(), policy, &param) == 0;
+#endif
+    }
+
+    bool set_current_thread_name(string const& name)
+    {
+        if (name.empty())
+        {
+            return false;
+        }
+#if defined(_WIN32)
+        // SetThreadDescription is Windows 10 1607+, look it up rather than fail to load on older systems
+        typedef HRESULT(WINAPI* set_description_fn)(HANDLE, PCWSTR);
+        static const set_description_fn set_description = reinterpret_cast<set_description_fn>(
+            ::GetProcAddress(::GetModuleHandleW(L"kernel32.dll"), "SetThreadDescription"));
+        if (!set_description)
+        {
+            return false;
+        }
+        wstring wide(name.begin(), name.end());
+        return SUCCEEDED(set_description(::GetCurrentThread(), wide.c_str()));
+#elif defined(__APPLE__)
+        return ::pthread_setname_np(name.c_str()) == 0;
+#else
+        return ::pthread_setname_np(::pthread_self(), name.substr(0, 15).c_str()) == 0;
+#endif
+    }
+}
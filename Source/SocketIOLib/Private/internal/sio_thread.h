@@ -0,0 +1,62 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+//
+//  sio_thread.h
+//
+//  Network thread placement and the busy poll loop client_impl runs instead of
+//  a blocking io_service::run() when network_thread_options::busy_poll is set.
+//  The setters act on the calling thread and return false where the platform
+//  has no such control or the process lacks the permission (e.g. raising the
+//  priority of an unprivileged Linux process).
+//
+
+#ifndef SIO_THREAD_H
+#define SIO_THREAD_H
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+
+namespace sio
+{
+    bool set_current_thread_affinity(int cpu);
+
+    // -2 lowest to 2 highest, 0 is the OS default
+    bool set_current_thread_priority(int priority);
+
+    // Linux keeps the first 15 characters
+    bool set_current_thread_name(std::string const& name);
+
+    // Polls io_service until it runs out of work or is stopped, like run() but never sleeps
+    // in the reactor. After spin_polls empty polls in a row it pauses between polls, doubling
+    // from 1 us up to max_backoff_micros, or only yields when that is 0.
+    template<typename io_service_type>
+    void busy_poll(io_service_type& io_service, unsigned spin_polls, unsigned max_backoff_micros)
+    {
+        unsigned empty_polls = 0;
+        unsigned pause_micros = 0;
+        // poll() stops the io_service once no work is left, exactly when run() would return
+        while (!io_service.stopped())
+        {
+            if (io_service.poll() > 0)
+            {
+                empty_polls = 0;
+                pause_micros = 0;
+                continue;
+            }
+            if (++empty_polls <= spin_polls)
+            {
+                continue;
+            }
+            if (max_backoff_micros == 0)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            pause_micros = pause_micros == 0 ? 1 : std::min(pause_micros * 2, max_backoff_micros);
+            std::this_thread::sleep_for(std::chrono::microseconds(pause_micros));
+        }
+    }
+}
+
+#endif // SIO_THREAD_H
@@ -0,0 +1,375 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+//
+//  sio_transport.cpp
+//
+//  unix_transport, memory_transport and the memory_pipe it connects to.
+//
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4503)
+#define _SCL_SECURE_NO_WARNINGS
+#endif
+
+#define ASIO_STANDALONE
+#define _WEBSOCKETPP_CPP11_STL_
+
+#include "sio_transport.h"
+
+using namespace std;
+
+namespace sio
+{
+#if SIO_UNIX_SOCKETS
+    unix_transport::unix_transport()
+    {
+        using std::placeholders::_1;
+        using std::placeholders::_2;
+        using std::placeholders::_3;
+        m_client.set_write_handler(std::bind(&unix_transport::on_write, this, _1, _2, _3));
+        m_client.set_shutdown_handler(std::bind(&unix_transport::on_shutdown, this, _1));
+    }
+
+    bool unix_transport::connect(string const& url, map<string, string> const& headers)
+    {
+        static const string scheme("ws+unix://");
+        size_t resource = url.find(':', scheme.size());
+        if (url.compare(0, scheme.size(), scheme) != 0 || resource == string::npos)
+        {
+            m_client.get_alog().write(websocketpp::log::alevel::app, "Not a ws+unix url: " + url);
+            return false;
+        }
+        string socket_path = url.substr(scheme.size(), resource - scheme.size());
+
+        m_stream = make_shared<stream>(m_io_service);
+        m_stream->con = get_connection("ws://localhost" + url.substr(resource + 1), headers);
+        if (!m_stream->con)
+        {
+            m_stream.reset();
+            return false;
+        }
+        // queues the upgrade request through on_write, it goes out once the socket connects
+        m_client.connect(m_stream->con);
+
+        shared_ptr<stream> s = m_stream;
+        s->socket.async_connect(asio::local::stream_protocol::endpoint(socket_path),
+            [this, s](asio::error_code const& ec) { on_socket_connected(s, ec); });
+        return true;
+    }
+
+    lib::error_code unix_transport::on_write(connection_hdl con, char const* data, size_t size)
+    {
+        shared_ptr<stream> s = m_stream;
+        if (!s || con.lock() != s->con)
+        {
+            return lib::error_code();
+        }
+        s->write_pending.append(data, size);
+        if (s->connected && s->write_inflight.empty() && !s->flush_queued)
+        {
+            s->flush_queued = true;
+            m_io_service.post(make_alloc_handler(m_handler_memory, [this, s]()
+            {
+                s->flush_queued = false;
+                if (s->write_inflight.empty())
+                {
+                    flush(s);
+                }
+            }));
+        }
+        return lib::error_code();
+    }
+
+    lib::error_code unix_transport::on_shutdown(connection_hdl con)
+    {
+        shared_ptr<stream> s = m_stream;
+        if (s && con.lock() == s->con)
+        {
+            s->shutdown = true;
+            if (!s->connected || (s->write_inflight.empty() && !s->flush_queued))
+            {
+                flush(s);
+            }
+        }
+        return lib::error_code();
+    }
+
+    void unix_transport::on_socket_connected(shared_ptr<stream> const& s, asio::error_code const& ec)
+    {
+        if (ec)
+        {
+            m_client.get_alog().write(websocketpp::log::alevel::app, "Unix socket connect error: " + ec.message());
+            // fails the pending upgrade, websocketpp reports it through the fail handler
+            s->con->fatal_error();
+            return;
+        }
+        s->connected = true;
+        flush(s);
+        start_read(s);
+    }
+
+    void unix_transport::start_read(shared_ptr<stream> const& s)
+    {
+        s->socket.async_read_some(asio::buffer(s->read_buffer), make_alloc_handler(m_handler_memory,
+            [this, s](asio::error_code const& ec, size_t bytes) { on_read(s, ec, bytes); }));
+    }
+
+    void unix_transport::on_read(shared_ptr<stream> const& s, asio::error_code const& ec, size_t bytes)
+    {
+        if (ec)
+        {
+            if (ec == asio::error::eof)
+            {
+                s->con->eof();
+            }
+            else if (ec != asio::error::operation_aborted)
+            {
+                s->con->fatal_error();
+            }
+            return;
+        }
+        s->con->read_all(s->read_buffer.data(), bytes);
+        if (s->socket.is_open())
+        {
+            start_read(s);
+        }
+    }
+
+    void unix_transport::flush(shared_ptr<stream> const& s)
+    {
+        if (s->write_pending.empty() || !s->connected || !s->socket.is_open())
+        {
+            if (s->shutdown)
+            {
+                close_socket(s);
+            }
+            return;
+        }
+        s->write_inflight.swap(s->write_pending);
+        asio::async_write(s->socket, asio::buffer(s->write_inflight), make_alloc_handler(m_handler_memory,
+            [this, s](asio::error_code const& ec, size_t) { on_written(s, ec); }));
+    }
+
+    void unix_transport::on_written(shared_ptr<stream> const& s, asio::error_code const& ec)
+    {
+        s->write_inflight.clear();
+        // a broken socket shows up on the read side as well, that is where the connection ends
+        if (!ec)
+        {
+            flush(s);
+        }
+        else if (s->shutdown)
+        {
+            close_socket(s);
+        }
+    }
+
+    void unix_transport::close_socket(shared_ptr<stream> const& s)
+    {
+        asio::error_code ec;
+        s->socket.shutdown(asio::local::stream_protocol::socket::shutdown_both, ec);
+        s->socket.close(ec);
+    }
+#endif
+
+    memory_transport::memory_transport() :
+        m_generation(0),
+        m_open(false),
+        m_max_message_size(0)
+    {
+    }
+
+    memory_transport::~memory_transport()
+    {
+        detach();
+    }
+
+    bool memory_transport::connect(string const& url, map<string, string> const& headers)
+    {
+        memory_pipe::connect_listener connect_listener;
+        ++m_generation;
+        m_open = false;
+        if (m_pipe)
+        {
+            lock_guard<mutex> guard(m_pipe->m_mutex);
+            // a pipe carries one connection at a time
+            if (!m_pipe->m_peer || m_pipe->m_peer == this)
+            {
+                m_pipe->m_peer = this;
+                m_pipe->m_generation = m_generation;
+                connect_listener = m_pipe->m_connect_listener;
+                m_frame_listener = m_pipe->m_frame_listener;
+                m_close_listener = m_pipe->m_close_listener;
+            }
+        }
+
+        // queued ahead of anything the listener sends, so the client opens before its first frame arrives
+        m_io_service.post(std::bind(&memory_transport::on_connected, this, m_generation));
+
+        if (connect_listener && connect_listener(url, headers))
+        {
+            m_open = true;
+            m_work.reset(new asio::io_service::work(m_io_service));
+        }
+        else
+        {
+            detach();
+        }
+        return true;
+    }
+
+    void memory_transport::send(frame_buffer const& payload, frame::opcode::value opcode, bool /*compress*/)
+    {
+        if (m_open && m_frame_listener)
+        {
+            m_frame_listener(payload.data, payload.size, opcode == frame::opcode::binary);
+        }
+    }
+
+    void memory_transport::close(close::status::value code, string const& reason)
+    {
+        if (!m_open)
+        {
+            return;
+        }
+        shutdown();
+        if (m_close_listener)
+        {
+            m_close_listener(code, reason);
+        }
+        // like websocketpp, the close handler runs after the close completed, never from inside close()
+        if (m_handlers.on_close)
+        {
+            m_io_service.post(std::bind(m_handlers.on_close, code, string()));
+        }
+    }
+
+    void memory_transport::post_frame(shared_ptr<const string> const& payload, bool binary, unsigned generation)
+    {
+        m_io_service.post(make_alloc_handler(m_handler_memory, std::bind(&memory_transport::on_frame, this, payload, binary, generation)));
+    }
+
+    void memory_transport::post_close(close::status::value code, string const& reason, unsigned generation)
+    {
+        m_io_service.post(make_alloc_handler(m_handler_memory, std::bind(&memory_transport::on_remote_close, this, code, reason, generation)));
+    }
+
+    void memory_transport::on_connected(unsigned generation)
+    {
+        if (generation != m_generation)
+        {
+            return;
+        }
+        if (m_open)
+        {
+            if (m_handlers.on_open) m_handlers.on_open();
+        }
+        else
+        {
+            if (m_handlers.on_fail) m_handlers.on_fail(string());
+        }
+    }
+
+    void memory_transport::on_frame(shared_ptr<const string> const& payload, bool binary, unsigned generation)
+    {
+        if (!m_open || generation != m_generation)
+        {
+            return;
+        }
+        if (m_max_message_size > 0 && payload->size() > m_max_message_size)
+        {
+            close(close::status::message_too_big, "Message too big");
+            return;
+        }
+        if (m_handlers.on_frame) m_handlers.on_frame(payload, binary);
+    }
+
+    void memory_transport::on_remote_close(close::status::value code, string const& reason, unsigned generation)
+    {
+        if (!m_open || generation != m_generation)
+        {
+            return;
+        }
+        shutdown();
+        if (m_handlers.on_close) m_handlers.on_close(code, reason);
+    }
+
+    void memory_transport::shutdown()
+    {
+        m_open = false;
+        detach();
+        // run() returns once the last timer is gone, as after a socket close
+        m_work.reset();
+    }
+
+    void memory_transport::detach()
+    {
+        if (m_pipe)
+        {
+            lock_guard<mutex> guard(m_pipe->m_mutex);
+            if (m_pipe->m_peer == this)
+            {
+                m_pipe->m_peer = nullptr;
+            }
+        }
+    }
+
+    memory_pipe::memory_pipe() :
+        m_peer(nullptr),
+        m_generation(0)
+    {
+    }
+
+    memory_pipe::ptr memory_pipe::create()
+    {
+        return ptr(new memory_pipe());
+    }
+
+    void memory_pipe::set_connect_listener(connect_listener const& l)
+    {
+        lock_guard<mutex> guard(m_mutex);
+        m_connect_listener = l;
+    }
+
+    void memory_pipe::set_frame_listener(frame_listener const& l)
+    {
+        lock_guard<mutex> guard(m_mutex);
+        m_frame_listener = l;
+    }
+
+    void memory_pipe::set_close_listener(close_listener const& l)
+    {
+        lock_guard<mutex> guard(m_mutex);
+        m_close_listener = l;
+    }
+
+    bool memory_pipe::send(string const& payload, bool binary)
+    {
+        return send(make_shared<const string>(payload), binary);
+    }
+
+    bool memory_pipe::send(shared_ptr<const string> const& payload, bool binary)
+    {
+        lock_guard<mutex> guard(m_mutex);
+        if (!m_peer)
+        {
+            return false;
+        }
+        m_peer->post_frame(payload, binary, m_generation);
+        return true;
+    }
+
+    void memory_pipe::close(int code, string const& reason)
+    {
+        lock_guard<mutex> guard(m_mutex);
+        if (m_peer)
+        {
+            m_peer->post_close(static_cast<close::status::value>(code), reason, m_generation);
+        }
+    }
+
+    bool memory_pipe::connected() const
+    {
+        lock_guard<mutex> guard(m_mutex);
+        return m_peer != nullptr;
+    }
+}
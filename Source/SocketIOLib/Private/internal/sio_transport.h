@@ -0,0 +1,495 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+//
+//  sio_transport.h
+//
+//  What client_impl runs on. A transport is the template argument of client_impl,
+//  the same way the TLS and plain websocketpp clients were, and provides:
+//
+//      asio::io_service& get_io_service()      timers and dispatch, run() drives it
+//      void set_handlers(transport_handlers)   open, fail, close and frame callbacks
+//      bool connect(url, headers)              false if no attempt could be started
+//      bool is_open() const
+//      void send(payload, opcode, compress)    one websocket data frame
+//      void close(code, reason)
+//      void run() / reset()                    network thread loop, restart for the next connect,
+//                                              busy polling polls get_io_service() in place of run()
+//      void set_max_message_size(bytes)        0 restores the default
+//      void set_logs_default/quiet/verbose()
+//
+//  Handlers are called on the network thread. websocket_transport wraps a
+//  websocketpp client, unix_transport runs the same websocket protocol over a
+//  unix domain socket and memory_transport talks to a memory_pipe in the same process.
+//
+
+#ifndef SIO_TRANSPORT_H
+#define SIO_TRANSPORT_H
+
+#ifndef SIO_TLS
+#define SIO_TLS 0
+#endif
+
+/* This disables two things:
+   1) error 4503 where MSVC complains about
+	  decorated names being too long. There's no way around
+	  this.
+   2) We also disable a security error triggered by
+	  websocketpp not using checked iterators.
+*/
+#ifdef _MSC_VER
+#pragma warning(disable : 4503)
+#define _SCL_SECURE_NO_WARNINGS
+#endif
+
+/* For this code, we will use standalone ASIO
+   and websocketpp in C++11 mode only */
+#define ASIO_STANDALONE
+#define _WEBSOCKETPP_CPP11_STL_
+
+#include <cstdint>
+#define INTIALIZER(__TYPE__)
+
+#include "sio_platform.h"
+#include "sio_handler_alloc.h"
+
+#if !SIO_STANDALONE && PLATFORM_WINDOWS
+//#define WIN32_LEAN_AND_MEAN
+#include "Windows/WindowsHWrapper.h"
+#include "Windows/AllowWindowsPlatformAtomics.h"
+#endif
+
+#include <websocketpp/client.hpp>
+#include <asio/system_timer.hpp>
+
+#if defined(DEBUG)
+  #if SIO_TLS
+    #define UI UI_ST
+    THIRD_PARTY_INCLUDES_START
+    #include "openssl/hmac.h"
+    #include <websocketpp/config/debug_asio.hpp>
+    typedef websocketpp::config::debug_asio_tls client_config_tls_base;
+    THIRD_PARTY_INCLUDES_END
+    #undef UI
+  #endif //SIO_TLS
+	#include <websocketpp/config/debug_asio_no_tls.hpp>
+	typedef websocketpp::config::debug_asio client_config_base;
+#else
+  #if SIO_TLS
+    #define UI UI_ST
+    THIRD_PARTY_INCLUDES_START
+    #include "openssl/hmac.h"
+    #include <websocketpp/config/asio_client.hpp>
+    typedef websocketpp::config::asio_tls_client client_config_tls_base;
+    THIRD_PARTY_INCLUDES_END
+    #undef UI
+  #endif //SIO_TLS
+	#include <websocketpp/config/asio_no_tls_client.hpp>
+	typedef websocketpp::config::asio_client client_config_base;
+#endif //DEBUG
+
+// websocketpp's asio transport is TCP only, over unix domain sockets the protocol runs on its
+// iostream transport and unix_transport moves the bytes
+#include <websocketpp/config/core_client.hpp>
+#include <asio/local/stream_protocol.hpp>
+typedef websocketpp::config::core_client client_config_unix_base;
+
+#if defined(ASIO_HAS_LOCAL_SOCKETS)
+#define SIO_UNIX_SOCKETS 1
+#else
+#define SIO_UNIX_SOCKETS 0
+#endif
+
+THIRD_PARTY_INCLUDES_START
+#include "sio_deflate.h"
+THIRD_PARTY_INCLUDES_END
+#include "sio_message_pool.h"
+
+/* Stock configs with our runtime configurable permessage-deflate extension and recycled
+   messages. The extension only offers itself when compression is enabled on the client. */
+#define SIO_DEFLATE_CONFIG(__NAME__, __BASE__) \
+    struct __NAME__ : public __BASE__ \
+    { \
+        typedef __NAME__ type; \
+        typedef __BASE__ base; \
+        typedef base::concurrency_type concurrency_type; \
+        typedef base::request_type request_type; \
+        typedef base::response_type response_type; \
+        typedef websocketpp::message_buffer::message<sio::message_pool> message_type; \
+        typedef sio::message_pool<message_type> con_msg_manager_type; \
+        typedef sio::message_pool_factory<con_msg_manager_type> endpoint_msg_manager_type; \
+        typedef base::alog_type alog_type; \
+        typedef base::elog_type elog_type; \
+        typedef base::rng_type rng_type; \
+        typedef base::transport_type transport_type; \
+        typedef sio::permessage_deflate<type> permessage_deflate_type; \
+    };
+
+SIO_DEFLATE_CONFIG(client_config, client_config_base)
+SIO_DEFLATE_CONFIG(client_config_unix, client_config_unix_base)
+#if SIO_TLS
+SIO_DEFLATE_CONFIG(client_config_tls, client_config_tls_base)
+#endif
+#undef SIO_DEFLATE_CONFIG
+
+#include <asio/deadline_timer.hpp>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "sio_memory_pipe.h"
+#include "sio_packet.h"
+#include "sio_simd.h"
+
+namespace sio
+{
+    using namespace websocketpp;
+
+    typedef websocketpp::client<client_config> client_type_no_tls;
+#if SIO_TLS
+    typedef websocketpp::client<client_config_tls> client_type_tls;
+#endif
+    typedef websocketpp::client<client_config_unix> client_type_unix;
+
+    struct transport_handlers
+    {
+        std::function<void()> on_open;
+        std::function<void(std::string const& retry_after)> on_fail;   // Retry-After header of a refused upgrade, if any
+        std::function<void(close::status::value code, std::string const& remote_reason)> on_close;    // the close code we sent or echoed
+        std::function<void(std::shared_ptr<const std::string> const& payload, bool binary)> on_frame;
+    };
+
+    // The websocket side shared by every websocketpp based transport, whatever carries the bytes.
+    template<typename client_type>
+    class websocket_protocol
+    {
+    public:
+        typedef typename client_type::message_ptr message_ptr;
+        typedef typename client_type::connection_ptr connection_ptr;
+
+        websocket_protocol()
+        {
+            using websocketpp::log::alevel;
+#ifndef DEBUG
+            m_client.clear_access_channels(alevel::all);
+            m_client.set_access_channels(alevel::connect | alevel::disconnect | alevel::app);
+#endif
+            using std::placeholders::_1;
+            using std::placeholders::_2;
+            m_client.set_open_handler(std::bind(&websocket_protocol::on_open, this, _1));
+            m_client.set_close_handler(std::bind(&websocket_protocol::on_close, this, _1));
+            m_client.set_fail_handler(std::bind(&websocket_protocol::on_fail, this, _1));
+            m_client.set_message_handler(std::bind(&websocket_protocol::on_message, this, _1, _2));
+        }
+
+        void set_handlers(transport_handlers const& handlers) { m_handlers = handlers; }
+
+        bool is_open() const { return !m_con.expired(); }
+
+        void send(frame_buffer const& payload, frame::opcode::value opcode, bool compress)
+        {
+            lib::error_code ec;
+            connection_ptr con = m_client.get_con_from_hdl(m_con, ec);
+            if (ec)
+            {
+                return;
+            }
+            message_ptr msg = con->get_message(opcode, payload.size);
+            if (!compress)
+            {
+                // websocketpp refuses such a text frame as well, only byte by byte
+                if (opcode == frame::opcode::text && !is_valid_utf8(payload.data, payload.size))
+                {
+                    m_client.get_alog().write(websocketpp::log::alevel::app, "Dropped a text frame that is not valid UTF-8");
+                    return;
+                }
+                prepare_frame(msg, payload, opcode);
+            }
+            else
+            {
+                msg->append_payload(payload.data, payload.size);
+                msg->set_compressed(compress);
+            }
+            con->send(msg);
+        }
+
+        void close(close::status::value code, std::string const& reason)
+        {
+            lib::error_code ec;
+            m_client.close(m_con, code, reason, ec);
+        }
+
+        void set_max_message_size(size_t bytes)
+        {
+            m_client.set_max_message_size(bytes > 0 ? bytes : client_config_base::max_message_size);
+        }
+
+        void set_logs_default()
+        {
+            m_client.clear_access_channels(websocketpp::log::alevel::all);
+            m_client.set_access_channels(websocketpp::log::alevel::connect | websocketpp::log::alevel::disconnect | websocketpp::log::alevel::app);
+        }
+
+        void set_logs_quiet() { m_client.clear_access_channels(websocketpp::log::alevel::all); }
+
+        void set_logs_verbose() { m_client.set_access_channels(websocketpp::log::alevel::all); }
+
+    protected:
+        connection_ptr get_connection(std::string const& url, std::map<std::string, std::string> const& headers)
+        {
+            lib::error_code ec;
+            connection_ptr con = m_client.get_connection(url, ec);
+            if (ec) {
+                m_client.get_alog().write(websocketpp::log::alevel::app,
+                    "Get Connection Error: " + ec.message());
+                return connection_ptr();
+            }
+
+            for (auto&& header : headers) {
+                con->replace_header(header.first, header.second);
+            }
+            return con;
+        }
+
+        client_type m_client;
+
+        // Connection pointer for client functions.
+        connection_hdl m_con;
+
+        transport_handlers m_handlers;
+
+    private:
+        // Client frames must be masked with an unpredictable key (RFC 6455 5.3, 10.3), so this is the
+        // config's random_device generator websocketpp masks with, not a seeded PRNG.
+        typename client_type::rng_type m_masking_rng;
+
+        void on_open(connection_hdl con)
+        {
+            m_con = con;
+            if (m_handlers.on_open) m_handlers.on_open();
+        }
+
+        void on_fail(connection_hdl con)
+        {
+            std::string retry_after;
+            lib::error_code ec;
+            connection_ptr conn_ptr = m_client.get_con_from_hdl(con, ec);
+            if (!ec)
+            {
+                // a server shedding load answers the upgrade with 503 and Retry-After
+                retry_after = conn_ptr->get_response_header("Retry-After");
+            }
+            m_con.reset();
+            if (m_handlers.on_fail) m_handlers.on_fail(retry_after);
+        }
+
+        void on_close(connection_hdl con)
+        {
+            close::status::value code = close::status::normal;
+            std::string remote_reason;
+            lib::error_code ec;
+            connection_ptr conn_ptr = m_client.get_con_from_hdl(con, ec);
+            if (!ec)
+            {
+                code = conn_ptr->get_local_close_code();
+                remote_reason = conn_ptr->get_remote_close_reason();
+            }
+            m_con.reset();
+            if (m_handlers.on_close) m_handlers.on_close(code, remote_reason);
+        }
+
+        void on_message(connection_hdl, message_ptr msg)
+        {
+            // Inbound text was already validated by websocketpp's hybi13 processor, which fails the
+            // connection with 1007. Its validator isn't configurable, so a second pass here would only add cost.
+            // The frame is ours now, steal its buffer so binary attachments reference it instead of copying.
+            std::shared_ptr<const std::string> payload = std::make_shared<const std::string>(std::move(msg->get_raw_payload()));
+            if (m_handlers.on_frame) m_handlers.on_frame(payload, msg->get_opcode() == frame::opcode::binary);
+        }
+
+        void prepare_frame(message_ptr const& msg, frame_buffer const& payload, frame::opcode::value opcode)
+        {
+            // Masking while copying out of the caller's buffer is the only copy of the payload.
+            // websocketpp sends prepared messages as is, writing header and payload as one gather list.
+            frame::masking_key_type key;
+            key.i = m_masking_rng();
+            frame::basic_header header(opcode, payload.size, true, true);
+            frame::extended_header ext(payload.size, key.i);
+            msg->set_header(frame::prepare_header(header, ext));
+
+            std::string& out = msg->get_raw_payload();
+            out.resize(payload.size);
+            if (payload.size > 0)
+            {
+                mask_copy(reinterpret_cast<uint8_t const*>(payload.data), reinterpret_cast<uint8_t*>(&out[0]), payload.size, key.i);
+            }
+            msg->set_prepared(true);
+        }
+    };
+
+    template<typename client_type>
+    class websocket_transport : public websocket_protocol<client_type>
+    {
+    public:
+        typedef typename websocket_protocol<client_type>::connection_ptr connection_ptr;
+
+        websocket_transport()
+        {
+            // Initialize the Asio transport policy
+            this->m_client.init_asio();
+        }
+
+        asio::io_service& get_io_service() { return this->m_client.get_io_service(); }
+
+        bool connect(std::string const& url, std::map<std::string, std::string> const& headers)
+        {
+            connection_ptr con = this->get_connection(url, headers);
+            if (!con)
+            {
+                return false;
+            }
+            this->m_client.connect(con);
+            return true;
+        }
+
+        void run()
+        {
+            this->m_client.run();
+            this->m_client.get_alog().write(websocketpp::log::alevel::devel,
+                "run loop end");
+        }
+
+        void reset() { this->m_client.reset(); }
+
+        // TLS clients only
+        void set_tls_init_handler(int verify_mode);
+    };
+
+    typedef websocket_transport<client_type_no_tls> transport_no_tls;
+#if SIO_TLS
+    typedef websocket_transport<client_type_tls> transport_tls;
+#endif
+
+#if SIO_UNIX_SOCKETS
+    // Takes ws+unix://<socket path>:<resource> urls, the form the node ws package uses. websocketpp
+    // sees a plain ws://localhost connection on its iostream transport, this class feeds it the bytes.
+    class unix_transport : public websocket_protocol<client_type_unix>
+    {
+    public:
+        unix_transport();
+
+        asio::io_service& get_io_service() { return m_io_service; }
+
+        bool connect(std::string const& url, std::map<std::string, std::string> const& headers);
+
+        void run() { m_io_service.run(); }
+
+        // the last connection is done, nothing refers to it anymore
+        void reset() { m_stream.reset(); m_io_service.reset(); }
+
+    private:
+        // one per connection attempt, late completions of an old attempt find their own stream
+        struct stream
+        {
+            stream(asio::io_service& io_service) : socket(io_service), connected(false), flush_queued(false), shutdown(false), read_buffer(64 * 1024) {}
+
+            asio::local::stream_protocol::socket socket;
+            connection_ptr con;         // iostream connections are only kept alive by their owner
+            bool connected;
+            bool flush_queued;          // frame header and payload arrive as separate writes, send them together
+            bool shutdown;              // close the socket once the queued bytes (e.g. a close frame) are out
+            std::string write_pending;
+            std::string write_inflight;
+            std::vector<char> read_buffer;
+        };
+
+        lib::error_code on_write(connection_hdl con, char const* data, size_t size);
+        lib::error_code on_shutdown(connection_hdl con);
+
+        void on_socket_connected(std::shared_ptr<stream> const& s, asio::error_code const& ec);
+        void start_read(std::shared_ptr<stream> const& s);
+        void on_read(std::shared_ptr<stream> const& s, asio::error_code const& ec, size_t bytes);
+        void flush(std::shared_ptr<stream> const& s);
+        void close_socket(std::shared_ptr<stream> const& s);
+        void on_written(std::shared_ptr<stream> const& s, asio::error_code const& ec);
+
+        handler_memory m_handler_memory;
+        asio::io_service m_io_service;
+        std::shared_ptr<stream> m_stream;
+    };
+#endif
+
+    // Frames go straight to and from a memory_pipe, on the same io_service model as websocketpp
+    // so timers, dispatch and the network thread behave as with a real connection.
+    class memory_transport
+    {
+    public:
+        memory_transport();
+
+        ~memory_transport();
+
+        void set_pipe(memory_pipe::ptr const& pipe) { m_pipe = pipe; }
+
+        void set_handlers(transport_handlers const& handlers) { m_handlers = handlers; }
+
+        asio::io_service& get_io_service() { return m_io_service; }
+
+        bool connect(std::string const& url, std::map<std::string, std::string> const& headers);
+
+        bool is_open() const { return m_open; }
+
+        void send(frame_buffer const& payload, frame::opcode::value opcode, bool compress);
+
+        void close(close::status::value code, std::string const& reason);
+
+        void run() { m_io_service.run(); }
+
+        void reset() { m_io_service.reset(); }
+
+        void set_max_message_size(size_t bytes) { m_max_message_size = bytes; }
+
+        void set_logs_default() {}
+
+        void set_logs_quiet() {}
+
+        void set_logs_verbose() {}
+
+    private:
+        // called by the pipe under its mutex
+        void post_frame(std::shared_ptr<const std::string> const& payload, bool binary, unsigned generation);
+        void post_close(close::status::value code, std::string const& reason, unsigned generation);
+
+        void on_connected(unsigned generation);
+        void on_frame(std::shared_ptr<const std::string> const& payload, bool binary, unsigned generation);
+        void on_remote_close(close::status::value code, std::string const& reason, unsigned generation);
+        void shutdown();
+        void detach();
+
+        // frames are posted from the pipe owner's thread, declared first so it outlives queued ones
+        handler_memory m_handler_memory;
+        asio::io_service m_io_service;
+
+        // keeps run() alive while a connection is open, like websocketpp's pending reads do
+        std::unique_ptr<asio::io_service::work> m_work;
+
+        memory_pipe::ptr m_pipe;
+        memory_pipe::frame_listener m_frame_listener;
+        memory_pipe::close_listener m_close_listener;
+
+        transport_handlers m_handlers;
+
+        // network thread only, bumped per connect so frames queued for an old connection are dropped
+        unsigned m_generation;
+        bool m_open;
+        size_t m_max_message_size;
+
+        friend class sio::memory_pipe;
+    };
+}
+
+#if !SIO_STANDALONE && PLATFORM_WINDOWS
+#include "Windows/HideWindowsPlatformAtomics.h"
+#endif
+
+#endif // SIO_TRANSPORT_H
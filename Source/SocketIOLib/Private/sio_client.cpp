@@ -26,13 +26,17 @@
 #include "sio_client.h"
 #include "internal/sio_client_impl.h"
 
+#if defined(ASIO_HAS_IO_URING_AS_DEFAULT)
+#include <liburing.h>
+#endif
+
 using namespace websocketpp;
 using std::stringstream;
 
 namespace sio
 {
     client::client():
-        m_impl(new client_impl<client_type_no_tls>())
+        m_impl(new client_impl<transport_no_tls>())
     {
     }
 
@@ -41,7 +45,7 @@ namespace sio
         if (bShouldUseTlsLibraries)
         {
 #if SIO_TLS
-            m_impl = new client_impl<client_type_tls>();
+            m_impl = new client_impl<transport_tls>();
 
             if (bShouldVerifyTLSCertificate)
             {
@@ -55,15 +59,68 @@ namespace sio
 
             m_impl->template_init(); // reinitialize based on the new mode
 #else
-            m_impl = new client_impl<client_type_no_tls>();
+            m_impl = new client_impl<transport_no_tls>();
 #endif
         }
         else
         {
-            m_impl = new client_impl<client_type_no_tls>();
+            m_impl = new client_impl<transport_no_tls>();
         }
     }
     
+    client::client(memory_pipe::ptr const& pipe)
+    {
+        client_impl<memory_transport>* impl = new client_impl<memory_transport>();
+        impl->m_transport.set_pipe(pipe);
+        m_impl = impl;
+    }
+
+    client::client(unix_socket_t)
+    {
+#if SIO_UNIX_SOCKETS
+        m_impl = new client_impl<unix_transport>();
+#else
+        // a plain client fails ws+unix urls like any unreachable server
+        m_impl = new client_impl<transport_no_tls>();
+#endif
+    }
+
+    bool client::has_unix_sockets()
+    {
+        return SIO_UNIX_SOCKETS != 0;
+    }
+
+    const char* client::io_backend()
+    {
+#if defined(ASIO_HAS_IO_URING_AS_DEFAULT)
+        return "io_uring";
+#elif defined(ASIO_HAS_IOCP)
+        return "iocp";
+#elif defined(ASIO_HAS_EPOLL)
+        return "epoll";
+#elif defined(ASIO_HAS_KQUEUE)
+        return "kqueue";
+#elif defined(ASIO_HAS_DEV_POLL)
+        return "/dev/poll";
+#else
+        return "select";
+#endif
+    }
+
+    bool client::io_backend_available()
+    {
+#if defined(ASIO_HAS_IO_URING_AS_DEFAULT)
+        // same setup asio does on its first io_service, which throws where the kernel refuses it
+        struct io_uring ring;
+        if (::io_uring_queue_init(16, &ring, 0) < 0)
+        {
+            return false;
+        }
+        ::io_uring_queue_exit(&ring);
+#endif
+        return true;
+    }
+
     client::~client()
     {
         delete m_impl;
@@ -182,10 +239,137 @@ namespace sio
         m_impl->set_reconnect_delay_max(millis);
     }
 
+    void client::set_reconnect_backoff(reconnect_backoff backoff)
+    {
+        m_impl->set_reconnect_backoff(backoff);
+    }
+
+    client::reconnect_backoff client::get_reconnect_backoff() const
+    {
+        return m_impl->get_reconnect_backoff();
+    }
+
     void client::set_path(const std::string& path)
     {
         m_path = path;
     }
+
+    void client::set_compression_options(compression_options const& options)
+    {
+        m_impl->set_compression_options(options);
+    }
+
+    client::compression_stats client::get_compression_stats() const
+    {
+        return m_impl->get_compression_stats();
+    }
+
+    void client::set_network_thread_options(network_thread_options const& options)
+    {
+        m_impl->set_network_thread_options(options);
+    }
+
+    client::network_thread_options client::get_network_thread_options() const
+    {
+        return m_impl->get_network_thread_options();
+    }
+
+    metrics_snapshot client::get_metrics() const
+    {
+        return m_impl->get_metrics();
+    }
+
+    void client::set_trace_options(trace_options const& options)
+    {
+        m_impl->set_trace_options(options);
+    }
+
+    trace_options client::get_trace_options() const
+    {
+        return m_impl->get_trace_options();
+    }
+
+    std::vector<packet_trace> client::get_trace_samples() const
+    {
+        return m_impl->get_trace_samples();
+    }
+
+    bool client::claim_trace(packet_trace& out)
+    {
+        traced_dispatch* dispatch = metrics_recorder::current_dispatch();
+        if (!dispatch || dispatch->claimed)
+        {
+            return false;
+        }
+        dispatch->claimed = true;
+        out = dispatch->trace;
+        return true;
+    }
+
+    void client::record_trace(packet_trace const& trace)
+    {
+        m_impl->record_trace(trace);
+    }
+
+    client::trace_recorder client::get_trace_recorder() const
+    {
+        return m_impl->get_trace_recorder();
+    }
+
+    std::shared_ptr<dispatch_gauge> client::get_dispatch_gauge() const
+    {
+        return m_impl->get_dispatch_gauge();
+    }
+
+    void client::set_attachment_codec(attachment_codec::ptr const& codec)
+    {
+        m_impl->set_attachment_codec(codec);
+    }
+
+    bool client::is_attachment_codec_active() const
+    {
+        return m_impl->is_attachment_codec_active();
+    }
+
+    void client::set_attachment_limits(attachment_limits const& limits, attachment_store::ptr const& store)
+    {
+        m_impl->set_attachment_limits(limits, store);
+    }
+
+    void client::set_wire_codec(wire_codec codec)
+    {
+        m_impl->set_wire_codec(codec);
+    }
+
+    client::wire_codec client::get_wire_codec() const
+    {
+        return m_impl->get_wire_codec();
+    }
+
+    bool client::start_capture(std::string const& path)
+    {
+        return m_impl->start_capture(path);
+    }
+
+    void client::stop_capture()
+    {
+        m_impl->stop_capture();
+    }
+
+    bool client::replay_capture(std::string const& path, bool realtime, replay_listener const& on_finished)
+    {
+        return m_impl->replay_capture(path, realtime, on_finished);
+    }
+
+    void client::stop_replay()
+    {
+        m_impl->stop_replay();
+    }
+
+    bool client::is_replaying() const
+    {
+        return m_impl->is_replaying();
+    }
    
    void client::stop()
    {
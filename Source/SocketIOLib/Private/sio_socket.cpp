@@ -24,6 +24,7 @@
 #include "sio_socket.h"
 #include "internal/sio_packet.h"
 #include "internal/sio_client_impl.h"
+#include "internal/sio_platform.h"
 #include <asio/steady_timer.hpp>
 #include <asio/error_code.hpp>
 #include <queue>
@@ -203,6 +204,9 @@ namespace sio
         std::string m_socket_id;
         
         std::map<unsigned int, std::function<void (message::list const&)> > m_acks;
+
+        // metrics clock time each pending ack was emitted at
+        std::map<unsigned int, uint64_t> m_ack_sent_micros;
         
         std::map<std::string, event_listener> m_event_binding;
         
@@ -279,13 +283,20 @@ namespace sio
     void socket::impl::emit(std::string const& name, message::list const& msglist, std::function<void (message::list const&)> const& ack)
     {
         NULL_GUARD(m_client);
+        SIO_LLM_SCOPE(SocketIO_Messages);
         message::ptr msg_ptr = msglist.to_array_message(name);
         int pack_id;
         if(ack)
         {
+            SIO_LLM_SCOPE(SocketIO_PacketQueue);
             pack_id = s_global_event_id++;
             std::lock_guard<std::mutex> guard(m_event_mutex);
             m_acks[pack_id] = ack;
+            if (metrics_recorder* metrics = m_client->get_metrics_recorder())
+            {
+                m_ack_sent_micros[pack_id] = metrics->now_micros();
+                metrics->ack_pending(1);
+            }
         }
         else
         {
@@ -303,7 +314,7 @@ namespace sio
         m_connection_timer.reset(new asio::system_timer(m_client->get_io_service()));
         lib::error_code ec;
         m_connection_timer->expires_from_now(std::chrono::milliseconds(20000), ec);
-        m_connection_timer->async_wait(std::bind(&socket::impl::timeout_connection,this, std::placeholders::_1));
+        m_connection_timer->async_wait(make_alloc_handler(m_client->get_handler_memory(), std::bind(&socket::impl::timeout_connection,this, std::placeholders::_1)));
     }
     
     void socket::impl::close()
@@ -320,7 +331,7 @@ namespace sio
             }
             lib::error_code ec;
             m_connection_timer->expires_from_now(std::chrono::milliseconds(3000), ec);
-            m_connection_timer->async_wait(std::bind(&socket::impl::on_close, this));
+            m_connection_timer->async_wait(make_alloc_handler(m_client->get_handler_memory(), std::bind(&socket::impl::on_close, this)));
         }
     }
     
@@ -357,6 +368,14 @@ namespace sio
         sio::client_impl_base *client = m_client;
         m_client = NULL;
 
+        // acks of a closed socket can't arrive anymore
+        if (metrics_recorder* metrics = client->get_metrics_recorder())
+        {
+            std::lock_guard<std::mutex> guard(m_event_mutex);
+            metrics->ack_pending(-static_cast<int64_t>(m_ack_sent_micros.size()));
+            m_ack_sent_micros.clear();
+        }
+
         if(m_connection_timer)
         {
             m_connection_timer->cancel();
@@ -485,6 +504,11 @@ namespace sio
     
     void socket::impl::ack(int msgId, const string &, const message::list &ack_message)
     {
+        // a replayed event's ack id belongs to a past session, queueing it would send it to the live server
+        if (m_client && m_client->is_replaying())
+        {
+            return;
+        }
         packet p(m_nsp, ack_message.to_array_message(),msgId,true);
         send_packet(p);
     }
@@ -500,6 +524,16 @@ namespace sio
                 l = it->second;
                 m_acks.erase(it);
             }
+            auto sent_it = m_ack_sent_micros.find(msgId);
+            if (sent_it != m_ack_sent_micros.end())
+            {
+                if (metrics_recorder* metrics = m_client ? m_client->get_metrics_recorder() : nullptr)
+                {
+                    metrics->record_ack_rtt(metrics->now_micros() - sent_it->second);
+                    metrics->ack_pending(-1);
+                }
+                m_ack_sent_micros.erase(sent_it);
+            }
         }
         if(l)l(message);
     }
@@ -543,6 +577,7 @@ namespace sio
         }
         else
         {
+            SIO_LLM_SCOPE(SocketIO_PacketQueue);
 			std::lock_guard<std::mutex> guard(m_packet_mutex);
             m_packet_queue.push(p);
         }
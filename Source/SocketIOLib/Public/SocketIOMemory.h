@@ -0,0 +1,32 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/LowLevelMemTracker.h"
+
+/**
+* Low Level Memory tracker tags for SocketIO, shown under SocketIO in 'stat LLM'
+* and split per subsystem in 'stat LLMFULL' (run with -llm).
+*
+* SocketIOLib's std containers need no allocator of their own: UE modules route
+* global new/delete through FMemory, so whatever is allocated inside one of
+* these scopes is attributed to its tag.
+*/
+LLM_DECLARE_TAG_API(SocketIO, SOCKETIOLIB_API);
+
+/** websocketpp/asio state, frame buffers and everything else on the network thread */
+LLM_DECLARE_TAG_API(SocketIO_Network, SOCKETIOLIB_API);
+
+/** sio::message trees, decoded from packets or built for emits */
+LLM_DECLARE_TAG_API(SocketIO_Messages, SOCKETIOLIB_API);
+
+/** Packets queued until a namespace connects, and pending ack callbacks */
+LLM_DECLARE_TAG_API(SocketIO_PacketQueue, SOCKETIOLIB_API);
+
+/** FJsonValue trees converted from sio::message */
+LLM_DECLARE_TAG_API(SocketIO_Json, SOCKETIOLIB_API);
+
+/** Attributes allocations in the current scope to one of the tags above, free without -llm */
+#define SIO_LLM_SCOPE(Tag) LLM_SCOPE_BYTAG(Tag)
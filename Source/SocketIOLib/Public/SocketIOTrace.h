@@ -0,0 +1,28 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Trace/Trace.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include <string>
+
+/**
+* Unreal Insights channel for all SocketIO work. Enable with -trace=cpu,socketio
+* (or 'Trace.Enable SocketIO' at runtime) to see network thread scopes and
+* per packet events next to gameplay in frame captures.
+*/
+UE_TRACE_CHANNEL_EXTERN(SocketIOChannel, SOCKETIOLIB_API);
+
+/** CPU scope on the SocketIO channel, free while the channel is off */
+#define SIO_TRACE_SCOPE(Name) TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(Name, SocketIOChannel)
+
+namespace SocketIOTrace
+{
+	/** Emits a SocketIO.Packet trace event. EventName is null for non-event packets. */
+	SOCKETIOLIB_API void OutputPacket(bool bInbound, const std::string& Namespace, const std::string* EventName, uint64 Size);
+
+	/** Names the calling thread in Insights, call once from each client's io_service thread */
+	SOCKETIOLIB_API void RegisterNetworkThread();
+}
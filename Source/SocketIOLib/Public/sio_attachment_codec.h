@@ -0,0 +1,101 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+//
+//  sio_attachment_codec.h
+//
+//  Optional compression of binary attachments. The client offers its codec in
+//  the namespace connect (auth) payload as "attachmentCodecs": [name] and only
+//  starts compressing once the server echoes "attachmentCodec": name back in its
+//  connect packet. Encoded attachments carry a small header so uncompressed
+//  attachments can still be mixed in (e.g. when compression doesn't pay off).
+//  Once active, a raw attachment that happens to start with a header magic is
+//  sent behind a "SIOR" header so it can't be taken for a compressed one.
+//
+
+#ifndef SIO_ATTACHMENT_CODEC_H
+#define SIO_ATTACHMENT_CODEC_H
+
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+
+namespace sio
+{
+    class attachment_codec
+    {
+    public:
+        typedef std::shared_ptr<attachment_codec> ptr;
+
+        attachment_codec() : m_min_size(1024) {}
+
+        virtual ~attachment_codec() {}
+
+        // Name exchanged in the handshake, e.g. "lz4"
+        virtual std::string const& get_name() const = 0;
+
+        // Compress in into out (body only, no header). Return false to send raw.
+        virtual bool compress(char const* in, size_t in_size, std::string& out) = 0;
+
+        // Decompress body into out, raw_size is the size recorded by the sender. Callers have
+        // already checked raw_size against max_ratio, implementations may size out to it upfront.
+        virtual bool decompress(char const* in, size_t in_size, size_t raw_size, std::string& out) = 0;
+
+        // Attachments smaller than this are never compressed.
+        void set_min_size(size_t min_size) { m_min_size = min_size; }
+
+        size_t get_min_size() const { return m_min_size; }
+
+        // Header: 4 byte magic, 4 byte little endian raw size. "SIOZ" is followed by a
+        // compressed body, "SIOR" by the raw bytes.
+        static const size_t header_size = 8;
+
+        // Neither deflate (1032:1) nor LZ4 (255:1) can inflate further, a larger claimed
+        // raw size is a lie meant to make the receiver allocate.
+        static const size_t max_ratio = 1032;
+
+        static bool has_header(std::string const& buf)
+        {
+            return buf.size() >= header_size && memcmp(buf.data(), "SIOZ", 4) == 0;
+        }
+
+        static bool has_raw_header(std::string const& buf)
+        {
+            return buf.size() >= header_size && memcmp(buf.data(), "SIOR", 4) == 0;
+        }
+
+        // A raw attachment starting like this has to be escaped with a "SIOR" header
+        static bool needs_escape(char const* data, size_t size)
+        {
+            return size >= 4 && (memcmp(data, "SIOZ", 4) == 0 || memcmp(data, "SIOR", 4) == 0);
+        }
+
+        static void write_header(std::string& out, uint32_t raw_size)
+        {
+            write_magic(out, "SIOZ", raw_size);
+        }
+
+        static void write_raw_header(std::string& out, uint32_t raw_size)
+        {
+            write_magic(out, "SIOR", raw_size);
+        }
+
+        static uint32_t read_raw_size(std::string const& buf)
+        {
+            unsigned char const* p = (unsigned char const*)buf.data() + 4;
+            return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+        }
+
+    private:
+        static void write_magic(std::string& out, char const* magic, uint32_t raw_size)
+        {
+            char header[header_size] = { magic[0], magic[1], magic[2], magic[3],
+                (char)(raw_size & 0xFF), (char)((raw_size >> 8) & 0xFF),
+                (char)((raw_size >> 16) & 0xFF), (char)((raw_size >> 24) & 0xFF) };
+            out.append(header, header_size);
+        }
+
+        size_t m_min_size;
+    };
+}
+
+#endif // SIO_ATTACHMENT_CODEC_H
@@ -0,0 +1,33 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+//
+//  sio_attachment_store.h
+//
+//  Moves large inbound attachments out of the heap while a binary packet waits
+//  for the rest of its attachments, e.g. into a memory mapped temp file. The
+//  store returns a binary_message referencing the stored bytes; its owner
+//  releases the storage once every handler dropped the message.
+//
+
+#ifndef SIO_ATTACHMENT_STORE_H
+#define SIO_ATTACHMENT_STORE_H
+
+#include <string>
+#include <memory>
+#include "sio_message.h"
+
+namespace sio
+{
+    class attachment_store
+    {
+    public:
+        typedef std::shared_ptr<attachment_store> ptr;
+
+        virtual ~attachment_store() {}
+
+        // Called on the network thread for attachments above the spill threshold.
+        // Return null to keep the attachment in memory.
+        virtual message::ptr store(std::shared_ptr<const std::string> const& buffer) = 0;
+    };
+}
+
+#endif // SIO_ATTACHMENT_STORE_H
@@ -9,8 +9,14 @@
 #define SIO_CLIENT_H
 #include <string>
 #include <functional>
+#include <cstdint>
 #include "sio_message.h"
 #include "sio_socket.h"
+#include "sio_attachment_codec.h"
+#include "sio_attachment_store.h"
+#include "sio_memory_pipe.h"
+#include "sio_metrics.h"
+#include "sio_trace.h"
 
 namespace sio
 {
@@ -23,6 +29,17 @@ namespace sio
             close_reason_normal,
             close_reason_drop
         };
+
+        // How the wait before each reconnect attempt grows, capped by set_reconnect_delay_max unless
+        // the server asked for a longer wait (see set_reconnect_backoff).
+        // The jittered strategies spread out clients that dropped together, e.g. when a server restarts.
+        enum reconnect_backoff
+        {
+            backoff_exponential,            // delay * 1.5^attempt, no jitter (default)
+            backoff_full_jitter,            // random in [0, exponential]
+            backoff_equal_jitter,           // half of exponential plus random in [0, half]
+            backoff_decorrelated_jitter     // random in [delay, 3 * previous wait]
+        };
         
         typedef std::function<void(void)> con_listener;
         
@@ -31,11 +48,95 @@ namespace sio
         typedef std::function<void(unsigned, unsigned)> reconnect_listener;
         
         typedef std::function<void(std::string const& nsp)> socket_listener;
+
+        // Called from the replay thread with the number of inbound frames replayed.
+        typedef std::function<void(size_t frames)> replay_listener;
+
+        // permessage-deflate settings, applied on the next connect.
+        struct compression_options
+        {
+            compression_options() :
+                enabled(false),
+                level(6),
+                client_max_window_bits(15),
+                server_max_window_bits(15),
+                client_no_context_takeover(false),
+                server_no_context_takeover(false),
+                min_compress_size(256)
+            {}
+
+            bool enabled;
+            int level;                          // zlib level 0-9
+            uint8_t client_max_window_bits;     // 9-15, our outgoing window
+            uint8_t server_max_window_bits;     // 9-15, requested from the server
+            bool client_no_context_takeover;    // reset our compressor after each message
+            bool server_no_context_takeover;    // ask the server to reset its compressor
+            size_t min_compress_size;           // frames smaller than this are sent raw
+        };
+
+        // Encoding of socket.io packets, the server must use the matching parser.
+        enum wire_codec
+        {
+            wire_codec_json,        // default socket.io parser
+            wire_codec_msgpack      // socket.io-msgpack-parser
+        };
+
+        // Limits for inbound binary attachments, applied on the next connect.
+        struct attachment_limits
+        {
+            size_t spill_threshold = 0;         // attachments this size or larger go to the store, 0 = never
+            size_t max_partial_size = 0;        // heap bytes a waiting binary packet may hold, 0 = unlimited
+        };
+
+        // How the network thread waits and where it runs, applied on the next connect.
+        struct network_thread_options
+        {
+            bool busy_poll = false;             // spin on non-blocking polls instead of sleeping in epoll/kqueue/IOCP, costs a core
+            unsigned spin_polls = 10000;        // empty polls in a row before backing off
+            unsigned max_backoff_micros = 0;    // longest pause between polls once backed off, 0 only yields
+            int cpu_affinity = -1;              // pin to this core, -1 lets the OS schedule it
+            int priority = 0;                   // -2 lowest to 2 highest, 0 keeps the OS default
+            std::string name;                   // OS thread name for debuggers and profilers, empty keeps the default
+        };
+
+        struct compression_stats
+        {
+            bool negotiated = false;
+            uint64_t bytes_in = 0;              // uncompressed bytes handed to deflate
+            uint64_t bytes_out = 0;             // compressed bytes written
+            uint64_t bytes_saved = 0;
+            uint64_t bytes_inflated_in = 0;     // compressed bytes received
+            uint64_t bytes_inflated_out = 0;    // bytes after inflate
+            uint64_t messages_compressed = 0;
+            uint64_t messages_skipped = 0;      // below min_compress_size on a compressed connection
+            uint64_t compress_micros = 0;
+            uint64_t decompress_micros = 0;
+        };
         
         client();
 
         client(const bool bShouldUseTlsLibraries, const bool bShouldVerifyTLSCertificate);
 
+        // Runs over pipe instead of a websocket, connect() with any http url.
+        explicit client(memory_pipe::ptr const& pipe);
+
+        // Websocket over a unix domain socket instead of TCP, for servers on the same host.
+        // connect() with unix:///path/to/server.sock, or ws+unix:///path/to/server.sock:/resource/
+        struct unix_socket_t {};
+
+        explicit client(unix_socket_t);
+
+        // False where the platform has no unix domain sockets, client(unix_socket_t) then fails every connect.
+        static bool has_unix_sockets();
+
+        // Event loop backend asio was built with: "io_uring", "epoll", "kqueue", "iocp", "/dev/poll" or "select".
+        // Fixed at compile time, io_uring needs the SIO_IO_URING build option on Linux.
+        static const char* io_backend();
+
+        // False when io_backend() can't run here, e.g. io_uring blocked by a container's seccomp
+        // profile. Every connect then fails, rebuild without SIO_IO_URING for such hosts.
+        static bool io_backend_available();
+
         ~client();
         
         //set listeners and event bindings.
@@ -74,8 +175,81 @@ namespace sio
 
         void set_reconnect_delay_max(unsigned millis);
 
+        // A server can push the next attempt back with a Retry-After header (seconds) on a refused
+        // upgrade, or "retry-after=<seconds>" in its close reason. That hint is a floor: the wait is the
+        // longer of it and the backoff, so it can exceed set_reconnect_delay_max. Jittered modes add up
+        // to a tenth of the hint so clients refused together don't return together.
+        void set_reconnect_backoff(reconnect_backoff backoff);
+
+        reconnect_backoff get_reconnect_backoff() const;
+
         void set_path(const std::string& path);
 
+        void set_compression_options(compression_options const& options);
+
+        compression_stats get_compression_stats() const;
+
+        void set_network_thread_options(network_thread_options const& options);
+
+        network_thread_options get_network_thread_options() const;
+
+        // Aggregated counters since the client was created, safe to call from any thread.
+        metrics_snapshot get_metrics() const;
+
+        // Per event latency tracing, see sio_trace.h. Off by default.
+        void set_trace_options(trace_options const& options);
+
+        trace_options get_trace_options() const;
+
+        // Sampled traces, oldest first.
+        std::vector<packet_trace> get_trace_samples() const;
+
+        // Only valid inside an event listener. Takes over the running event's trace so a listener
+        // that defers the handler can stamp the remaining stages. False if tracing is off.
+        static bool claim_trace(packet_trace& out);
+
+        // Returns a claimed trace once the deferred handler finished.
+        void record_trace(packet_trace const& trace);
+
+        typedef std::function<void(packet_trace const&)> trace_recorder;
+
+        // Same as record_trace, but keeps only the metrics alive instead of the client, so a
+        // deferred handler never ends up releasing the last client reference. Any thread.
+        trace_recorder get_trace_recorder() const;
+
+        // For listeners that defer their handler to another thread, reported as dispatch_queue_depth.
+        std::shared_ptr<dispatch_gauge> get_dispatch_gauge() const;
+
+        // Offer codec for binary attachments, takes effect on the next namespace connect.
+        void set_attachment_codec(attachment_codec::ptr const& codec);
+
+        bool is_attachment_codec_active() const;
+
+        // Exceeding max_partial_size closes the connection with a protocol error.
+        void set_attachment_limits(attachment_limits const& limits, attachment_store::ptr const& store = attachment_store::ptr());
+
+        // Only call while disconnected.
+        void set_wire_codec(wire_codec codec);
+
+        wire_codec get_wire_codec() const;
+
+        // Logs every websocket frame sent or received, with timestamp, direction and opcode, to a
+        // binary file. False if the file can't be opened.
+        bool start_capture(std::string const& path);
+
+        void stop_capture();
+
+        // Feeds the inbound frames of a capture through decode and event dispatch on a replay
+        // thread, at the captured pace or as fast as possible. Engine.io control frames and
+        // namespace connects, acks of earlier emits and acks for replayed events are skipped and
+        // nothing is sent. Only while disconnected with no reconnect pending (false otherwise),
+        // connect() stops a running replay.
+        bool replay_capture(std::string const& path, bool realtime, replay_listener const& on_finished = nullptr);
+
+        void stop_replay();
+
+        bool is_replaying() const;
+
         void set_logs_default();
 
         void set_logs_quiet();
@@ -0,0 +1,79 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+//
+//  sio_memory_pipe.h
+//
+//  In-process stand-in for a websocket connection. A client built with
+//  client(memory_pipe::ptr) sends its frames to the pipe's listeners and
+//  receives whatever the other end send()s, with no sockets and no HTTP
+//  upgrade in between, so tests and benchmarks can push packets through
+//  packet_manager and sio::socket as fast as they decode.
+//
+//  The other end speaks engine.io itself, e.g. accept, then
+//      pipe->send("0{\"sid\":\"a\",\"pingInterval\":25000,\"pingTimeout\":20000}", false);
+//  and answer "40" frames with "40{\"sid\":\"b\"}".
+//
+
+#ifndef SIO_MEMORY_PIPE_H
+#define SIO_MEMORY_PIPE_H
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace sio
+{
+    class memory_transport;
+
+    class SOCKETIOLIB_API memory_pipe
+    {
+    public:
+        typedef std::shared_ptr<memory_pipe> ptr;
+
+        // Return false to refuse, the client then fails the attempt like a refused upgrade.
+        typedef std::function<bool(std::string const& url, std::map<std::string, std::string> const& headers)> connect_listener;
+
+        // data is only valid during the call.
+        typedef std::function<void(char const* data, size_t size, bool binary)> frame_listener;
+
+        typedef std::function<void(int code, std::string const& reason)> close_listener;
+
+        static ptr create();
+
+        // Listeners run on the client's network thread, set them before connecting.
+        void set_connect_listener(connect_listener const& l);
+
+        void set_frame_listener(frame_listener const& l);
+
+        // Only for closes the client starts.
+        void set_close_listener(close_listener const& l);
+
+        // Queues a frame for the client, safe from any thread. False if no client is connected.
+        bool send(std::string const& payload, bool binary);
+
+        bool send(std::shared_ptr<const std::string> const& payload, bool binary);
+
+        // Closes from this end. 1000 is a normal close, anything else makes the client reconnect,
+        // no sooner than a "retry-after=<seconds>" in reason asks.
+        void close(int code = 1000, std::string const& reason = "");
+
+        bool connected() const;
+
+    private:
+        memory_pipe();
+
+        connect_listener m_connect_listener;
+        frame_listener m_frame_listener;
+        close_listener m_close_listener;
+
+        // transport of the connection being served and its generation, guarded by m_mutex
+        memory_transport* m_peer;
+        unsigned m_generation;
+        mutable std::mutex m_mutex;
+
+        friend class memory_transport;
+    };
+}
+
+#endif // SIO_MEMORY_PIPE_H
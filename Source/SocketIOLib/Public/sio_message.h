@@ -13,6 +13,7 @@
 #include <map>
 #include <cassert>
 #include <type_traits>
+#include <mutex>
 namespace sio
 {
     class message
@@ -228,8 +229,18 @@ namespace sio
     class binary_message : public message
     {
         std::shared_ptr<const std::string> _v;
+        std::shared_ptr<const void> _owner;
+        char const* _data;
+        size_t _size;
+        mutable std::once_flag _materialized;
+
         binary_message(std::shared_ptr<const std::string> const& v)
-            :message(flag_binary),_v(v)
+            :message(flag_binary),_v(v),_data(v ? v->data() : nullptr),_size(v ? v->size() : 0)
+        {
+        }
+
+        binary_message(std::shared_ptr<const void> const& owner, char const* data, size_t size)
+            :message(flag_binary),_owner(owner),_data(data),_size(size)
         {
         }
     public:
@@ -238,8 +249,43 @@ namespace sio
             return ptr(new binary_message(v));
         }
 
+        // Reference caller owned bytes without copying. owner keeps data alive
+        // until the message and every frame sent from it are released.
+        static message::ptr create(std::shared_ptr<const void> const& owner, char const* data, size_t size)
+        {
+            return ptr(new binary_message(owner, data, size));
+        }
+
+        // External buffers are copied into a string on first call only.
         std::shared_ptr<const std::string> const& get_binary() const
         {
+            if (_owner)
+            {
+                std::call_once(_materialized, [this]
+                {
+                    const_cast<binary_message*>(this)->_v = std::make_shared<const std::string>(_data, _size);
+                });
+            }
+            return _v;
+        }
+
+        char const* get_binary_data() const
+        {
+            return _data;
+        }
+
+        size_t get_binary_size() const
+        {
+            return _size;
+        }
+
+        // Whatever keeps get_binary_data() alive, either the string or the external owner.
+        std::shared_ptr<const void> get_binary_owner() const
+        {
+            if (_owner)
+            {
+                return _owner;
+            }
             return _v;
         }
     };
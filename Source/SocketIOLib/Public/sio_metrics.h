@@ -0,0 +1,169 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+//
+//  sio_metrics.h
+//
+//  Point in time view of a client's traffic and timing counters, returned by
+//  client::get_metrics(). Counters only ever grow; take two snapshots and
+//  diff them (see captured_micros) to get rates.
+//
+
+#ifndef SIO_METRICS_H
+#define SIO_METRICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace sio
+{
+    // Log2 buckets in microseconds: bucket i holds samples below 2^i us, the last one everything above.
+    struct latency_histogram
+    {
+        static const size_t bucket_count = 24;
+
+        uint64_t count = 0;
+        uint64_t sum_micros = 0;
+        uint64_t max_micros = 0;
+        uint64_t buckets[bucket_count] = {};
+
+        static size_t bucket_for(uint64_t micros)
+        {
+            size_t index = 0;
+            while (index + 1 < bucket_count && micros >= (uint64_t(1) << index))
+            {
+                index++;
+            }
+            return index;
+        }
+
+        double mean_micros() const
+        {
+            return count > 0 ? double(sum_micros) / double(count) : 0.0;
+        }
+
+        // Upper bound of the bucket holding the given fraction (0..1) of samples.
+        uint64_t percentile_micros(double fraction) const
+        {
+            if (count == 0)
+            {
+                return 0;
+            }
+            uint64_t target = uint64_t(fraction * double(count));
+            uint64_t seen = 0;
+            for (size_t i = 0; i < bucket_count; ++i)
+            {
+                seen += buckets[i];
+                if (seen > target)
+                {
+                    return i + 1 < bucket_count ? (uint64_t(1) << i) : max_micros;
+                }
+            }
+            return max_micros;
+        }
+
+        void merge(latency_histogram const& other)
+        {
+            count += other.count;
+            sum_micros += other.sum_micros;
+            max_micros = other.max_micros > max_micros ? other.max_micros : max_micros;
+            for (size_t i = 0; i < bucket_count; ++i)
+            {
+                buckets[i] += other.buckets[i];
+            }
+        }
+    };
+
+    struct traffic_counters
+    {
+        uint64_t packets_in = 0;
+        uint64_t packets_out = 0;
+        uint64_t bytes_in = 0;
+        uint64_t bytes_out = 0;
+
+        void merge(traffic_counters const& other)
+        {
+            packets_in += other.packets_in;
+            packets_out += other.packets_out;
+            bytes_in += other.bytes_in;
+            bytes_out += other.bytes_out;
+        }
+    };
+
+    // Where an inbound event spent its time, filled from packet traces while tracing is enabled.
+    struct event_latency
+    {
+        latency_histogram decode;           // first frame received until the packet was decoded
+        latency_histogram dispatch;         // decoded until the listener was invoked
+        latency_histogram queue;            // handed to another thread until the handler started, 0 when handled inline
+        latency_histogram handler;          // handler start to end
+        latency_histogram total;            // first frame received until the handler finished
+
+        void merge(event_latency const& other)
+        {
+            decode.merge(other.decode);
+            dispatch.merge(other.dispatch);
+            queue.merge(other.queue);
+            handler.merge(other.handler);
+            total.merge(other.total);
+        }
+    };
+
+    struct namespace_metrics
+    {
+        traffic_counters traffic;                       // socket.io packets of this namespace
+        std::map<std::string, traffic_counters> events; // by event name, acks are only counted on the namespace
+        std::map<std::string, event_latency> latency;  // by event name, only while tracing
+    };
+
+    struct metrics_snapshot
+    {
+        uint64_t captured_micros = 0;                   // steady clock time since the client was created
+
+        traffic_counters frames;                        // every websocket frame, including engine.io ping/pong
+        std::map<std::string, namespace_metrics> namespaces;
+
+        latency_histogram encode_micros;                // packet to frames, includes handing frames to the network thread
+        latency_histogram decode_micros;                // frame to packet, excludes event handlers
+        latency_histogram ack_rtt_micros;               // emit with ack until the ack arrived
+
+        uint64_t reconnects = 0;
+        uint64_t outstanding_acks = 0;                  // emits still waiting for their ack
+        uint64_t send_queue_depth = 0;                  // frames queued for the network thread right now
+        uint64_t send_queue_peak = 0;
+        uint64_t dispatch_queue_depth = 0;              // events waiting for a deferred handler, see dispatch_gauge
+        uint64_t dispatch_queue_peak = 0;
+    };
+
+    // Events a listener handed to another thread (e.g. a game thread) whose handler hasn't
+    // started yet. push() when queueing, pop() when the handler starts. Get it from
+    // client::get_dispatch_gauge(), it may outlive the client.
+    class dispatch_gauge
+    {
+    public:
+        void push()
+        {
+            int64_t depth = m_depth.fetch_add(1, std::memory_order_relaxed) + 1;
+            int64_t peak = m_peak.load(std::memory_order_relaxed);
+            while (depth > peak && !m_peak.compare_exchange_weak(peak, depth, std::memory_order_relaxed))
+            {
+            }
+        }
+
+        void pop() { m_depth.fetch_sub(1, std::memory_order_relaxed); }
+
+        uint64_t depth() const
+        {
+            int64_t depth = m_depth.load(std::memory_order_relaxed);
+            return depth > 0 ? static_cast<uint64_t>(depth) : 0;
+        }
+
+        uint64_t peak() const { return static_cast<uint64_t>(m_peak.load(std::memory_order_relaxed)); }
+
+    private:
+        std::atomic<int64_t> m_depth{ 0 };
+        std::atomic<int64_t> m_peak{ 0 };
+    };
+}
+
+#endif // SIO_METRICS_H
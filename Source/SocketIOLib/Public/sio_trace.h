@@ -0,0 +1,49 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+//
+//  sio_trace.h
+//
+//  Timestamps of one inbound event on its way from the socket to its handler.
+//  With tracing enabled the client stamps receive, decode and dispatch. A
+//  listener that handles the event inline needs to do nothing. One that hands
+//  the event to another thread takes the trace over with client::claim_trace(),
+//  stamps the remaining fields and returns it with client::record_trace().
+//
+
+#ifndef SIO_TRACE_H
+#define SIO_TRACE_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace sio
+{
+    // Monotonic clock shared by every trace field.
+    inline uint64_t trace_clock_micros()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    // 0 means the stage was not reached or does not apply.
+    struct packet_trace
+    {
+        std::string nsp;
+        std::string event;
+        uint64_t received_micros = 0;       // first websocket frame of the packet in client_impl::on_message
+        uint64_t decoded_micros = 0;
+        uint64_t dispatched_micros = 0;     // listener invoked, still on the network thread
+        uint64_t enqueued_micros = 0;       // handed to another thread
+        uint64_t handler_start_micros = 0;
+        uint64_t handler_end_micros = 0;
+    };
+
+    struct trace_options
+    {
+        bool enabled = false;
+        unsigned sample_one_in = 0;         // keep every Nth finished trace for get_trace_samples(), 0 = none
+        size_t sample_capacity = 1024;      // newest samples kept
+    };
+}
+
+#endif // SIO_TRACE_H
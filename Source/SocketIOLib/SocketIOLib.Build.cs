@@ -1,6 +1,7 @@
 // Copyright 2018-current Getnamo. All Rights Reserved
 
 
+using System;
 using System.IO;
 using UnrealBuildTool;
 
@@ -61,6 +62,9 @@ public SocketIOLib(ReadOnlyTargetRules Target) : base(Target)
 					}
 				);
 
+				//permessage-deflate extension
+				AddEngineThirdPartyPrivateStaticDependencies(Target, "zlib");
+
 				//Setup TLS support | Maybe other platforms work as well (untested)
 				if (
 					Target.Platform == UnrealTargetPlatform.Win64 ||
@@ -72,6 +76,15 @@ public SocketIOLib(ReadOnlyTargetRules Target) : base(Target)
 				{
 					PublicDefinitions.Add("SIO_TLS=1");
 				}
+
+				//io_uring instead of epoll for dedicated Linux servers (kernel 5.10+, liburing installed).
+				//Opt in with SIO_IO_URING=1 in the build environment, asio picks its backend at compile time.
+				if (Target.Platform == UnrealTargetPlatform.Linux && Environment.GetEnvironmentVariable("SIO_IO_URING") == "1")
+				{
+					PublicDefinitions.Add("ASIO_HAS_IO_URING=1");
+					PublicDefinitions.Add("ASIO_DISABLE_EPOLL=1");
+					PublicSystemLibraries.Add("uring");
+				}
 			}
 	}
 }
@@ -0,0 +1,65 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SIOBenchmarkTypes.generated.h"
+
+/** Leaf of the nested struct corpus used by the USIOJConvert benchmarks */
+USTRUCT()
+struct FSIOBenchItem
+{
+	GENERATED_USTRUCT_BODY();
+
+	UPROPERTY()
+	FString Name;
+
+	UPROPERTY()
+	int32 Count = 0;
+
+	UPROPERTY()
+	float Weight = 0.f;
+
+	UPROPERTY()
+	TArray<float> Samples;
+};
+
+USTRUCT()
+struct FSIOBenchInventory
+{
+	GENERATED_USTRUCT_BODY();
+
+	UPROPERTY()
+	FString Owner;
+
+	UPROPERTY()
+	TArray<FSIOBenchItem> Items;
+
+	UPROPERTY()
+	TMap<FString, int32> Currencies;
+};
+
+USTRUCT()
+struct FSIOBenchPlayerState
+{
+	GENERATED_USTRUCT_BODY();
+
+	UPROPERTY()
+	FString PlayerId;
+
+	UPROPERTY()
+	FVector Location = FVector::ZeroVector;
+
+	UPROPERTY()
+	FRotator Rotation = FRotator::ZeroRotator;
+
+	UPROPERTY()
+	bool bAlive = true;
+
+	UPROPERTY()
+	FSIOBenchItem Equipped;
+
+	UPROPERTY()
+	FSIOBenchInventory Inventory;
+};
@@ -0,0 +1,411 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+
+
+#include "SIOBenchmarks.h"
+#include "SIOBenchmarkTypes.h"
+#include "SocketIOTools.h"
+#include "SIOMessageConvert.h"
+#include "SIOJConvert.h"
+#include "SIOAttachmentCodec.h"
+#include "CUOpusCoder.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/App.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+namespace
+{
+	/**
+	* Forwards to the engine allocator and counts calls made by the current thread. Installed
+	* as GMalloc only while benchmarks run; blocks allocated through it are freed by the same
+	* inner allocator, so swapping it in and out is safe. Never deleted for the same reason.
+	*/
+	class FSIOCountingMalloc : public FMalloc
+	{
+	public:
+		explicit FSIOCountingMalloc(FMalloc* InInner) : Inner(InInner) {}
+
+		static thread_local uint64 ThreadAllocations;
+
+		virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+		{
+			ThreadAllocations++;
+			return Inner->Malloc(Count, Alignment);
+		}
+
+		virtual void* TryMalloc(SIZE_T Count, uint32 Alignment) override
+		{
+			ThreadAllocations++;
+			return Inner->TryMalloc(Count, Alignment);
+		}
+
+		virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+		{
+			ThreadAllocations++;
+			return Inner->Realloc(Original, Count, Alignment);
+		}
+
+		virtual void* TryRealloc(void* Original, SIZE_T Count, uint32 Alignment) override
+		{
+			ThreadAllocations++;
+			return Inner->TryRealloc(Original, Count, Alignment);
+		}
+
+		virtual void Free(void* Original) override
+		{
+			Inner->Free(Original);
+		}
+
+		virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override
+		{
+			return Inner->QuantizeSize(Count, Alignment);
+		}
+
+		virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override
+		{
+			return Inner->GetAllocationSize(Original, SizeOut);
+		}
+
+		virtual void Trim(bool bTrimThreadCaches) override
+		{
+			Inner->Trim(bTrimThreadCaches);
+		}
+
+		virtual void SetupTLSCachesOnCurrentThread() override
+		{
+			Inner->SetupTLSCachesOnCurrentThread();
+		}
+
+		virtual void ClearAndDisableTLSCachesOnCurrentThread() override
+		{
+			Inner->ClearAndDisableTLSCachesOnCurrentThread();
+		}
+
+		virtual bool IsInternallyThreadSafe() const override
+		{
+			return Inner->IsInternallyThreadSafe();
+		}
+
+		virtual const TCHAR* GetDescriptiveName() override
+		{
+			return Inner->GetDescriptiveName();
+		}
+
+		FMalloc* Inner;
+	};
+
+	thread_local uint64 FSIOCountingMalloc::ThreadAllocations = 0;
+
+	struct FBenchCase
+	{
+		FString Name;
+		int64 BytesPerOp = 0;
+		TFunction<void()> Op;
+		TMap<FString, double> Counters;
+	};
+
+	FSIOBenchmarkResult RunCase(const FBenchCase& Case, double MinSeconds)
+	{
+		//warm caches and lazily built state (trimmed key maps, opus coder)
+		Case.Op();
+
+		int64 Batch = 1;
+		int64 Iterations = 0;
+		double Elapsed = 0.0;
+		uint64 Allocations = 0;
+		while (Elapsed < MinSeconds)
+		{
+			const uint64 AllocationsBefore = FSIOCountingMalloc::ThreadAllocations;
+			const double Start = FPlatformTime::Seconds();
+			for (int64 i = 0; i < Batch; i++)
+			{
+				Case.Op();
+			}
+			Elapsed += FPlatformTime::Seconds() - Start;
+			Allocations += FSIOCountingMalloc::ThreadAllocations - AllocationsBefore;
+			Iterations += Batch;
+			Batch = FMath::Min<int64>(Batch * 2, 1 << 20);
+		}
+
+		FSIOBenchmarkResult Result;
+		Result.Name = Case.Name;
+		Result.Iterations = Iterations;
+		Result.NsPerOp = Elapsed * 1e9 / Iterations;
+		Result.OpsPerSecond = Iterations / Elapsed;
+		Result.BytesPerSecond = Case.BytesPerOp * Result.OpsPerSecond;
+		Result.AllocsPerOp = double(Allocations) / Iterations;
+		Result.Counters = Case.Counters;
+		if (Case.BytesPerOp > 0)
+		{
+			Result.Counters.Add(TEXT("ns_per_byte"), Result.NsPerOp / Case.BytesPerOp);
+		}
+		return Result;
+	}
+
+	/** Same shapes as SocketIOLib/Benchmarks so the two suites line up */
+	sio::message::ptr MakeMessageCorpus(int32 Kind)
+	{
+		sio::message::list Args;
+		if (Kind == 0)
+		{
+			sio::message::ptr Object = sio::object_message::create();
+			Object->get_map()["user"] = sio::string_message::create("player_42");
+			Object->get_map()["text"] = sio::string_message::create("gg well played");
+			Object->get_map()["ts"] = sio::int_message::create(1700000000123);
+			Args.push(Object);
+		}
+		else if (Kind == 1)
+		{
+			sio::message::ptr Root = sio::object_message::create();
+			sio::message::ptr Entities = sio::array_message::create();
+			for (int32 i = 0; i < 100; i++)
+			{
+				sio::message::ptr Entity = sio::object_message::create();
+				Entity->get_map()["id"] = sio::int_message::create(i);
+				Entity->get_map()["name"] = sio::string_message::create("entity_" + std::to_string(i));
+				Entity->get_map()["alive"] = sio::bool_message::create(i % 3 != 0);
+				sio::message::ptr Position = sio::array_message::create();
+				Position->get_vector().push_back(sio::double_message::create(i * 1.5));
+				Position->get_vector().push_back(sio::double_message::create(i * -2.25));
+				Position->get_vector().push_back(sio::double_message::create(100.0 + i));
+				Entity->get_map()["pos"] = Position;
+				Entities->get_vector().push_back(Entity);
+			}
+			Root->get_map()["entities"] = Entities;
+			Root->get_map()["tick"] = sio::int_message::create(123456);
+			Args.push(Root);
+		}
+		else
+		{
+			sio::message::ptr Object = sio::object_message::create();
+			Object->get_map()["codec"] = sio::string_message::create("opus");
+			Args.push(Object);
+			for (int32 i = 0; i < 4; i++)
+			{
+				Args.push(std::make_shared<const std::string>(64 * 1024, char('a' + i)));
+			}
+		}
+		return Args.to_array_message("bench");
+	}
+
+	FSIOBenchPlayerState MakeStructCorpus()
+	{
+		FSIOBenchPlayerState State;
+		State.PlayerId = TEXT("player_42");
+		State.Location = FVector(120.5, -40.25, 88.0);
+		State.Rotation = FRotator(0.0, 90.0, 0.0);
+		State.Equipped.Name = TEXT("sword");
+		State.Equipped.Count = 1;
+		State.Equipped.Weight = 3.5f;
+		State.Inventory.Owner = State.PlayerId;
+		for (int32 i = 0; i < 32; i++)
+		{
+			FSIOBenchItem Item;
+			Item.Name = FString::Printf(TEXT("item_%d"), i);
+			Item.Count = i;
+			Item.Weight = i * 0.25f;
+			Item.Samples = { 1.f, 2.f, 3.f, 4.f };
+			State.Inventory.Items.Add(Item);
+		}
+		State.Inventory.Currencies.Add(TEXT("gold"), 1200);
+		State.Inventory.Currencies.Add(TEXT("gems"), 15);
+		return State;
+	}
+
+	/** One second of a 440 Hz tone in the coder's default format (16 kHz mono 16 bit) */
+	TArray<uint8> MakePCMCorpus(int32 SampleRate)
+	{
+		TArray<uint8> PCM;
+		PCM.SetNumUninitialized(SampleRate * sizeof(int16));
+		int16* Samples = (int16*)PCM.GetData();
+		for (int32 i = 0; i < SampleRate; i++)
+		{
+			Samples[i] = (int16)(8000.f * FMath::Sin(2.f * PI * 440.f * i / SampleRate));
+		}
+		return PCM;
+	}
+
+	TArray<FBenchCase> MakeCases()
+	{
+		TArray<FBenchCase> Cases;
+		const TCHAR* CorpusNames[] = { TEXT("small_event"), TEXT("large_object"), TEXT("binary_heavy") };
+
+		for (int32 Kind = 0; Kind < 3; Kind++)
+		{
+			sio::message::ptr Message = MakeMessageCorpus(Kind);
+			TSharedPtr<FJsonValue> JsonValue = USIOMessageConvert::ToJsonValue(Message);
+
+			Cases.Add({ FString::Printf(TEXT("SIOMessageConvert.ToJsonValue/%s"), CorpusNames[Kind]), 0, [Message]()
+			{
+				TSharedPtr<FJsonValue> Result = USIOMessageConvert::ToJsonValue(Message);
+			} });
+			Cases.Add({ FString::Printf(TEXT("SIOMessageConvert.ToSIOMessage/%s"), CorpusNames[Kind]), 0, [JsonValue]()
+			{
+				sio::message::ptr Result = USIOMessageConvert::ToSIOMessage(JsonValue);
+			} });
+		}
+
+		TSharedPtr<FSIOBenchPlayerState> Struct = MakeShared<FSIOBenchPlayerState>(MakeStructCorpus());
+		TSharedPtr<FJsonObject> StructJson = USIOJConvert::ToJsonObject(FSIOBenchPlayerState::StaticStruct(), Struct.Get());
+		Cases.Add({ TEXT("SIOJConvert.ToJsonObject/nested_struct"), 0, [Struct]()
+		{
+			TSharedPtr<FJsonObject> Result = USIOJConvert::ToJsonObject(FSIOBenchPlayerState::StaticStruct(), Struct.Get());
+		} });
+		Cases.Add({ TEXT("SIOJConvert.JsonObjectToUStruct/nested_struct"), 0, [StructJson]()
+		{
+			FSIOBenchPlayerState Result;
+			USIOJConvert::JsonObjectToUStruct(StructJson, FSIOBenchPlayerState::StaticStruct(), &Result);
+		} });
+
+		//attachment codecs on the binary_heavy attachments, bytes are the raw side in both directions
+		sio::message::ptr BinaryHeavy = MakeMessageCorpus(2);
+		TSharedPtr<std::vector<std::shared_ptr<const std::string>>> Attachments = MakeShared<std::vector<std::shared_ptr<const std::string>>>();
+		int64 AttachmentBytes = 0;
+		for (const sio::message::ptr& Arg : BinaryHeavy->get_vector())
+		{
+			if (Arg->get_flag() == sio::message::flag_binary)
+			{
+				Attachments->push_back(Arg->get_binary());
+				AttachmentBytes += (int64)Arg->get_binary()->size();
+			}
+		}
+		for (ESIOAttachmentCodec CodecType : { ESIOAttachmentCodec::LZ4, ESIOAttachmentCodec::ZLIB })
+		{
+			TSharedPtr<FSIOAttachmentCodec> AttachmentCodec = MakeShared<FSIOAttachmentCodec>(CodecType);
+			TSharedPtr<std::vector<std::string>> Compressed = MakeShared<std::vector<std::string>>();
+			int64 CompressedBytes = 0;
+			for (const std::shared_ptr<const std::string>& Attachment : *Attachments)
+			{
+				std::string Body;
+				AttachmentCodec->compress(Attachment->data(), Attachment->size(), Body);
+				CompressedBytes += (int64)Body.size();
+				Compressed->push_back(std::move(Body));
+			}
+			const FString CodecName = FSIOAttachmentCodec::CodecName(CodecType);
+			const double Ratio = CompressedBytes > 0 ? double(AttachmentBytes) / CompressedBytes : 0.0;
+
+			FBenchCase CompressCase{ FString::Printf(TEXT("SIOAttachmentCodec.Compress/%s/binary_heavy"), *CodecName), AttachmentBytes, [AttachmentCodec, Attachments]()
+			{
+				std::string Body;
+				for (const std::shared_ptr<const std::string>& Attachment : *Attachments)
+				{
+					Body.clear();
+					AttachmentCodec->compress(Attachment->data(), Attachment->size(), Body);
+				}
+			} };
+			CompressCase.Counters.Add(TEXT("compression_ratio"), Ratio);
+			Cases.Add(CompressCase);
+
+			FBenchCase DecompressCase{ FString::Printf(TEXT("SIOAttachmentCodec.Decompress/%s/binary_heavy"), *CodecName), AttachmentBytes, [AttachmentCodec, Attachments, Compressed]()
+			{
+				std::string Raw;
+				for (size_t i = 0; i < Compressed->size(); i++)
+				{
+					Raw.clear();
+					AttachmentCodec->decompress((*Compressed)[i].data(), (*Compressed)[i].size(), (*Attachments)[i]->size(), Raw);
+				}
+			} };
+			DecompressCase.Counters.Add(TEXT("compression_ratio"), Ratio);
+			Cases.Add(DecompressCase);
+		}
+
+		TSharedPtr<FCUOpusCoder> Coder = MakeShared<FCUOpusCoder>();
+		TSharedPtr<TArray<uint8>> PCM = MakeShared<TArray<uint8>>(MakePCMCorpus(Coder->SampleRate));
+		TSharedPtr<FCUOpusMinimalStream> Encoded = MakeShared<FCUOpusMinimalStream>();
+		Coder->EncodeStream(*PCM, *Encoded);
+		Cases.Add({ TEXT("CUOpusCoder.EncodeStream/1s_pcm"), PCM->Num(), [Coder, PCM]()
+		{
+			FCUOpusMinimalStream Result;
+			Coder->EncodeStream(*PCM, Result);
+		} });
+		Cases.Add({ TEXT("CUOpusCoder.DecodeStream/1s_pcm"), PCM->Num(), [Coder, Encoded]()
+		{
+			TArray<uint8> Result;
+			Coder->DecodeStream(*Encoded, Result);
+		} });
+
+		return Cases;
+	}
+}
+
+TArray<FSIOBenchmarkResult> FSIOBenchmarks::Run(const FString& Filter, double MinSecondsPerCase)
+{
+	static FSIOCountingMalloc* CountingMalloc = nullptr;
+	if (!CountingMalloc)
+	{
+		CountingMalloc = new FSIOCountingMalloc(GMalloc);
+	}
+	FMalloc* PreviousMalloc = GMalloc;
+	GMalloc = CountingMalloc;
+
+	TArray<FSIOBenchmarkResult> Results;
+	for (const FBenchCase& Case : MakeCases())
+	{
+		if (!Filter.IsEmpty() && !Case.Name.Contains(Filter))
+		{
+			continue;
+		}
+		FSIOBenchmarkResult Result = RunCase(Case, MinSecondsPerCase);
+		FString CounterText;
+		for (const TPair<FString, double>& Counter : Result.Counters)
+		{
+			CounterText += FString::Printf(TEXT(" %s=%.3f"), *Counter.Key, Counter.Value);
+		}
+		UE_LOG(SocketIOTools, Log, TEXT("%-52s %12.1f ns/op %10.1f allocs/op%s"), *Result.Name, Result.NsPerOp, Result.AllocsPerOp, *CounterText);
+		Results.Add(Result);
+	}
+
+	GMalloc = PreviousMalloc;
+	return Results;
+}
+
+FString FSIOBenchmarks::ToJson(const TArray<FSIOBenchmarkResult>& Results)
+{
+	TSharedPtr<FJsonObject> Root = MakeShared<FJsonObject>();
+
+	TSharedPtr<FJsonObject> Context = MakeShared<FJsonObject>();
+	Context->SetStringField(TEXT("date"), FDateTime::UtcNow().ToIso8601());
+	Context->SetStringField(TEXT("executable"), TEXT("SocketIOTools"));
+	Context->SetNumberField(TEXT("num_cpus"), FPlatformMisc::NumberOfCoresIncludingHyperthreads());
+	Context->SetStringField(TEXT("library_build_type"), LexToString(FApp::GetBuildConfiguration()));
+	Root->SetObjectField(TEXT("context"), Context);
+
+	TArray<TSharedPtr<FJsonValue>> Benchmarks;
+	for (const FSIOBenchmarkResult& Result : Results)
+	{
+		TSharedPtr<FJsonObject> Entry = MakeShared<FJsonObject>();
+		Entry->SetStringField(TEXT("name"), Result.Name);
+		Entry->SetStringField(TEXT("run_name"), Result.Name);
+		Entry->SetStringField(TEXT("run_type"), TEXT("iteration"));
+		Entry->SetNumberField(TEXT("iterations"), Result.Iterations);
+		Entry->SetNumberField(TEXT("real_time"), Result.NsPerOp);
+		Entry->SetNumberField(TEXT("cpu_time"), Result.NsPerOp);
+		Entry->SetStringField(TEXT("time_unit"), TEXT("ns"));
+		Entry->SetNumberField(TEXT("items_per_second"), Result.OpsPerSecond);
+		if (Result.BytesPerSecond > 0.0)
+		{
+			Entry->SetNumberField(TEXT("bytes_per_second"), Result.BytesPerSecond);
+		}
+		Entry->SetNumberField(TEXT("allocs_per_op"), Result.AllocsPerOp);
+		for (const TPair<FString, double>& Counter : Result.Counters)
+		{
+			Entry->SetNumberField(Counter.Key, Counter.Value);
+		}
+		Benchmarks.Add(MakeShared<FJsonValueObject>(Entry));
+	}
+	Root->SetArrayField(TEXT("benchmarks"), Benchmarks);
+
+	FString Json;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Json);
+	FJsonSerializer::Serialize(Root.ToSharedRef(), Writer);
+	return Json;
+}
+
+bool FSIOBenchmarks::SaveJson(const TArray<FSIOBenchmarkResult>& Results, const FString& FilePath)
+{
+	const FString Path = FilePath.IsEmpty() ? FPaths::ProfilingDir() / TEXT("SocketIOBenchmarks.json") : FilePath;
+	return FFileHelper::SaveStringToFile(ToJson(Results), *Path);
+}
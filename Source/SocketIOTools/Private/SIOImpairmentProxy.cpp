@@ -0,0 +1,558 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+
+
+#include "SIOImpairmentProxy.h"
+#include "SocketIOTools.h"
+#include "Misc/ScopeLock.h"
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4503)
+#define _SCL_SECURE_NO_WARNINGS
+#endif
+
+#define ASIO_STANDALONE
+
+#if PLATFORM_WINDOWS
+#include "Windows/WindowsHWrapper.h"
+#include "Windows/AllowWindowsPlatformAtomics.h"
+#endif
+
+THIRD_PARTY_INCLUDES_START
+#include <asio.hpp>
+#include <asio/steady_timer.hpp>
+THIRD_PARTY_INCLUDES_END
+
+#if PLATFORM_WINDOWS
+#include "Windows/HideWindowsPlatformAtomics.h"
+#endif
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	typedef std::chrono::steady_clock FClock;
+
+	const size_t ReadChunkSize = 16 * 1024;
+
+	/** Per direction backlog before reading pauses, stands in for the TCP window */
+	const size_t MaxQueuedBytes = 4 * 1024 * 1024;
+
+	struct FImpairmentCounters
+	{
+		std::atomic<int32> ActiveConnections{ 0 };
+		std::atomic<int64> Connections{ 0 };
+		std::atomic<int64> BytesUp{ 0 };
+		std::atomic<int64> BytesDown{ 0 };
+		std::atomic<int64> Stalls{ 0 };
+		std::atomic<int64> InjectedDisconnects{ 0 };
+		std::atomic<int64> BytesInFlight{ 0 };
+	};
+
+	struct FChunk
+	{
+		std::vector<char> Data;
+		FClock::time_point Due;
+	};
+
+	class FImpairedConnection;
+
+	/** One direction of a connection: reads From, delays, writes To */
+	struct FPipe
+	{
+		FPipe(asio::io_service& Io, asio::ip::tcp::socket& InFrom, asio::ip::tcp::socket& InTo, std::atomic<int64>& InBytes)
+			: From(InFrom), To(InTo), Timer(Io), Bytes(InBytes)
+		{
+		}
+
+		asio::ip::tcp::socket& From;
+		asio::ip::tcp::socket& To;
+		asio::steady_timer Timer;
+		std::atomic<int64>& Bytes;
+
+		std::array<char, ReadChunkSize> ReadBuffer;
+		std::deque<FChunk> Queue;
+		size_t QueuedBytes = 0;
+		bool bReading = false;
+		bool bWriting = false;
+		bool bTimerArmed = false;
+		bool bEof = false;
+		FClock::time_point LastDue;
+		FClock::time_point LinkFree;
+	};
+
+	class FImpairedConnection : public std::enable_shared_from_this<FImpairedConnection>
+	{
+	public:
+		FImpairedConnection(asio::io_service& InIo, uint64 Seed, FImpairmentCounters& InCounters, std::set<std::shared_ptr<FImpairedConnection>>& InRegistry)
+			: Io(InIo)
+			, Client(InIo)
+			, Upstream(InIo)
+			, Up(InIo, Client, Upstream, InCounters.BytesUp)
+			, Down(InIo, Upstream, Client, InCounters.BytesDown)
+			, StallTimer(InIo)
+			, DisconnectTimer(InIo)
+			, Random(Seed)
+			, Counters(InCounters)
+			, Registry(InRegistry)
+		{
+		}
+
+		asio::io_service& Io;
+		asio::ip::tcp::socket Client;
+		asio::ip::tcp::socket Upstream;
+
+		void Open(const asio::ip::tcp::endpoint& Target, const FSIOImpairmentConfig& InConfig)
+		{
+			Config = InConfig;
+			std::shared_ptr<FImpairedConnection> Self = shared_from_this();
+			Upstream.async_connect(Target, [Self](const asio::error_code& Ec)
+			{
+				if (Ec)
+				{
+					Self->Close();
+					return;
+				}
+				asio::error_code Ignored;
+				Self->Client.set_option(asio::ip::tcp::no_delay(true), Ignored);
+				Self->Upstream.set_option(asio::ip::tcp::no_delay(true), Ignored);
+				Self->Read(Self->Up);
+				Self->Read(Self->Down);
+				Self->ScheduleStall(FClock::now());
+				Self->ScheduleDisconnect();
+			});
+		}
+
+		/** Graceful: both sockets closed, queued data is dropped */
+		void Close()
+		{
+			if (bClosed)
+			{
+				return;
+			}
+			bClosed = true;
+			asio::error_code Ignored;
+			Up.Timer.cancel(Ignored);
+			Down.Timer.cancel(Ignored);
+			StallTimer.cancel(Ignored);
+			DisconnectTimer.cancel(Ignored);
+			Client.close(Ignored);
+			Upstream.close(Ignored);
+			Counters.BytesInFlight -= (int64)(Up.QueuedBytes + Down.QueuedBytes);
+			Up.QueuedBytes = Down.QueuedBytes = 0;
+			Up.Queue.clear();
+			Down.Queue.clear();
+			Counters.ActiveConnections--;
+			Registry.erase(shared_from_this());
+		}
+
+		/** Abrupt: linger 0 turns close into a RST, the peer sees a connection reset */
+		void Abort()
+		{
+			if (bClosed)
+			{
+				return;
+			}
+			asio::error_code Ignored;
+			Client.set_option(asio::socket_base::linger(true, 0), Ignored);
+			Upstream.set_option(asio::socket_base::linger(true, 0), Ignored);
+			Counters.InjectedDisconnects++;
+			Close();
+		}
+
+	private:
+		FPipe Up;
+		FPipe Down;
+		asio::steady_timer StallTimer;
+		asio::steady_timer DisconnectTimer;
+		FSIOImpairmentConfig Config;
+		std::mt19937_64 Random;
+		FImpairmentCounters& Counters;
+		std::set<std::shared_ptr<FImpairedConnection>>& Registry;
+		FClock::time_point StallUntil;
+		bool bClosed = false;
+
+		void Read(FPipe& Pipe)
+		{
+			if (bClosed || Pipe.bReading || Pipe.bEof || Pipe.QueuedBytes >= MaxQueuedBytes)
+			{
+				return;
+			}
+			Pipe.bReading = true;
+			std::shared_ptr<FImpairedConnection> Self = shared_from_this();
+			Pipe.From.async_read_some(asio::buffer(Pipe.ReadBuffer), [Self, &Pipe](const asio::error_code& Ec, size_t Bytes)
+			{
+				Pipe.bReading = false;
+				if (Self->bClosed)
+				{
+					return;
+				}
+				if (Ec)
+				{
+					//EOF or reset, forward the half close once everything queued is out
+					Pipe.bEof = true;
+					Self->Pump(Pipe);
+					return;
+				}
+				Self->Enqueue(Pipe, Bytes);
+				Self->Read(Pipe);
+			});
+		}
+
+		void Enqueue(FPipe& Pipe, size_t Bytes)
+		{
+			const FClock::time_point Now = FClock::now();
+			int64 DelayMicros = (int64)Config.LatencyMs * 1000;
+			if (Config.JitterMs > 0)
+			{
+				DelayMicros += std::uniform_int_distribution<int64>(0, (int64)Config.JitterMs * 1000)(Random);
+			}
+			FClock::time_point Due = Now + std::chrono::microseconds(DelayMicros);
+
+			//bytes leave the link one after another at the capped rate
+			if (Config.BandwidthBytesPerSecond > 0)
+			{
+				const FClock::time_point Start = std::max(Now, Pipe.LinkFree);
+				Pipe.LinkFree = Start + std::chrono::microseconds((int64)(Bytes * 1000000ull / (uint64)Config.BandwidthBytesPerSecond));
+				Due = std::max(Due, Pipe.LinkFree + std::chrono::microseconds(DelayMicros));
+			}
+
+			//a stream never reorders, jitter only ever adds to the previous chunk's delay
+			Due = std::max(Due, Pipe.LastDue);
+			Pipe.LastDue = Due;
+
+			Pipe.Queue.push_back({ std::vector<char>(Pipe.ReadBuffer.data(), Pipe.ReadBuffer.data() + Bytes), Due });
+			Pipe.QueuedBytes += Bytes;
+			Counters.BytesInFlight += (int64)Bytes;
+			Pump(Pipe);
+		}
+
+		void Pump(FPipe& Pipe)
+		{
+			if (bClosed || Pipe.bWriting)
+			{
+				return;
+			}
+			if (Pipe.Queue.empty())
+			{
+				if (Pipe.bEof)
+				{
+					asio::error_code Ignored;
+					Pipe.To.shutdown(asio::ip::tcp::socket::shutdown_send, Ignored);
+					if (Up.bEof && Down.bEof && Up.Queue.empty() && Down.Queue.empty())
+					{
+						Close();
+					}
+				}
+				return;
+			}
+
+			const FClock::time_point Due = std::max(Pipe.Queue.front().Due, StallUntil);
+			std::shared_ptr<FImpairedConnection> Self = shared_from_this();
+			if (Due > FClock::now())
+			{
+				if (!Pipe.bTimerArmed)
+				{
+					Pipe.bTimerArmed = true;
+					Pipe.Timer.expires_at(Due);
+					Pipe.Timer.async_wait([Self, &Pipe](const asio::error_code& Ec)
+					{
+						Pipe.bTimerArmed = false;
+						if (!Ec)
+						{
+							Self->Pump(Pipe);
+						}
+					});
+				}
+				return;
+			}
+
+			Pipe.bWriting = true;
+			asio::async_write(Pipe.To, asio::buffer(Pipe.Queue.front().Data), [Self, &Pipe](const asio::error_code& Ec, size_t Bytes)
+			{
+				Pipe.bWriting = false;
+				if (Self->bClosed)
+				{
+					return;
+				}
+				if (Ec)
+				{
+					Self->Close();
+					return;
+				}
+				Pipe.Queue.pop_front();
+				Pipe.QueuedBytes -= Bytes;
+				Self->Counters.BytesInFlight -= (int64)Bytes;
+				Pipe.Bytes += (int64)Bytes;
+				Self->Read(Pipe);
+				Self->Pump(Pipe);
+			});
+		}
+
+		void ScheduleStall(FClock::time_point After)
+		{
+			if (bClosed || Config.StallIntervalMs <= 0 || Config.StallDurationMs <= 0)
+			{
+				return;
+			}
+			const double WaitMs = std::exponential_distribution<double>(1.0 / Config.StallIntervalMs)(Random);
+			StallTimer.expires_at(After + std::chrono::microseconds((int64)(WaitMs * 1000.0)));
+			std::shared_ptr<FImpairedConnection> Self = shared_from_this();
+			StallTimer.async_wait([Self](const asio::error_code& Ec)
+			{
+				if (Ec || Self->bClosed)
+				{
+					return;
+				}
+				//pending pump timers wake at their old due time, see the stall and re-arm past it
+				Self->StallUntil = FClock::now() + std::chrono::milliseconds(Self->Config.StallDurationMs);
+				Self->Counters.Stalls++;
+				Self->ScheduleStall(Self->StallUntil);
+			});
+		}
+
+		void ScheduleDisconnect()
+		{
+			if (Config.DisconnectAfterMs <= 0)
+			{
+				return;
+			}
+			int64 LifetimeMs = Config.DisconnectAfterMs;
+			if (Config.DisconnectJitterMs > 0)
+			{
+				LifetimeMs += std::uniform_int_distribution<int64>(0, Config.DisconnectJitterMs)(Random);
+			}
+			DisconnectTimer.expires_from_now(std::chrono::milliseconds(LifetimeMs));
+			std::shared_ptr<FImpairedConnection> Self = shared_from_this();
+			DisconnectTimer.async_wait([Self](const asio::error_code& Ec)
+			{
+				if (!Ec)
+				{
+					Self->Abort();
+				}
+			});
+		}
+	};
+}
+
+class FSIOImpairmentProxyImpl
+{
+public:
+	FSIOImpairmentConfig Config;
+	mutable FCriticalSection ConfigLock;
+
+	asio::io_service Io;
+	asio::ip::tcp::acceptor Acceptor{ Io };
+	std::unique_ptr<std::thread> Thread;
+	std::atomic<bool> bRunning{ false };
+	std::atomic<int32> BoundPort{ 0 };
+	FImpairmentCounters Counters;
+
+	//io thread only
+	std::set<std::shared_ptr<FImpairedConnection>> Connections;
+	uint64 ConnectionIndex = 0;
+
+	FSIOImpairmentConfig GetConfig() const
+	{
+		FScopeLock ScopeLock(&ConfigLock);
+		return Config;
+	}
+
+	bool ResolveTarget(const FSIOImpairmentConfig& Current, asio::ip::tcp::endpoint& OutTarget)
+	{
+		const std::string Host = TCHAR_TO_UTF8(*Current.TargetHost);
+		asio::error_code Ec;
+		asio::ip::address Address = Host == "localhost" ? asio::ip::address(asio::ip::address_v4::loopback()) : asio::ip::address::from_string(Host, Ec);
+		if (Ec)
+		{
+			return false;
+		}
+		OutTarget = asio::ip::tcp::endpoint(Address, Current.TargetPort);
+		return true;
+	}
+
+	void Accept()
+	{
+		//connection n gets the same random stream in every run with this seed
+		const uint64 Seed = (uint64)GetConfig().Seed ^ ((ConnectionIndex + 1) * 0x9E3779B97F4A7C15ull);
+		ConnectionIndex++;
+		std::shared_ptr<FImpairedConnection> Connection = std::make_shared<FImpairedConnection>(Io, Seed, Counters, Connections);
+
+		Acceptor.async_accept(Connection->Client, [this, Connection](const asio::error_code& Ec)
+		{
+			if (Ec)
+			{
+				//acceptor closed by Stop
+				return;
+			}
+			const FSIOImpairmentConfig Current = GetConfig();
+			asio::ip::tcp::endpoint Target;
+			if (ResolveTarget(Current, Target))
+			{
+				Connections.insert(Connection);
+				Counters.Connections++;
+				Counters.ActiveConnections++;
+				Connection->Open(Target, Current);
+			}
+			Accept();
+		});
+	}
+
+	bool Start()
+	{
+		if (bRunning)
+		{
+			return false;
+		}
+		const FSIOImpairmentConfig Current = GetConfig();
+		asio::ip::tcp::endpoint Target;
+		if (!ResolveTarget(Current, Target))
+		{
+			UE_LOG(SocketIOTools, Warning, TEXT("FSIOImpairmentProxy: TargetHost %s is not an IP address"), *Current.TargetHost);
+			return false;
+		}
+
+		asio::error_code Ec;
+		const asio::ip::tcp::endpoint Endpoint(asio::ip::address_v4::loopback(), Current.ListenPort);
+		Acceptor.open(Endpoint.protocol(), Ec);
+		if (!Ec)
+		{
+			Acceptor.set_option(asio::socket_base::reuse_address(true), Ec);
+			Acceptor.bind(Endpoint, Ec);
+		}
+		if (!Ec)
+		{
+			Acceptor.listen(asio::socket_base::max_connections, Ec);
+		}
+		if (Ec)
+		{
+			UE_LOG(SocketIOTools, Warning, TEXT("FSIOImpairmentProxy: can't listen on port %d: %s"), Current.ListenPort, UTF8_TO_TCHAR(Ec.message().c_str()));
+			asio::error_code Ignored;
+			Acceptor.close(Ignored);
+			return false;
+		}
+		BoundPort = Acceptor.local_endpoint(Ec).port();
+
+		ConnectionIndex = 0;
+		Accept();
+		bRunning = true;
+		Thread.reset(new std::thread([this]()
+		{
+			Io.run();
+		}));
+		return true;
+	}
+
+	void AbortAll()
+	{
+		//Abort erases from the set
+		std::vector<std::shared_ptr<FImpairedConnection>> Open(Connections.begin(), Connections.end());
+		for (std::shared_ptr<FImpairedConnection>& Connection : Open)
+		{
+			Connection->Abort();
+		}
+	}
+
+	void Stop()
+	{
+		if (!bRunning)
+		{
+			return;
+		}
+		Io.post([this]()
+		{
+			asio::error_code Ignored;
+			Acceptor.close(Ignored);
+			std::vector<std::shared_ptr<FImpairedConnection>> Open(Connections.begin(), Connections.end());
+			for (std::shared_ptr<FImpairedConnection>& Connection : Open)
+			{
+				Connection->Close();
+			}
+		});
+		Thread->join();
+		Thread.reset();
+		Io.reset();
+		bRunning = false;
+	}
+};
+
+FSIOImpairmentProxy::FSIOImpairmentProxy(const FSIOImpairmentConfig& InConfig)
+	: Impl(MakeUnique<FSIOImpairmentProxyImpl>())
+{
+	Impl->Config = InConfig;
+}
+
+FSIOImpairmentProxy::~FSIOImpairmentProxy()
+{
+	Stop();
+}
+
+bool FSIOImpairmentProxy::Start()
+{
+	return Impl->Start();
+}
+
+void FSIOImpairmentProxy::Stop()
+{
+	Impl->Stop();
+}
+
+bool FSIOImpairmentProxy::IsRunning() const
+{
+	return Impl->bRunning;
+}
+
+int32 FSIOImpairmentProxy::GetPort() const
+{
+	return Impl->BoundPort;
+}
+
+FString FSIOImpairmentProxy::GetUrl() const
+{
+	return FString::Printf(TEXT("http://127.0.0.1:%d"), GetPort());
+}
+
+void FSIOImpairmentProxy::SetConfig(const FSIOImpairmentConfig& InConfig)
+{
+	FScopeLock ScopeLock(&Impl->ConfigLock);
+	Impl->Config = InConfig;
+}
+
+FSIOImpairmentConfig FSIOImpairmentProxy::GetConfig() const
+{
+	return Impl->GetConfig();
+}
+
+FSIOImpairmentStats FSIOImpairmentProxy::GetStats() const
+{
+	FSIOImpairmentStats Stats;
+	Stats.ActiveConnections = Impl->Counters.ActiveConnections;
+	Stats.Connections = Impl->Counters.Connections;
+	Stats.BytesUp = Impl->Counters.BytesUp;
+	Stats.BytesDown = Impl->Counters.BytesDown;
+	Stats.Stalls = Impl->Counters.Stalls;
+	Stats.InjectedDisconnects = Impl->Counters.InjectedDisconnects;
+	Stats.BytesInFlight = Impl->Counters.BytesInFlight;
+	return Stats;
+}
+
+void FSIOImpairmentProxy::DisconnectAll()
+{
+	if (!Impl->bRunning)
+	{
+		return;
+	}
+	FSIOImpairmentProxyImpl* ImplPtr = Impl.Get();
+	Impl->Io.post([ImplPtr]()
+	{
+		ImplPtr->AbortAll();
+	});
+}
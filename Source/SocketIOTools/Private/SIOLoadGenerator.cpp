@@ -0,0 +1,453 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+
+
+#include "SIOLoadGenerator.h"
+#include "SocketIOTools.h"
+#include "Misc/ScopeLock.h"
+#include "sio_client.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	typedef std::chrono::steady_clock FClock;
+
+	/** Latency samples kept for percentiles, older ones are replaced at random past this */
+	const size_t MaxLatencySamples = 1 << 22;
+
+	std::string ToStd(const FString& InString)
+	{
+		return std::string(TCHAR_TO_UTF8(*InString));
+	}
+
+	std::string NormalizeNamespace(const std::string& Nsp)
+	{
+		return (Nsp.empty() || Nsp[0] != '/') ? "/" + Nsp : Nsp;
+	}
+}
+
+struct FLoadClient
+{
+	std::unique_ptr<sio::client> Client;
+	sio::socket::ptr Socket;
+	std::atomic<bool> bOpen{ false };
+
+	//driver thread only
+	double EmitCarry = 0.0;
+	int64 Sequence = 0;
+};
+
+class FSIOLoadGeneratorImpl
+{
+public:
+	FSIOLoadGeneratorConfig Config;
+	TUniquePtr<FSIOLoopbackServer> Loopback;
+	std::string Url;
+	std::string Namespace;
+	std::string Event;
+
+	std::vector<std::unique_ptr<FLoadClient>> Clients;
+	std::unique_ptr<std::thread> Driver;
+	std::atomic<bool> bRunning{ false };
+	std::atomic<bool> bStopRequested{ false };
+	std::atomic<bool> bMeasuring{ false };
+
+	FClock::time_point Origin;
+	FClock::time_point MeasureStart;
+	FClock::time_point MeasureEnd;
+
+	std::atomic<int32> Connected{ 0 };
+	std::atomic<int32> Failed{ 0 };
+	std::atomic<int64> Emitted{ 0 };
+	std::atomic<int64> Acked{ 0 };
+	std::atomic<int64> Received{ 0 };
+
+	//shared payload parts, the per emit object only adds the timestamp and sequence
+	std::vector<sio::message::ptr> PayloadFields;
+	std::shared_ptr<const std::string> PayloadBinary;
+
+	mutable FCriticalSection SamplesLock;
+	std::vector<uint32> LatencySamples;
+	uint64 LatencySeen = 0;
+	uint64 LatencySumMicros = 0;
+	std::mt19937_64 Random{ std::random_device()() };		//reservoir slots, guarded by SamplesLock
+
+	int64 NowMicros() const
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(FClock::now() - Origin).count();
+	}
+
+	void RecordLatency(int64 SentMicros)
+	{
+		if (!bMeasuring)
+		{
+			return;
+		}
+		const uint32 Micros = (uint32)FMath::Clamp<int64>(NowMicros() - SentMicros, 0, MAX_uint32);
+		FScopeLock ScopeLock(&SamplesLock);
+		LatencySeen++;
+		LatencySumMicros += Micros;
+		if (LatencySamples.size() < MaxLatencySamples)
+		{
+			LatencySamples.push_back(Micros);
+		}
+		else
+		{
+			//reservoir, keeps the percentiles unbiased on long runs
+			const uint64 Slot = Random() % LatencySeen;
+			if (Slot < MaxLatencySamples)
+			{
+				LatencySamples[(size_t)Slot] = Micros;
+			}
+		}
+	}
+
+	void CreateClient()
+	{
+		std::unique_ptr<FLoadClient> LoadClient(new FLoadClient());
+		FLoadClient* ClientPtr = LoadClient.get();
+		const bool bTls = Url.compare(0, 5, "https") == 0 || Url.compare(0, 3, "wss") == 0;
+		LoadClient->Client.reset(new sio::client(bTls, false));
+		sio::client& Client = *LoadClient->Client;
+
+		Client.set_logs_quiet();
+		Client.set_reconnect_attempts(0);
+		Client.set_socket_open_listener([this, ClientPtr](std::string const& Nsp)
+		{
+			if (NormalizeNamespace(Nsp) == Namespace && !ClientPtr->bOpen.exchange(true))
+			{
+				Connected++;
+			}
+		});
+		Client.set_fail_listener([this]()
+		{
+			Failed++;
+		});
+
+		Client.connect(Url);
+		LoadClient->Socket = Client.socket(Namespace);
+		LoadClient->Socket->on(Event, sio::socket::event_listener([this](sio::event& ReceivedEvent)
+		{
+			if (!bMeasuring)
+			{
+				return;
+			}
+			Received++;
+			if (Config.Pattern == ESIOLoadPattern::Emit)
+			{
+				const sio::message::ptr& Message = ReceivedEvent.get_message();
+				if (Message && Message->get_flag() == sio::message::flag_object)
+				{
+					const std::map<std::string, sio::message::ptr>& Map = Message->get_map();
+					auto Sent = Map.find("t");
+					if (Sent != Map.end() && Sent->second && Sent->second->get_flag() == sio::message::flag_integer)
+					{
+						RecordLatency(Sent->second->get_int());
+					}
+				}
+			}
+		}));
+
+		Clients.push_back(std::move(LoadClient));
+	}
+
+	void EmitFrom(FLoadClient& LoadClient)
+	{
+		const int64 SentMicros = NowMicros();
+		sio::message::ptr Payload = sio::object_message::create();
+		std::map<std::string, sio::message::ptr>& Map = Payload->get_map();
+		Map["t"] = sio::int_message::create(SentMicros);
+		Map["seq"] = sio::int_message::create(LoadClient.Sequence++);
+		for (size_t i = 0; i < PayloadFields.size(); i++)
+		{
+			Map["f" + std::to_string(i)] = PayloadFields[i];
+		}
+
+		sio::message::list Args(Payload);
+		if (PayloadBinary)
+		{
+			Args.push(PayloadBinary);
+		}
+
+		if (Config.Pattern == ESIOLoadPattern::EmitAck)
+		{
+			LoadClient.Socket->emit(Event, Args, [this, SentMicros](sio::message::list const&)
+			{
+				if (bMeasuring)
+				{
+					Acked++;
+					RecordLatency(SentMicros);
+				}
+			});
+		}
+		else
+		{
+			LoadClient.Socket->emit(Event, Args);
+		}
+		if (bMeasuring)
+		{
+			Emitted++;
+		}
+	}
+
+	void DriverLoop()
+	{
+		const int32 ClientCount = FMath::Max(Config.Clients, 1);
+		const double ConnectRate = FMath::Max(Config.ConnectRatePerSecond, 1);
+		FClock::time_point LastTick = Origin;
+		FClock::time_point RampDone;
+		std::uniform_real_distribution<double> Phase(0.0, 1.0);
+		//driver thread only, Random belongs to the latency reservoir on the network threads
+		std::mt19937_64 DriverRandom{ std::random_device()() };
+
+		while (!bStopRequested)
+		{
+			const FClock::time_point Now = FClock::now();
+			const double Elapsed = std::chrono::duration<double>(Now - Origin).count();
+
+			//connect ramp
+			const int32 Target = FMath::Min(ClientCount, (int32)(Elapsed * ConnectRate) + 1);
+			while ((int32)Clients.size() < Target)
+			{
+				CreateClient();
+				//spread first emits over a period so clients don't fire in lockstep
+				Clients.back()->EmitCarry = Phase(DriverRandom);
+				if ((int32)Clients.size() == ClientCount)
+				{
+					RampDone = Now;
+				}
+			}
+
+			//measure once every client settled, or after a grace period for the stragglers
+			if (!bMeasuring && (int32)Clients.size() == ClientCount &&
+				(Connected + Failed >= ClientCount || Now - RampDone > std::chrono::seconds(5)))
+			{
+				MeasureStart = Now;
+				bMeasuring = true;
+			}
+
+			if (Config.Pattern != ESIOLoadPattern::Receive && Config.EmitRatePerSecond > 0.f)
+			{
+				const double Dt = std::chrono::duration<double>(Now - LastTick).count();
+				for (std::unique_ptr<FLoadClient>& LoadClient : Clients)
+				{
+					if (!LoadClient->bOpen)
+					{
+						continue;
+					}
+					LoadClient->EmitCarry += Dt * Config.EmitRatePerSecond;
+					while (LoadClient->EmitCarry >= 1.0)
+					{
+						LoadClient->EmitCarry -= 1.0;
+						EmitFrom(*LoadClient);
+					}
+				}
+			}
+			LastTick = Now;
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+
+	bool Start()
+	{
+		if (bRunning)
+		{
+			return false;
+		}
+
+		if (Config.Url.IsEmpty())
+		{
+			FSIOLoopbackServerConfig LoopbackConfig = Config.LoopbackConfig;
+			if (Config.Pattern == ESIOLoadPattern::Receive)
+			{
+				LoopbackConfig.Mode = ESIOLoopbackMode::Flood;
+				LoopbackConfig.FloodEvent = Config.Event;
+				LoopbackConfig.FloodNamespace = Config.Namespace;
+			}
+			Loopback = MakeUnique<FSIOLoopbackServer>(LoopbackConfig);
+			if (!Loopback->Start())
+			{
+				Loopback.Reset();
+				return false;
+			}
+			Url = ToStd(Loopback->GetUrl());
+		}
+		else
+		{
+			Url = ToStd(Config.Url);
+		}
+		Namespace = NormalizeNamespace(ToStd(Config.Namespace));
+		Event = ToStd(Config.Event);
+
+		PayloadFields.clear();
+		for (int32 i = 0; i < Config.PayloadFields; i++)
+		{
+			PayloadFields.push_back(sio::string_message::create(std::string((size_t)FMath::Max(Config.PayloadFieldBytes, 0), 'x')));
+		}
+		PayloadBinary.reset();
+		if (Config.PayloadBinaryBytes > 0)
+		{
+			PayloadBinary = std::make_shared<const std::string>((size_t)Config.PayloadBinaryBytes, '\x5a');
+		}
+
+		Connected = 0;
+		Failed = 0;
+		Emitted = 0;
+		Acked = 0;
+		Received = 0;
+		{
+			FScopeLock ScopeLock(&SamplesLock);
+			LatencySamples.clear();
+			LatencySeen = 0;
+			LatencySumMicros = 0;
+		}
+		Clients.reserve((size_t)FMath::Max(Config.Clients, 1));
+
+		bStopRequested = false;
+		bMeasuring = false;
+		Origin = FClock::now();
+		bRunning = true;
+		Driver.reset(new std::thread([this]()
+		{
+			DriverLoop();
+		}));
+		return true;
+	}
+
+	void Stop()
+	{
+		if (!bRunning)
+		{
+			return;
+		}
+		bStopRequested = true;
+		Driver->join();
+		Driver.reset();
+
+		MeasureEnd = FClock::now();
+		if (!bMeasuring)
+		{
+			MeasureStart = MeasureEnd;
+		}
+		bMeasuring = false;
+
+		//close everything first so the network threads wind down in parallel, then join them
+		for (std::unique_ptr<FLoadClient>& LoadClient : Clients)
+		{
+			LoadClient->Client->clear_con_listeners();
+			LoadClient->Client->clear_socket_listeners();
+			LoadClient->Client->close();
+		}
+		Clients.clear();
+
+		if (Loopback.IsValid())
+		{
+			Loopback->Stop();
+			Loopback.Reset();
+		}
+		bRunning = false;
+	}
+
+	FSIOLoadGeneratorReport GetReport() const
+	{
+		FSIOLoadGeneratorReport Report;
+		Report.ClientsConnected = Connected;
+		Report.ClientsFailed = Failed;
+		Report.Emitted = Emitted;
+		Report.Acked = Acked;
+		Report.Received = Received;
+
+		const FClock::time_point End = bMeasuring ? FClock::now() : MeasureEnd;
+		Report.Seconds = (bMeasuring || !bRunning) ? std::chrono::duration<double>(End - MeasureStart).count() : 0.0;
+		if (Report.Seconds > 0.0)
+		{
+			Report.EmitsPerSecond = Report.Emitted / Report.Seconds;
+			Report.AcksPerSecond = Report.Acked / Report.Seconds;
+			Report.ReceivedPerSecond = Report.Received / Report.Seconds;
+		}
+
+		std::vector<uint32> Sorted;
+		{
+			FScopeLock ScopeLock(&SamplesLock);
+			Sorted = LatencySamples;
+			Report.LatencySamples = (int64)LatencySeen;
+			Report.MeanMs = LatencySeen > 0 ? LatencySumMicros / 1000.0 / LatencySeen : 0.0;
+		}
+		if (!Sorted.empty())
+		{
+			std::sort(Sorted.begin(), Sorted.end());
+			auto Percentile = [&Sorted](double Fraction)
+			{
+				const size_t Index = FMath::Min((size_t)(Fraction * Sorted.size()), Sorted.size() - 1);
+				return Sorted[Index] / 1000.0;
+			};
+			Report.P50Ms = Percentile(0.5);
+			Report.P90Ms = Percentile(0.9);
+			Report.P99Ms = Percentile(0.99);
+			Report.P999Ms = Percentile(0.999);
+			Report.MaxMs = Sorted.back() / 1000.0;
+		}
+		return Report;
+	}
+};
+
+FString FSIOLoadGeneratorReport::ToString() const
+{
+	return FString::Printf(TEXT("clients %d (%d failed), %.1fs: emit %.0f/s, ack %.0f/s, recv %.0f/s, latency ms mean %.2f p50 %.2f p90 %.2f p99 %.2f p99.9 %.2f max %.2f (%lld samples)"),
+		ClientsConnected, ClientsFailed, Seconds, EmitsPerSecond, AcksPerSecond, ReceivedPerSecond,
+		MeanMs, P50Ms, P90Ms, P99Ms, P999Ms, MaxMs, LatencySamples);
+}
+
+FSIOLoadGenerator::FSIOLoadGenerator(const FSIOLoadGeneratorConfig& InConfig)
+	: Impl(MakeUnique<FSIOLoadGeneratorImpl>())
+{
+	Impl->Config = InConfig;
+}
+
+FSIOLoadGenerator::~FSIOLoadGenerator()
+{
+	Stop();
+}
+
+bool FSIOLoadGenerator::Start()
+{
+	return Impl->Start();
+}
+
+void FSIOLoadGenerator::Stop()
+{
+	Impl->Stop();
+}
+
+bool FSIOLoadGenerator::IsRunning() const
+{
+	return Impl->bRunning;
+}
+
+FSIOLoadGeneratorReport FSIOLoadGenerator::Run()
+{
+	if (!Start())
+	{
+		return FSIOLoadGeneratorReport();
+	}
+	while (!Impl->bMeasuring && Impl->bRunning)
+	{
+		FPlatformProcess::Sleep(0.01f);
+	}
+	FPlatformProcess::Sleep(FMath::Max(Impl->Config.DurationSeconds, 0.f));
+	Stop();
+	return GetReport();
+}
+
+FSIOLoadGeneratorReport FSIOLoadGenerator::GetReport() const
+{
+	return Impl->GetReport();
+}
@@ -0,0 +1,729 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+
+
+#include "SIOLoopbackServer.h"
+#include "SocketIOTools.h"
+#include "SIOAttachmentCodec.h"
+#include "Misc/ScopeLock.h"
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4503)
+#define _SCL_SECURE_NO_WARNINGS
+#endif
+
+/* Same standalone ASIO / C++11 websocketpp setup as SocketIOLib */
+#define ASIO_STANDALONE
+#define _WEBSOCKETPP_CPP11_STL_
+
+#if PLATFORM_WINDOWS
+#include "Windows/WindowsHWrapper.h"
+#include "Windows/AllowWindowsPlatformAtomics.h"
+#endif
+
+THIRD_PARTY_INCLUDES_START
+#include <websocketpp/config/asio_no_tls.hpp>
+#include <websocketpp/server.hpp>
+#include <asio/steady_timer.hpp>
+THIRD_PARTY_INCLUDES_END
+
+#if PLATFORM_WINDOWS
+#include "Windows/HideWindowsPlatformAtomics.h"
+#endif
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef websocketpp::server<websocketpp::config::asio> FWsServer;
+typedef websocketpp::connection_hdl FConnectionHdl;
+typedef websocketpp::frame::opcode::value FOpcode;
+
+namespace
+{
+	/** Socket.IO packet types, the digit after the Engine.IO message prefix '4' */
+	enum ESIOPacketType
+	{
+		PacketConnect = 0,
+		PacketDisconnect = 1,
+		PacketEvent = 2,
+		PacketAck = 3,
+		PacketConnectError = 4,
+		PacketBinaryEvent = 5,
+		PacketBinaryAck = 6
+	};
+
+	struct FParsedPacket
+	{
+		int32 Type = -1;
+		int32 Attachments = 0;
+		std::string Namespace = "/";
+		int64 Id = -1;
+		std::string Data;
+	};
+
+	struct FOutFrame
+	{
+		std::string Payload;
+		FOpcode Opcode;
+	};
+
+	/** <type>[<attachments>-][<nsp>,][<id>][<json>] after the leading '4' */
+	bool ParsePacket(const std::string& Payload, FParsedPacket& Out)
+	{
+		if (Payload.size() < 2 || Payload[0] != '4' || Payload[1] < '0' || Payload[1] > '6')
+		{
+			return false;
+		}
+		Out.Type = Payload[1] - '0';
+		size_t Pos = 2;
+
+		if (Out.Type == PacketBinaryEvent || Out.Type == PacketBinaryAck)
+		{
+			size_t Dash = Payload.find('-', Pos);
+			if (Dash == std::string::npos)
+			{
+				return false;
+			}
+			Out.Attachments = atoi(Payload.substr(Pos, Dash - Pos).c_str());
+			Pos = Dash + 1;
+		}
+
+		if (Pos < Payload.size() && Payload[Pos] == '/')
+		{
+			size_t Comma = Payload.find(',', Pos);
+			size_t End = Comma == std::string::npos ? Payload.size() : Comma;
+			Out.Namespace = Payload.substr(Pos, End - Pos);
+			Pos = Comma == std::string::npos ? End : Comma + 1;
+		}
+
+		size_t IdStart = Pos;
+		while (Pos < Payload.size() && Payload[Pos] >= '0' && Payload[Pos] <= '9')
+		{
+			Pos++;
+		}
+		if (Pos > IdStart)
+		{
+			Out.Id = atoll(Payload.substr(IdStart, Pos - IdStart).c_str());
+		}
+
+		Out.Data = Payload.substr(Pos);
+		return true;
+	}
+
+	std::string BuildPacket(int32 Type, int32 Attachments, const std::string& Namespace, int64 Id, const std::string& Data)
+	{
+		std::string Out = "4";
+		Out += char('0' + Type);
+		if (Attachments > 0)
+		{
+			Out += std::to_string(Attachments);
+			Out += '-';
+		}
+		if (!Namespace.empty() && Namespace != "/")
+		{
+			Out += Namespace;
+			Out += ',';
+		}
+		if (Id >= 0)
+		{
+			Out += std::to_string(Id);
+		}
+		Out += Data;
+		return Out;
+	}
+
+	/** ["name",a,b] -> [a,b], the arguments an ack answers with. Input is trusted client output. */
+	std::string EventArguments(const std::string& Data)
+	{
+		size_t Pos = Data.find('[');
+		if (Pos == std::string::npos)
+		{
+			return "[]";
+		}
+		Pos = Data.find('"', Pos);
+		if (Pos == std::string::npos)
+		{
+			return "[]";
+		}
+		for (Pos++; Pos < Data.size() && Data[Pos] != '"'; Pos++)
+		{
+			if (Data[Pos] == '\\')
+			{
+				Pos++;
+			}
+		}
+		size_t Next = Data.find_first_of(",]", Pos + 1);
+		if (Next == std::string::npos || Data[Next] == ']')
+		{
+			return "[]";
+		}
+		return "[" + Data.substr(Next + 1);
+	}
+
+	std::string ToStd(const FString& InString)
+	{
+		return std::string(TCHAR_TO_UTF8(*InString));
+	}
+
+	/** First of Accepted named in the "attachmentCodecs" array of a connect packet's auth payload */
+	FString ChooseAttachmentCodec(const std::string& Data, const TArray<FString>& Accepted)
+	{
+		size_t Key = Data.find("\"attachmentCodecs\"");
+		if (Key == std::string::npos)
+		{
+			return FString();
+		}
+		size_t Open = Data.find('[', Key);
+		size_t Close = Open == std::string::npos ? std::string::npos : Data.find(']', Open);
+		if (Close == std::string::npos)
+		{
+			return FString();
+		}
+		const std::string Offer = Data.substr(Open, Close - Open);
+		for (const FString& Name : Accepted)
+		{
+			if (Offer.find("\"" + ToStd(Name) + "\"") != std::string::npos)
+			{
+				return Name;
+			}
+		}
+		return FString();
+	}
+
+	ESIOAttachmentCodec AttachmentCodecFromName(const FString& Name)
+	{
+		return Name == FSIOAttachmentCodec::CodecName(ESIOAttachmentCodec::ZLIB) ? ESIOAttachmentCodec::ZLIB :
+			Name == FSIOAttachmentCodec::CodecName(ESIOAttachmentCodec::LZ4) ? ESIOAttachmentCodec::LZ4 : ESIOAttachmentCodec::NONE;
+	}
+
+	/** Same framing as sio::json_codec: compressed when it pays off, escaped if raw bytes look like a header */
+	std::string EncodeAttachment(sio::attachment_codec& Codec, const std::string& Raw)
+	{
+		std::string Out;
+		std::string Body;
+		if (Raw.size() >= Codec.get_min_size() && Raw.size() <= 0xFFFFFFFFu && Codec.compress(Raw.data(), Raw.size(), Body) &&
+			Body.size() + sio::attachment_codec::header_size < Raw.size())
+		{
+			sio::attachment_codec::write_header(Out, (uint32_t)Raw.size());
+			Out += Body;
+			return Out;
+		}
+		if (sio::attachment_codec::needs_escape(Raw.data(), Raw.size()))
+		{
+			sio::attachment_codec::write_raw_header(Out, (uint32_t)Raw.size());
+			Out += Raw;
+			return Out;
+		}
+		return Raw;
+	}
+}
+
+struct FLoopbackConnection
+{
+	FConnectionHdl Hdl;
+	std::string Sid;
+	std::set<std::string> Namespaces;
+
+	//negotiated attachment codec, null sends attachments raw
+	std::shared_ptr<FSIOAttachmentCodec> Codec;
+
+	//binary packet waiting for its attachment frames
+	FParsedPacket Pending;
+	std::vector<std::string> PendingBuffers;
+};
+
+class FSIOLoopbackServerImpl
+{
+public:
+	FSIOLoopbackServerConfig Config;
+	mutable FCriticalSection ConfigLock;
+
+	FWsServer Server;
+	std::unique_ptr<std::thread> Thread;
+	std::atomic<bool> bRunning{ false };
+	std::atomic<int32> BoundPort{ 0 };
+
+	//server thread only
+	std::map<FConnectionHdl, std::shared_ptr<FLoopbackConnection>, std::owner_less<FConnectionHdl>> Connections;
+	std::unique_ptr<asio::steady_timer> PingTimer;
+	std::unique_ptr<asio::steady_timer> FloodTimer;
+	std::chrono::steady_clock::time_point LastFlood;
+	double FloodCarry = 0.0;
+	std::mt19937_64 Random{ std::random_device()() };
+
+	std::atomic<int32> Clients{ 0 };
+	std::atomic<int64> FramesIn{ 0 };
+	std::atomic<int64> FramesOut{ 0 };
+	std::atomic<int64> BytesIn{ 0 };
+	std::atomic<int64> BytesOut{ 0 };
+	std::atomic<int64> EventsIn{ 0 };
+	std::atomic<int64> EventsOut{ 0 };
+	std::atomic<int64> AcksOut{ 0 };
+
+	FSIOLoopbackServerImpl()
+	{
+		Server.clear_access_channels(websocketpp::log::alevel::all);
+		Server.clear_error_channels(websocketpp::log::elevel::all);
+		Server.init_asio();
+		Server.set_reuse_addr(true);
+
+		using websocketpp::lib::placeholders::_1;
+		using websocketpp::lib::placeholders::_2;
+		Server.set_open_handler(websocketpp::lib::bind(&FSIOLoopbackServerImpl::OnOpen, this, _1));
+		Server.set_close_handler(websocketpp::lib::bind(&FSIOLoopbackServerImpl::OnClose, this, _1));
+		Server.set_message_handler(websocketpp::lib::bind(&FSIOLoopbackServerImpl::OnMessage, this, _1, _2));
+	}
+
+	FSIOLoopbackServerConfig GetConfig() const
+	{
+		FScopeLock ScopeLock(&ConfigLock);
+		return Config;
+	}
+
+	void Send(const FConnectionHdl& Hdl, const std::string& Payload, FOpcode Opcode = websocketpp::frame::opcode::text)
+	{
+		websocketpp::lib::error_code Ec;
+		Server.send(Hdl, Payload, Opcode, Ec);
+		if (!Ec)
+		{
+			FramesOut++;
+			BytesOut += (int64)Payload.size();
+		}
+	}
+
+	void SendFrames(const FConnectionHdl& Hdl, const std::vector<FOutFrame>& Frames)
+	{
+		for (const FOutFrame& Frame : Frames)
+		{
+			Send(Hdl, Frame.Payload, Frame.Opcode);
+		}
+	}
+
+	void SendDelayed(const FConnectionHdl& Hdl, std::vector<FOutFrame> Frames, int32 DelayMs)
+	{
+		if (DelayMs <= 0)
+		{
+			SendFrames(Hdl, Frames);
+			return;
+		}
+		std::shared_ptr<asio::steady_timer> Timer = std::make_shared<asio::steady_timer>(Server.get_io_service(), std::chrono::milliseconds(DelayMs));
+		Timer->async_wait([this, Timer, Hdl, Frames](const asio::error_code& Ec)
+		{
+			if (!Ec)
+			{
+				SendFrames(Hdl, Frames);
+			}
+		});
+	}
+
+	void OnOpen(FConnectionHdl Hdl)
+	{
+		const FSIOLoopbackServerConfig Current = GetConfig();
+
+		std::shared_ptr<FLoopbackConnection> Connection = std::make_shared<FLoopbackConnection>();
+		Connection->Hdl = Hdl;
+		char Sid[17];
+		snprintf(Sid, sizeof(Sid), "%016llx", (unsigned long long)Random());
+		Connection->Sid = Sid;
+		Connections[Hdl] = Connection;
+		Clients++;
+
+		Send(Hdl, "0{\"sid\":\"" + Connection->Sid + "\",\"upgrades\":[],\"pingInterval\":" + std::to_string(Current.PingIntervalMs) +
+			",\"pingTimeout\":" + std::to_string(Current.PingTimeoutMs) + ",\"maxPayload\":100000000}");
+	}
+
+	void OnClose(FConnectionHdl Hdl)
+	{
+		if (Connections.erase(Hdl) > 0)
+		{
+			Clients--;
+		}
+	}
+
+	void OnMessage(FConnectionHdl Hdl, FWsServer::message_ptr Msg)
+	{
+		auto It = Connections.find(Hdl);
+		if (It == Connections.end())
+		{
+			return;
+		}
+		FLoopbackConnection& Connection = *It->second;
+		const std::string& Payload = Msg->get_payload();
+		FramesIn++;
+		BytesIn += (int64)Payload.size();
+
+		if (Msg->get_opcode() == websocketpp::frame::opcode::binary)
+		{
+			if (Connection.Pending.Attachments > (int32)Connection.PendingBuffers.size())
+			{
+				Connection.PendingBuffers.push_back(Payload);
+				if ((int32)Connection.PendingBuffers.size() == Connection.Pending.Attachments)
+				{
+					HandlePacket(Connection, Connection.Pending, Connection.PendingBuffers);
+					Connection.Pending = FParsedPacket();
+					Connection.PendingBuffers.clear();
+				}
+			}
+			return;
+		}
+
+		if (Payload.empty())
+		{
+			return;
+		}
+		switch (Payload[0])
+		{
+		case '2':	//ping from a client, answer like a server would
+			Send(Hdl, "3" + Payload.substr(1));
+			return;
+		case '3':	//pong to our ping
+			return;
+		case '4':
+			break;
+		default:
+			return;
+		}
+
+		FParsedPacket Packet;
+		if (!ParsePacket(Payload, Packet))
+		{
+			return;
+		}
+		if (Packet.Attachments > 0)
+		{
+			Connection.Pending = Packet;
+			Connection.PendingBuffers.clear();
+			return;
+		}
+		HandlePacket(Connection, Packet, std::vector<std::string>());
+	}
+
+	void HandlePacket(FLoopbackConnection& Connection, const FParsedPacket& Packet, const std::vector<std::string>& Buffers)
+	{
+		switch (Packet.Type)
+		{
+		case PacketConnect:
+		{
+			Connection.Namespaces.insert(Packet.Namespace);
+			if (!Connection.Codec)
+			{
+				const FString CodecName = ChooseAttachmentCodec(Packet.Data, GetConfig().AttachmentCodecs);
+				const ESIOAttachmentCodec Codec = AttachmentCodecFromName(CodecName);
+				if (Codec != ESIOAttachmentCodec::NONE)
+				{
+					Connection.Codec = std::make_shared<FSIOAttachmentCodec>(Codec);
+				}
+			}
+			std::string Reply = "{\"sid\":\"" + Connection.Sid + "\"";
+			if (Connection.Codec)
+			{
+				Reply += ",\"attachmentCodec\":\"" + Connection.Codec->get_name() + "\"";
+			}
+			Send(Connection.Hdl, BuildPacket(PacketConnect, 0, Packet.Namespace, -1, Reply + "}"));
+			break;
+		}
+		case PacketDisconnect:
+			Connection.Namespaces.erase(Packet.Namespace);
+			break;
+		case PacketEvent:
+		case PacketBinaryEvent:
+			HandleEvent(Connection, Packet, Buffers);
+			break;
+		default:
+			//acks to our emits and connect errors need no answer
+			break;
+		}
+	}
+
+	void HandleEvent(FLoopbackConnection& Connection, const FParsedPacket& Packet, const std::vector<std::string>& Buffers)
+	{
+		EventsIn++;
+		const FSIOLoopbackServerConfig Current = GetConfig();
+		const bool bBinary = !Buffers.empty();
+		std::vector<FOutFrame> Frames;
+
+		//attachments keep their order, so the placeholders in the echoed JSON stay valid. They
+		//arrive in the connection's negotiated encoding, which is also what it expects back.
+		auto AddBuffers = [&Frames, &Buffers]()
+		{
+			for (const std::string& Buffer : Buffers)
+			{
+				Frames.push_back({ Buffer, websocketpp::frame::opcode::binary });
+			}
+		};
+
+		if (Current.Mode != ESIOLoopbackMode::Silent)
+		{
+			Frames.push_back({ BuildPacket(bBinary ? PacketBinaryEvent : PacketEvent, (int32)Buffers.size(), Packet.Namespace, -1, Packet.Data), websocketpp::frame::opcode::text });
+			AddBuffers();
+			EventsOut++;
+		}
+		if (Packet.Id >= 0)
+		{
+			Frames.push_back({ BuildPacket(bBinary ? PacketBinaryAck : PacketAck, (int32)Buffers.size(), Packet.Namespace, Packet.Id, EventArguments(Packet.Data)), websocketpp::frame::opcode::text });
+			AddBuffers();
+			AcksOut++;
+		}
+		SendDelayed(Connection.Hdl, std::move(Frames), Current.ReplyDelayMs);
+	}
+
+	void SchedulePing()
+	{
+		const int32 IntervalMs = FMath::Max(GetConfig().PingIntervalMs, 1);
+		PingTimer->expires_from_now(std::chrono::milliseconds(IntervalMs));
+		PingTimer->async_wait([this](const asio::error_code& Ec)
+		{
+			if (Ec)
+			{
+				return;
+			}
+			for (auto& Pair : Connections)
+			{
+				Send(Pair.second->Hdl, "2");
+			}
+			SchedulePing();
+		});
+	}
+
+	void ScheduleFlood()
+	{
+		FloodTimer->expires_from_now(std::chrono::milliseconds(10));
+		FloodTimer->async_wait([this](const asio::error_code& Ec)
+		{
+			if (Ec)
+			{
+				return;
+			}
+			Flood();
+			ScheduleFlood();
+		});
+	}
+
+	void Flood()
+	{
+		const FSIOLoopbackServerConfig Current = GetConfig();
+		const std::chrono::steady_clock::time_point Now = std::chrono::steady_clock::now();
+		const double Elapsed = std::chrono::duration<double>(Now - LastFlood).count();
+		LastFlood = Now;
+		if (Current.Mode != ESIOLoopbackMode::Flood || Current.FloodRatePerSecond <= 0)
+		{
+			FloodCarry = 0.0;
+			return;
+		}
+
+		//timer ticks are late under load, carry the fraction so the rate holds on average
+		FloodCarry += Elapsed * Current.FloodRatePerSecond;
+		const int32 Count = (int32)FloodCarry;
+		FloodCarry -= Count;
+		if (Count == 0)
+		{
+			return;
+		}
+
+		const std::string Namespace = ToStd(Current.FloodNamespace);
+		std::vector<FOutFrame> Frames;
+		std::string Attachment;
+		if (Current.FloodBinaryBytes > 0)
+		{
+			Frames.push_back({ BuildPacket(PacketBinaryEvent, 1, Namespace, -1, "[\"" + ToStd(Current.FloodEvent) + "\"," + ToStd(Current.FloodPayload) + ",{\"_placeholder\":true,\"num\":0}]"), websocketpp::frame::opcode::text });
+			Attachment.assign((size_t)Current.FloodBinaryBytes, '\x5a');
+		}
+		else
+		{
+			Frames.push_back({ BuildPacket(PacketEvent, 0, Namespace, -1, "[\"" + ToStd(Current.FloodEvent) + "\"," + ToStd(Current.FloodPayload) + "]"), websocketpp::frame::opcode::text });
+		}
+
+		//the attachment once per codec in use, not per client
+		std::map<std::string, std::vector<FOutFrame>> FramesByCodec;
+		for (auto& Pair : Connections)
+		{
+			if (Pair.second->Namespaces.count(Namespace) == 0)
+			{
+				continue;
+			}
+			const std::string CodecName = Pair.second->Codec ? Pair.second->Codec->get_name() : std::string();
+			auto Encoded = FramesByCodec.find(CodecName);
+			if (Encoded == FramesByCodec.end())
+			{
+				std::vector<FOutFrame> CodecFrames = Frames;
+				if (!Attachment.empty())
+				{
+					CodecFrames.push_back({ Pair.second->Codec ? EncodeAttachment(*Pair.second->Codec, Attachment) : Attachment, websocketpp::frame::opcode::binary });
+				}
+				Encoded = FramesByCodec.emplace(CodecName, std::move(CodecFrames)).first;
+			}
+			for (int32 i = 0; i < Count; i++)
+			{
+				SendFrames(Pair.second->Hdl, Encoded->second);
+			}
+			EventsOut += Count;
+		}
+	}
+
+	void EmitToAll(const std::string& Namespace, const std::string& Data)
+	{
+		const std::string Payload = BuildPacket(PacketEvent, 0, Namespace, -1, Data);
+		for (auto& Pair : Connections)
+		{
+			if (Pair.second->Namespaces.count(Namespace) > 0)
+			{
+				Send(Pair.second->Hdl, Payload);
+				EventsOut++;
+			}
+		}
+	}
+
+	bool Start()
+	{
+		if (bRunning)
+		{
+			return false;
+		}
+		const FSIOLoopbackServerConfig Current = GetConfig();
+
+		websocketpp::lib::error_code Ec;
+		Server.listen(asio::ip::tcp::endpoint(asio::ip::address_v4::loopback(), Current.Port), Ec);
+		if (Ec)
+		{
+			UE_LOG(SocketIOTools, Warning, TEXT("FSIOLoopbackServer: can't listen on port %d: %s"), Current.Port, UTF8_TO_TCHAR(Ec.message().c_str()));
+			return false;
+		}
+		Server.start_accept(Ec);
+		if (Ec)
+		{
+			Server.stop_listening(Ec);
+			return false;
+		}
+		asio::error_code EndpointEc;
+		BoundPort = Server.get_local_endpoint(EndpointEc).port();
+
+		PingTimer.reset(new asio::steady_timer(Server.get_io_service()));
+		FloodTimer.reset(new asio::steady_timer(Server.get_io_service()));
+		LastFlood = std::chrono::steady_clock::now();
+		FloodCarry = 0.0;
+		SchedulePing();
+		ScheduleFlood();
+
+		bRunning = true;
+		Thread.reset(new std::thread([this]()
+		{
+			Server.run();
+		}));
+		return true;
+	}
+
+	void Stop()
+	{
+		if (!bRunning)
+		{
+			return;
+		}
+		//close from the server thread, run() returns once the last close handshake is done
+		Server.get_io_service().post([this]()
+		{
+			websocketpp::lib::error_code Ec;
+			Server.stop_listening(Ec);
+			PingTimer->cancel();
+			FloodTimer->cancel();
+			for (auto& Pair : Connections)
+			{
+				Server.close(Pair.second->Hdl, websocketpp::close::status::going_away, "server stopped", Ec);
+			}
+		});
+		Thread->join();
+		Thread.reset();
+		Connections.clear();
+		Clients = 0;
+		PingTimer.reset();
+		FloodTimer.reset();
+		Server.reset();
+		bRunning = false;
+	}
+};
+
+FSIOLoopbackServer::FSIOLoopbackServer(const FSIOLoopbackServerConfig& InConfig)
+	: Impl(MakeUnique<FSIOLoopbackServerImpl>())
+{
+	Impl->Config = InConfig;
+}
+
+FSIOLoopbackServer::~FSIOLoopbackServer()
+{
+	Stop();
+}
+
+bool FSIOLoopbackServer::Start()
+{
+	return Impl->Start();
+}
+
+void FSIOLoopbackServer::Stop()
+{
+	Impl->Stop();
+}
+
+bool FSIOLoopbackServer::IsRunning() const
+{
+	return Impl->bRunning;
+}
+
+int32 FSIOLoopbackServer::GetPort() const
+{
+	return Impl->BoundPort;
+}
+
+FString FSIOLoopbackServer::GetUrl() const
+{
+	return FString::Printf(TEXT("http://127.0.0.1:%d"), GetPort());
+}
+
+void FSIOLoopbackServer::SetConfig(const FSIOLoopbackServerConfig& InConfig)
+{
+	FScopeLock ScopeLock(&Impl->ConfigLock);
+	Impl->Config = InConfig;
+}
+
+FSIOLoopbackServerConfig FSIOLoopbackServer::GetConfig() const
+{
+	return Impl->GetConfig();
+}
+
+FSIOLoopbackServerStats FSIOLoopbackServer::GetStats() const
+{
+	FSIOLoopbackServerStats Stats;
+	Stats.Clients = Impl->Clients;
+	Stats.FramesIn = Impl->FramesIn;
+	Stats.FramesOut = Impl->FramesOut;
+	Stats.BytesIn = Impl->BytesIn;
+	Stats.BytesOut = Impl->BytesOut;
+	Stats.EventsIn = Impl->EventsIn;
+	Stats.EventsOut = Impl->EventsOut;
+	Stats.AcksOut = Impl->AcksOut;
+	return Stats;
+}
+
+void FSIOLoopbackServer::Emit(const FString& Event, const FString& JsonArgs /*= TEXT("[]")*/, const FString& Namespace /*= TEXT("/")*/)
+{
+	if (!Impl->bRunning)
+	{
+		return;
+	}
+	//["event",args...] from the argument array
+	std::string Args = ToStd(JsonArgs);
+	size_t Open = Args.find('[');
+	std::string Rest = Open == std::string::npos ? "]" : Args.substr(Open + 1);
+	size_t First = Rest.find_first_not_of(" \t\r\n");
+	std::string Data = "[\"" + ToStd(Event) + "\"" + ((First != std::string::npos && Rest[First] != ']') ? "," : "") + Rest;
+
+	FSIOLoopbackServerImpl* ImplPtr = Impl.Get();
+	std::string Nsp = ToStd(Namespace);
+	Impl->Server.get_io_service().post([ImplPtr, Nsp, Data]()
+	{
+		ImplPtr->EmitToAll(Nsp, Data);
+	});
+}
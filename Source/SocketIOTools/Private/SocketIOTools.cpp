@@ -0,0 +1,236 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+
+
+#include "SocketIOTools.h"
+#include "SIOLoopbackServer.h"
+#include "SIOLoadGenerator.h"
+#include "SIOBenchmarks.h"
+#include "SIOImpairmentProxy.h"
+#include "HAL/IConsoleManager.h"
+
+DEFINE_LOG_CATEGORY(SocketIOTools);
+
+class FSocketIOToolsModule : public ISocketIOToolsModule
+{
+public:
+	virtual void StartupModule() override
+	{
+		StartCommand = MakeUnique<FAutoConsoleCommand>(
+			TEXT("SocketIO.Loopback.Start"),
+			TEXT("Start a loopback Socket.IO server on 127.0.0.1. Args: [port] [echo|flood|silent]"),
+			FConsoleCommandWithArgsDelegate::CreateRaw(this, &FSocketIOToolsModule::StartLoopback));
+
+		StopCommand = MakeUnique<FAutoConsoleCommand>(
+			TEXT("SocketIO.Loopback.Stop"),
+			TEXT("Stop the loopback Socket.IO server"),
+			FConsoleCommandDelegate::CreateRaw(this, &FSocketIOToolsModule::StopLoopback));
+
+		LoadStartCommand = MakeUnique<FAutoConsoleCommand>(
+			TEXT("SocketIO.LoadTest.Start"),
+			TEXT("Start a load generator. Args: [clients] [emit|ack|receive] [emits per second per client] [url], no url loads a loopback server"),
+			FConsoleCommandWithArgsDelegate::CreateRaw(this, &FSocketIOToolsModule::StartLoadTest));
+
+		LoadStopCommand = MakeUnique<FAutoConsoleCommand>(
+			TEXT("SocketIO.LoadTest.Stop"),
+			TEXT("Stop the load generator and log its report"),
+			FConsoleCommandDelegate::CreateRaw(this, &FSocketIOToolsModule::StopLoadTest));
+
+		BenchmarkCommand = MakeUnique<FAutoConsoleCommand>(
+			TEXT("SocketIO.Benchmark"),
+			TEXT("Run the conversion and Opus benchmarks, writes Saved/Profiling/SocketIOBenchmarks.json. Args: [name filter] [seconds per case]"),
+			FConsoleCommandWithArgsDelegate::CreateRaw(this, &FSocketIOToolsModule::RunBenchmarks));
+
+		ImpairStartCommand = MakeUnique<FAutoConsoleCommand>(
+			TEXT("SocketIO.Impair.Start"),
+			TEXT("Start an impairment proxy in front of 127.0.0.1:<target port>. Args: <target port> [latency ms] [jitter ms] [bytes per second] [seed], 0 target port uses the loopback server"),
+			FConsoleCommandWithArgsDelegate::CreateRaw(this, &FSocketIOToolsModule::StartImpairment));
+
+		ImpairStopCommand = MakeUnique<FAutoConsoleCommand>(
+			TEXT("SocketIO.Impair.Stop"),
+			TEXT("Stop the impairment proxy"),
+			FConsoleCommandDelegate::CreateRaw(this, &FSocketIOToolsModule::StopImpairment));
+	}
+
+	virtual void ShutdownModule() override
+	{
+		StartCommand.Reset();
+		StopCommand.Reset();
+		LoadStartCommand.Reset();
+		LoadStopCommand.Reset();
+		BenchmarkCommand.Reset();
+		ImpairStartCommand.Reset();
+		ImpairStopCommand.Reset();
+		StopImpairment();
+		StopLoadTest();
+		StopLoopback();
+	}
+
+private:
+	void StartLoopback(const TArray<FString>& Args)
+	{
+		FSIOLoopbackServerConfig Config;
+		if (Args.Num() > 0)
+		{
+			Config.Port = (uint16)FCString::Atoi(*Args[0]);
+		}
+		if (Args.Num() > 1)
+		{
+			if (Args[1].Equals(TEXT("flood"), ESearchCase::IgnoreCase))
+			{
+				Config.Mode = ESIOLoopbackMode::Flood;
+			}
+			else if (Args[1].Equals(TEXT("silent"), ESearchCase::IgnoreCase))
+			{
+				Config.Mode = ESIOLoopbackMode::Silent;
+			}
+		}
+
+		StopLoopback();
+		LoopbackServer = MakeUnique<FSIOLoopbackServer>(Config);
+		if (LoopbackServer->Start())
+		{
+			UE_LOG(SocketIOTools, Log, TEXT("Loopback server listening on %s"), *LoopbackServer->GetUrl());
+		}
+		else
+		{
+			LoopbackServer.Reset();
+		}
+	}
+
+	void StopLoopback()
+	{
+		if (LoopbackServer.IsValid())
+		{
+			LoopbackServer->Stop();
+			LoopbackServer.Reset();
+			UE_LOG(SocketIOTools, Log, TEXT("Loopback server stopped"));
+		}
+	}
+
+	void StartLoadTest(const TArray<FString>& Args)
+	{
+		FSIOLoadGeneratorConfig Config;
+		if (Args.Num() > 0)
+		{
+			Config.Clients = FCString::Atoi(*Args[0]);
+		}
+		if (Args.Num() > 1)
+		{
+			if (Args[1].Equals(TEXT("emit"), ESearchCase::IgnoreCase))
+			{
+				Config.Pattern = ESIOLoadPattern::Emit;
+			}
+			else if (Args[1].Equals(TEXT("receive"), ESearchCase::IgnoreCase))
+			{
+				Config.Pattern = ESIOLoadPattern::Receive;
+			}
+		}
+		if (Args.Num() > 2)
+		{
+			Config.EmitRatePerSecond = FCString::Atof(*Args[2]);
+		}
+		if (Args.Num() > 3)
+		{
+			Config.Url = Args[3];
+		}
+
+		StopLoadTest();
+		LoadGenerator = MakeUnique<FSIOLoadGenerator>(Config);
+		if (LoadGenerator->Start())
+		{
+			UE_LOG(SocketIOTools, Log, TEXT("Load test started with %d clients"), Config.Clients);
+		}
+		else
+		{
+			UE_LOG(SocketIOTools, Warning, TEXT("Load test failed to start"));
+			LoadGenerator.Reset();
+		}
+	}
+
+	void StopLoadTest()
+	{
+		if (LoadGenerator.IsValid())
+		{
+			LoadGenerator->Stop();
+			UE_LOG(SocketIOTools, Log, TEXT("Load test: %s"), *LoadGenerator->GetReport().ToString());
+			LoadGenerator.Reset();
+		}
+	}
+
+	void RunBenchmarks(const TArray<FString>& Args)
+	{
+		const FString Filter = Args.Num() > 0 ? Args[0] : FString();
+		const double Seconds = Args.Num() > 1 ? FCString::Atod(*Args[1]) : 0.5;
+		TArray<FSIOBenchmarkResult> Results = FSIOBenchmarks::Run(Filter, Seconds);
+		if (!FSIOBenchmarks::SaveJson(Results))
+		{
+			UE_LOG(SocketIOTools, Warning, TEXT("Failed to write benchmark results"));
+		}
+	}
+
+	void StartImpairment(const TArray<FString>& Args)
+	{
+		FSIOImpairmentConfig Config;
+		Config.TargetPort = Args.Num() > 0 ? (uint16)FCString::Atoi(*Args[0]) : 0;
+		if (Config.TargetPort == 0 && LoopbackServer.IsValid())
+		{
+			Config.TargetPort = (uint16)LoopbackServer->GetPort();
+		}
+		if (Args.Num() > 1)
+		{
+			Config.LatencyMs = FCString::Atoi(*Args[1]);
+		}
+		if (Args.Num() > 2)
+		{
+			Config.JitterMs = FCString::Atoi(*Args[2]);
+		}
+		if (Args.Num() > 3)
+		{
+			Config.BandwidthBytesPerSecond = FCString::Atoi(*Args[3]);
+		}
+		if (Args.Num() > 4)
+		{
+			Config.Seed = FCString::Atoi64(*Args[4]);
+		}
+		if (Config.TargetPort == 0)
+		{
+			UE_LOG(SocketIOTools, Warning, TEXT("SocketIO.Impair.Start needs a target port or a running loopback server"));
+			return;
+		}
+
+		StopImpairment();
+		ImpairmentProxy = MakeUnique<FSIOImpairmentProxy>(Config);
+		if (ImpairmentProxy->Start())
+		{
+			UE_LOG(SocketIOTools, Log, TEXT("Impairment proxy on %s -> port %d"), *ImpairmentProxy->GetUrl(), Config.TargetPort);
+		}
+		else
+		{
+			ImpairmentProxy.Reset();
+		}
+	}
+
+	void StopImpairment()
+	{
+		if (ImpairmentProxy.IsValid())
+		{
+			ImpairmentProxy->Stop();
+			ImpairmentProxy.Reset();
+			UE_LOG(SocketIOTools, Log, TEXT("Impairment proxy stopped"));
+		}
+	}
+
+	TUniquePtr<FSIOLoopbackServer> LoopbackServer;
+	TUniquePtr<FSIOLoadGenerator> LoadGenerator;
+	TUniquePtr<FSIOImpairmentProxy> ImpairmentProxy;
+	TUniquePtr<FAutoConsoleCommand> StartCommand;
+	TUniquePtr<FAutoConsoleCommand> StopCommand;
+	TUniquePtr<FAutoConsoleCommand> LoadStartCommand;
+	TUniquePtr<FAutoConsoleCommand> LoadStopCommand;
+	TUniquePtr<FAutoConsoleCommand> BenchmarkCommand;
+	TUniquePtr<FAutoConsoleCommand> ImpairStartCommand;
+	TUniquePtr<FAutoConsoleCommand> ImpairStopCommand;
+};
+
+
+IMPLEMENT_MODULE(FSocketIOToolsModule, SocketIOTools)
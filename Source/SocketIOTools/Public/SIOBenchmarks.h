@@ -0,0 +1,42 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct SOCKETIOTOOLS_API FSIOBenchmarkResult
+{
+	FString Name;
+	int64 Iterations = 0;
+	double NsPerOp = 0.0;
+	double OpsPerSecond = 0.0;
+	double BytesPerSecond = 0.0;
+
+	/** Heap allocations through GMalloc on the benchmark thread */
+	double AllocsPerOp = 0.0;
+
+	/** Case specific values (compression_ratio, ns_per_byte), written like Google Benchmark user counters */
+	TMap<FString, double> Counters;
+};
+
+/**
+* Engine side benchmark suite: sio::message <-> FJsonValue conversion, USIOJConvert struct
+* conversion on nested structs, Opus encode/decode and the LZ4/Zlib attachment codecs. The protocol core (codecs, dispatch)
+* is covered by SocketIOLib/Benchmarks with Google Benchmark.
+*
+* Run from the console or headless, results go to Saved/Profiling/SocketIOBenchmarks.json
+* in Google Benchmark's JSON layout so both suites feed the same regression tooling:
+*	UnrealEditor-Cmd <Project> -ExecCmds="SocketIO.Benchmark,Quit" -unattended -nullrhi
+*/
+class SOCKETIOTOOLS_API FSIOBenchmarks
+{
+public:
+	/** Runs every case whose name contains Filter (all when empty) for about MinSecondsPerCase each */
+	static TArray<FSIOBenchmarkResult> Run(const FString& Filter = FString(), double MinSecondsPerCase = 0.5);
+
+	static FString ToJson(const TArray<FSIOBenchmarkResult>& Results);
+
+	/** Writes ToJson, empty FilePath uses Saved/Profiling/SocketIOBenchmarks.json */
+	static bool SaveJson(const TArray<FSIOBenchmarkResult>& Results, const FString& FilePath = FString());
+};
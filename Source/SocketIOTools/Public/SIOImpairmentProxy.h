@@ -0,0 +1,97 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct SOCKETIOTOOLS_API FSIOImpairmentConfig
+{
+	/** Listen port on 127.0.0.1, 0 picks a free one (see FSIOImpairmentProxy::GetPort) */
+	uint16 ListenPort = 0;
+
+	/** Where traffic is forwarded, e.g. an FSIOLoopbackServer. An IP address or localhost. */
+	FString TargetHost = TEXT("127.0.0.1");
+	uint16 TargetPort = 0;
+
+	/** One way delay added in each direction, RTT grows by twice this */
+	int32 LatencyMs = 0;
+
+	/** Uniform extra delay in [0, JitterMs] per chunk. Chunks never overtake each other, like TCP. */
+	int32 JitterMs = 0;
+
+	/** Per direction cap, 0 is unlimited */
+	int32 BandwidthBytesPerSecond = 0;
+
+	/** Mean time between stalls (exponentially distributed), 0 disables stalls */
+	int32 StallIntervalMs = 0;
+
+	/** Nothing is delivered in either direction while a stall lasts */
+	int32 StallDurationMs = 0;
+
+	/** Reset each connection (RST, no close handshake) after this long, 0 never */
+	int32 DisconnectAfterMs = 0;
+
+	/** Uniform extra lifetime in [0, DisconnectJitterMs] per connection */
+	int32 DisconnectJitterMs = 0;
+
+	/** Same seed and the same traffic give the same delays, stalls and disconnects */
+	int64 Seed = 1;
+};
+
+struct SOCKETIOTOOLS_API FSIOImpairmentStats
+{
+	int32 ActiveConnections = 0;
+	int64 Connections = 0;
+	int64 BytesUp = 0;
+	int64 BytesDown = 0;
+	int64 Stalls = 0;
+	int64 InjectedDisconnects = 0;
+
+	/** Bytes read but not yet delivered, both directions */
+	int64 BytesInFlight = 0;
+};
+
+/**
+* TCP proxy on 127.0.0.1 that impairs the traffic it forwards: latency, jitter, bandwidth caps,
+* stalls and abrupt disconnects, all drawn from a seeded generator so runs are reproducible.
+* Sits below websocket and engine.io, so client_impl sees exactly what a bad network does to it.
+*
+* Usage:
+*	FSIOLoopbackServer Server; Server.Start();
+*	FSIOImpairmentConfig Config; Config.TargetPort = Server.GetPort(); Config.LatencyMs = 100;
+*	FSIOImpairmentProxy Proxy(Config); Proxy.Start();
+*	NativeClient->Connect(Proxy.GetUrl());	//200 ms RTT to the loopback server
+*/
+class SOCKETIOTOOLS_API FSIOImpairmentProxy
+{
+public:
+	FSIOImpairmentProxy(const FSIOImpairmentConfig& InConfig = FSIOImpairmentConfig());
+	~FSIOImpairmentProxy();
+
+	/** False if the listen port can't be bound or it already runs */
+	bool Start();
+
+	/** Drops all connections and joins the proxy thread */
+	void Stop();
+
+	bool IsRunning() const;
+
+	int32 GetPort() const;
+
+	/** http://127.0.0.1:<port>, pass to Connect */
+	FString GetUrl() const;
+
+	/** Applies to connections accepted after the call */
+	void SetConfig(const FSIOImpairmentConfig& InConfig);
+
+	FSIOImpairmentConfig GetConfig() const;
+
+	FSIOImpairmentStats GetStats() const;
+
+	/** Resets every open connection now, as if the network dropped */
+	void DisconnectAll();
+
+private:
+	TUniquePtr<class FSIOImpairmentProxyImpl> Impl;
+};
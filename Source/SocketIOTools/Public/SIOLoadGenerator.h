@@ -0,0 +1,110 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SIOLoopbackServer.h"
+
+/** What each simulated client does once connected */
+enum class ESIOLoadPattern : uint8
+{
+	/** Emit at EmitRatePerSecond, latency is the time until the server echoes the event back */
+	Emit,
+
+	/** Emit with an ack callback at EmitRatePerSecond, latency is the ack round trip */
+	EmitAck,
+
+	/** Emit nothing, count what the server pushes (use with ESIOLoopbackMode::Flood) */
+	Receive
+};
+
+struct SOCKETIOTOOLS_API FSIOLoadGeneratorConfig
+{
+	/** Server to load, empty starts an FSIOLoopbackServer with LoopbackConfig */
+	FString Url;
+
+	FSIOLoopbackServerConfig LoopbackConfig;
+
+	int32 Clients = 100;
+
+	/** Connect ramp, clients per second */
+	int32 ConnectRatePerSecond = 200;
+
+	ESIOLoadPattern Pattern = ESIOLoadPattern::EmitAck;
+
+	FString Event = TEXT("load");
+
+	FString Namespace = TEXT("/");
+
+	/** Per client */
+	float EmitRatePerSecond = 10.f;
+
+	/** Payload shape: an object with PayloadFields string fields of PayloadFieldBytes each */
+	int32 PayloadFields = 1;
+	int32 PayloadFieldBytes = 64;
+
+	/** Adds a binary attachment of this size to every emit, 0 for none */
+	int32 PayloadBinaryBytes = 0;
+
+	/** Measured time after the last client connected */
+	float DurationSeconds = 10.f;
+};
+
+struct SOCKETIOTOOLS_API FSIOLoadGeneratorReport
+{
+	int32 ClientsConnected = 0;
+	int32 ClientsFailed = 0;
+	int64 Emitted = 0;
+	int64 Acked = 0;
+	int64 Received = 0;
+	double Seconds = 0.0;
+	double EmitsPerSecond = 0.0;
+	double AcksPerSecond = 0.0;
+	double ReceivedPerSecond = 0.0;
+
+	/** Round trip latency, see ESIOLoadPattern */
+	int64 LatencySamples = 0;
+	double MeanMs = 0.0;
+	double P50Ms = 0.0;
+	double P90Ms = 0.0;
+	double P99Ms = 0.0;
+	double P999Ms = 0.0;
+	double MaxMs = 0.0;
+
+	FString ToString() const;
+};
+
+/**
+* Headless load generator: many sio::client instances in one process running a scripted
+* emit/ack/receive pattern, reported as throughput and latency percentiles. Goes through the
+* unmodified client, so client_impl and packet_manager hot paths are part of what is measured.
+* Every sio::client owns a network thread, size Clients to what the machine can schedule.
+*
+* Usage:
+*	FSIOLoadGenerator Generator(Config);
+*	FSIOLoadGeneratorReport Report = Generator.Run();	//blocks for ramp + DurationSeconds
+*/
+class SOCKETIOTOOLS_API FSIOLoadGenerator
+{
+public:
+	FSIOLoadGenerator(const FSIOLoadGeneratorConfig& InConfig = FSIOLoadGeneratorConfig());
+	~FSIOLoadGenerator();
+
+	/** Starts the loopback server if needed and the driver thread, returns immediately */
+	bool Start();
+
+	/** Closes all clients, the report covers the time until now */
+	void Stop();
+
+	bool IsRunning() const;
+
+	/** Start, wait for the ramp and DurationSeconds, Stop and report */
+	FSIOLoadGeneratorReport Run();
+
+	/** Live while running, final after Stop */
+	FSIOLoadGeneratorReport GetReport() const;
+
+private:
+	TUniquePtr<class FSIOLoadGeneratorImpl> Impl;
+};
@@ -0,0 +1,114 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** What the loopback server does with events it receives */
+enum class ESIOLoopbackMode : uint8
+{
+	/** Emit every event back to its sender and answer acks with the event's arguments */
+	Echo,
+
+	/** Echo, and emit FloodEvent to every client at FloodRatePerSecond */
+	Flood,
+
+	/** Answer acks only */
+	Silent
+};
+
+struct SOCKETIOTOOLS_API FSIOLoopbackServerConfig
+{
+	/** Listen port on 127.0.0.1, 0 picks a free one (see FSIOLoopbackServer::GetPort) */
+	uint16 Port = 0;
+
+	ESIOLoopbackMode Mode = ESIOLoopbackMode::Echo;
+
+	/** Hold echoes and acks back this long, simulates server processing time */
+	int32 ReplyDelayMs = 0;
+
+	/** Engine.IO ping cadence advertised in the handshake, the server pings at this interval */
+	int32 PingIntervalMs = 25000;
+
+	int32 PingTimeoutMs = 20000;
+
+	/** Flood mode: event name, JSON argument and rate per client */
+	FString FloodEvent = TEXT("flood");
+	FString FloodPayload = TEXT("{}");
+	int32 FloodRatePerSecond = 1000;
+
+	/** Flood mode: attach a binary buffer of this size to each event, 0 sends plain events */
+	int32 FloodBinaryBytes = 0;
+
+	/** Flood mode: namespace the flood goes to */
+	FString FloodNamespace = TEXT("/");
+
+	/**
+	* Attachment codecs accepted from a client's attachmentCodecs offer, most preferred first.
+	* The chosen one is echoed in the namespace connect reply and used for flood attachments.
+	* Empty declines compression.
+	*/
+	TArray<FString> AttachmentCodecs = { TEXT("lz4"), TEXT("zlib") };
+};
+
+struct SOCKETIOTOOLS_API FSIOLoopbackServerStats
+{
+	int32 Clients = 0;
+	int64 FramesIn = 0;
+	int64 FramesOut = 0;
+	int64 BytesIn = 0;
+	int64 BytesOut = 0;
+	int64 EventsIn = 0;
+	int64 EventsOut = 0;
+	int64 AcksOut = 0;
+};
+
+/**
+* In process Socket.IO server for tests and benchmarks on machines without network or Node.
+* Listens on 127.0.0.1 and runs on its own thread. Speaks Engine.IO 4 over websocket only:
+* handshake, ping/pong, namespaces, events, acks and binary attachments, JSON wire format,
+* with the plugin's attachment codec negotiation.
+*
+* Usage:
+*	FSIOLoopbackServer Server;
+*	Server.Start();
+*	NativeClient->Connect(Server.GetUrl());
+*/
+class SOCKETIOTOOLS_API FSIOLoopbackServer
+{
+public:
+	FSIOLoopbackServer(const FSIOLoopbackServerConfig& InConfig = FSIOLoopbackServerConfig());
+	~FSIOLoopbackServer();
+
+	/** Binds and starts the server thread. False if the port can't be bound or it already runs. */
+	bool Start();
+
+	/** Closes all clients and joins the server thread */
+	void Stop();
+
+	bool IsRunning() const;
+
+	/** Bound port, valid after Start */
+	int32 GetPort() const;
+
+	/** http://127.0.0.1:<port>, pass to Connect */
+	FString GetUrl() const;
+
+	/** Takes effect for the next received event and flood tick, the port only on the next Start */
+	void SetConfig(const FSIOLoopbackServerConfig& InConfig);
+
+	FSIOLoopbackServerConfig GetConfig() const;
+
+	FSIOLoopbackServerStats GetStats() const;
+
+	/**
+	* Emit to every client connected to the namespace
+	*
+	* @param JsonArgs	JSON array of the event's arguments, e.g. [1,"two"]
+	*/
+	void Emit(const FString& Event, const FString& JsonArgs = TEXT("[]"), const FString& Namespace = TEXT("/"));
+
+private:
+	TUniquePtr<class FSIOLoopbackServerImpl> Impl;
+};
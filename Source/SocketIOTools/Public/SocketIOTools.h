@@ -0,0 +1,40 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+
+
+#pragma once
+
+#include "Runtime/Core/Public/Modules/ModuleManager.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(SocketIOTools, Log, All);
+
+
+/**
+* Developer only helpers for testing and benchmarking SocketIO without a network or Node,
+* e.g. FSIOLoopbackServer, FSIOImpairmentProxy, FSIOLoadGenerator and FSIOBenchmarks.
+* Not loaded in shipping builds.
+*/
+class SOCKETIOTOOLS_API ISocketIOToolsModule : public IModuleInterface
+{
+public:
+
+	/**
+	* Singleton - like access to this module's interface.  This is just for convenience!
+	* Beware of calling this during the shutdown phase, though.Your module might have been unloaded already.
+	*
+	* @return Returns singleton instance, loading the module on demand if needed
+	*/
+	static inline ISocketIOToolsModule& Get()
+	{
+		return FModuleManager::LoadModuleChecked< ISocketIOToolsModule >("SocketIOTools");
+	}
+
+	/**
+	* Checks to see if this module is loaded and ready.  It is only valid to call Get() if IsAvailable() returns true.
+	*
+	* @return True if the module is loaded and ready to use
+	*/
+	static inline bool IsAvailable()
+	{
+		return FModuleManager::Get().IsModuleLoaded("SocketIOTools");
+	}
+};
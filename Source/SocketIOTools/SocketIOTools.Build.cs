@@ -0,0 +1,59 @@
+// Copyright 2018-current Getnamo. All Rights Reserved
+
+
+using System.IO;
+using UnrealBuildTool;
+
+namespace UnrealBuildTool.Rules
+{
+	public class SocketIOTools : ModuleRules
+	{
+		private string ThirdPartyPath
+		{
+			get { return Path.GetFullPath(Path.Combine(ModuleDirectory, "../ThirdParty/")); }
+		}
+
+		public SocketIOTools(ReadOnlyTargetRules Target) : base(Target)
+		{
+			PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
+			bUseRTTI = true;
+			bEnableExceptions = true;
+
+			PublicIncludePaths.AddRange(
+				new string[] {
+					Path.Combine(ModuleDirectory, "Public"),
+				}
+			);
+
+
+			PrivateIncludePaths.AddRange(
+				new string[] {
+					Path.Combine(ModuleDirectory, "Private"),
+					Path.Combine(ThirdPartyPath, "websocketpp"),
+					Path.Combine(ThirdPartyPath, "asio/asio/include"),
+				}
+			);
+
+
+			PublicDependencyModuleNames.AddRange(
+				new string[]
+				{
+					"Core",
+				}
+			);
+
+
+			PrivateDependencyModuleNames.AddRange(
+				new string[]
+				{
+					"CoreUObject",
+					"Json",
+					"SIOJson",
+					"CoreUtility",
+					"SocketIOLib",
+					"SocketIOClient",
+				}
+			);
+		}
+	}
+}